@@ -307,6 +307,47 @@ hsaKmtWaitOnMultipleEvents_Ext(
     uint64_t   *event_age       //IN/OUT
     );
 
+/**
+  Creates a wait set for hsaKmtWaitOnEventWaitSet, with room for NumEvents
+  events. The set grows on demand, NumEvents may be 0.
+*/
+
+HSAKMT_STATUS
+HSAKMTAPI
+hsaKmtCreateEventWaitSet(
+    HSAuint32         NumEvents,    //IN
+    HsaEventWaitSet** WaitSet       //OUT
+    );
+
+/**
+  Destroys a wait set created by hsaKmtCreateEventWaitSet.
+*/
+
+HSAKMT_STATUS
+HSAKMTAPI
+hsaKmtDestroyEventWaitSet(
+    HsaEventWaitSet*  WaitSet       //IN
+    );
+
+/**
+  Same as hsaKmtWaitOnMultipleEvents_Ext, but keeps the kernel wait
+  arguments in WaitSet between calls. Repeated waits on the same event
+  list reuse them without allocating or rebuilding the array.
+
+  A wait set must not be used by more than one thread at a time.
+*/
+
+HSAKMT_STATUS
+HSAKMTAPI
+hsaKmtWaitOnEventWaitSet(
+    HsaEventWaitSet*  WaitSet,      //IN
+    HsaEvent*   Events[],           //IN
+    HSAuint32   NumEvents,          //IN
+    bool        WaitOnAll,          //IN
+    HSAuint32   Milliseconds,       //IN
+    uint64_t   *event_age           //IN/OUT
+    );
+
 /**
   new TEMPORARY function definition - to be used only on "Triniti + Southern Islands" platform
   If used on other platforms the function will return HSAKMT_STATUS_ERROR
@@ -573,7 +573,8 @@ typedef struct _HsaMemFlags
             unsigned int GTTAccess:     1;  // default = 0; If 1: The caller indicates this memory will be mapped to GART for MES
 					    // KFD will allocate GTT memory with the Preferred_node set as gpu_id for GART mapping
             unsigned int Contiguous:	1; // Allocate contiguous VRAM
-            unsigned int Reserved:      9;
+            unsigned int NUMAInterleave: 1; // Interleave system memory pages across all allowed NUMA nodes
+            unsigned int Reserved:      8;
 
         } ui32;
         HSAuint32 Value;
@@ -1110,6 +1111,12 @@ typedef struct _HsaEvent
     HsaEventData    EventData;
 } HsaEvent;
 
+/**
+  Opaque, caller-owned state for repeated multi-event waits.
+  See hsaKmtCreateEventWaitSet.
+*/
+typedef struct _HsaEventWaitSet HsaEventWaitSet;
+
 typedef enum _HsaEventTimeout
 {
     HSA_EVENTTIMEOUT_IMMEDIATE  = 0,
@@ -382,82 +382,215 @@ HSAKMT_STATUS HSAKMTAPI hsaKmtWaitOnMultipleEvents(HsaEvent *Events[],
 	return hsaKmtWaitOnMultipleEvents_Ext(Events, NumEvents, WaitOnAll, Milliseconds, NULL);
 }
 
+/* Caller-owned ioctl array reused across waits, see hsaKmtWaitOnEventWaitSet */
+struct _HsaEventWaitSet {
+	struct kfd_event_data *event_data;
+	HSAuint32 capacity;
+	/* Leading entries already holding an event ID from an earlier wait */
+	HSAuint32 num_valid;
+};
+
+/* Events waited on by hsaKmtWaitOnMultipleEvents_Ext without a heap allocation */
+#define WAIT_EVENTS_ON_STACK 16
+
+/* Issues the wait ioctl on a prepared event_data array, then makes a single
+ * pass over the results to return signal ages and translate exception data.
+ */
+static HSAKMT_STATUS wait_on_event_data(HsaEvent *Events[],
+					struct kfd_event_data *event_data,
+					HSAuint32 NumEvents,
+					bool WaitOnAll,
+					HSAuint32 Milliseconds,
+					uint64_t *event_age)
+{
+	HSAKMT_STATUS result;
+	bool translate;
+	struct kfd_ioctl_wait_events_args args = {0};
+
+	args.wait_for_all = WaitOnAll;
+	args.timeout = Milliseconds;
+	args.num_events = NumEvents;
+	args.events_ptr = (uint64_t)(uintptr_t)event_data;
+
+	if (hsakmt_ioctl(hsakmt_kfd_fd, AMDKFD_IOC_WAIT_EVENTS, &args) == -1)
+		result = HSAKMT_STATUS_ERROR;
+	else if (args.wait_result == KFD_IOC_WAIT_RESULT_TIMEOUT)
+		result = HSAKMT_STATUS_WAIT_TIMEOUT;
+	else
+		result = HSAKMT_STATUS_SUCCESS;
+
+	/* Ages are returned whatever the outcome, exception data only on success
+	 * and up to the first event whose GPU can't be translated to a node.
+	 */
+	translate = (result == HSAKMT_STATUS_SUCCESS);
+	for (HSAuint32 i = 0; i < NumEvents; i++) {
+		if (Events[i]->EventData.EventType == HSA_EVENTTYPE_SIGNAL) {
+			if (event_age)
+				event_age[i] = event_data[i].signal_event_data.last_event_age;
+		} else if (!translate) {
+			continue;
+		} else if (Events[i]->EventData.EventType == HSA_EVENTTYPE_MEMORY &&
+			   event_data[i].memory_exception_data.gpu_id) {
+			Events[i]->EventData.EventData.MemoryAccessFault.VirtualAddress = event_data[i].memory_exception_data.va;
+			result = hsakmt_gpuid_to_nodeid(event_data[i].memory_exception_data.gpu_id, &Events[i]->EventData.EventData.MemoryAccessFault.NodeId);
+			if (result != HSAKMT_STATUS_SUCCESS) {
+				translate = false;
+				continue;
+			}
+			Events[i]->EventData.EventData.MemoryAccessFault.Failure.NotPresent = event_data[i].memory_exception_data.failure.NotPresent;
+			Events[i]->EventData.EventData.MemoryAccessFault.Failure.ReadOnly = event_data[i].memory_exception_data.failure.ReadOnly;
+			Events[i]->EventData.EventData.MemoryAccessFault.Failure.NoExecute = event_data[i].memory_exception_data.failure.NoExecute;
+			Events[i]->EventData.EventData.MemoryAccessFault.Failure.Imprecise = event_data[i].memory_exception_data.failure.imprecise;
+			Events[i]->EventData.EventData.MemoryAccessFault.Failure.ErrorType = event_data[i].memory_exception_data.ErrorType;
+			Events[i]->EventData.EventData.MemoryAccessFault.Failure.ECC =
+					((event_data[i].memory_exception_data.ErrorType == 1) || (event_data[i].memory_exception_data.ErrorType == 2)) ? 1 : 0;
+			Events[i]->EventData.EventData.MemoryAccessFault.Flags = HSA_EVENTID_MEMORY_FATAL_PROCESS;
+			analysis_memory_exception(&event_data[i].memory_exception_data);
+		} else if (Events[i]->EventData.EventType == HSA_EVENTTYPE_HW_EXCEPTION &&
+			   event_data[i].hw_exception_data.gpu_id) {
+			result = hsakmt_gpuid_to_nodeid(event_data[i].hw_exception_data.gpu_id, &Events[i]->EventData.EventData.HwException.NodeId);
+			if (result != HSAKMT_STATUS_SUCCESS) {
+				translate = false;
+				continue;
+			}
+			Events[i]->EventData.EventData.HwException.ResetType = event_data[i].hw_exception_data.reset_type;
+			Events[i]->EventData.EventData.HwException.ResetCause = event_data[i].hw_exception_data.reset_cause;
+			Events[i]->EventData.EventData.HwException.MemoryLost = event_data[i].hw_exception_data.memory_lost;
+		}
+	}
+
+	return result;
+}
+
 HSAKMT_STATUS HSAKMTAPI hsaKmtWaitOnMultipleEvents_Ext(HsaEvent *Events[],
 						   HSAuint32 NumEvents,
 						   bool WaitOnAll,
 						   HSAuint32 Milliseconds,
 						   uint64_t *event_age)
 {
-        HSAKMT_STATUS result;
-        CHECK_KFD_OPEN();
+	HSAKMT_STATUS result;
+	struct kfd_event_data stack_data[WAIT_EVENTS_ON_STACK];
+	struct kfd_event_data *event_data = stack_data;
+
+	CHECK_KFD_OPEN();
 
-        if (!Events)
+	if (!Events)
 		return HSAKMT_STATUS_INVALID_HANDLE;
 
-        struct kfd_event_data *event_data =
-        calloc(NumEvents, sizeof(struct kfd_event_data));
-        if (!event_data) {
-		return HSAKMT_STATUS_NO_MEMORY;
+	if (NumEvents > WAIT_EVENTS_ON_STACK) {
+		event_data = calloc(NumEvents, sizeof(struct kfd_event_data));
+		if (!event_data)
+			return HSAKMT_STATUS_NO_MEMORY;
+	} else {
+		memset(stack_data, 0, NumEvents * sizeof(struct kfd_event_data));
 	}
-        for (HSAuint32 i = 0; i < NumEvents; i++) {
+
+	for (HSAuint32 i = 0; i < NumEvents; i++) {
 		event_data[i].event_id = Events[i]->EventId;
-		event_data[i].kfd_event_data_ext = (uint64_t)(uintptr_t)NULL;
 		if (event_age && Events[i]->EventData.EventType == HSA_EVENTTYPE_SIGNAL)
 			event_data[i].signal_event_data.last_event_age = event_age[i];
 	}
 
-        struct kfd_ioctl_wait_events_args args = {0};
+	result = wait_on_event_data(Events, event_data, NumEvents, WaitOnAll,
+				    Milliseconds, event_age);
 
-	args.wait_for_all = WaitOnAll;
-	args.timeout = Milliseconds;
-	args.num_events = NumEvents;
-	args.events_ptr = (uint64_t)(uintptr_t)event_data;
+	if (event_data != stack_data)
+		free(event_data);
 
-	if (hsakmt_ioctl(hsakmt_kfd_fd, AMDKFD_IOC_WAIT_EVENTS, &args) == -1)
-		result = HSAKMT_STATUS_ERROR;
-	else if (args.wait_result == KFD_IOC_WAIT_RESULT_TIMEOUT)
-		result = HSAKMT_STATUS_WAIT_TIMEOUT;
-	else {
-		result = HSAKMT_STATUS_SUCCESS;
-		for (HSAuint32 i = 0; i < NumEvents; i++) {
-			if (Events[i]->EventData.EventType == HSA_EVENTTYPE_MEMORY &&
-			    event_data[i].memory_exception_data.gpu_id) {
-				Events[i]->EventData.EventData.MemoryAccessFault.VirtualAddress = event_data[i].memory_exception_data.va;
-				result = hsakmt_gpuid_to_nodeid(event_data[i].memory_exception_data.gpu_id, &Events[i]->EventData.EventData.MemoryAccessFault.NodeId);
-				if (result != HSAKMT_STATUS_SUCCESS)
-					goto out;
-				Events[i]->EventData.EventData.MemoryAccessFault.Failure.NotPresent = event_data[i].memory_exception_data.failure.NotPresent;
-				Events[i]->EventData.EventData.MemoryAccessFault.Failure.ReadOnly = event_data[i].memory_exception_data.failure.ReadOnly;
-				Events[i]->EventData.EventData.MemoryAccessFault.Failure.NoExecute = event_data[i].memory_exception_data.failure.NoExecute;
-				Events[i]->EventData.EventData.MemoryAccessFault.Failure.Imprecise = event_data[i].memory_exception_data.failure.imprecise;
-				Events[i]->EventData.EventData.MemoryAccessFault.Failure.ErrorType = event_data[i].memory_exception_data.ErrorType;
-				Events[i]->EventData.EventData.MemoryAccessFault.Failure.ECC =
-						((event_data[i].memory_exception_data.ErrorType == 1) || (event_data[i].memory_exception_data.ErrorType == 2)) ? 1 : 0;
-				Events[i]->EventData.EventData.MemoryAccessFault.Flags = HSA_EVENTID_MEMORY_FATAL_PROCESS;
-				analysis_memory_exception(&event_data[i].memory_exception_data);
-			} else if (Events[i]->EventData.EventType == HSA_EVENTTYPE_HW_EXCEPTION &&
-				event_data[i].hw_exception_data.gpu_id) {
-
-				result = hsakmt_gpuid_to_nodeid(event_data[i].hw_exception_data.gpu_id, &Events[i]->EventData.EventData.HwException.NodeId);
-				if (result != HSAKMT_STATUS_SUCCESS)
-					goto out;
-
-				Events[i]->EventData.EventData.HwException.ResetType = event_data[i].hw_exception_data.reset_type;
-				Events[i]->EventData.EventData.HwException.ResetCause = event_data[i].hw_exception_data.reset_cause;
-				Events[i]->EventData.EventData.HwException.MemoryLost = event_data[i].hw_exception_data.memory_lost;
-			}
+	return result;
+}
+
+HSAKMT_STATUS HSAKMTAPI hsaKmtCreateEventWaitSet(HSAuint32 NumEvents,
+						 HsaEventWaitSet **WaitSet)
+{
+	HsaEventWaitSet *ws;
+
+	CHECK_KFD_OPEN();
+
+	if (!WaitSet)
+		return HSAKMT_STATUS_INVALID_PARAMETER;
+
+	ws = calloc(1, sizeof(*ws));
+	if (!ws)
+		return HSAKMT_STATUS_NO_MEMORY;
+
+	if (NumEvents) {
+		ws->event_data = calloc(NumEvents, sizeof(struct kfd_event_data));
+		if (!ws->event_data) {
+			free(ws);
+			return HSAKMT_STATUS_NO_MEMORY;
 		}
+		ws->capacity = NumEvents;
 	}
-out:
 
-	for (HSAuint32 i = 0; i < NumEvents; i++) {
-		if (event_age && Events[i]->EventData.EventType == HSA_EVENTTYPE_SIGNAL)
-			event_age[i] = event_data[i].signal_event_data.last_event_age;
+	*WaitSet = ws;
+	return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS HSAKMTAPI hsaKmtDestroyEventWaitSet(HsaEventWaitSet *WaitSet)
+{
+	if (!WaitSet)
+		return HSAKMT_STATUS_INVALID_HANDLE;
+
+	free(WaitSet->event_data);
+	free(WaitSet);
+	return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS HSAKMTAPI hsaKmtWaitOnEventWaitSet(HsaEventWaitSet *WaitSet,
+						 HsaEvent *Events[],
+						 HSAuint32 NumEvents,
+						 bool WaitOnAll,
+						 HSAuint32 Milliseconds,
+						 uint64_t *event_age)
+{
+	struct kfd_event_data *event_data;
+
+	CHECK_KFD_OPEN();
+
+	if (!WaitSet || !Events)
+		return HSAKMT_STATUS_INVALID_HANDLE;
+
+	if (NumEvents > WaitSet->capacity) {
+		/* Grow geometrically so slowly growing lists don't realloc every wait */
+		HSAuint32 capacity = WaitSet->capacity ? WaitSet->capacity : 1;
+
+		while (capacity < NumEvents)
+			capacity *= 2;
+		event_data = realloc(WaitSet->event_data,
+				     capacity * sizeof(struct kfd_event_data));
+		if (!event_data)
+			return HSAKMT_STATUS_NO_MEMORY;
+		WaitSet->event_data = event_data;
+		WaitSet->capacity = capacity;
 	}
+	event_data = WaitSet->event_data;
 
-	free(event_data);
+	/* Entries still hold the IDs KFD saw on the previous wait, so repeated
+	 * waits on the same list only refresh ages instead of rebuilding the array.
+	 */
+	for (HSAuint32 i = 0; i < NumEvents; i++) {
+		struct kfd_event_data *data = &event_data[i];
 
-	return result;
+		if (i >= WaitSet->num_valid || data->event_id != Events[i]->EventId) {
+			memset(data, 0, sizeof(*data));
+			data->event_id = Events[i]->EventId;
+		}
+
+		if (Events[i]->EventData.EventType == HSA_EVENTTYPE_SIGNAL) {
+			data->signal_event_data.last_event_age = event_age ? event_age[i] : 0;
+		} else if (data->memory_exception_data.gpu_id ||
+			   data->hw_exception_data.gpu_id) {
+			/* KFD only writes exception data on a fault, drop the stale report */
+			memset(&data->memory_exception_data, 0,
+			       sizeof(data->memory_exception_data));
+		}
+	}
+	if (NumEvents > WaitSet->num_valid)
+		WaitSet->num_valid = NumEvents;
+
+	return wait_on_event_data(Events, event_data, NumEvents, WaitOnAll,
+				  Milliseconds, event_age);
 }
 
 HSAKMT_STATUS HSAKMTAPI hsaKmtOpenSMI(HSAuint32 NodeId, int *fd)
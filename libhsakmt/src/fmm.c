@@ -206,6 +206,16 @@ enum svm_aperture_type {
 	SVM_APERTURE_NUM
 };
 
+/* Placement of paged system memory not given an explicit policy by its
+ * allocation flags, selected by HSA_HOST_NUMA_POLICY
+ */
+enum numa_host_policy {
+	NUMA_HOST_POLICY_PREFERRED,	/* nearest node, fall back when full */
+	NUMA_HOST_POLICY_BIND,		/* nearest node only */
+	NUMA_HOST_POLICY_INTERLEAVE,	/* round robin over allowed nodes */
+	NUMA_HOST_POLICY_LOCAL,		/* no mbind, first touch decides */
+};
+
 /* The main structure for dGPU Shared Virtual Memory Management */
 typedef struct {
 	/* Two apertures can have different MTypes (for coherency) */
@@ -229,6 +239,12 @@ typedef struct {
 	/* whether all memory is coherent (GPU cache disabled) */
 	bool disable_cache;
 
+	/* default NUMA placement of paged system memory */
+	enum numa_host_policy numa_policy;
+
+	/* whether to verify NUMA policies with get_mempolicy after mbind */
+	bool check_numa_policy;
+
 	/* specifies the alignment size as PAGE_SIZE * 2^alignment_order */
 	uint32_t alignment_order;
 } svm_t;
@@ -251,6 +267,8 @@ static svm_t svm = {
 	.userptr_for_paged_mem = false,
 	.check_userptr = false,
 	.disable_cache = false,
+	.numa_policy = NUMA_HOST_POLICY_PREFERRED,
+	.check_numa_policy = false,
 };
 
 /* On APU, for memory allocated on the system memory that GPU doesn't access
@@ -1699,9 +1717,33 @@ static void *fmm_allocate_host_cpu(void *address, uint64_t MemorySizeInBytes,
 	return mem;
 }
 
+/* Reads back the policy of mem and warns if it differs from what was set */
+static void check_mem_numa_policy(void *mem, int mode, struct bitmask *node_mask)
+{
+	struct bitmask *actual_mask;
+	int actual_mode;
+
+	actual_mask = numa_allocate_nodemask();
+	if (!actual_mask)
+		return;
+
+	if (get_mempolicy(&actual_mode, actual_mask->maskp, actual_mask->size,
+			  mem, MPOL_F_ADDR)) {
+		pr_warn_once("get_mempolicy failed for %p: %s\n", mem,
+			     strerror(errno));
+	} else if ((actual_mode & ~MPOL_F_STATIC_NODES) != (mode & ~MPOL_F_STATIC_NODES) ||
+		   !numa_bitmask_equal(actual_mask, node_mask)) {
+		pr_warn("NUMA policy of %p is mode %d, expected mode %d\n", mem,
+			actual_mode & ~MPOL_F_STATIC_NODES, mode & ~MPOL_F_STATIC_NODES);
+	}
+
+	numa_bitmask_free(actual_mask);
+}
+
 static int bind_mem_to_numa(uint32_t node_id, void *mem,
 			    uint64_t SizeInBytes, HsaMemFlags mflags)
 {
+	enum numa_host_policy policy = svm.numa_policy;
 	int mode = MPOL_F_STATIC_NODES;
 	struct bitmask *node_mask;
 	int num_node;
@@ -1710,7 +1752,15 @@ static int bind_mem_to_numa(uint32_t node_id, void *mem,
 	pr_debug("%s mem %p flags 0x%x size 0x%lx node_id %d\n", __func__,
 		mem, mflags.Value, SizeInBytes, node_id);
 
+	/* Allocation flags override the process default */
 	if (mflags.ui32.NoNUMABind)
+		policy = NUMA_HOST_POLICY_LOCAL;
+	else if (mflags.ui32.NUMAInterleave)
+		policy = NUMA_HOST_POLICY_INTERLEAVE;
+	else if (mflags.ui32.NoSubstitute)
+		policy = NUMA_HOST_POLICY_BIND;
+
+	if (policy == NUMA_HOST_POLICY_LOCAL)
 		return 0;
 
 	if (numa_available() == -1)
@@ -1719,7 +1769,7 @@ static int bind_mem_to_numa(uint32_t node_id, void *mem,
 	num_node = numa_max_node() + 1;
 
 	/* Ignore binding requests to invalid nodes IDs */
-	if (node_id >= (unsigned)num_node) {
+	if (policy != NUMA_HOST_POLICY_INTERLEAVE && node_id >= (unsigned)num_node) {
 		pr_warn("node_id %d >= num_node %d\n", node_id, num_node);
 		return 0;
 	}
@@ -1727,17 +1777,27 @@ static int bind_mem_to_numa(uint32_t node_id, void *mem,
 	if (num_node <= 1)
 		return 0;
 
-	node_mask = numa_bitmask_alloc(num_node);
-	if (!node_mask)
-		return -ENOMEM;
+	if (policy == NUMA_HOST_POLICY_INTERLEAVE) {
+		node_mask = numa_get_mems_allowed();
+		if (!node_mask)
+			return -ENOMEM;
+		mode |= MPOL_INTERLEAVE;
+	} else {
+		node_mask = numa_bitmask_alloc(num_node);
+		if (!node_mask)
+			return -ENOMEM;
 
 #ifdef __PPC64__
-	numa_bitmask_setbit(node_mask, node_id * 8);
+		numa_bitmask_setbit(node_mask, node_id * 8);
 #else
-	numa_bitmask_setbit(node_mask, node_id);
+		numa_bitmask_setbit(node_mask, node_id);
 #endif
-	mode |= mflags.ui32.NoSubstitute ? MPOL_BIND : MPOL_PREFERRED;
-	r = mbind(mem, SizeInBytes, mode, node_mask->maskp, num_node + 1, 0);
+		mode |= (policy == NUMA_HOST_POLICY_BIND) ? MPOL_BIND : MPOL_PREFERRED;
+	}
+
+	r = mbind(mem, SizeInBytes, mode, node_mask->maskp, node_mask->size + 1, 0);
+	if (!r && svm.check_numa_policy)
+		check_mem_numa_policy(mem, mode, node_mask);
 	numa_bitmask_free(node_mask);
 
 	if (r) {
@@ -2499,7 +2559,7 @@ HSAKMT_STATUS hsakmt_fmm_init_process_apertures(unsigned int NumNodes)
 	uint32_t num_of_sysfs_nodes;
 	HSAKMT_STATUS ret = HSAKMT_STATUS_SUCCESS;
 	char *disableCache, *pagedUserptr, *checkUserptr, *guardPagesStr, *reserveSvm;
-	char *maxVaAlignStr;
+	char *maxVaAlignStr, *numaPolicy, *checkNumaPolicy;
 	unsigned int guardPages = 1;
 	uint64_t svm_base = 0, svm_limit = 0;
 	uint32_t svm_alignment = 0;
@@ -2520,6 +2580,30 @@ HSAKMT_STATUS hsakmt_fmm_init_process_apertures(unsigned int NumNodes)
 	checkUserptr = getenv("HSA_CHECK_USERPTR");
 	svm.check_userptr = (checkUserptr && strcmp(checkUserptr, "0"));
 
+	/* HSA_HOST_NUMA_POLICY selects where paged system memory is placed
+	 * unless its allocation flags ask for a policy: "preferred" (default)
+	 * nearest node with fallback, "bind" nearest node only, "interleave"
+	 * across allowed nodes or "local" to leave it to first touch.
+	 */
+	numaPolicy = getenv("HSA_HOST_NUMA_POLICY");
+	svm.numa_policy = NUMA_HOST_POLICY_PREFERRED;
+	if (numaPolicy) {
+		if (!strcmp(numaPolicy, "bind"))
+			svm.numa_policy = NUMA_HOST_POLICY_BIND;
+		else if (!strcmp(numaPolicy, "interleave"))
+			svm.numa_policy = NUMA_HOST_POLICY_INTERLEAVE;
+		else if (!strcmp(numaPolicy, "local"))
+			svm.numa_policy = NUMA_HOST_POLICY_LOCAL;
+		else if (strcmp(numaPolicy, "preferred"))
+			pr_warn("Unknown HSA_HOST_NUMA_POLICY %s\n", numaPolicy);
+	}
+
+	/* If HSA_CHECK_NUMA_POLICY is set to a non-0 value, read back the
+	 * policy of each bound allocation
+	 */
+	checkNumaPolicy = getenv("HSA_CHECK_NUMA_POLICY");
+	svm.check_numa_policy = (checkNumaPolicy && strcmp(checkNumaPolicy, "0"));
+
 	/* If HSA_RESERVE_SVM is set to a non-0 value,
 	 * enable packet capture and replay mode.
 	 */
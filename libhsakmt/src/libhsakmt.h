@@ -211,6 +211,7 @@ void* hsakmt_allocate_exec_aligned_memory_gpu(uint32_t size, uint32_t align,
 void hsakmt_free_exec_aligned_memory_gpu(void *addr, uint32_t size, uint32_t align);
 HSAKMT_STATUS hsakmt_init_process_doorbells(unsigned int NumNodes);
 void hsakmt_destroy_process_doorbells(void);
+HSAKMT_STATUS hsakmt_init_queue_buffer_pools(unsigned int NumNodes);
 HSAKMT_STATUS hsakmt_init_device_debugging_memory(unsigned int NumNodes);
 void hsakmt_destroy_device_debugging_memory(void);
 bool hsakmt_debug_get_reg_status(uint32_t node_id);
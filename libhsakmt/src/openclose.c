@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <strings.h>
 #include "fmm.h"
+#include "queue_buffer_pool.h"
 #include <dlfcn.h>
 #include <string.h>
 
@@ -100,6 +101,7 @@ static void child_fork_handler(void)
 static void clear_after_fork(void)
 {
 	hsakmt_clear_process_doorbells();
+	hsakmt_clear_queue_buffer_pools();
 	hsakmt_clear_events_page();
 	hsakmt_fmm_clear_all_mem();
 	hsakmt_destroy_device_debugging_memory();
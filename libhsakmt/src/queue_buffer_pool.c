@@ -0,0 +1,366 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including
+ * the next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "queue_buffer_pool.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct queue_buffer {
+	struct queue_buffer *next;
+	void *addr;
+	uint32_t size;
+	enum queue_buffer_kind kind;
+	bool use_ats;
+	uint64_t idle_since;
+};
+
+struct queue_buffer_pool {
+	/* Most recently released first */
+	struct queue_buffer *free_list;
+	uint64_t cached_bytes;
+	pthread_mutex_t mutex;
+};
+
+static unsigned int num_queue_buffer_pools;
+static struct queue_buffer_pool *queue_buffer_pools;
+static uint64_t queue_buffer_pool_limit;
+static uint64_t queue_buffer_idle_ns;
+static queue_buffer_free_fn queue_buffer_free_memory;
+
+/* The reaper thread frees idle entries so that buffers left behind by the
+ * last queue of a burst don't stay resident until the next queue is created
+ * or destroyed. It is started by the first put and sleeps while the pools
+ * are empty.
+ */
+static pthread_mutex_t reaper_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reaper_cond;
+static pthread_t reaper_thread;
+static bool reaper_started;
+static bool reaper_pending;
+static bool reaper_stop;
+
+static uint64_t queue_buffer_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void queue_buffer_free_list(struct queue_buffer *list)
+{
+	struct queue_buffer *next;
+
+	for (; list; list = next) {
+		next = list->next;
+		queue_buffer_free_memory(list->kind, list->addr, list->size,
+					 list->use_ats);
+		free(list);
+	}
+}
+
+/* Moves entries idle too long, or beyond the pool limit, to *evicted and
+ * returns when the oldest kept entry will expire, or UINT64_MAX if none is
+ * kept. Called with pool->mutex held.
+ */
+static uint64_t queue_buffer_pool_trim(struct queue_buffer_pool *pool,
+				       uint64_t now,
+				       struct queue_buffer **evicted)
+{
+	uint64_t kept = 0, expires = UINT64_MAX;
+	struct queue_buffer **link = &pool->free_list;
+
+	while (*link) {
+		struct queue_buffer *buf = *link;
+
+		if (kept + buf->size > queue_buffer_pool_limit ||
+		    buf->idle_since + queue_buffer_idle_ns <= now) {
+			*link = buf->next;
+			pool->cached_bytes -= buf->size;
+			buf->next = *evicted;
+			*evicted = buf;
+			continue;
+		}
+		kept += buf->size;
+		/* The list is ordered newest first */
+		expires = buf->idle_since + queue_buffer_idle_ns;
+		link = &buf->next;
+	}
+
+	return expires;
+}
+
+/* Trims every pool and returns the earliest expiry of the remaining entries */
+static uint64_t queue_buffer_pools_trim(void)
+{
+	uint64_t now = queue_buffer_now();
+	uint64_t next = UINT64_MAX, expires;
+	struct queue_buffer *evicted = NULL;
+	unsigned int i;
+
+	for (i = 0; i < num_queue_buffer_pools; i++) {
+		pthread_mutex_lock(&queue_buffer_pools[i].mutex);
+		expires = queue_buffer_pool_trim(&queue_buffer_pools[i], now,
+						 &evicted);
+		pthread_mutex_unlock(&queue_buffer_pools[i].mutex);
+		if (expires < next)
+			next = expires;
+	}
+
+	queue_buffer_free_list(evicted);
+	return next;
+}
+
+static void *queue_buffer_reaper(void *arg)
+{
+	uint64_t next;
+	struct timespec ts;
+
+	(void)arg;
+
+	pthread_mutex_lock(&reaper_lock);
+	while (!reaper_stop) {
+		reaper_pending = false;
+		pthread_mutex_unlock(&reaper_lock);
+
+		next = queue_buffer_pools_trim();
+
+		pthread_mutex_lock(&reaper_lock);
+		if (reaper_stop || reaper_pending)
+			continue;
+
+		if (next == UINT64_MAX) {
+			pthread_cond_wait(&reaper_cond, &reaper_lock);
+		} else {
+			ts.tv_sec = next / 1000000000ULL;
+			ts.tv_nsec = next % 1000000000ULL;
+			pthread_cond_timedwait(&reaper_cond, &reaper_lock, &ts);
+		}
+	}
+	pthread_mutex_unlock(&reaper_lock);
+
+	return NULL;
+}
+
+/* Wakes the reaper so it picks up a newly released buffer, starting it on
+ * first use.
+ */
+static void queue_buffer_reaper_kick(void)
+{
+	pthread_condattr_t attr;
+	sigset_t all, old;
+	int ret;
+
+	pthread_mutex_lock(&reaper_lock);
+	if (!reaper_started && !reaper_stop) {
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&reaper_cond, &attr);
+		pthread_condattr_destroy(&attr);
+
+		/* Keep the application's signals off the reaper */
+		sigfillset(&all);
+		pthread_sigmask(SIG_SETMASK, &all, &old);
+		ret = pthread_create(&reaper_thread, NULL, queue_buffer_reaper,
+				     NULL);
+		pthread_sigmask(SIG_SETMASK, &old, NULL);
+		if (ret) {
+			/* Entries are still trimmed on get and put */
+			pthread_cond_destroy(&reaper_cond);
+			pthread_mutex_unlock(&reaper_lock);
+			return;
+		}
+		reaper_started = true;
+	}
+	reaper_pending = true;
+	if (reaper_started)
+		pthread_cond_signal(&reaper_cond);
+	pthread_mutex_unlock(&reaper_lock);
+}
+
+void *hsakmt_queue_buffer_get(uint32_t NodeId, enum queue_buffer_kind kind,
+			      uint32_t size, bool use_ats)
+{
+	struct queue_buffer_pool *pool;
+	struct queue_buffer *buf, **link, *evicted = NULL;
+	void *addr = NULL;
+
+	if (NodeId >= num_queue_buffer_pools)
+		return NULL;
+	pool = &queue_buffer_pools[NodeId];
+
+	pthread_mutex_lock(&pool->mutex);
+	queue_buffer_pool_trim(pool, queue_buffer_now(), &evicted);
+	for (link = &pool->free_list; *link; link = &(*link)->next) {
+		buf = *link;
+		if (buf->kind != kind || buf->size != size ||
+		    buf->use_ats != use_ats)
+			continue;
+
+		*link = buf->next;
+		pool->cached_bytes -= buf->size;
+		addr = buf->addr;
+		free(buf);
+		break;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	queue_buffer_free_list(evicted);
+	return addr;
+}
+
+void hsakmt_queue_buffer_put(uint32_t NodeId, enum queue_buffer_kind kind,
+			     void *addr, uint32_t size, bool use_ats)
+{
+	struct queue_buffer_pool *pool;
+	struct queue_buffer *buf, *evicted = NULL;
+
+	if (NodeId >= num_queue_buffer_pools || size > queue_buffer_pool_limit)
+		goto free_now;
+
+	buf = malloc(sizeof(*buf));
+	if (!buf)
+		goto free_now;
+
+	buf->addr = addr;
+	buf->size = size;
+	buf->kind = kind;
+	buf->use_ats = use_ats;
+	buf->idle_since = queue_buffer_now();
+
+	pool = &queue_buffer_pools[NodeId];
+	pthread_mutex_lock(&pool->mutex);
+	buf->next = pool->free_list;
+	pool->free_list = buf;
+	pool->cached_bytes += size;
+	queue_buffer_pool_trim(pool, buf->idle_since, &evicted);
+	pthread_mutex_unlock(&pool->mutex);
+
+	queue_buffer_free_list(evicted);
+	queue_buffer_reaper_kick();
+	return;
+
+free_now:
+	queue_buffer_free_memory(kind, addr, size, use_ats);
+}
+
+uint64_t hsakmt_queue_buffer_cached_bytes(uint32_t NodeId)
+{
+	uint64_t bytes;
+
+	if (NodeId >= num_queue_buffer_pools)
+		return 0;
+
+	pthread_mutex_lock(&queue_buffer_pools[NodeId].mutex);
+	bytes = queue_buffer_pools[NodeId].cached_bytes;
+	pthread_mutex_unlock(&queue_buffer_pools[NodeId].mutex);
+
+	return bytes;
+}
+
+HSAKMT_STATUS hsakmt_queue_buffer_pools_init(unsigned int NumNodes,
+					     uint64_t limit, uint64_t idle_ns,
+					     queue_buffer_free_fn free_memory)
+{
+	unsigned int i;
+
+	if (!limit || !NumNodes)
+		return HSAKMT_STATUS_SUCCESS;
+
+	queue_buffer_pools = calloc(NumNodes, sizeof(*queue_buffer_pools));
+	if (!queue_buffer_pools)
+		return HSAKMT_STATUS_NO_MEMORY;
+
+	for (i = 0; i < NumNodes; i++)
+		pthread_mutex_init(&queue_buffer_pools[i].mutex, NULL);
+
+	queue_buffer_pool_limit = limit;
+	queue_buffer_idle_ns = idle_ns;
+	queue_buffer_free_memory = free_memory;
+	num_queue_buffer_pools = NumNodes;
+
+	pthread_mutex_lock(&reaper_lock);
+	reaper_stop = false;
+	pthread_mutex_unlock(&reaper_lock);
+
+	return HSAKMT_STATUS_SUCCESS;
+}
+
+void hsakmt_destroy_queue_buffer_pools(void)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&reaper_lock);
+	reaper_stop = true;
+	if (reaper_started)
+		pthread_cond_signal(&reaper_cond);
+	pthread_mutex_unlock(&reaper_lock);
+
+	if (reaper_started) {
+		pthread_join(reaper_thread, NULL);
+		pthread_cond_destroy(&reaper_cond);
+		reaper_started = false;
+	}
+
+	for (i = 0; i < num_queue_buffer_pools; i++) {
+		queue_buffer_free_list(queue_buffer_pools[i].free_list);
+		pthread_mutex_destroy(&queue_buffer_pools[i].mutex);
+	}
+
+	free(queue_buffer_pools);
+	queue_buffer_pools = NULL;
+	num_queue_buffer_pools = 0;
+}
+
+/* Called only from the child process after a fork(). GPU mappings are
+ * cleared with the rest of the FMM state and unified CWSR areas are
+ * MADV_DONTFORK, so only the bookkeeping is dropped. The reaper thread
+ * doesn't exist in the child; its state is reset so the next put starts
+ * a new one.
+ */
+void hsakmt_clear_queue_buffer_pools(void)
+{
+	unsigned int i;
+	struct queue_buffer *buf, *next;
+
+	for (i = 0; i < num_queue_buffer_pools; i++) {
+		for (buf = queue_buffer_pools[i].free_list; buf; buf = next) {
+			next = buf->next;
+			free(buf);
+		}
+		pthread_mutex_init(&queue_buffer_pools[i].mutex, NULL);
+	}
+
+	free(queue_buffer_pools);
+	queue_buffer_pools = NULL;
+	num_queue_buffer_pools = 0;
+
+	pthread_mutex_init(&reaper_lock, NULL);
+	reaper_started = false;
+	reaper_pending = false;
+	reaper_stop = false;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including
+ * the next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef QUEUE_BUFFER_POOL_H_
+#define QUEUE_BUFFER_POOL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hsakmt/hsakmttypes.h"
+
+/* EOP and context save/restore buffers of destroyed queues are kept per node
+ * for reuse by the next queue needing the same kind and size.
+ */
+enum queue_buffer_kind {
+	QUEUE_BUFFER_EOP,
+	QUEUE_BUFFER_CWSR,
+	QUEUE_BUFFER_CWSR_UNIFIED,
+};
+
+/* Releases a buffer evicted from a pool */
+typedef void (*queue_buffer_free_fn)(enum queue_buffer_kind kind, void *addr,
+				     uint32_t size, bool use_ats);
+
+/* Creates one pool per node. Each pool caches at most limit bytes, and a
+ * background thread frees entries idle for longer than idle_ns. A limit of 0
+ * disables pooling.
+ */
+HSAKMT_STATUS hsakmt_queue_buffer_pools_init(unsigned int NumNodes,
+					     uint64_t limit, uint64_t idle_ns,
+					     queue_buffer_free_fn free_memory);
+
+/* Returns a pooled buffer of the given kind and size on NodeId, or NULL */
+void *hsakmt_queue_buffer_get(uint32_t NodeId, enum queue_buffer_kind kind,
+			      uint32_t size, bool use_ats);
+
+/* Returns a queue buffer to NodeId's pool, freeing it if it doesn't fit */
+void hsakmt_queue_buffer_put(uint32_t NodeId, enum queue_buffer_kind kind,
+			     void *addr, uint32_t size, bool use_ats);
+
+/* Bytes currently cached for NodeId */
+uint64_t hsakmt_queue_buffer_cached_bytes(uint32_t NodeId);
+
+void hsakmt_destroy_queue_buffer_pools(void);
+void hsakmt_clear_queue_buffer_pools(void);
+
+#endif /* QUEUE_BUFFER_POOL_H_ */
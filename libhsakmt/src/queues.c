@@ -25,6 +25,7 @@
 
 #include "libhsakmt.h"
 #include "fmm.h"
+#include "queue_buffer_pool.h"
 #include "hsakmt/linux/kfd_ioctl.h"
 #include <stdlib.h>
 #include <string.h>
@@ -54,6 +55,7 @@
 
 struct queue {
 	uint32_t queue_id;
+	uint32_t node_id;
 	uint64_t wptr;
 	uint64_t rptr;
 	void *eop_buffer;
@@ -84,6 +86,14 @@ struct process_doorbells {
 static unsigned int num_doorbells;
 static struct process_doorbells *doorbells;
 
+/* Bytes of queue buffers cached per node for reuse. 64MB holds the CWSR and
+ * EOP buffers of a couple of queues on the largest parts, enough for
+ * create/destroy loops, and idle entries are freed after
+ * QUEUE_BUFFER_IDLE_NS so the cache doesn't stay resident.
+ */
+#define QUEUE_BUFFER_POOL_DEFAULT_SIZE	(64ULL << 20)
+#define QUEUE_BUFFER_IDLE_NS		(2ULL * 1000000000ULL)
+
 uint32_t hsakmt_get_vgpr_size_per_cu(uint32_t gfxv)
 {
 	uint32_t vgpr_size = 0x40000;
@@ -418,6 +428,32 @@ static void free_exec_aligned_memory(void *addr, uint32_t size, uint32_t align,
 		munmap(addr, size);
 }
 
+static void queue_buffer_free_memory(enum queue_buffer_kind kind, void *addr,
+				     uint32_t size, bool use_ats)
+{
+	if (kind == QUEUE_BUFFER_CWSR_UNIFIED)
+		munmap(addr, size);
+	else
+		free_exec_aligned_memory(addr, size, PAGE_SIZE, use_ats);
+}
+
+HSAKMT_STATUS hsakmt_init_queue_buffer_pools(unsigned int NumNodes)
+{
+	uint64_t limit;
+	char *envvar;
+
+	/* HSA_QUEUE_BUFFER_POOL_SIZE caps the bytes cached per node, 0
+	 * disables reuse.
+	 */
+	envvar = getenv("HSA_QUEUE_BUFFER_POOL_SIZE");
+	limit = envvar ? strtoull(envvar, NULL, 0)
+		       : QUEUE_BUFFER_POOL_DEFAULT_SIZE;
+
+	return hsakmt_queue_buffer_pools_init(NumNodes, limit,
+					      QUEUE_BUFFER_IDLE_NS,
+					      queue_buffer_free_memory);
+}
+
 static HSAKMT_STATUS register_svm_range(void *mem, uint32_t size,
 				uint32_t gpuNode, uint32_t prefetchNode,
 				uint32_t preferredNode, bool alwaysMapped)
@@ -457,15 +493,18 @@ static HSAKMT_STATUS register_svm_range(void *mem, uint32_t size,
 static void free_queue(struct queue *q)
 {
 	if (q->eop_buffer)
-		free_exec_aligned_memory(q->eop_buffer,
-					 q->eop_buffer_size,
-					 PAGE_SIZE, q->use_ats);
+		hsakmt_queue_buffer_put(q->node_id, QUEUE_BUFFER_EOP,
+					q->eop_buffer, q->eop_buffer_size,
+					q->use_ats);
 	if (q->unified_ctx_save_restore)
-		munmap(q->ctx_save_restore, q->total_mem_alloc_size);
+		hsakmt_queue_buffer_put(q->node_id, QUEUE_BUFFER_CWSR_UNIFIED,
+					q->ctx_save_restore,
+					PAGE_ALIGN_UP(q->total_mem_alloc_size),
+					false);
 	else if (q->ctx_save_restore)
-		free_exec_aligned_memory(q->ctx_save_restore,
-					 q->total_mem_alloc_size,
-					 PAGE_SIZE, q->use_ats);
+		hsakmt_queue_buffer_put(q->node_id, QUEUE_BUFFER_CWSR,
+					q->ctx_save_restore,
+					q->total_mem_alloc_size, q->use_ats);
 
 	free_exec_aligned_memory((void *)q, sizeof(*q), PAGE_SIZE, q->use_ats);
 }
@@ -479,7 +518,8 @@ static inline void fill_cwsr_header(struct queue *q, void *addr,
 	for (i = 0; i < NumXcc; i++) {
 		header = (HsaUserContextSaveAreaHeader *)
 			((uintptr_t)addr + (i * q->ctx_save_restore_size));
-		header->ErrorEventId = 0;
+		/* Pooled areas hold the previous queue's header */
+		memset(header, 0, sizeof(*header));
 		if (Event)
 			header->ErrorEventId = Event->EventId;
 		header->ErrorReason = ErrPayload;
@@ -502,10 +542,18 @@ static int handle_concrete_asic(struct queue *q,
 		return HSAKMT_STATUS_SUCCESS;
 
 	if (q->eop_buffer_size > 0) {
-		pr_info("Allocating VRAM for EOP\n");
-		q->eop_buffer = allocate_exec_aligned_memory(q->eop_buffer_size,
-				q->use_ats, gpu_id,
-				NodeId, true, true, /* Unused for VRAM */false);
+		/* CP reinitializes the EOP ring on queue creation, so a pooled
+		 * buffer is used as is.
+		 */
+		q->eop_buffer = hsakmt_queue_buffer_get(NodeId,
+						QUEUE_BUFFER_EOP,
+						q->eop_buffer_size, q->use_ats);
+		if (!q->eop_buffer) {
+			pr_info("Allocating VRAM for EOP\n");
+			q->eop_buffer = allocate_exec_aligned_memory(q->eop_buffer_size,
+					q->use_ats, gpu_id,
+					NodeId, true, true, /* Unused for VRAM */false);
+		}
 		if (!q->eop_buffer)
 			return HSAKMT_STATUS_NO_MEMORY;
 
@@ -536,39 +584,54 @@ static int handle_concrete_asic(struct queue *q,
 		 */
 		if (!q->use_ats && hsakmt_is_svm_api_supported) {
 			uint32_t size = PAGE_ALIGN_UP(q->total_mem_alloc_size);
+			void *addr = hsakmt_queue_buffer_get(NodeId,
+						QUEUE_BUFFER_CWSR_UNIFIED,
+						size, false);
 
-			pr_info("Allocating GTT for CWSR\n");
-			void *addr = hsakmt_mmap_allocate_aligned(PROT_READ | PROT_WRITE,
-						     MAP_ANONYMOUS | MAP_PRIVATE,
-						     size, GPU_HUGE_PAGE_SIZE, 0,
-						     0, (void *)LONG_MAX);
-			if (!addr) {
-				pr_err("mmap failed to alloc ctx area size 0x%x: %s\n",
-					size, strerror(errno));
-			} else {
-				/*
-				 * To avoid fork child process COW MMU notifier
-				 * callback evict parent process queues.
-				 */
-				if (madvise(addr, size, MADV_DONTFORK))
-					pr_err("madvise failed -%d\n", errno);
-
+			if (addr) {
+				/* Still registered from its previous queue */
 				fill_cwsr_header(q, addr, Event, ErrPayload, node.NumXcc);
-
-				HSAKMT_STATUS r = register_svm_range(addr, size,
-						NodeId, NodeId, 0, true);
-
-				if (r == HSAKMT_STATUS_SUCCESS) {
-					q->ctx_save_restore = addr;
-					q->unified_ctx_save_restore = true;
+				q->ctx_save_restore = addr;
+				q->unified_ctx_save_restore = true;
+			} else {
+				pr_info("Allocating GTT for CWSR\n");
+				addr = hsakmt_mmap_allocate_aligned(PROT_READ | PROT_WRITE,
+							     MAP_ANONYMOUS | MAP_PRIVATE,
+							     size, GPU_HUGE_PAGE_SIZE, 0,
+							     0, (void *)LONG_MAX);
+				if (!addr) {
+					pr_err("mmap failed to alloc ctx area size 0x%x: %s\n",
+						size, strerror(errno));
 				} else {
-					munmap(addr, size);
+					/*
+					 * To avoid fork child process COW MMU notifier
+					 * callback evict parent process queues.
+					 */
+					if (madvise(addr, size, MADV_DONTFORK))
+						pr_err("madvise failed -%d\n", errno);
+
+					fill_cwsr_header(q, addr, Event, ErrPayload, node.NumXcc);
+
+					HSAKMT_STATUS r = register_svm_range(addr, size,
+							NodeId, NodeId, 0, true);
+
+					if (r == HSAKMT_STATUS_SUCCESS) {
+						q->ctx_save_restore = addr;
+						q->unified_ctx_save_restore = true;
+					} else {
+						munmap(addr, size);
+					}
 				}
 			}
 		}
 
 		if (!q->unified_ctx_save_restore) {
-			q->ctx_save_restore = allocate_exec_aligned_memory(
+			q->ctx_save_restore = hsakmt_queue_buffer_get(NodeId,
+							QUEUE_BUFFER_CWSR,
+							q->total_mem_alloc_size,
+							q->use_ats);
+			if (!q->ctx_save_restore)
+				q->ctx_save_restore = allocate_exec_aligned_memory(
 							q->total_mem_alloc_size,
 							q->use_ats, gpu_id, NodeId,
 							false, false, false);
@@ -643,6 +706,7 @@ HSAKMT_STATUS HSAKMTAPI hsaKmtCreateQueueExt(HSAuint32 NodeId,
 
 	memset(q, 0, sizeof(*q));
 
+	q->node_id = NodeId;
 	q->gfxv = hsakmt_get_gfxv_by_node_id(NodeId);
 	q->use_ats = false;
 
@@ -42,6 +42,7 @@
 
 #include "libhsakmt.h"
 #include "fmm.h"
+#include "queue_buffer_pool.h"
 
 /* Number of memory banks added by thunk on top of topology
  * This only includes static heaps like LDS, scratch and SVM,
@@ -2195,6 +2196,10 @@ HSAKMT_STATUS HSAKMTAPI hsaKmtAcquireSystemProperties(HsaSystemProperties *Syste
 	if (err != HSAKMT_STATUS_SUCCESS)
 		goto init_doorbells_failed;
 
+	/* Queue buffer reuse is an optimization, run without it on failure */
+	if (hsakmt_init_queue_buffer_pools(g_system->NumNodes) != HSAKMT_STATUS_SUCCESS)
+		pr_warn("Insufficient memory for queue buffer pools\n");
+
 	*SystemProperties = *g_system;
 
 	goto out;
@@ -2213,6 +2218,7 @@ HSAKMT_STATUS HSAKMTAPI hsaKmtReleaseSystemProperties(void)
 {
 	pthread_mutex_lock(&hsakmt_mutex);
 
+	hsakmt_destroy_queue_buffer_pools();
 	hsakmt_destroy_process_doorbells();
 	hsakmt_fmm_destroy_process_apertures();
 	topology_drop_snapshot();
@@ -23,6 +23,7 @@
 
 #include <math.h>
 #include <limits.h>
+#include <iomanip>
 
 #include "KFDEventTest.hpp"
 #include "PM4Queue.hpp"
@@ -361,6 +362,69 @@ TEST_F(KFDEventTest, SignalMultipleEventsWaitForAll) {
     TEST_END;
 }
 
+/* Compare the per-call cost of waiting on 1 to 1024 events through
+ * hsaKmtWaitOnMultipleEvents_Ext, which rebuilds the ioctl arguments every
+ * time, and through a reused wait set. Waits use a zero timeout on
+ * unsignaled events, so the numbers are pure call overhead.
+ */
+TEST_F(KFDEventTest, MultipleEventsWaitSetOverhead) {
+    TEST_START(TESTPROFILE_RUNALL);
+
+    static const unsigned int MAX_EVENT_NUMBER = 1024;
+    static const unsigned int ITERATIONS = 1000;
+
+    HsaEvent* pHsaEvent[MAX_EVENT_NUMBER];
+    HsaEventWaitSet* waitSet = NULL;
+    unsigned int i;
+
+    int defaultGPUNode = m_NodeInfo.HsaDefaultGPUNode();
+    ASSERT_GE(defaultGPUNode, 0) << "failed to get default GPU Node";
+
+    for (i = 0; i < MAX_EVENT_NUMBER; i++) {
+        pHsaEvent[i] = NULL;
+        ASSERT_SUCCESS(CreateQueueTypeEvent(false, false, defaultGPUNode, &pHsaEvent[i]));
+    }
+
+    ASSERT_SUCCESS(hsaKmtCreateEventWaitSet(0, &waitSet));
+
+    /* A reused set must still see a CPU signal on its last event */
+    ASSERT_EQ(HSAKMT_STATUS_WAIT_TIMEOUT,
+              hsaKmtWaitOnEventWaitSet(waitSet, pHsaEvent, MAX_EVENT_NUMBER, false, 0, NULL));
+    EXPECT_SUCCESS(hsaKmtSetEvent(pHsaEvent[MAX_EVENT_NUMBER - 1]));
+    EXPECT_SUCCESS(hsaKmtWaitOnEventWaitSet(waitSet, pHsaEvent, MAX_EVENT_NUMBER, false,
+                                            g_TestTimeOut, NULL));
+
+    LOG() << std::setw(8) << "Events" << std::setw(16) << "Ext (us/wait)"
+          << std::setw(20) << "WaitSet (us/wait)" << std::endl;
+
+    for (unsigned int count = 1; count <= MAX_EVENT_NUMBER; count *= 4) {
+        HSAuint64 start, extTime, setTime;
+
+        start = gettime();
+        for (i = 0; i < ITERATIONS; i++)
+            ASSERT_EQ(HSAKMT_STATUS_WAIT_TIMEOUT,
+                      hsaKmtWaitOnMultipleEvents_Ext(pHsaEvent, count, false, 0, NULL));
+        extTime = gettime() - start;
+
+        start = gettime();
+        for (i = 0; i < ITERATIONS; i++)
+            ASSERT_EQ(HSAKMT_STATUS_WAIT_TIMEOUT,
+                      hsaKmtWaitOnEventWaitSet(waitSet, pHsaEvent, count, false, 0, NULL));
+        setTime = gettime() - start;
+
+        LOG() << std::setw(8) << count
+              << std::setw(16) << (double)extTime / ITERATIONS / 1000
+              << std::setw(20) << (double)setTime / ITERATIONS / 1000 << std::endl;
+    }
+
+    EXPECT_SUCCESS(hsaKmtDestroyEventWaitSet(waitSet));
+
+    for (i = 0; i < MAX_EVENT_NUMBER; i++)
+        EXPECT_SUCCESS(hsaKmtDestroyEvent(pHsaEvent[i]));
+
+    TEST_END;
+}
+
 /* Send an event interrupt with 0 context ID. Test that KFD handles it
  * gracefully and with good performance. On current GPUs and firmware it
  * should be handled on a fast path.
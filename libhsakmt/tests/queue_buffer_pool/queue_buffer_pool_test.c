@@ -0,0 +1,268 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including
+ * the next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Host-only checks of the queue buffer pool's accounting. Buffers are plain
+ * malloc() memory released through a counting free callback, so no KFD
+ * device is needed.
+ */
+
+#include "queue_buffer_pool.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MS		1000000ULL
+#define IDLE_FOREVER	(3600ULL * 1000 * MS)
+
+static pthread_mutex_t free_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int num_allocs, num_frees;
+static uint64_t freed_bytes;
+static int failures;
+
+#define CHECK(cond)							\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: %s: check failed: %s\n", \
+				__FILE__, __LINE__, __func__, #cond);	\
+			failures++;					\
+		}							\
+	} while (0)
+
+static void *alloc_buffer(uint32_t size)
+{
+	pthread_mutex_lock(&free_lock);
+	num_allocs++;
+	pthread_mutex_unlock(&free_lock);
+	return malloc(size);
+}
+
+static void free_buffer(enum queue_buffer_kind kind, void *addr,
+			uint32_t size, bool use_ats)
+{
+	(void)kind;
+	(void)use_ats;
+
+	pthread_mutex_lock(&free_lock);
+	num_frees++;
+	freed_bytes += size;
+	pthread_mutex_unlock(&free_lock);
+	free(addr);
+}
+
+static unsigned int frees(void)
+{
+	unsigned int n;
+
+	pthread_mutex_lock(&free_lock);
+	n = num_frees;
+	pthread_mutex_unlock(&free_lock);
+	return n;
+}
+
+static void reset_counts(void)
+{
+	pthread_mutex_lock(&free_lock);
+	num_allocs = num_frees = 0;
+	freed_bytes = 0;
+	pthread_mutex_unlock(&free_lock);
+}
+
+static void sleep_ms(unsigned int ms)
+{
+	struct timespec ts = { ms / 1000, (ms % 1000) * MS };
+
+	nanosleep(&ts, NULL);
+}
+
+static void test_reuse_and_accounting(void)
+{
+	void *eop, *cwsr;
+
+	reset_counts();
+	CHECK(hsakmt_queue_buffer_pools_init(2, 1 << 20, IDLE_FOREVER,
+					     free_buffer) == HSAKMT_STATUS_SUCCESS);
+
+	eop = alloc_buffer(4096);
+	cwsr = alloc_buffer(65536);
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_EOP, eop, 4096, false);
+	hsakmt_queue_buffer_put(1, QUEUE_BUFFER_CWSR, cwsr, 65536, false);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 4096);
+	CHECK(hsakmt_queue_buffer_cached_bytes(1) == 65536);
+	CHECK(frees() == 0);
+
+	/* Buffers are only handed out on the node they were released on */
+	CHECK(hsakmt_queue_buffer_get(1, QUEUE_BUFFER_EOP, 4096, false) == NULL);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_EOP, 4096, false) == eop);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 0);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_EOP, 4096, false) == NULL);
+	CHECK(hsakmt_queue_buffer_get(1, QUEUE_BUFFER_CWSR, 65536, false) == cwsr);
+	CHECK(hsakmt_queue_buffer_cached_bytes(1) == 0);
+
+	/* Out of range nodes have no pool */
+	CHECK(hsakmt_queue_buffer_get(2, QUEUE_BUFFER_EOP, 4096, false) == NULL);
+	CHECK(hsakmt_queue_buffer_cached_bytes(2) == 0);
+
+	hsakmt_destroy_queue_buffer_pools();
+	CHECK(frees() == 0);
+	free(eop);
+	free(cwsr);
+}
+
+static void test_match_kind_size_ats(void)
+{
+	void *buf;
+
+	reset_counts();
+	hsakmt_queue_buffer_pools_init(1, 1 << 20, IDLE_FOREVER, free_buffer);
+
+	buf = alloc_buffer(8192);
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_CWSR, buf, 8192, false);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_CWSR_UNIFIED, 8192,
+				      false) == NULL);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_CWSR, 4096, false) == NULL);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_CWSR, 8192, true) == NULL);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 8192);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_CWSR, 8192, false) == buf);
+
+	hsakmt_destroy_queue_buffer_pools();
+	free(buf);
+}
+
+static void test_limit_evicts_oldest(void)
+{
+	void *a, *b, *c, *big;
+
+	reset_counts();
+	hsakmt_queue_buffer_pools_init(1, 8192, IDLE_FOREVER, free_buffer);
+
+	a = alloc_buffer(4096);
+	b = alloc_buffer(4096);
+	c = alloc_buffer(4096);
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_EOP, a, 4096, false);
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_EOP, b, 4096, false);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 8192);
+	CHECK(frees() == 0);
+
+	/* The oldest entry makes room for the newest */
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_EOP, c, 4096, false);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 8192);
+	CHECK(frees() == 1);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_EOP, 4096, false) == c);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_EOP, 4096, false) == b);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_EOP, 4096, false) == NULL);
+
+	/* Buffers larger than the limit are never cached */
+	big = alloc_buffer(16384);
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_CWSR, big, 16384, false);
+	CHECK(frees() == 2);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 0);
+
+	hsakmt_destroy_queue_buffer_pools();
+	free(b);
+	free(c);
+}
+
+static void test_idle_entries_freed_without_access(void)
+{
+	unsigned int waited;
+
+	reset_counts();
+	hsakmt_queue_buffer_pools_init(2, 1 << 20, 50 * MS, free_buffer);
+
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_EOP, alloc_buffer(4096), 4096,
+				false);
+	hsakmt_queue_buffer_put(1, QUEUE_BUFFER_CWSR, alloc_buffer(65536),
+				65536, false);
+
+	/* Nothing touches the pools; the reaper alone must free them */
+	for (waited = 0; frees() < 2 && waited < 2000; waited += 10)
+		sleep_ms(10);
+	CHECK(frees() == 2);
+	CHECK(freed_bytes == 4096 + 65536);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 0);
+	CHECK(hsakmt_queue_buffer_cached_bytes(1) == 0);
+
+	/* The reaper keeps serving buffers released after it went idle */
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_EOP, alloc_buffer(4096), 4096,
+				false);
+	for (waited = 0; frees() < 3 && waited < 2000; waited += 10)
+		sleep_ms(10);
+	CHECK(frees() == 3);
+
+	hsakmt_destroy_queue_buffer_pools();
+	CHECK(num_allocs == num_frees);
+}
+
+static void test_destroy_frees_everything(void)
+{
+	unsigned int i;
+
+	reset_counts();
+	hsakmt_queue_buffer_pools_init(4, 1 << 20, IDLE_FOREVER, free_buffer);
+
+	for (i = 0; i < 16; i++)
+		hsakmt_queue_buffer_put(i % 4, QUEUE_BUFFER_CWSR,
+					alloc_buffer(4096 << (i % 3)),
+					4096 << (i % 3), false);
+	CHECK(frees() == 0);
+
+	hsakmt_destroy_queue_buffer_pools();
+	CHECK(num_allocs == 16);
+	CHECK(num_frees == num_allocs);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 0);
+}
+
+static void test_zero_limit_disables_pool(void)
+{
+	reset_counts();
+	CHECK(hsakmt_queue_buffer_pools_init(1, 0, IDLE_FOREVER,
+					     free_buffer) == HSAKMT_STATUS_SUCCESS);
+
+	hsakmt_queue_buffer_put(0, QUEUE_BUFFER_EOP, alloc_buffer(4096), 4096,
+				false);
+	CHECK(frees() == 1);
+	CHECK(hsakmt_queue_buffer_get(0, QUEUE_BUFFER_EOP, 4096, false) == NULL);
+	CHECK(hsakmt_queue_buffer_cached_bytes(0) == 0);
+
+	hsakmt_destroy_queue_buffer_pools();
+}
+
+int main(void)
+{
+	test_reuse_and_accounting();
+	test_match_kind_size_ats();
+	test_limit_evicts_oldest();
+	test_idle_entries_freed_without_access();
+	test_destroy_frees_everything();
+	test_zero_limit_disables_pool();
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All queue buffer pool checks passed\n");
+	return 0;
+}
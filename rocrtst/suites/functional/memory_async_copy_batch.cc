@@ -0,0 +1,206 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+
+#include "suites/functional/memory_async_copy_batch.h"
+#include "common/base_rocr_utils.h"
+#include "common/common.h"
+#include "gtest/gtest.h"
+#include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
+
+static const size_t kNumCopies = 512;
+static const size_t kStride = 8192;
+
+MemoryAsyncCopyBatch::MemoryAsyncCopyBatch(void) : TestBase() {
+  set_num_iteration(1);
+  set_title("RocR Async Copy Batch Test");
+  set_description("This test scatters small copies of varying size with "
+      "hsa_amd_memory_async_copy_batch from host to device, device to device "
+      "and back to host, then verifies every byte and that the completion "
+      "signal was decremented only once per batch.");
+}
+
+MemoryAsyncCopyBatch::~MemoryAsyncCopyBatch(void) {
+}
+
+void MemoryAsyncCopyBatch::SetUp(void) {
+  hsa_status_t err;
+  TestBase::SetUp();
+
+  err = rocrtst::SetDefaultAgents(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  err = rocrtst::SetPoolsTypical(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+void MemoryAsyncCopyBatch::CopyBatch(const std::vector<hsa_amd_copy_desc_t>& copies,
+                                     hsa_agent_t dst_agent, hsa_agent_t src_agent,
+                                     const char* name) {
+  hsa_status_t err;
+  hsa_signal_t dep, signal;
+  err = hsa_signal_create(1, 0, nullptr, &dep);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_signal_create(1, 0, nullptr, &signal);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  err = hsa_amd_memory_async_copy_batch(copies.data(), copies.size(), dst_agent, src_agent, 1,
+                                        &dep, signal);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  // Nothing may retire before the dependency is satisfied.
+  EXPECT_EQ(hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, 1, 1000000,
+                                      HSA_WAIT_STATE_ACTIVE), 1) << name;
+  hsa_signal_store_screlease(dep, 0);
+
+  hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX,
+                            HSA_WAIT_STATE_BLOCKED);
+  EXPECT_EQ(hsa_signal_load_scacquire(signal), 0) << name;
+
+  if (verbosity() > 0) std::cout << "  " << name << " completed" << std::endl;
+
+  hsa_signal_destroy(signal);
+  hsa_signal_destroy(dep);
+}
+
+void MemoryAsyncCopyBatch::Run(void) {
+  hsa_status_t err;
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::Run();
+
+  const size_t size = kNumCopies * kStride;
+  uint8_t* src = nullptr;
+  err = hsa_amd_memory_pool_allocate(cpu_pool(), size, 0, reinterpret_cast<void**>(&src));
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  uint8_t* readback = nullptr;
+  err = hsa_amd_memory_pool_allocate(cpu_pool(), size, 0, reinterpret_cast<void**>(&readback));
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  uint8_t* dev = nullptr;
+  err = hsa_amd_memory_pool_allocate(device_pool(), size, 0, reinterpret_cast<void**>(&dev));
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  uint8_t* dev2 = nullptr;
+  err = hsa_amd_memory_pool_allocate(device_pool(), size, 0, reinterpret_cast<void**>(&dev2));
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  hsa_agent_t agents[2] = {*gpu_device1(), *cpu_device()};
+  for (void* ptr : {static_cast<void*>(src), static_cast<void*>(readback),
+                    static_cast<void*>(dev), static_cast<void*>(dev2)}) {
+    err = hsa_amd_agents_allow_access(2, agents, nullptr, ptr);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  }
+
+  for (size_t i = 0; i < size; i++) src[i] = static_cast<uint8_t>(i * 13 + (i >> 9));
+  memset(readback, 0, size);
+  err = hsa_amd_memory_fill(dev, 0, size / 4);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_amd_memory_fill(dev2, 0, size / 4);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  // Copy i covers a prefix of slot i, sizes cycle from 4 bytes to a full slot. Every 64th copy is
+  // empty and must be skipped.
+  std::vector<size_t> lengths(kNumCopies);
+  for (size_t i = 0; i < kNumCopies; i++)
+    lengths[i] = (i % 64 == 63) ? 0 : 4 + (i * 36) % (kStride - 4);
+
+  auto batch = [&](uint8_t* dst, const uint8_t* from) {
+    std::vector<hsa_amd_copy_desc_t> copies(kNumCopies);
+    for (size_t i = 0; i < kNumCopies; i++)
+      copies[i] = {dst + i * kStride, from + i * kStride, lengths[i]};
+    return copies;
+  };
+
+  CopyBatch(batch(dev, src), *gpu_device1(), *cpu_device(), "Host to device");
+  CopyBatch(batch(dev2, dev), *gpu_device1(), *gpu_device1(), "Device to device");
+  CopyBatch(batch(readback, dev2), *cpu_device(), *gpu_device1(), "Device to host");
+
+  size_t mismatch = 0;
+  for (size_t i = 0; i < kNumCopies; i++) {
+    for (size_t j = 0; j < kStride; j++) {
+      const size_t at = i * kStride + j;
+      const uint8_t expected = (j < lengths[i]) ? src[at] : 0;
+      if (readback[at] != expected) mismatch++;
+    }
+  }
+  EXPECT_EQ(mismatch, 0u);
+
+  // An empty batch queues nothing and leaves the signal untouched.
+  hsa_signal_t signal;
+  err = hsa_signal_create(1, 0, nullptr, &signal);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_amd_memory_async_copy_batch(nullptr, 0, *gpu_device1(), *cpu_device(), 0, nullptr,
+                                        signal);
+  EXPECT_EQ(HSA_STATUS_SUCCESS, err);
+  EXPECT_EQ(hsa_signal_load_scacquire(signal), 1);
+  hsa_signal_destroy(signal);
+
+  hsa_amd_memory_pool_free(dev2);
+  hsa_amd_memory_pool_free(dev);
+  hsa_amd_memory_pool_free(readback);
+  hsa_amd_memory_pool_free(src);
+}
+
+void MemoryAsyncCopyBatch::DisplayTestInfo(void) {
+  TestBase::DisplayTestInfo();
+}
+
+void MemoryAsyncCopyBatch::DisplayResults(void) const {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::DisplayResults();
+}
+
+void MemoryAsyncCopyBatch::Close(void) {
+  TestBase::Close();
+}
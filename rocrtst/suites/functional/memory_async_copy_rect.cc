@@ -0,0 +1,203 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+
+#include "suites/functional/memory_async_copy_rect.h"
+#include "common/base_rocr_utils.h"
+#include "common/common.h"
+#include "gtest/gtest.h"
+#include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
+
+static const size_t kWidePitch = 1 << 20;
+
+MemoryAsyncCopyRect::MemoryAsyncCopyRect(void) : TestBase() {
+  set_num_iteration(1);
+  set_title("RocR Async Copy Rect Test");
+  set_description("This test copies pitched sub-volumes from host to device "
+      "memory with hsa_amd_memory_async_copy_rect and verifies the whole "
+      "destination surface. Shapes cover merged linear copies, unaligned "
+      "rects and pitches that need the wide pitch or per slice forms.");
+}
+
+MemoryAsyncCopyRect::~MemoryAsyncCopyRect(void) {
+}
+
+void MemoryAsyncCopyRect::SetUp(void) {
+  hsa_status_t err;
+  TestBase::SetUp();
+
+  err = rocrtst::SetDefaultAgents(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  err = rocrtst::SetPoolsTypical(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+static size_t SurfaceSize(size_t pitch, size_t slice, const hsa_dim3_t& offset,
+                          const hsa_dim3_t& range) {
+  if (range.z == 1 && offset.z == 0) return (offset.y + range.y) * pitch;
+  return (offset.z + range.z) * slice;
+}
+
+static size_t ByteOffset(size_t pitch, size_t slice, const hsa_dim3_t& offset,
+                         size_t x, size_t y, size_t z) {
+  return (offset.x + x) + (offset.y + y) * pitch + (offset.z + z) * slice;
+}
+
+void MemoryAsyncCopyRect::CopyShape(const Shape& shape) {
+  hsa_status_t err;
+
+  const size_t src_size = SurfaceSize(shape.src_pitch, shape.src_slice, shape.src_offset,
+                                      shape.range);
+  const size_t dst_size = SurfaceSize(shape.dst_pitch, shape.dst_slice, shape.dst_offset,
+                                      shape.range);
+
+  uint8_t* src = nullptr;
+  err = hsa_amd_memory_pool_allocate(cpu_pool(), src_size, 0, reinterpret_cast<void**>(&src));
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  uint8_t* readback = nullptr;
+  err = hsa_amd_memory_pool_allocate(cpu_pool(), dst_size, 0,
+                                     reinterpret_cast<void**>(&readback));
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  void* dst = nullptr;
+  err = hsa_amd_memory_pool_allocate(device_pool(), (dst_size + 3) & ~size_t(3), 0, &dst);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  hsa_agent_t agents[2] = {*gpu_device1(), *cpu_device()};
+  err = hsa_amd_agents_allow_access(2, agents, nullptr, src);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_amd_agents_allow_access(2, agents, nullptr, readback);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_amd_agents_allow_access(2, agents, nullptr, dst);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  for (size_t i = 0; i < src_size; i++) src[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+  err = hsa_amd_memory_fill(dst, 0, (dst_size + 3) / 4);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  hsa_signal_t signal;
+  err = hsa_signal_create(1, 0, nullptr, &signal);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  hsa_pitched_ptr_t src_ptr = {src, shape.src_pitch, shape.src_slice};
+  hsa_pitched_ptr_t dst_ptr = {dst, shape.dst_pitch, shape.dst_slice};
+  err = hsa_amd_memory_async_copy_rect(&dst_ptr, &shape.dst_offset, &src_ptr, &shape.src_offset,
+                                       &shape.range, *gpu_device1(), hsaHostToDevice, 0,
+                                       nullptr, signal);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX,
+                            HSA_WAIT_STATE_BLOCKED);
+
+  hsa_signal_store_relaxed(signal, 1);
+  err = hsa_amd_memory_async_copy(readback, *cpu_device(), dst, *gpu_device1(), dst_size, 0,
+                                  nullptr, signal);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX,
+                            HSA_WAIT_STATE_BLOCKED);
+
+  // Bytes inside the destination rect come from the source rect, all others stay zero.
+  std::vector<uint8_t> expected(dst_size, 0);
+  for (size_t z = 0; z < shape.range.z; z++)
+    for (size_t y = 0; y < shape.range.y; y++)
+      for (size_t x = 0; x < shape.range.x; x++)
+        expected[ByteOffset(shape.dst_pitch, shape.dst_slice, shape.dst_offset, x, y, z)] =
+            src[ByteOffset(shape.src_pitch, shape.src_slice, shape.src_offset, x, y, z)];
+
+  size_t mismatch = 0;
+  for (size_t i = 0; i < dst_size; i++) {
+    if (readback[i] != expected[i]) mismatch++;
+  }
+  EXPECT_EQ(mismatch, 0u) << "Shape: " << shape.name;
+
+  if (verbosity() > 0) {
+    std::cout << "  " << shape.name << (mismatch ? " FAILED" : " passed") << std::endl;
+  }
+
+  hsa_signal_destroy(signal);
+  hsa_amd_memory_pool_free(dst);
+  hsa_amd_memory_pool_free(readback);
+  hsa_amd_memory_pool_free(src);
+}
+
+void MemoryAsyncCopyRect::Run(void) {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::Run();
+
+  const Shape shapes[] = {
+    {"Contiguous volume", 256, 256 * 16, 256, 256 * 16, {0, 0, 0}, {0, 0, 0}, {256, 16, 4}},
+    {"Contiguous rows", 4096, 4096 * 20, 4096, 4096 * 24, {0, 2, 1}, {0, 5, 0}, {4096, 16, 3}},
+    {"Sub-volume", 512, 512 * 32, 1024, 1024 * 40, {12, 3, 1}, {20, 5, 2}, {100, 10, 3}},
+    {"Unaligned rows", 64, 0, 64, 0, {1, 0, 0}, {3, 1, 0}, {7, 5, 1}},
+    {"Wide pitch", kWidePitch, 0, kWidePitch, 0, {16, 1, 0}, {32, 0, 0}, {64, 4, 1}},
+    {"Wide pitch volume", kWidePitch, kWidePitch * 8, kWidePitch, kWidePitch * 8,
+        {0, 1, 0}, {4, 2, 1}, {64, 4, 2}},
+  };
+
+  for (const Shape& shape : shapes) CopyShape(shape);
+}
+
+void MemoryAsyncCopyRect::DisplayTestInfo(void) {
+  TestBase::DisplayTestInfo();
+}
+
+void MemoryAsyncCopyRect::DisplayResults(void) const {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::DisplayResults();
+}
+
+void MemoryAsyncCopyRect::Close(void) {
+  TestBase::Close();
+}
@@ -0,0 +1,97 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#ifndef ROCRTST_SUITES_FUNCTIONAL_MEMORY_ASYNC_COPY_RECT_H_
+#define ROCRTST_SUITES_FUNCTIONAL_MEMORY_ASYNC_COPY_RECT_H_
+
+#include "suites/test_common/test_base.h"
+#include "common/base_rocr.h"
+#include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
+
+// @Brief: This class checks hsa_amd_memory_async_copy_rect over shapes the
+//  runtime decomposes differently: contiguous volumes and rows, unaligned
+//  sub-volumes and pitches too wide for a single rect packet.
+
+class MemoryAsyncCopyRect : public TestBase {
+ public:
+  // @Brief: Constructor
+  MemoryAsyncCopyRect(void);
+
+  // @Brief: Destructor
+  virtual ~MemoryAsyncCopyRect(void);
+
+  // @Brief: Set up the environment for the test
+  virtual void SetUp(void);
+
+  // @Brief: Run the test case
+  virtual void Run(void);
+
+  // @Brief: Display  results we got
+  virtual void DisplayResults(void) const;
+
+  // @Brief: Display information about what this test does
+  virtual void DisplayTestInfo(void);
+
+  // @Brief: Clean up and close the runtime
+  virtual void Close(void);
+
+ private:
+  struct Shape {
+    const char* name;
+    size_t src_pitch;
+    size_t src_slice;
+    size_t dst_pitch;
+    size_t dst_slice;
+    hsa_dim3_t src_offset;
+    hsa_dim3_t dst_offset;
+    hsa_dim3_t range;
+  };
+
+  // @Brief: Copy one shape host to device and check every byte of the
+  //  destination surface
+  void CopyShape(const Shape& shape);
+};
+
+#endif  // ROCRTST_SUITES_FUNCTIONAL_MEMORY_ASYNC_COPY_RECT_H_
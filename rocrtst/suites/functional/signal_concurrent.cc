@@ -54,6 +54,7 @@
 #include "common/concurrent_utils.h"
 #include "gtest/gtest.h"
 #include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
 
 static const int N = 8;
 static const int M = 32;
@@ -118,7 +119,34 @@ static void signal_wait_component_func(void *data) {
   hsa_signal_wait_scacquire(*signal_ptr, HSA_SIGNAL_CONDITION_EQ, CMP_VAL, UINT64_MAX, HSA_WAIT_STATE_BLOCKED);
   return;
 }
-SignalConcurrentTest::SignalConcurrentTest(bool destroy, bool max_consumer, bool cpu, bool create)
+// Many waiters test: signals and the threads waiting on them.
+static const uint32_t kManySignals = 100000;
+static const uint32_t kManyWaiterThreads = 100;
+
+struct WaitAnyGroup {
+  hsa_signal_t* signals;
+  uint32_t count;
+};
+
+static void signals_wait_any_func(void *data) {
+  WaitAnyGroup* group = reinterpret_cast<WaitAnyGroup*>(data);
+  std::vector<hsa_signal_t> pending(group->signals, group->signals + group->count);
+  std::vector<hsa_signal_condition_t> conds(group->count, HSA_SIGNAL_CONDITION_EQ);
+  std::vector<hsa_signal_value_t> values(group->count, CMP_VAL);
+
+  while (!pending.empty()) {
+    hsa_signal_value_t value;
+    uint32_t index = hsa_amd_signal_wait_any(pending.size(), &pending[0], &conds[0], &values[0],
+                                             UINT64_MAX, HSA_WAIT_STATE_BLOCKED, &value);
+    ASSERT_LT(index, pending.size());
+    ASSERT_EQ(CMP_VAL, value);
+    pending[index] = pending.back();
+    pending.pop_back();
+  }
+}
+
+SignalConcurrentTest::SignalConcurrentTest(bool destroy, bool max_consumer, bool cpu, bool create,
+                                           bool many_waiters, bool host_only)
     : TestBase() {
   set_num_iteration(10);  // Number of iterations to execute of the main test;
                         // This is a default value which can be overridden
@@ -135,6 +163,12 @@ SignalConcurrentTest::SignalConcurrentTest(bool destroy, bool max_consumer, bool
   } else if (cpu) {
     set_title("RocR CPU Signal Completion Test");
     set_description("This test checks whether CPU signals completed");
+  } else if (many_waiters) {
+    set_title("RocR Signal Many Waiters Test");
+    set_description("This test waits on more signals than the driver has events for");
+  } else if (host_only) {
+    set_title("RocR Host Only Signal Test");
+    set_description("This test passes values between threads through host only signals");
   }
 }
 
@@ -374,6 +408,140 @@ void SignalConcurrentTest::TestSignalCreateMaxConsumers(void) {
   ASSERT_EQ(HSA_STATUS_SUCCESS, status);
 }
 
+/*
+ * Test Name: TestSignalManyWaiters
+ * Scope: Conformance
+ *
+ * Purpose: Verifies that blocked waits complete when there are more
+ * interrupt signals than KFD signal events, so that signals share events.
+ *
+ * Test Description:
+ * 1) Create kManySignals signals.
+ * 2) Split the signals between kManyWaiterThreads threads, each of which
+ *    waits on all of its signals at once with hsa_amd_signal_wait_any
+ *    until every one has been set.
+ * 3) Set the signals from the main thread in reverse order so that
+ *    signals sharing an event complete at different times.
+ * 4) Destroy all of the signals in the main thread.
+ *
+ * Expected Results: All waiting threads wake up and observe every one of
+ * their signals set.
+ */
+void SignalConcurrentTest::TestSignalManyWaiters(void) {
+  uint32_t i;
+  hsa_status_t status;
+
+  std::vector<hsa_signal_t> many_signals(kManySignals);
+  for (i = 0; i < kManySignals; ++i) {
+    status = hsa_signal_create(INI_VAL, 0, NULL, &many_signals[i]);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, status);
+  }
+
+  const uint32_t per_thread = kManySignals / kManyWaiterThreads;
+  std::vector<WaitAnyGroup> groups(kManyWaiterThreads);
+  struct rocrtst::test_group *tg_sg_wait = rocrtst::TestGroupCreate(kManyWaiterThreads);
+  for (i = 0; i < kManyWaiterThreads; ++i) {
+    groups[i].signals = &many_signals[i * per_thread];
+    groups[i].count = (i == kManyWaiterThreads - 1) ? kManySignals - i * per_thread : per_thread;
+    rocrtst::TestGroupAdd(tg_sg_wait, &signals_wait_any_func, &groups[i], 1);
+  }
+
+  rocrtst::TestGroupThreadCreate(tg_sg_wait);
+  rocrtst::TestGroupStart(tg_sg_wait);
+
+  for (i = kManySignals; i > 0; --i) {
+    hsa_signal_store_screlease(many_signals[i - 1], CMP_VAL);
+  }
+
+  rocrtst::TestGroupWait(tg_sg_wait);
+  rocrtst::TestGroupExit(tg_sg_wait);
+  rocrtst::TestGroupDestroy(tg_sg_wait);
+
+  for (i = 0; i < kManySignals; ++i) {
+    status = hsa_signal_destroy(many_signals[i]);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, status);
+  }
+}
+
+/*
+ * Test Name: TestSignalHostOnly
+ * Scope: Conformance
+ *
+ * Purpose: Verifies that blocked waiters on signals created with
+ * HSA_AMD_SIGNAL_HOST_ONLY are woken by host updates.
+ *
+ * Test Description:
+ * 1) Create a host only signal per thread for requests and one for replies.
+ * 2) Each of N threads repeatedly waits (blocked) for its request signal to
+ *    reach the next iteration number, then decrements the reply signal.
+ * 3) The main thread publishes each iteration and waits (blocked) for all
+ *    threads to reply before starting the next one.
+ * 4) Check that host only signals can not be combined with IPC.
+ *
+ * Expected Results: All iterations complete without relying on timeouts and
+ * invalid attribute combinations are rejected.
+ */
+static const int kHostOnlyIterations = 1000;
+
+struct HostOnlyPair {
+  hsa_signal_t request;
+  hsa_signal_t reply;
+};
+
+static void host_only_worker_func(void *data) {
+  HostOnlyPair* pair = reinterpret_cast<HostOnlyPair*>(data);
+  for (int i = 1; i <= kHostOnlyIterations; ++i) {
+    hsa_signal_value_t value = hsa_signal_wait_scacquire(pair->request, HSA_SIGNAL_CONDITION_EQ,
+                                                         i, UINT64_MAX, HSA_WAIT_STATE_BLOCKED);
+    ASSERT_EQ(i, value);
+    hsa_signal_subtract_screlease(pair->reply, 1);
+  }
+}
+
+void SignalConcurrentTest::TestSignalHostOnly(void) {
+  int i;
+  hsa_status_t status;
+
+  hsa_signal_t reply;
+  status = hsa_amd_signal_create(INI_VAL, 0, NULL, HSA_AMD_SIGNAL_HOST_ONLY, &reply);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, status);
+
+  std::vector<HostOnlyPair> pairs(N);
+  struct rocrtst::test_group *tg_sg_wait = rocrtst::TestGroupCreate(N);
+  for (i = 0; i < N; ++i) {
+    status = hsa_amd_signal_create(INI_VAL, 0, NULL, HSA_AMD_SIGNAL_HOST_ONLY, &pairs[i].request);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, status);
+    pairs[i].reply = reply;
+    rocrtst::TestGroupAdd(tg_sg_wait, &host_only_worker_func, &pairs[i], 1);
+  }
+
+  rocrtst::TestGroupThreadCreate(tg_sg_wait);
+  rocrtst::TestGroupStart(tg_sg_wait);
+
+  for (int iter = 1; iter <= kHostOnlyIterations; ++iter) {
+    hsa_signal_store_relaxed(reply, N);
+    for (i = 0; i < N; ++i) hsa_signal_store_screlease(pairs[i].request, iter);
+    hsa_signal_wait_scacquire(reply, HSA_SIGNAL_CONDITION_EQ, 0, UINT64_MAX,
+                              HSA_WAIT_STATE_BLOCKED);
+  }
+
+  rocrtst::TestGroupWait(tg_sg_wait);
+  rocrtst::TestGroupExit(tg_sg_wait);
+  rocrtst::TestGroupDestroy(tg_sg_wait);
+
+  for (i = 0; i < N; ++i) {
+    status = hsa_signal_destroy(pairs[i].request);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, status);
+  }
+  status = hsa_signal_destroy(reply);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, status);
+
+  hsa_signal_t invalid;
+  status = hsa_amd_signal_create(INI_VAL, 0, NULL,
+                                 HSA_AMD_SIGNAL_HOST_ONLY | HSA_AMD_SIGNAL_IPC, &invalid);
+  ASSERT_EQ(HSA_STATUS_ERROR_INVALID_ARGUMENT, status);
+}
+
 void SignalConcurrentTest::TestSignalCPUCompletion(void) {
   // Not clear with the requirements, have to check with Runtime team/Ramesh
   // As we are not implemented the test fully hence the test will be skipped for now
@@ -52,7 +52,8 @@
 
 class SignalConcurrentTest : public TestBase {
  public:
-    SignalConcurrentTest(bool, bool, bool, bool);
+    SignalConcurrentTest(bool, bool, bool, bool, bool many_waiters = false,
+                         bool host_only = false);
 
     // @Brief: Destructor for the SignalConcurrentTest class
     virtual ~SignalConcurrentTest();
@@ -78,6 +79,10 @@ class SignalConcurrentTest : public TestBase {
 
     void TestSignalCreateMaxConsumers(void);
 
+    void TestSignalManyWaiters(void);
+
+    void TestSignalHostOnly(void);
+
     // @Brief: This is not implemented, created a member function for future reference
     void TestSignalCPUCompletion(void);
 };
@@ -0,0 +1,194 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "suites/performance/memory_copy_latency.h"
+#include "common/base_rocr_utils.h"
+#include "common/common.h"
+#include "common/hsatimer.h"
+#include "gtest/gtest.h"
+#include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
+
+static const size_t kCopySizes[] = {4, 256, 4096, 65536};
+static const size_t kMaxCopySize = 65536;
+
+MemoryCopyLatency::MemoryCopyLatency(void) : TestBase() {
+#if ROCRTST_EMULATOR_BUILD
+  set_num_iteration(1);
+#else
+  set_num_iteration(1000);
+#endif
+  set_title("Small hsa_memory_copy Latency");
+  set_description("This test measures the average time of blocking "
+      "hsa_memory_copy calls of a few bytes up to 64KB between pageable or "
+      "pinned host memory and device memory. Set HSA_COPY_PIN_CACHE_SIZE to "
+      "let pageable copies reuse pins between calls.");
+}
+
+MemoryCopyLatency::~MemoryCopyLatency(void) {
+}
+
+void MemoryCopyLatency::SetUp(void) {
+  hsa_status_t err;
+  TestBase::SetUp();
+
+  err = rocrtst::SetDefaultAgents(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  err = rocrtst::SetPoolsTypical(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+double MemoryCopyLatency::TimeCopy(void* dst, void* src, size_t size) {
+  hsa_status_t err;
+  std::vector<double> timer;
+  rocrtst::PerfTimer p_timer;
+
+  // The first copy pays for first touch and any pin, leave it out.
+  err = hsa_memory_copy(dst, src, size);
+  EXPECT_EQ(HSA_STATUS_SUCCESS, err);
+
+  int id = p_timer.CreateTimer();
+  for (uint32_t i = 0; i < num_iteration(); i++) {
+    p_timer.StartTimer(id);
+    err = hsa_memory_copy(dst, src, size);
+    p_timer.StopTimer(id);
+    EXPECT_EQ(HSA_STATUS_SUCCESS, err);
+    timer.push_back(p_timer.ReadTimer(id));
+    p_timer.ResetTimer(id);
+  }
+
+  // Drop the slowest 2% to filter out preemption.
+  std::sort(timer.begin(), timer.end());
+  timer.erase(timer.begin() + timer.size() * 98 / 100 + 1, timer.end());
+  return rocrtst::CalcMean(timer);
+}
+
+void MemoryCopyLatency::Run(void) {
+  hsa_status_t err;
+
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::Run();
+
+  void* dev = nullptr;
+  err = hsa_amd_memory_pool_allocate(device_pool(), kMaxCopySize, 0, &dev);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  void* pinned = nullptr;
+  err = hsa_amd_memory_pool_allocate(cpu_pool(), kMaxCopySize, 0, &pinned);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_amd_agents_allow_access(1, gpu_device1(), nullptr, pinned);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  void* pageable = malloc(kMaxCopySize);
+  ASSERT_NE(pageable, nullptr);
+  memset(pageable, 0xA5, kMaxCopySize);
+
+  for (size_t size : kCopySizes) {
+    Result res;
+    res.size = size;
+
+    res.path = "Pageable -> Device";
+    res.mean = TimeCopy(dev, pageable, size);
+    results_.push_back(res);
+
+    res.path = "Device -> Pageable";
+    res.mean = TimeCopy(pageable, dev, size);
+    results_.push_back(res);
+
+    res.path = "Pinned -> Device";
+    res.mean = TimeCopy(dev, pinned, size);
+    results_.push_back(res);
+
+    if (verbosity() >= VERBOSE_PROGRESS) {
+      std::cout << ".";
+      fflush(stdout);
+    }
+  }
+
+  if (verbosity() >= VERBOSE_PROGRESS) {
+    std::cout << std::endl;
+  }
+
+  free(pageable);
+  err = hsa_amd_memory_pool_free(pinned);
+  EXPECT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_amd_memory_pool_free(dev);
+  EXPECT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+void MemoryCopyLatency::DisplayTestInfo(void) {
+  TestBase::DisplayTestInfo();
+}
+
+void MemoryCopyLatency::DisplayResults(void) const {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::DisplayResults();
+
+  std::cout << std::setw(20) << "Path" << std::setw(10) << "Size"
+            << std::setw(16) << "Mean (uS)" << std::endl;
+  for (const auto& res : results_) {
+    std::cout << std::setw(20) << res.path << std::setw(10) << res.size
+              << std::setw(16) << std::fixed << std::setprecision(2)
+              << res.mean * 1e6 << std::endl;
+  }
+}
+
+void MemoryCopyLatency::Close(void) {
+  TestBase::Close();
+}
@@ -0,0 +1,257 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#include <numa.h>
+#include <numaif.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "suites/performance/memory_host_numa_policy.h"
+#include "common/base_rocr_utils.h"
+#include "common/common.h"
+#include "common/hsatimer.h"
+#include "gtest/gtest.h"
+#include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
+
+// Size of each host buffer.
+static const size_t kBufferSize = 64 * 1024 * 1024;
+// Timed repetitions of each copy, after one untimed warm up.
+static const int kIterations = 10;
+
+MemoryHostNumaPolicy::MemoryHostNumaPolicy(void)
+    : TestBase(), size_(kBufferSize), pool_node_(0) {
+  set_num_iteration(kIterations);
+  set_title("Host Memory NUMA Placement Policies");
+  set_description("This test allocates host memory from the CPU pool with "
+      "each NUMA placement flag, reports the NUMA node of every page using "
+      "get_mempolicy, and compares host to device and device to host "
+      "hsa_amd_memory_async_copy bandwidth with a CPU-only memcpy of the "
+      "same buffer.");
+}
+
+MemoryHostNumaPolicy::~MemoryHostNumaPolicy(void) {
+}
+
+void MemoryHostNumaPolicy::SetUp(void) {
+  hsa_status_t err;
+  TestBase::SetUp();
+
+  err = rocrtst::SetDefaultAgents(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  err = rocrtst::SetPoolsTypical(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  err = hsa_agent_get_info(*cpu_device(), HSA_AGENT_INFO_NODE, &pool_node_);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+static double GBps(size_t size, double seconds) {
+  return static_cast<double>(size) / seconds / 1e9;
+}
+
+void MemoryHostNumaPolicy::RunPolicy(const char* name, uint32_t flag) {
+  hsa_status_t err;
+  Result result;
+  result.policy = name;
+
+  void* host = nullptr;
+  err = hsa_amd_memory_pool_allocate(cpu_pool(), size_, flag, &host);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  // First touch from the CPU, which is what places pages under the local policy.
+  memset(host, 1, size_);
+
+  // Validate placement page by page.
+  const int nodes = numa_max_node() + 1;
+  const size_t page = 4096;
+  result.pages_per_node.assign(nodes, 0);
+  for (size_t off = 0; off < size_; off += page) {
+    int node = -1;
+    void* addr = static_cast<uint8_t*>(host) + off;
+    if (get_mempolicy(&node, nullptr, 0, addr, MPOL_F_NODE | MPOL_F_ADDR) == 0 &&
+        node >= 0 && node < nodes)
+      result.pages_per_node[node]++;
+  }
+
+  const size_t used = std::count_if(result.pages_per_node.begin(), result.pages_per_node.end(),
+                                    [](size_t n) { return n != 0; });
+  if (flag == HSA_AMD_MEMORY_POOL_NUMA_INTERLEAVE_FLAG) {
+    struct bitmask* allowed = numa_get_mems_allowed();
+    result.placement_ok = used == static_cast<size_t>(numa_bitmask_weight(allowed));
+    numa_bitmask_free(allowed);
+  } else if (flag == HSA_AMD_MEMORY_POOL_NUMA_BIND_FLAG) {
+    result.placement_ok = used == 1 && pool_node_ < static_cast<uint32_t>(nodes) &&
+        result.pages_per_node[pool_node_] != 0;
+  } else if (flag == HSA_AMD_MEMORY_POOL_NUMA_LOCAL_FLAG) {
+    result.placement_ok = used == 1;
+  } else {
+    // Preferred placement may fall back when the node is full.
+    result.placement_ok = pool_node_ < static_cast<uint32_t>(nodes) &&
+        result.pages_per_node[pool_node_] != 0;
+  }
+
+  void* dev = nullptr;
+  err = hsa_amd_memory_pool_allocate(device_pool(), size_, 0, &dev);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  err = hsa_amd_agents_allow_access(1, gpu_device1(), nullptr, host);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  void* baseline = malloc(size_);
+  ASSERT_NE(baseline, nullptr);
+  memset(baseline, 0, size_);
+
+  hsa_signal_t signal;
+  err = hsa_signal_create(1, 0, nullptr, &signal);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  rocrtst::PerfTimer p_timer;
+  int timer = p_timer.CreateTimer();
+
+  auto time_copy = [&](void* dst, hsa_agent_t dst_agent, const void* src,
+                       hsa_agent_t src_agent) {
+    double total = 0;
+    for (int i = 0; i <= kIterations; i++) {
+      hsa_signal_store_relaxed(signal, 1);
+      p_timer.StartTimer(timer);
+      err = hsa_amd_memory_async_copy(dst, dst_agent, src, src_agent, size_, 0, nullptr,
+                                      signal);
+      EXPECT_EQ(HSA_STATUS_SUCCESS, err);
+      while (hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX,
+                                       HSA_WAIT_STATE_ACTIVE) != 0) {
+      }
+      p_timer.StopTimer(timer);
+      if (i != 0) total += p_timer.ReadTimer(timer);
+      p_timer.ResetTimer(timer);
+    }
+    return GBps(size_, total / kIterations);
+  };
+
+  result.h2d = time_copy(dev, *gpu_device1(), host, *cpu_device());
+  result.d2h = time_copy(host, *cpu_device(), dev, *gpu_device1());
+
+  double total = 0;
+  for (int i = 0; i <= kIterations; i++) {
+    p_timer.StartTimer(timer);
+    memcpy(baseline, host, size_);
+    p_timer.StopTimer(timer);
+    if (i != 0) total += p_timer.ReadTimer(timer);
+    p_timer.ResetTimer(timer);
+  }
+  result.memcpy = GBps(size_, total / kIterations);
+
+  err = hsa_signal_destroy(signal);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  free(baseline);
+  err = hsa_amd_memory_pool_free(dev);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_amd_memory_pool_free(host);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  results_.push_back(result);
+}
+
+void MemoryHostNumaPolicy::Run(void) {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::Run();
+
+  if (numa_available() == -1) {
+    std::cout << "NUMA is not available, skipping." << std::endl;
+    return;
+  }
+
+  RunPolicy("default", 0);
+  RunPolicy("interleave", HSA_AMD_MEMORY_POOL_NUMA_INTERLEAVE_FLAG);
+  RunPolicy("bind", HSA_AMD_MEMORY_POOL_NUMA_BIND_FLAG);
+  RunPolicy("local", HSA_AMD_MEMORY_POOL_NUMA_LOCAL_FLAG);
+
+  // Only one placement flag may be given.
+  void* ptr = nullptr;
+  hsa_status_t err = hsa_amd_memory_pool_allocate(
+      cpu_pool(), size_, HSA_AMD_MEMORY_POOL_NUMA_INTERLEAVE_FLAG |
+      HSA_AMD_MEMORY_POOL_NUMA_BIND_FLAG, &ptr);
+  EXPECT_EQ(HSA_STATUS_ERROR_INVALID_ARGUMENT, err);
+}
+
+void MemoryHostNumaPolicy::DisplayTestInfo(void) {
+  TestBase::DisplayTestInfo();
+}
+
+void MemoryHostNumaPolicy::DisplayResults(void) const {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::DisplayResults();
+
+  std::cout << "Buffer size: " << size_ << " bytes, CPU pool node " << pool_node_ << std::endl;
+  std::cout << std::setw(12) << "Policy" << std::setw(24) << "Pages per node"
+            << std::setw(11) << "Placement" << std::setw(12) << "H2D GB/s"
+            << std::setw(12) << "D2H GB/s" << std::setw(14) << "memcpy GB/s" << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+  for (const auto& r : results_) {
+    std::string pages;
+    for (size_t n = 0; n < r.pages_per_node.size(); n++) {
+      if (n != 0) pages += "/";
+      pages += std::to_string(r.pages_per_node[n]);
+    }
+    std::cout << std::setw(12) << r.policy << std::setw(24) << pages
+              << std::setw(11) << (r.placement_ok ? "ok" : "MISMATCH") << std::setw(12)
+              << r.h2d << std::setw(12) << r.d2h << std::setw(14) << r.memcpy << std::endl;
+  }
+}
+
+void MemoryHostNumaPolicy::Close(void) {
+  TestBase::Close();
+}
@@ -0,0 +1,106 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#ifndef ROCRTST_SUITES_PERFORMANCE_MEMORY_HOST_NUMA_POLICY_H_
+#define ROCRTST_SUITES_PERFORMANCE_MEMORY_HOST_NUMA_POLICY_H_
+
+#include <string>
+#include <vector>
+
+#include "suites/test_common/test_base.h"
+#include "common/base_rocr.h"
+#include "hsa/hsa.h"
+
+// @Brief: This class allocates host memory from the CPU pool under each
+//  NUMA placement flag, reports where the pages landed according to
+//  get_mempolicy, and measures host to device and device to host copy
+//  bandwidth against a CPU-only memcpy of the same buffer.
+
+class MemoryHostNumaPolicy : public TestBase {
+ public:
+  // @Brief: Constructor
+  MemoryHostNumaPolicy(void);
+
+  // @Brief: Destructor
+  virtual ~MemoryHostNumaPolicy(void);
+
+  // @Brief: Set up the environment for the test
+  virtual void SetUp(void);
+
+  // @Brief: Run the test case
+  virtual void Run(void);
+
+  // @Brief: Display  results we got
+  virtual void DisplayResults(void) const;
+
+  // @Brief: Display information about what this test does
+  virtual void DisplayTestInfo(void);
+
+  // @Brief: Clean up and close the runtime
+  virtual void Close(void);
+
+ private:
+  struct Result {
+    std::string policy;
+    // Pages found on each NUMA node
+    std::vector<size_t> pages_per_node;
+    // Whether the placement matches the policy
+    bool placement_ok;
+    // Bandwidth in GB/s
+    double h2d;
+    double d2h;
+    double memcpy;
+  };
+
+  // @Brief: Allocate with one policy flag and record placement and bandwidth
+  void RunPolicy(const char* name, uint32_t flag);
+
+  // @Brief: Size of each buffer
+  size_t size_;
+  // @Brief: NUMA node of the CPU pool
+  uint32_t pool_node_;
+  std::vector<Result> results_;
+};
+
+#endif  // ROCRTST_SUITES_PERFORMANCE_MEMORY_HOST_NUMA_POLICY_H_
@@ -0,0 +1,207 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "suites/performance/memory_lock_cache.h"
+#include "common/base_rocr_utils.h"
+#include "common/common.h"
+#include "common/hsatimer.h"
+#include "gtest/gtest.h"
+#include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
+
+// Ring buffers and the slot each request locks.
+static const int kRings = 8;
+static const size_t kRingSize = 4 * 1024 * 1024;
+static const size_t kSlotSize = 64 * 1024;
+// Requests per mode, after one untimed pass over every slot.
+static const int kRequests = 10000;
+
+MemoryLockCache::MemoryLockCache(void) : TestBase() {
+  set_num_iteration(kRequests);
+  set_title("Host Memory Lock Cache");
+  set_description("This test locks 64KB slots of eight 4MB malloc'd ring "
+      "buffers with hsa_amd_memory_lock for every request and unlocks them "
+      "afterwards, as an I/O stack would. It reports the average lock and "
+      "unlock time and the HSA_AMD_SYSTEM_INFO_LOCK_CACHE_* counters, with "
+      "the rings held locked and with whole rings locked per request. Set "
+      "HSA_LOCK_CACHE_SIZE to keep unlocked rings pinned between requests.");
+}
+
+MemoryLockCache::~MemoryLockCache(void) {
+}
+
+void MemoryLockCache::SetUp(void) {
+  hsa_status_t err;
+  TestBase::SetUp();
+
+  err = rocrtst::SetDefaultAgents(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  for (int i = 0; i < kRings; i++) {
+    void* ring = aligned_alloc(4096, kRingSize);
+    ASSERT_NE(ring, nullptr);
+    memset(ring, 0, kRingSize);
+    rings_.push_back(ring);
+  }
+}
+
+static void LockCounters(uint64_t* hits, uint64_t* misses, size_t* cached) {
+  hsa_status_t err;
+  err = hsa_system_get_info(HSA_AMD_SYSTEM_INFO_LOCK_CACHE_HITS, hits);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_system_get_info(HSA_AMD_SYSTEM_INFO_LOCK_CACHE_MISSES, misses);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_system_get_info(HSA_AMD_SYSTEM_INFO_LOCK_CACHE_SIZE, cached);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+void MemoryLockCache::RunMode(const char* name, bool hold_rings) {
+  hsa_status_t err;
+  Result result;
+  result.mode = name;
+
+  std::vector<void*> ring_agent(kRings, nullptr);
+  if (hold_rings) {
+    for (int i = 0; i < kRings; i++) {
+      err = hsa_amd_memory_lock(rings_[i], kRingSize, gpu_device1(), 1, &ring_agent[i]);
+      ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    }
+  }
+
+  const size_t slots = kRingSize / kSlotSize;
+  auto request = [&](int n) {
+    const int ring = n % kRings;
+    const size_t offset = ((n / kRings) % slots) * kSlotSize;
+    uint8_t* host = static_cast<uint8_t*>(rings_[ring]);
+    void* agent_ptr = nullptr;
+    if (hold_rings) {
+      err = hsa_amd_memory_lock(host + offset, kSlotSize, gpu_device1(), 1, &agent_ptr);
+      ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+      // A covered slot must resolve within the ring's mapping.
+      EXPECT_EQ(static_cast<uint8_t*>(ring_agent[ring]) + offset, agent_ptr);
+      err = hsa_amd_memory_unlock(host + offset);
+    } else {
+      err = hsa_amd_memory_lock(host, kRingSize, gpu_device1(), 1, &agent_ptr);
+      ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+      err = hsa_amd_memory_unlock(host);
+    }
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  };
+
+  for (int n = 0; n < static_cast<int>(kRings * slots); n++) request(n);
+
+  uint64_t hits, misses;
+  size_t cached;
+  LockCounters(&hits, &misses, &cached);
+
+  rocrtst::PerfTimer p_timer;
+  int timer = p_timer.CreateTimer();
+  p_timer.StartTimer(timer);
+  for (int n = 0; n < kRequests; n++) request(n);
+  p_timer.StopTimer(timer);
+  result.lock_us = p_timer.ReadTimer(timer) * 1e6 / kRequests;
+
+  LockCounters(&result.hits, &result.misses, &result.cached);
+  result.hits -= hits;
+  result.misses -= misses;
+
+  if (hold_rings) {
+    for (int i = 0; i < kRings; i++) {
+      err = hsa_amd_memory_unlock(rings_[i]);
+      ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    }
+  }
+
+  results_.push_back(result);
+}
+
+void MemoryLockCache::Run(void) {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::Run();
+
+  RunMode("held", true);
+  RunMode("per-request", false);
+
+  // Every slot lock is covered by its held ring.
+  ASSERT_EQ(2u, results_.size());
+  EXPECT_EQ(0u, results_[0].misses);
+}
+
+void MemoryLockCache::DisplayTestInfo(void) {
+  TestBase::DisplayTestInfo();
+}
+
+void MemoryLockCache::DisplayResults(void) const {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::DisplayResults();
+
+  std::cout << kRequests << " requests over " << kRings << " rings of " << kRingSize
+            << " bytes, " << kSlotSize << " byte slots" << std::endl;
+  std::cout << std::setw(14) << "Mode" << std::setw(16) << "Lock+unlock us"
+            << std::setw(10) << "Hits" << std::setw(10) << "Misses"
+            << std::setw(16) << "Cached bytes" << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+  for (const auto& r : results_) {
+    std::cout << std::setw(14) << r.mode << std::setw(16) << r.lock_us << std::setw(10)
+              << r.hits << std::setw(10) << r.misses << std::setw(16) << r.cached << std::endl;
+  }
+}
+
+void MemoryLockCache::Close(void) {
+  for (auto ring : rings_) free(ring);
+  rings_.clear();
+  TestBase::Close();
+}
@@ -0,0 +1,170 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+#include "suites/performance/queue_create_latency.h"
+#include "common/base_rocr_utils.h"
+#include "common/common.h"
+#include "common/helper_funcs.h"
+#include "common/hsatimer.h"
+#include "gtest/gtest.h"
+#include "hsa/hsa.h"
+
+static const uint32_t kQueueSizes[] = {64, 1024, 4096, 65536};
+
+QueueCreateLatency::QueueCreateLatency(void) : TestBase() {
+#if ROCRTST_EMULATOR_BUILD
+  set_num_iteration(1);
+#else
+  set_num_iteration(200);
+#endif
+  set_title("Queue Create/Destroy Latency");
+  set_description("This test measures the average time of hsa_queue_create and "
+      "hsa_queue_destroy for queues that are destroyed right after creation, "
+      "as frameworks do for short lived streams.");
+}
+
+QueueCreateLatency::~QueueCreateLatency(void) {
+}
+
+void QueueCreateLatency::SetUp(void) {
+  hsa_status_t err;
+  TestBase::SetUp();
+
+  err = rocrtst::SetDefaultAgents(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+void QueueCreateLatency::Run(void) {
+  hsa_status_t err;
+
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::Run();
+
+  uint32_t max_size = 0;
+  err = hsa_agent_get_info(*gpu_device1(), HSA_AGENT_INFO_QUEUE_MAX_SIZE,
+                           &max_size);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  rocrtst::PerfTimer p_timer;
+  int create_id = p_timer.CreateTimer();
+  int destroy_id = p_timer.CreateTimer();
+
+  for (uint32_t size : kQueueSizes) {
+    if (size > max_size) {
+      continue;
+    }
+
+    std::vector<double> create_time;
+    std::vector<double> destroy_time;
+
+    // One extra round to leave out first use costs.
+    for (uint32_t i = 0; i <= num_iteration(); i++) {
+      hsa_queue_t* q = nullptr;
+
+      p_timer.StartTimer(create_id);
+      err = hsa_queue_create(*gpu_device1(), size, HSA_QUEUE_TYPE_SINGLE,
+                             nullptr, nullptr, UINT32_MAX, UINT32_MAX, &q);
+      p_timer.StopTimer(create_id);
+      ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+      p_timer.StartTimer(destroy_id);
+      err = hsa_queue_destroy(q);
+      p_timer.StopTimer(destroy_id);
+      ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+      if (i != 0) {
+        create_time.push_back(p_timer.ReadTimer(create_id));
+        destroy_time.push_back(p_timer.ReadTimer(destroy_id));
+      }
+      p_timer.ResetTimer(create_id);
+      p_timer.ResetTimer(destroy_id);
+    }
+
+    Result res;
+    res.queue_size = size;
+    res.create_mean = rocrtst::CalcMean(create_time);
+    res.destroy_mean = rocrtst::CalcMean(destroy_time);
+    results_.push_back(res);
+
+    if (verbosity() >= VERBOSE_PROGRESS) {
+      std::cout << ".";
+      fflush(stdout);
+    }
+  }
+
+  if (verbosity() >= VERBOSE_PROGRESS) {
+    std::cout << std::endl;
+  }
+}
+
+void QueueCreateLatency::DisplayTestInfo(void) {
+  TestBase::DisplayTestInfo();
+}
+
+void QueueCreateLatency::DisplayResults(void) const {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::DisplayResults();
+
+  std::cout << std::setw(12) << "Packets" << std::setw(16) << "Create (uS)"
+            << std::setw(16) << "Destroy (uS)" << std::endl;
+  for (const auto& res : results_) {
+    std::cout << std::setw(12) << res.queue_size << std::setw(16) << std::fixed
+              << std::setprecision(2) << res.create_mean * 1e6
+              << std::setw(16) << res.destroy_mean * 1e6 << std::endl;
+  }
+}
+
+void QueueCreateLatency::Close(void) {
+  TestBase::Close();
+}
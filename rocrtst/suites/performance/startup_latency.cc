@@ -0,0 +1,289 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <iomanip>
+#include <iostream>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "suites/performance/startup_latency.h"
+#include "common/base_rocr_utils.h"
+#include "common/common.h"
+#include "common/hsatimer.h"
+#include "gtest/gtest.h"
+#include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
+
+// Repetitions of each init to shutdown sequence.
+static const int kRepeats = 5;
+// Size of the host to device copy made on first use.
+static const size_t kCopySize = 1024 * 1024;
+// Threads racing to create the first queues on one GPU.
+static const uint32_t kFirstQueueThreads = 4;
+
+StartupLatency::StartupLatency(void) : TestBase(), num_gpus_(0) {
+  set_num_iteration(kRepeats);
+  set_title("Runtime Startup Latency");
+  set_description("This test times hsa_init, agent and pool discovery, the "
+      "first queue creation and first host to device copy on one GPU, queue "
+      "creation on the remaining GPUs, and hsa_shut_down. The first queues "
+      "are created by several threads at once, so a lazy GPU is brought up "
+      "under contention. It repeats the sequence for 1, 2, 4, ... of the "
+      "installed GPUs selected with ROCR_VISIBLE_DEVICES, with "
+      "HSA_ENABLE_LAZY_AGENT_INIT set to 0 (eager) and 1 (lazy).");
+}
+
+StartupLatency::~StartupLatency(void) {
+}
+
+void StartupLatency::SetUp(void) {
+  hsa_status_t err;
+  TestBase::SetUp();
+
+  std::vector<hsa_agent_t> gpus;
+  err = hsa_iterate_agents(rocrtst::IterateGPUAgents, &gpus);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  num_gpus_ = gpus.size();
+}
+
+// Restores an environment variable saved before the test changed it.
+static void RestoreEnv(const char* name, const char* saved) {
+  if (saved != nullptr)
+    setenv(name, saved, 1);
+  else
+    unsetenv(name);
+}
+
+void StartupLatency::RunTopology(const char* mode, uint32_t gpus) {
+  hsa_status_t err;
+  Result result = {mode, gpus, 0, 0, 0, 0, 0, 0};
+
+  std::string visible;
+  for (uint32_t i = 0; i < gpus; i++) {
+    if (i != 0) visible += ",";
+    visible += std::to_string(i);
+  }
+  setenv("ROCR_VISIBLE_DEVICES", visible.c_str(), 1);
+
+  rocrtst::PerfTimer p_timer;
+  int timer = p_timer.CreateTimer();
+  auto lap = [&]() {
+    p_timer.StopTimer(timer);
+    double ms = p_timer.ReadTimer(timer) * 1000.0 / kRepeats;
+    p_timer.ResetTimer(timer);
+    p_timer.StartTimer(timer);
+    return ms;
+  };
+
+  for (int i = 0; i < kRepeats; i++) {
+    p_timer.StartTimer(timer);
+    err = hsa_init();
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    result.init += lap();
+
+    std::vector<hsa_agent_t> agents;
+    err = hsa_iterate_agents(rocrtst::IterateGPUAgents, &agents);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    ASSERT_EQ(gpus, agents.size());
+    err = rocrtst::SetDefaultAgents(this);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    err = rocrtst::SetPoolsTypical(this);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    result.discover += lap();
+
+    // The first queue brings up scratch and the trap handler of a lazy agent. Several threads
+    // race to create it; the agent must be brought up once and every creation must succeed.
+    std::vector<hsa_queue_t*> queues(gpus - 1 + kFirstQueueThreads, nullptr);
+    uint32_t queue_size;
+    err = hsa_agent_get_info(agents[0], HSA_AGENT_INFO_QUEUE_MIN_SIZE, &queue_size);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    std::vector<hsa_status_t> status(kFirstQueueThreads, HSA_STATUS_ERROR);
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> ready(0);
+    std::atomic<bool> go(false);
+    for (uint32_t t = 0; t < kFirstQueueThreads; t++) {
+      threads.emplace_back([&, t]() {
+        ready++;
+        while (!go.load()) std::this_thread::yield();
+        status[t] = hsa_queue_create(agents[0], queue_size, HSA_QUEUE_TYPE_MULTI, nullptr,
+                                     nullptr, UINT32_MAX, UINT32_MAX, &queues[t]);
+      });
+    }
+    while (ready.load() != kFirstQueueThreads) std::this_thread::yield();
+    p_timer.ResetTimer(timer);
+    p_timer.StartTimer(timer);
+    go.store(true);
+    for (auto& thread : threads) thread.join();
+    result.first_queue += lap();
+    for (uint32_t t = 0; t < kFirstQueueThreads; t++) {
+      ASSERT_EQ(HSA_STATUS_SUCCESS, status[t]);
+      for (uint32_t u = 0; u < t; u++) ASSERT_NE(queues[u], queues[t]);
+    }
+
+    // The first copy creates the internal DMA queue and blit.
+    void* host = nullptr;
+    void* dev = nullptr;
+    hsa_signal_t signal;
+    err = hsa_amd_memory_pool_allocate(cpu_pool(), kCopySize, 0, &host);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    err = hsa_amd_memory_pool_allocate(device_pool(), kCopySize, 0, &dev);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    err = hsa_amd_agents_allow_access(1, gpu_device1(), nullptr, host);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    err = hsa_signal_create(1, 0, nullptr, &signal);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    p_timer.ResetTimer(timer);
+    p_timer.StartTimer(timer);
+    err = hsa_amd_memory_async_copy(dev, *gpu_device1(), host, *cpu_device(), kCopySize, 0,
+                                    nullptr, signal);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    while (hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX,
+                                     HSA_WAIT_STATE_BLOCKED) != 0) {
+    }
+    result.first_copy += lap();
+
+    for (uint32_t g = 1; g < gpus; g++) {
+      err = hsa_queue_create(agents[g], queue_size, HSA_QUEUE_TYPE_MULTI, nullptr, nullptr,
+                             UINT32_MAX, UINT32_MAX, &queues[kFirstQueueThreads - 1 + g]);
+      ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    }
+    result.other_queues += lap();
+
+    for (auto queue : queues) {
+      err = hsa_queue_destroy(queue);
+      ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    }
+    err = hsa_signal_destroy(signal);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    err = hsa_amd_memory_pool_free(dev);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    err = hsa_amd_memory_pool_free(host);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    p_timer.ResetTimer(timer);
+    p_timer.StartTimer(timer);
+    err = hsa_shut_down();
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+    result.shutdown += lap();
+    p_timer.StopTimer(timer);
+    p_timer.ResetTimer(timer);
+  }
+
+  results_.push_back(result);
+}
+
+void StartupLatency::Run(void) {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::Run();
+
+  if (num_gpus_ == 0) {
+    std::cout << "No GPU found, skipping." << std::endl;
+    return;
+  }
+
+  const char* env = getenv("ROCR_VISIBLE_DEVICES");
+  const bool had_visible = env != nullptr;
+  const std::string saved_visible = had_visible ? env : "";
+  env = getenv("HSA_ENABLE_LAZY_AGENT_INIT");
+  const bool had_lazy = env != nullptr;
+  const std::string saved_lazy = had_lazy ? env : "";
+
+  // Each sequence needs the runtime fully closed to reread the environment.
+  while (hsa_shut_down() == HSA_STATUS_SUCCESS) {
+  }
+
+  const char* modes[] = {"eager", "lazy"};
+  for (int m = 0; m < 2; m++) {
+    setenv("HSA_ENABLE_LAZY_AGENT_INIT", m == 0 ? "0" : "1", 1);
+    for (uint32_t gpus = 1;; gpus *= 2) {
+      if (gpus > num_gpus_) gpus = num_gpus_;
+      RunTopology(modes[m], gpus);
+      if (gpus == num_gpus_) break;
+    }
+  }
+
+  RestoreEnv("ROCR_VISIBLE_DEVICES", had_visible ? saved_visible.c_str() : nullptr);
+  RestoreEnv("HSA_ENABLE_LAZY_AGENT_INIT", had_lazy ? saved_lazy.c_str() : nullptr);
+
+  // Reopen for Close().
+  ASSERT_EQ(HSA_STATUS_SUCCESS, hsa_init());
+  ASSERT_EQ(HSA_STATUS_SUCCESS, rocrtst::SetDefaultAgents(this));
+}
+
+void StartupLatency::DisplayTestInfo(void) {
+  TestBase::DisplayTestInfo();
+}
+
+void StartupLatency::DisplayResults(void) const {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::DisplayResults();
+
+  std::cout << "Average of " << kRepeats << " runs, milliseconds" << std::endl;
+  std::cout << std::setw(7) << "Mode" << std::setw(6) << "GPUs" << std::setw(10) << "init"
+            << std::setw(10) << "discover" << std::setw(13) << "first queue"
+            << std::setw(12) << "first copy" << std::setw(14) << "other queues"
+            << std::setw(10) << "shutdown" << std::setw(10) << "total" << std::endl;
+  std::cout << std::fixed << std::setprecision(3);
+  for (const auto& r : results_) {
+    const double total =
+        r.init + r.discover + r.first_queue + r.first_copy + r.other_queues + r.shutdown;
+    std::cout << std::setw(7) << r.mode << std::setw(6) << r.gpus << std::setw(10) << r.init
+              << std::setw(10) << r.discover << std::setw(13) << r.first_queue
+              << std::setw(12) << r.first_copy << std::setw(14) << r.other_queues
+              << std::setw(10) << r.shutdown << std::setw(10) << total << std::endl;
+  }
+}
+
+void StartupLatency::Close(void) {
+  TestBase::Close();
+}
@@ -0,0 +1,198 @@
+/*
+ * =============================================================================
+ *   ROC Runtime Conformance Release License
+ * =============================================================================
+ * The University of Illinois/NCSA
+ * Open Source License (NCSA)
+ *
+ * Copyright (c) 2024, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD ROC Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "suites/performance/virtual_memory_map.h"
+#include "common/base_rocr_utils.h"
+#include "common/common.h"
+#include "common/hsatimer.h"
+#include "gtest/gtest.h"
+#include "hsa/hsa.h"
+#include "hsa/hsa_ext_amd.h"
+
+// Number of live mappings.
+static const size_t kMappings = 100000;
+// Mappings covered by each ranged hsa_amd_vmem_set_access call.
+static const size_t kSpanMappings = 64;
+
+VirtMemoryMapStress::VirtMemoryMapStress(void)
+    : TestBase(), mappings_(kMappings), granule_(0), map_mean_(0), set_access_mean_(0),
+      set_access_span_mean_(0), get_access_mean_(0), unmap_mean_(0) {
+  set_num_iteration(1);
+  set_title("Virtual Memory Map Stress");
+  set_description("This test maps one granule sized handle at 100k adjacent "
+      "addresses of a single reservation, then measures the average time of "
+      "map, set access (per mapping and over spans of mappings), get access "
+      "and unmap with every mapping live.");
+}
+
+VirtMemoryMapStress::~VirtMemoryMapStress(void) {
+}
+
+void VirtMemoryMapStress::SetUp(void) {
+  hsa_status_t err;
+  TestBase::SetUp();
+
+  err = rocrtst::SetDefaultAgents(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  err = rocrtst::SetPoolsTypical(this);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+void VirtMemoryMapStress::Run(void) {
+  hsa_status_t err;
+
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::Run();
+
+  rocrtst::pool_info_t pool_i;
+  err = rocrtst::AcquirePoolInfo(device_pool(), &pool_i);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  granule_ = pool_i.alloc_granule;
+
+  void* base = nullptr;
+  err = hsa_amd_vmem_address_reserve(&base, mappings_ * granule_, 0, 0);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  // The same handle backs every mapping so only address space grows with the count.
+  hsa_amd_vmem_alloc_handle_t handle;
+  err = hsa_amd_vmem_handle_create(device_pool(), granule_, MEMORY_TYPE_NONE, 0, &handle);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+
+  auto chunk = [&](size_t i) { return static_cast<uint8_t*>(base) + i * granule_; };
+
+  hsa_amd_memory_access_desc_t desc;
+  desc.permissions = HSA_ACCESS_PERMISSION_RW;
+  desc.agent_handle = *gpu_device1();
+
+  rocrtst::PerfTimer p_timer;
+  int timer = p_timer.CreateTimer();
+
+  p_timer.StartTimer(timer);
+  for (size_t i = 0; i < mappings_; i++) {
+    err = hsa_amd_vmem_map(chunk(i), granule_, 0, handle, 0);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  }
+  p_timer.StopTimer(timer);
+  map_mean_ = p_timer.ReadTimer(timer) / mappings_;
+  p_timer.ResetTimer(timer);
+
+  p_timer.StartTimer(timer);
+  for (size_t i = 0; i < mappings_; i++) {
+    err = hsa_amd_vmem_set_access(chunk(i), granule_, &desc, 1);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  }
+  p_timer.StopTimer(timer);
+  set_access_mean_ = p_timer.ReadTimer(timer) / mappings_;
+  p_timer.ResetTimer(timer);
+
+  // Access is unchanged, so this measures walking the mappings of each span.
+  const size_t spans = mappings_ / kSpanMappings;
+  p_timer.StartTimer(timer);
+  for (size_t i = 0; i < spans; i++) {
+    err = hsa_amd_vmem_set_access(chunk(i * kSpanMappings), kSpanMappings * granule_, &desc, 1);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  }
+  p_timer.StopTimer(timer);
+  set_access_span_mean_ = p_timer.ReadTimer(timer) / spans;
+  p_timer.ResetTimer(timer);
+
+  hsa_access_permission_t perm;
+  p_timer.StartTimer(timer);
+  for (size_t i = 0; i < mappings_; i++) {
+    // Stride through the reservation so lookups do not hit neighbouring entries.
+    err = hsa_amd_vmem_get_access(chunk((i * 7919) % mappings_) + granule_ / 2, &perm,
+                                  *gpu_device1());
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  }
+  p_timer.StopTimer(timer);
+  get_access_mean_ = p_timer.ReadTimer(timer) / mappings_;
+  p_timer.ResetTimer(timer);
+  ASSERT_EQ(HSA_ACCESS_PERMISSION_RW, perm);
+
+  p_timer.StartTimer(timer);
+  for (size_t i = 0; i < mappings_; i++) {
+    err = hsa_amd_vmem_unmap(chunk(i), granule_);
+    ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  }
+  p_timer.StopTimer(timer);
+  unmap_mean_ = p_timer.ReadTimer(timer) / mappings_;
+
+  err = hsa_amd_vmem_handle_release(handle);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+  err = hsa_amd_vmem_address_free(base, mappings_ * granule_);
+  ASSERT_EQ(HSA_STATUS_SUCCESS, err);
+}
+
+void VirtMemoryMapStress::DisplayTestInfo(void) {
+  TestBase::DisplayTestInfo();
+}
+
+void VirtMemoryMapStress::DisplayResults(void) const {
+  if (!rocrtst::CheckProfile(this)) {
+    return;
+  }
+
+  TestBase::DisplayResults();
+
+  std::cout << "Live mappings: " << mappings_ << " x " << granule_ << " bytes" << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << std::setw(28) << "map (uS): " << map_mean_ * 1e6 << std::endl;
+  std::cout << std::setw(28) << "set_access (uS): " << set_access_mean_ * 1e6 << std::endl;
+  std::cout << std::setw(28) << "set_access x" << kSpanMappings << " (uS): "
+            << set_access_span_mean_ * 1e6 << std::endl;
+  std::cout << std::setw(28) << "get_access (uS): " << get_access_mean_ * 1e6 << std::endl;
+  std::cout << std::setw(28) << "unmap (uS): " << unmap_mean_ * 1e6 << std::endl;
+}
+
+void VirtMemoryMapStress::Close(void) {
+  TestBase::Close();
+}
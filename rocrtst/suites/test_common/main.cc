@@ -58,10 +58,18 @@
 #include "suites/functional/memory_allocation.h"
 #include "suites/functional/deallocation_notifier.h"
 #include "suites/functional/virtual_memory.h"
+#include "suites/functional/memory_async_copy_batch.h"
+#include "suites/functional/memory_async_copy_rect.h"
 #include "suites/performance/dispatch_time.h"
 #include "suites/performance/memory_async_copy.h"
 #include "suites/performance/memory_async_copy_numa.h"
+#include "suites/performance/memory_copy_latency.h"
+#include "suites/performance/queue_create_latency.h"
 #include "suites/performance/enqueueLatency.h"
+#include "suites/performance/virtual_memory_map.h"
+#include "suites/performance/memory_host_numa_policy.h"
+#include "suites/performance/memory_lock_cache.h"
+#include "suites/performance/startup_latency.h"
 #include "suites/negative/memory_allocate_negative_tests.h"
 #include "suites/negative/queue_validation.h"
 #include "suites/stress/memory_concurrent_tests.h"
@@ -214,6 +222,20 @@ TEST(rocrtstFunc, Signal_Create_Concurrently) {
   RunCustomTestEpilog(&sd);
 }
 
+TEST(rocrtstFunc, Signal_Many_Waiters) {
+  SignalConcurrentTest sd(false, false, false, false, true);
+  RunCustomTestProlog(&sd);
+  sd.TestSignalManyWaiters();
+  RunCustomTestEpilog(&sd);
+}
+
+TEST(rocrtstFunc, Signal_Host_Only) {
+  SignalConcurrentTest sd(false, false, false, false, false, true);
+  RunCustomTestProlog(&sd);
+  sd.TestSignalHostOnly();
+  RunCustomTestEpilog(&sd);
+}
+
 /* Temporary: Disable CU Masking until it is fixed */
 TEST(rocrtstFunc, DISABLED_CU_Masking) {
   CU_Masking sd;
@@ -374,6 +396,16 @@ TEST(rocrtstFunc, Deallocation_Notifier_Test) {
   RunGenericTest(&notifier);
 }
 
+TEST(rocrtstFunc, Memory_Async_Copy_Rect) {
+  MemoryAsyncCopyRect mcr;
+  RunGenericTest(&mcr);
+}
+
+TEST(rocrtstFunc, Memory_Async_Copy_Batch) {
+  MemoryAsyncCopyBatch mcb;
+  RunGenericTest(&mcb);
+}
+
 TEST(rocrtstFunc, AgentProp_UUID) {
   AgentPropTest propTest;
   RunCustomTestProlog(&propTest);
@@ -513,6 +545,36 @@ TEST(rocrtstPerf, ENQUEUE_LATENCY) {
   RunGenericTest(&multiPacketequeue);
 }
 
+TEST(rocrtstPerf, Memory_Copy_Latency) {
+  MemoryCopyLatency mcl;
+  RunGenericTest(&mcl);
+}
+
+TEST(rocrtstPerf, Queue_Create_Latency) {
+  QueueCreateLatency qcl;
+  RunGenericTest(&qcl);
+}
+
+TEST(rocrtstPerf, Virtual_Memory_Map_Stress) {
+  VirtMemoryMapStress vms;
+  RunGenericTest(&vms);
+}
+
+TEST(rocrtstPerf, Memory_Host_NUMA_Policy) {
+  MemoryHostNumaPolicy mhnp;
+  RunGenericTest(&mhnp);
+}
+
+TEST(rocrtstPerf, Memory_Lock_Cache) {
+  MemoryLockCache mlc;
+  RunGenericTest(&mlc);
+}
+
+TEST(rocrtstPerf, Startup_Latency) {
+  StartupLatency sl;
+  RunGenericTest(&sl);
+}
+
 TEST(rocrtstPerf, DISABLED_Memory_Async_Copy_NUMA) {
   MemoryAsyncCopyNUMA numa;
   RunGenericTest(&numa);
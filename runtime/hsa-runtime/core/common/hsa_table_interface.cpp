@@ -1312,6 +1312,15 @@ hsa_status_t HSA_API hsa_amd_enable_logging(uint8_t* flags, void* file) {
   return amdExtTable->hsa_amd_enable_logging_fn(flags, file);
 }
 
+hsa_status_t HSA_API hsa_amd_memory_async_copy_batch(const hsa_amd_copy_desc_t* copies, size_t count,
+                                                     hsa_agent_t dst_agent, hsa_agent_t src_agent,
+                                                     uint32_t num_dep_signals,
+                                                     const hsa_signal_t* dep_signals,
+                                                     hsa_signal_t completion_signal) {
+  return amdExtTable->hsa_amd_memory_async_copy_batch_fn(
+      copies, count, dst_agent, src_agent, num_dep_signals, dep_signals, completion_signal);
+}
+
 // Tools only table interfaces.
 namespace rocr {
 
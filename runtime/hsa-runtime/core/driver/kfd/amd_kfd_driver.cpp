@@ -133,6 +133,16 @@ KfdDriver::AllocateMemory(const core::MemoryRegion &mem_region,
             ? 1
             : kmt_alloc_flags.ui32.Uncached);
 
+  if (m_region.IsSystem()) {
+    // Per allocation NUMA placement, otherwise the thunk applies HSA_HOST_NUMA_POLICY.
+    if (alloc_flags & core::MemoryRegion::AllocateNumaInterleave)
+      kmt_alloc_flags.ui32.NUMAInterleave = 1;
+    else if (alloc_flags & core::MemoryRegion::AllocateNumaBind)
+      kmt_alloc_flags.ui32.NoSubstitute = 1;
+    else if (alloc_flags & core::MemoryRegion::AllocateNumaLocal)
+      kmt_alloc_flags.ui32.NoNUMABind = 1;
+  }
+
   if (m_region.IsLocalMemory()) {
     // Allocate physically contiguous memory. AllocateKfdMemory function call
     // will fail if this flag is not supported in KFD.
@@ -175,6 +185,11 @@ KfdDriver::AllocateMemory(const core::MemoryRegion &mem_region,
   *mem = AllocateKfdMemory(kmt_alloc_flags, node_id, size);
   if (*mem == nullptr) {
     m_region.owner()->Trim();
+    // System memory also backs the pooled AQL rings of every GPU.
+    if (m_region.IsSystem()) {
+      for (auto agent : core::Runtime::runtime_singleton_->gpu_agents())
+        static_cast<AMD::GpuAgent*>(agent)->TrimRingBuffers();
+    }
     *mem = AllocateKfdMemory(kmt_alloc_flags, node_id, size);
   }
 
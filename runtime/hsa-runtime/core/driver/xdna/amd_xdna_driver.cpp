@@ -45,6 +45,9 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <string>
 
@@ -57,10 +60,37 @@
 namespace rocr {
 namespace AMD {
 
-XdnaDriver::XdnaDriver(std::string devnode_name)
-    : core::Driver(core::DriverType::XDNA, devnode_name) {}
+namespace {
+/// @brief Builds the first word of an ERT command. It has the same fields as
+/// the state word of hsa_amd_aie_ert_packet_t.
+uint32_t ErtHeader(uint32_t state, uint32_t custom, uint32_t count,
+                   uint32_t opcode, uint32_t type) {
+  return (state & 0xF) | ((custom & 0xFF) << 4) | ((count & 0x7FF) << 12) |
+         ((opcode & 0x1F) << 23) | ((type & 0xF) << 28);
+}
+} // namespace
 
-XdnaDriver::~XdnaDriver() { FreeDeviceHeap(); }
+XdnaDriver::XdnaDriver(std::string devnode_name)
+    : core::Driver(core::DriverType::XDNA, devnode_name),
+      dev_bo_heap_(new SimpleHeap<BoBlockAllocator>(
+          BoBlockAllocator(*this, AMDXDNA_BO_DEV))),
+      cmd_bo_heap_(new SimpleHeap<BoBlockAllocator>(
+          BoBlockAllocator(*this, AMDXDNA_BO_CMD))),
+      cmd_sink_(new CommandSink(*this)) {}
+
+XdnaDriver::~XdnaDriver() {
+  cmd_sink_.reset();
+  {
+    ScopedAcquire<KernelMutex> lock(&bo_lock_);
+    // Return cached pool blocks, then close whatever the application leaked
+    // so the BOs don't outlive the driver.
+    dev_bo_heap_.reset();
+    cmd_bo_heap_.reset();
+    while (!vmem_handle_mappings.empty())
+      ReleaseBo(vmem_handle_mappings.begin()->first);
+  }
+  FreeDeviceHeap();
+}
 
 hsa_status_t XdnaDriver::DiscoverDriver() {
   const int max_minor_num(64);
@@ -135,65 +165,89 @@ XdnaDriver::AllocateMemory(const core::MemoryRegion &mem_region,
                            void **mem, size_t size, uint32_t node_id) {
   const MemoryRegion &m_region(static_cast<const MemoryRegion &>(mem_region));
 
-  amdxdna_drm_create_bo create_bo_args{0};
-  create_bo_args.size = size;
-
-  amdxdna_drm_get_bo_info get_bo_info_args{0};
-  drm_gem_close close_bo_args{0};
-  void *mapped_mem(nullptr);
-
   if (!m_region.IsSystem()) {
     return HSA_STATUS_ERROR_INVALID_REGION;
   }
 
-  if (m_region.kernarg()) {
-    create_bo_args.type = AMDXDNA_BO_CMD;
-  } else {
-    create_bo_args.type = AMDXDNA_BO_DEV;
-  }
-
-  if (ioctl(fd_, DRM_IOCTL_AMDXDNA_CREATE_BO, &create_bo_args) < 0) {
-    return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
-  }
-
-  get_bo_info_args.handle = create_bo_args.handle;
-  // In case we need to close this BO to avoid leaks due to some error after
-  // creation.
-  close_bo_args.handle = create_bo_args.handle;
+  return AllocateBoMemory(m_region.kernarg() ? AMDXDNA_BO_CMD : AMDXDNA_BO_DEV,
+                          alloc_flags, mem, size);
+}
 
-  if (ioctl(fd_, DRM_IOCTL_AMDXDNA_GET_BO_INFO, &get_bo_info_args) < 0) {
-    // Close the BO in the case we can't get info about it.
-    ioctl(fd_, DRM_IOCTL_GEM_CLOSE, &close_bo_args);
-    return HSA_STATUS_ERROR;
+hsa_status_t
+XdnaDriver::AllocateBoMemory(uint32_t type,
+                             core::MemoryRegion::AllocateFlags alloc_flags,
+                             void **mem, size_t size) {
+  ScopedAcquire<KernelMutex> lock(&bo_lock_);
+
+  // Small buffers share pooled BOs. Handle-only allocations need a BO of
+  // their own since the handle is what the caller gets back.
+  if (!(alloc_flags & core::MemoryRegion::AllocateMemoryOnly) &&
+      size <= kSubAllocLimit) {
+    try {
+      *mem = BoHeap(type).alloc(size);
+      return HSA_STATUS_SUCCESS;
+    } catch (const hsa_exception &e) {
+      return e.error_code();
+    }
   }
 
-  /// TODO: For now we always map the memory and keep a mapping from handles
-  /// to VA memory addresses. Once we can support the separate VMEM call to
-  /// map handles we can fix this.
-  if (m_region.kernarg()) {
-    mapped_mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
-                      get_bo_info_args.map_offset);
-    if (mapped_mem == MAP_FAILED) {
-      // Close the BO in the case when a mapping fails and we got a BO handle.
-      ioctl(fd_, DRM_IOCTL_GEM_CLOSE, &close_bo_args);
-      return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
-    }
-  } else {
-    mapped_mem = reinterpret_cast<void *>(get_bo_info_args.vaddr);
+  uint32_t handle(0);
+  void *mapped_mem(nullptr);
+  hsa_status_t status(CreateBo(type, size, &handle, &mapped_mem));
+  if (status != HSA_STATUS_SUCCESS) {
+    return status;
   }
 
   if (alloc_flags & core::MemoryRegion::AllocateMemoryOnly) {
-    *mem = reinterpret_cast<void *>(create_bo_args.handle);
+    *mem = reinterpret_cast<void *>(handle);
   } else {
     *mem = mapped_mem;
   }
 
-  vmem_handle_mappings.emplace(create_bo_args.handle, mapped_mem);
-
   return HSA_STATUS_SUCCESS;
 }
 
 hsa_status_t XdnaDriver::FreeMemory(void *mem, size_t size) {
+  ScopedAcquire<KernelMutex> lock(&bo_lock_);
+
+  if (dev_bo_heap_->free(mem) || cmd_bo_heap_->free(mem)) {
+    return HSA_STATUS_SUCCESS;
+  }
+
+  auto it(bo_handles_by_va_.find(reinterpret_cast<uintptr_t>(mem)));
+  if (it != bo_handles_by_va_.end()) {
+    return ReleaseBo(it->second);
+  }
+
+  // Handle-only allocations are returned to the caller as the handle itself.
+  const uintptr_t handle(reinterpret_cast<uintptr_t>(mem));
+  if (handle <= std::numeric_limits<uint32_t>::max() &&
+      vmem_handle_mappings.count(static_cast<uint32_t>(handle)) != 0) {
+    return ReleaseBo(static_cast<uint32_t>(handle));
+  }
+
+  return HSA_STATUS_ERROR_INVALID_ALLOCATION;
+}
+
+hsa_status_t XdnaDriver::GetBoHandle(const void *ptr, uint32_t *handle,
+                                     size_t *offset) const {
+  const uintptr_t addr(reinterpret_cast<uintptr_t>(ptr));
+
+  ScopedAcquire<KernelMutex> lock(&bo_lock_);
+
+  auto it(bo_handles_by_va_.upper_bound(addr));
+  if (it == bo_handles_by_va_.begin()) {
+    return HSA_STATUS_ERROR_INVALID_ALLOCATION;
+  }
+  --it;
+
+  const BufferObject &bo(vmem_handle_mappings.at(it->second));
+  if (addr >= it->first + bo.size) {
+    return HSA_STATUS_ERROR_INVALID_ALLOCATION;
+  }
+
+  *handle = it->second;
+  *offset = addr - it->first;
   return HSA_STATUS_SUCCESS;
 }
 
@@ -226,6 +280,14 @@ hsa_status_t XdnaDriver::CreateQueue(core::Queue &queue) const {
 
   aie_queue.SetHwCtxHandle(create_hwctx_args.handle);
 
+  // There is no user-mode doorbell, so queue packets reach the context
+  // through command submission.
+  try {
+    aie_queue.SetCommandSink(*cmd_sink_);
+  } catch (const hsa_exception &e) {
+    return e.error_code();
+  }
+
   return HSA_STATUS_SUCCESS;
 }
 
@@ -245,6 +307,257 @@ hsa_status_t XdnaDriver::DestroyQueue(core::Queue &queue) const {
   return HSA_STATUS_SUCCESS;
 }
 
+hsa_status_t XdnaDriver::CreateBo(uint32_t type, size_t size,
+                                  uint32_t *handle, void **mem) {
+  amdxdna_drm_create_bo create_bo_args{0};
+  create_bo_args.size = size;
+  create_bo_args.type = type;
+
+  amdxdna_drm_get_bo_info get_bo_info_args{0};
+  drm_gem_close close_bo_args{0};
+  void *mapped_mem(nullptr);
+
+  if (ioctl(fd_, DRM_IOCTL_AMDXDNA_CREATE_BO, &create_bo_args) < 0) {
+    return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
+  }
+
+  get_bo_info_args.handle = create_bo_args.handle;
+  // In case we need to close this BO to avoid leaks due to some error after
+  // creation.
+  close_bo_args.handle = create_bo_args.handle;
+
+  if (ioctl(fd_, DRM_IOCTL_AMDXDNA_GET_BO_INFO, &get_bo_info_args) < 0) {
+    // Close the BO in the case we can't get info about it.
+    ioctl(fd_, DRM_IOCTL_GEM_CLOSE, &close_bo_args);
+    return HSA_STATUS_ERROR;
+  }
+
+  /// TODO: For now we always map the memory and keep a mapping from handles
+  /// to VA memory addresses. Once we can support the separate VMEM call to
+  /// map handles we can fix this.
+  const bool cpu_mapped(type == AMDXDNA_BO_CMD);
+  if (cpu_mapped) {
+    mapped_mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                      get_bo_info_args.map_offset);
+    if (mapped_mem == MAP_FAILED) {
+      // Close the BO in the case when a mapping fails and we got a BO handle.
+      ioctl(fd_, DRM_IOCTL_GEM_CLOSE, &close_bo_args);
+      return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
+    }
+  } else {
+    mapped_mem = reinterpret_cast<void *>(get_bo_info_args.vaddr);
+  }
+
+  vmem_handle_mappings[create_bo_args.handle] = {mapped_mem, size, cpu_mapped};
+  bo_handles_by_va_[reinterpret_cast<uintptr_t>(mapped_mem)] =
+      create_bo_args.handle;
+
+  *handle = create_bo_args.handle;
+  *mem = mapped_mem;
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t XdnaDriver::ReleaseBo(uint32_t handle) {
+  auto it(vmem_handle_mappings.find(handle));
+  if (it == vmem_handle_mappings.end()) {
+    return HSA_STATUS_ERROR_INVALID_ALLOCATION;
+  }
+
+  const BufferObject bo(it->second);
+  vmem_handle_mappings.erase(it);
+  bo_handles_by_va_.erase(reinterpret_cast<uintptr_t>(bo.vaddr));
+
+  if (bo.cpu_mapped) {
+    munmap(bo.vaddr, bo.size);
+  }
+
+  drm_gem_close close_bo_args{0};
+  close_bo_args.handle = handle;
+  if (ioctl(fd_, DRM_IOCTL_GEM_CLOSE, &close_bo_args) < 0) {
+    return HSA_STATUS_ERROR;
+  }
+
+  return HSA_STATUS_SUCCESS;
+}
+
+SimpleHeap<XdnaDriver::BoBlockAllocator> &XdnaDriver::BoHeap(uint32_t type) {
+  return (type == AMDXDNA_BO_CMD) ? *cmd_bo_heap_ : *dev_bo_heap_;
+}
+
+void *XdnaDriver::BoBlockAllocator::alloc(size_t request_size,
+                                          size_t &allocated_size) const {
+  uint32_t handle(0);
+  void *mem(nullptr);
+  const size_t size(AlignUp(request_size, block_size()));
+
+  hsa_status_t err(driver_.CreateBo(type_, size, &handle, &mem));
+  if (err != HSA_STATUS_SUCCESS)
+    throw AMD::hsa_exception(err, "XdnaDriver::BoBlockAllocator::alloc failed.");
+
+  allocated_size = size;
+  return mem;
+}
+
+void XdnaDriver::BoBlockAllocator::free(void *ptr, size_t length) const {
+  auto it(driver_.bo_handles_by_va_.find(reinterpret_cast<uintptr_t>(ptr)));
+  assert(it != driver_.bo_handles_by_va_.end() && "Unknown BO block.");
+  driver_.ReleaseBo(it->second);
+}
+
+XdnaDriver::CommandSink::~CommandSink() {
+  ScopedAcquire<KernelMutex> lock(&driver_.bo_lock_);
+  for (const CmdBo &bo : free_bos_)
+    driver_.ReleaseBo(bo.handle);
+  for (const auto &submission : in_flight_)
+    for (const CmdBo &bo : submission.second)
+      driver_.ReleaseBo(bo.handle);
+}
+
+hsa_status_t
+XdnaDriver::CommandSink::SubmitChain(uint32_t hw_ctx,
+                                     const hsa_amd_aie_ert_packet_t *const *cmds,
+                                     uint32_t count, uint64_t *seq) {
+  static_assert(sizeof(uint32_t) + sizeof(hsa_amd_aie_ert_command_chain_data_t) +
+                        AieCommandSubmitter::kMaxChainLength * sizeof(uint64_t) <=
+                    kCmdBoSize,
+                "Command chain does not fit in a command BO.");
+  assert(count != 0 && count <= AieCommandSubmitter::kMaxChainLength);
+
+  ScopedAcquire<KernelMutex> lock(&lock_);
+
+  // A single command is submitted directly, more are wrapped in a chain.
+  const uint32_t num_bos(count == 1 ? 1 : count + 1);
+  std::vector<CmdBo> bos(num_bos);
+  for (uint32_t i = 0; i < num_bos; ++i) {
+    hsa_status_t status(AcquireCmdBo(&bos[i]));
+    if (status != HSA_STATUS_SUCCESS) {
+      free_bos_.insert(free_bos_.end(), bos.begin(), bos.begin() + i);
+      return status;
+    }
+  }
+
+  // The ERT header lives in the AQL packet and the payload in the
+  // application's buffer, so each command is assembled in its own BO.
+  CmdBo *cmd_bos(&bos[num_bos - count]);
+  for (uint32_t i = 0; i < count; ++i) {
+    const hsa_amd_aie_ert_packet_t &ert(*cmds[i]);
+    cmd_bos[i].cmd[0] = ErtHeader(HSA_AMD_AIE_ERT_STATE_NEW, ert.custom,
+                                  ert.count, ert.opcode, ert.type);
+    memcpy(&cmd_bos[i].cmd[1], reinterpret_cast<const void *>(ert.payload_data),
+           ert.count * sizeof(uint32_t));
+  }
+
+  if (count > 1) {
+    auto *chain(
+        reinterpret_cast<hsa_amd_aie_ert_command_chain_data_t *>(&bos[0].cmd[1]));
+    memset(chain, 0, sizeof(*chain));
+    chain->command_count = count;
+    // The driver takes the BO handle of each command rather than its address.
+    for (uint32_t i = 0; i < count; ++i)
+      chain->data[i] = cmd_bos[i].handle;
+    bos[0].cmd[0] = ErtHeader(
+        HSA_AMD_AIE_ERT_STATE_NEW, 0,
+        (sizeof(*chain) + count * sizeof(uint64_t)) / sizeof(uint32_t),
+        HSA_AMD_AIE_ERT_CMD_CHAIN, HSA_AMD_AIE_ERT_CMD_TYPE_DEFAULT);
+  }
+
+  // The device can only reach buffers whose BOs are attached to the
+  // submission, so pass every BO the payloads point into.
+  std::vector<uint32_t> bo_args;
+  for (uint32_t i = 0; i < count; ++i)
+    AddPayloadBos(*cmds[i], &bo_args);
+  std::sort(bo_args.begin(), bo_args.end());
+  bo_args.erase(std::unique(bo_args.begin(), bo_args.end()), bo_args.end());
+
+  amdxdna_drm_exec_cmd exec_cmd_args{0};
+  exec_cmd_args.hwctx = hw_ctx;
+  exec_cmd_args.type = AMDXDNA_CMD_SUBMIT_EXEC_BUF;
+  exec_cmd_args.cmd_handles = bos[0].handle;
+  exec_cmd_args.args = reinterpret_cast<uintptr_t>(bo_args.data());
+  exec_cmd_args.cmd_count = 1;
+  exec_cmd_args.arg_count = bo_args.size();
+
+  if (ioctl(driver_.fd_, DRM_IOCTL_AMDXDNA_EXEC_CMD, &exec_cmd_args) < 0) {
+    free_bos_.insert(free_bos_.end(), bos.begin(), bos.end());
+    return HSA_STATUS_ERROR;
+  }
+
+  *seq = exec_cmd_args.seq;
+  in_flight_[std::make_pair(hw_ctx, exec_cmd_args.seq)] = std::move(bos);
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t XdnaDriver::CommandSink::WaitChain(uint32_t hw_ctx,
+                                                uint64_t seq) {
+  amdxdna_drm_wait_cmd wait_cmd_args{.hwctx = hw_ctx, .timeout = 0, .seq = seq};
+  const bool waited(ioctl(driver_.fd_, DRM_IOCTL_AMDXDNA_WAIT_CMD,
+                          &wait_cmd_args) >= 0);
+
+  ScopedAcquire<KernelMutex> lock(&lock_);
+
+  auto it(in_flight_.find(std::make_pair(hw_ctx, seq)));
+  if (it == in_flight_.end()) {
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  // A chain reports the state of the whole chain in its own header.
+  const uint32_t state(it->second[0].cmd[0] & 0xF);
+  if (waited) {
+    free_bos_.insert(free_bos_.end(), it->second.begin(), it->second.end());
+  } else {
+    // The device may still own the BOs, so hand them back to the kernel
+    // rather than reusing them.
+    ScopedAcquire<KernelMutex> bo_lock(&driver_.bo_lock_);
+    for (const CmdBo &bo : it->second)
+      driver_.ReleaseBo(bo.handle);
+  }
+  in_flight_.erase(it);
+
+  return (waited && state == HSA_AMD_AIE_ERT_STATE_COMPLETED)
+             ? HSA_STATUS_SUCCESS
+             : HSA_STATUS_ERROR;
+}
+
+void XdnaDriver::CommandSink::AddPayloadBos(
+    const hsa_amd_aie_ert_packet_t &ert, std::vector<uint32_t> *handles) const {
+  // Only kernel starts reference application buffers.
+  if (!AieCommandSubmitter::IsChainable(ert)) {
+    return;
+  }
+
+  // Buffer addresses are passed as pairs of DWORDs, low half first, after
+  // the CU mask. Arguments are packed, so a pair may start at any DWORD.
+  const auto *payload(
+      reinterpret_cast<const hsa_amd_aie_ert_start_kernel_data_t *>(
+          ert.payload_data));
+  const uint32_t num_data(ert.count > 0 ? ert.count - 1 : 0);
+  for (uint32_t i = 0; i + 1 < num_data; ++i) {
+    const uint64_t addr(uint64_t(payload->data[i]) |
+                        (uint64_t(payload->data[i + 1]) << 32));
+    uint32_t handle(0);
+    size_t offset(0);
+    if (driver_.GetBoHandle(reinterpret_cast<const void *>(addr), &handle,
+                            &offset) == HSA_STATUS_SUCCESS) {
+      handles->push_back(handle);
+    }
+  }
+}
+
+hsa_status_t XdnaDriver::CommandSink::AcquireCmdBo(CmdBo *bo) {
+  if (!free_bos_.empty()) {
+    *bo = free_bos_.back();
+    free_bos_.pop_back();
+    return HSA_STATUS_SUCCESS;
+  }
+
+  ScopedAcquire<KernelMutex> lock(&driver_.bo_lock_);
+  void *mem(nullptr);
+  hsa_status_t status(
+      driver_.CreateBo(AMDXDNA_BO_CMD, kCmdBoSize, &bo->handle, &mem));
+  bo->cmd = reinterpret_cast<uint32_t *>(mem);
+  return status;
+}
+
 hsa_status_t XdnaDriver::QueryDriverVersion() {
   amdxdna_drm_query_aie_version aie_version{0, 0};
   amdxdna_drm_get_info args{DRM_AMDXDNA_QUERY_AIE_VERSION, sizeof(aie_version),
@@ -287,12 +600,15 @@ hsa_status_t XdnaDriver::InitDeviceHeap() {
     return HSA_STATUS_ERROR;
   }
 
+  dev_heap_handle = create_bo_args.handle;
+
   dev_heap_parent = mmap(0, dev_heap_align * 2 - 1, PROT_READ | PROT_WRITE,
                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 
   if (dev_heap_parent == MAP_FAILED) {
     // Close the BO in the case when a mapping fails and we got a BO handle.
     ioctl(fd_, DRM_IOCTL_GEM_CLOSE, &close_bo_args);
+    dev_heap_handle = 0;
     dev_heap_parent = nullptr;
     return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
   }
@@ -305,9 +621,7 @@ hsa_status_t XdnaDriver::InitDeviceHeap() {
            MAP_SHARED | MAP_FIXED, fd_, get_bo_info_args.map_offset);
 
   if (dev_heap_aligned == MAP_FAILED) {
-    // Close the BO in the case when a mapping fails and we got a BO handle.
-    ioctl(fd_, DRM_IOCTL_GEM_CLOSE, &close_bo_args);
-    // Unmap the dev_heap_parent.
+    // Unmap the dev_heap_parent and close the BO.
     dev_heap_aligned = nullptr;
     FreeDeviceHeap();
     return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
@@ -327,6 +641,14 @@ hsa_status_t XdnaDriver::FreeDeviceHeap() {
     dev_heap_aligned = nullptr;
   }
 
+  // Device BOs are carved from the heap, so it is closed after them.
+  if (dev_heap_handle) {
+    drm_gem_close close_bo_args{0};
+    close_bo_args.handle = dev_heap_handle;
+    ioctl(fd_, DRM_IOCTL_GEM_CLOSE, &close_bo_args);
+    dev_heap_handle = 0;
+  }
+
   return HSA_STATUS_SUCCESS;
 }
 
@@ -65,6 +65,7 @@ class MemoryRegion;
 
 namespace core {
 class Signal;
+struct LinearCopyDesc;
 
 typedef void (*HsaEventCallback)(hsa_status_t status, hsa_queue_t* source,
                                  void* data);
@@ -197,6 +198,28 @@ class Agent : public Checked<0xF6BC25EB17E6F917> {
     return HSA_STATUS_ERROR;
   }
 
+  // @brief Submit a batch of DMA copies between the same pair of agents.
+  // This call does not wait until the copies are finished.
+  //
+  // @details Semantics match DmaCopy, but every copy in @p copies waits on
+  // @p dep_signals and @p out_signal is decremented once, after the whole
+  // batch has completed.
+  //
+  // @param [in] copies Array of copy descriptors.
+  // @param [in] count Number of elements in @p copies.
+  // @param [in] dst_agent Agent that owns the destination memory.
+  // @param [in] src_agent Agent that owns the source memory.
+  // @param [in] dep_signals Array of signal dependency.
+  // @param [in] out_signal Completion signal.
+  //
+  // @retval HSA_STATUS_SUCCESS The copies are queued.
+  virtual hsa_status_t DmaCopyBatch(const LinearCopyDesc* copies, size_t count,
+                                    core::Agent& dst_agent, core::Agent& src_agent,
+                                    std::vector<core::Signal*>& dep_signals,
+                                    core::Signal& out_signal) {
+    return HSA_STATUS_ERROR;
+  }
+
   // @brief Return DMA availability status for copy direction.
   //
   // @param [in] dst_agent Destination agent.
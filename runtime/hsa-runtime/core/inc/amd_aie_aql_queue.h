@@ -44,8 +44,10 @@
 #define HSA_RUNTIME_CORE_INC_AMD_HW_AQL_AIE_COMMAND_PROCESSOR_H_
 
 #include <limits>
+#include <memory>
 
 #include "core/inc/amd_aie_agent.h"
+#include "core/inc/amd_aie_cmd_submitter.h"
 #include "core/inc/queue.h"
 #include "core/inc/runtime.h"
 #include "core/inc/signal.h"
@@ -105,6 +107,12 @@ public:
     hw_ctx_handle_ = hw_ctx_handle;
   }
   uint32_t GetHwCtxHandle() const { return hw_ctx_handle_; }
+  /// @brief Routes doorbell rings to a submission engine feeding @p sink.
+  /// Used by drivers that do not expose a hardware doorbell. Must be called
+  /// after the hardware context handle is set.
+  void SetCommandSink(AieCommandSink &sink) {
+    submitter_.reset(new AieCommandSubmitter(sink, amd_queue_, hw_ctx_handle_));
+  }
 
   // GPU-specific queue functions are unsupported.
   hsa_status_t GetCUMasking(uint32_t num_cu_mask_count,
@@ -142,6 +150,10 @@ private:
   /// execute on the AIE agent at the same time.
   uint32_t hw_ctx_handle_ = std::numeric_limits<uint32_t>::max();
 
+  /// @brief Translates packets into driver submissions when there is no
+  /// hardware doorbell.
+  std::unique_ptr<AieCommandSubmitter> submitter_;
+
   /// @brief Indicates if queue is active.
   std::atomic<bool> active_;
   static int rtti_id_;
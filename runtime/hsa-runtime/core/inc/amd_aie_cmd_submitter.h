@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_AIE_CMD_SUBMITTER_H_
+#define HSA_RUNTIME_CORE_INC_AMD_AIE_CMD_SUBMITTER_H_
+
+#include <atomic>
+#include <deque>
+
+#include "core/inc/queue.h"
+#include "core/util/locks.h"
+#include "core/util/os.h"
+#include "inc/hsa_ext_amd.h"
+
+namespace rocr {
+namespace AMD {
+
+/// @brief Destination for the ERT commands of an AIE queue.
+///
+/// Implemented by the kernel driver. The submission engine only depends on
+/// this interface so it can be driven by a fake sink on the host.
+class AieCommandSink {
+public:
+  virtual ~AieCommandSink() = default;
+
+  /// @brief Submits ERT commands to a hardware context as one unit of work.
+  /// @param hw_ctx Hardware context handle of the queue.
+  /// @param cmds ERT packets in queue order. More than one packet is submitted
+  /// as a single command chain.
+  /// @param count Number of packets in @p cmds.
+  /// @param[out] seq Sequence number to pass to WaitChain.
+  virtual hsa_status_t SubmitChain(uint32_t hw_ctx,
+                                   const hsa_amd_aie_ert_packet_t *const *cmds,
+                                   uint32_t count, uint64_t *seq) = 0;
+
+  /// @brief Blocks until submission @p seq finished and releases its
+  /// resources.
+  /// @retval HSA_STATUS_ERROR if a command in the chain did not complete.
+  virtual hsa_status_t WaitChain(uint32_t hw_ctx, uint64_t seq) = 0;
+};
+
+/// @brief Translates the packets of an AIE AQL queue into command chains.
+///
+/// Each doorbell ring walks the newly published packets. Consecutive ERT
+/// dispatches are coalesced into one chain per submission, so the driver sees
+/// one submit and one wait for up to kMaxChainLength packets. Other packets
+/// are processed on the host in queue order. A barrier-AND/OR packet stops
+/// translation until its dependencies are met so later commands cannot
+/// overtake it.
+///
+/// A retire thread waits for each submission in order, then releases its
+/// packet slots, advances the read index and decrements completion signals.
+class AieCommandSubmitter {
+public:
+  /// Most packets coalesced into one command chain.
+  static const uint32_t kMaxChainLength = 32;
+
+  AieCommandSubmitter(AieCommandSink &sink, amd_queue_t &queue,
+                      uint32_t hw_ctx);
+  /// @brief Retires every outstanding submission, then stops the retire
+  /// thread.
+  ~AieCommandSubmitter();
+
+  /// @brief Submits the packets published since the last call.
+  void Submit();
+
+  /// @brief Returns true if @p ert can share a command chain with its
+  /// neighbours.
+  static bool IsChainable(const hsa_amd_aie_ert_packet_t &ert);
+
+private:
+  /// @brief Consecutive packets retired together.
+  struct Batch {
+    /// Queue index of the first packet.
+    uint64_t first;
+    uint32_t count;
+    /// The packets were submitted to the device as sequence number seq.
+    bool on_device;
+    uint64_t seq;
+  };
+
+  /// @brief Submits the pending chain, if any. Caller holds lock_.
+  void FlushChain(const hsa_amd_aie_ert_packet_t **chain, uint32_t &count,
+                  uint64_t first);
+  /// @brief Queues a batch for the retire thread. Caller holds lock_.
+  void PushBatch(const Batch &batch);
+
+  /// @brief Waits for a batch, then retires its packets.
+  void Retire(const Batch &batch);
+  /// @brief Waits for a barrier packet's dependencies. Returns false if the
+  /// submitter was stopped first.
+  bool WaitBarrier(const core::AqlPacket &pkt);
+
+  static void RetireThread(void *arg);
+
+  AieCommandSink &sink_;
+  amd_queue_t &queue_;
+  core::AqlPacket *ring_;
+  const uint64_t mask_;
+  const uint32_t hw_ctx_;
+
+  /// Guards submit_index_, blocked_ and batches_.
+  KernelMutex lock_;
+  /// Index of the next packet to translate.
+  uint64_t submit_index_ = 0;
+  /// Translation stopped at a barrier packet that has not been retired.
+  bool blocked_ = false;
+  /// Submissions not yet retired, in queue order.
+  std::deque<Batch> batches_;
+
+  /// Counts batches_ entries for the retire thread.
+  os::Semaphore pending_;
+  std::atomic<bool> stop_;
+  os::Thread retire_thread_;
+};
+
+} // namespace AMD
+} // namespace rocr
+
+#endif // header guard
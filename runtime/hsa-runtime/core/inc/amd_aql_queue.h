@@ -227,6 +227,34 @@ class AqlQueue : public core::Queue, private core::LocalSignal, public core::Doo
   /// @brief Async reclaim alternate scratch memory
   void AsyncReclaimAltScratch();
 
+  /// @brief Scratch currently bound to this queue.
+  const ScratchInfo& queue_scratch() const { return queue_scratch_; }
+
+  /// @brief Returns true if main scratch may be reclaimed for use by another queue: async reclaim
+  /// is supported, main scratch is bound and no packets are outstanding.
+  bool MainScratchStealable();
+
+  /// @brief Serializes changes to the main scratch binding between this queue's scratch handlers,
+  /// async reclaim and steals by other queues. Ordered before the agent's scratch lock.
+  KernelMutex& main_scratch_lock() { return main_scratch_lock_; }
+
+  /// @brief Start reclaiming main scratch on behalf of another queue and wait at most timeout_us
+  /// for the last dispatch using scratch to retire. On timeout the queue keeps its block. Caller
+  /// must hold main_scratch_lock() and should not hold the agent's scratch lock.
+  bool WaitMainScratchIdle(uint64_t timeout_us);
+
+  /// @brief Hand idle main scratch to another queue. The queue's scratch state is copied to
+  /// surrendered and the queue no longer references the block, which is not returned to the
+  /// cache. Caller must hold main_scratch_lock() and the agent's scratch lock.
+  void SurrenderMainScratch(ScratchInfo& surrendered);
+
+  /// @brief Backing of a ring buffer. Pooled rings are only reused for the same placement.
+  enum RingPlacement : uint32_t { RingSystem = 0, RingDevice = 1, RingSharedMapping = 2 };
+
+  /// @brief Release a ring buffer no longer owned by any queue.
+  static void FreeRingBuffer(GpuAgent* agent, void* ring, uint32_t alloc_bytes,
+                             uint32_t placement);
+
  protected:
   bool _IsA(Queue::rtti_t id) const override { return id == &rtti_id_; }
 
@@ -234,9 +262,10 @@ class AqlQueue : public core::Queue, private core::LocalSignal, public core::Doo
   uint32_t ComputeRingBufferMinPkts();
   uint32_t ComputeRingBufferMaxPkts();
 
-  // (De)allocates and (de)registers ring_buf_.
+  // (De)allocates and (de)registers ring_buf_. Rings are recycled through the agent's ring pool.
   void AllocRegisteredRingBuffer(uint32_t queue_size_pkts);
   void FreeRegisteredRingBuffer();
+  RingPlacement GetRingPlacement() const;
 
   /// @brief Abstracts the file handle use for double mapping queues.
   void CloseRingBufferFD(const char* ring_buf_shm_path, int fd) const;
@@ -299,6 +328,9 @@ class AqlQueue : public core::Queue, private core::LocalSignal, public core::Doo
   // Handle of scratch memory descriptor
   ScratchInfo queue_scratch_;
 
+  // Guards the main scratch binding, see main_scratch_lock().
+  KernelMutex main_scratch_lock_;
+
   AMD::callback_t<core::HsaEventCallback> errors_callback_;
 
   void* errors_data_;
@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Packet templates, kernarg slab and copy history used by BlitKernel.  Kept free of agent and
+// queue types so the dispatch logic can be checked without a device.
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_BLIT_DISPATCH_H_
+#define HSA_RUNTIME_CORE_INC_AMD_BLIT_DISPATCH_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+#include "inc/hsa.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace AMD {
+
+union BlitKernelArgs {
+  struct __ALIGNED__(16) {
+    uint64_t phase1_src_start;
+    uint64_t phase1_dst_start;
+    uint64_t phase2_src_start;
+    uint64_t phase2_dst_start;
+    uint64_t phase3_src_start;
+    uint64_t phase3_dst_start;
+    uint64_t phase4_src_start;
+    uint64_t phase4_dst_start;
+    uint64_t phase4_src_end;
+    uint64_t phase4_dst_end;
+    uint32_t num_workitems;
+  } copy_aligned;
+
+  struct __ALIGNED__(16) {
+    uint64_t phase1_src_start;
+    uint64_t phase1_dst_start;
+    uint64_t phase2_src_start;
+    uint64_t phase2_dst_start;
+    uint64_t phase2_src_end;
+    uint64_t phase2_dst_end;
+    uint32_t num_workitems;
+  } copy_misaligned;
+
+  struct __ALIGNED__(16) {
+    uint64_t phase1_dst_start;
+    uint64_t phase2_dst_start;
+    uint64_t phase2_dst_end;
+    uint32_t fill_value;
+    uint32_t num_workitems;
+  } fill;
+};
+
+/// Dispatch packet and launch shape precomputed for a kernel type. Only the
+/// kernarg address and completion signal vary between dispatches.
+struct BlitDispatchTemplate {
+  hsa_kernel_dispatch_packet_t packet;
+  uint32_t num_workitems;
+  /// Bytes moved per iteration of the kernel's unrolled vector phase.
+  uint64_t block_size;
+
+  void Init(uint64_t kernel_object, uint32_t workitems, uint64_t block);
+
+  /// Returns the packet for one dispatch. The header is left invalid, it is
+  /// published separately once the packet body is visible.
+  hsa_kernel_dispatch_packet_t Build(const BlitKernelArgs* args,
+                                     hsa_signal_t completion_signal) const;
+
+  /// Phase boundaries of a copy for the CopyAligned kernel.
+  void SetCopyAlignedArgs(uintptr_t dst, uintptr_t src, uint64_t size,
+                          BlitKernelArgs* args) const;
+  /// Phase boundaries of a copy for the CopyMisaligned kernel.
+  void SetCopyMisalignedArgs(uintptr_t dst, uintptr_t src, uint64_t size,
+                             BlitKernelArgs* args) const;
+  /// Phase boundaries of a dword fill for the Fill kernel.
+  void SetFillArgs(uintptr_t dst, uint32_t value, uint64_t size, BlitKernelArgs* args) const;
+};
+
+/// Kernel arguments with one entry per queue slot. The entry of a packet is
+/// selected by its write index, so it is not reused before the packet
+/// processor has consumed that packet and the queue has room again.
+class BlitKernargSlab {
+ public:
+  BlitKernargSlab() : base_(nullptr), mask_(0) {}
+
+  static size_t Bytes(uint32_t slots) { return slots * AlignUp(sizeof(BlitKernelArgs), 16); }
+
+  /// @p base holds Bytes(slots) bytes, 16 byte aligned. @p slots is a power of two.
+  void Init(void* base, uint32_t slots) {
+    base_ = reinterpret_cast<BlitKernelArgs*>(base);
+    mask_ = slots - 1;
+  }
+
+  void* base() const { return base_; }
+
+  BlitKernelArgs* At(uint64_t index) const { return &base_[index & mask_]; }
+
+ private:
+  BlitKernelArgs* base_;
+  uint32_t mask_;
+};
+
+/// Bytes queued per packet index, used to report how much copy work is still
+/// pending behind the queue's read index. Safe for concurrent recorders.
+class BlitHistory {
+ public:
+  BlitHistory() : mask_(0), bytes_queued_(0), last_queued_(0), pending_search_index_(0) {}
+
+  /// @p slots is the queue size, a power of two.
+  void Init(uint32_t slots);
+
+  /// Record @p size bytes for the packet at @p index.
+  void Record(uint64_t size, uint64_t index);
+
+  /// Bytes queued in packets at or after @p read_index.
+  uint64_t PendingBytes(uint64_t read_index);
+
+ private:
+  // Index after which bytes will have been written.
+  // index is cleared while bytes is updated so readers can detect a torn record.
+  struct BytesWritten {
+    std::atomic<uint64_t> index;
+    std::atomic<uint64_t> bytes;
+  };
+
+  uint32_t mask_;
+
+  /// Bytes moved by commands < index.
+  /// Any record's byte value may be inexact by the size of concurrently issued operations.
+  std::unique_ptr<BytesWritten[]> bytes_written_;
+
+  /// Total bytes written by all commands issued.
+  std::atomic<uint64_t> bytes_queued_;
+
+  /// Index where most recent blit operation queued.
+  std::atomic<uint64_t> last_queued_;
+
+  /// Search resume index
+  std::atomic<uint64_t> pending_search_index_;
+};
+
+}  // namespace AMD
+}  // namespace rocr
+
+#endif  // header guard
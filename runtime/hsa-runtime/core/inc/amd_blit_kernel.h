@@ -47,8 +47,10 @@
 #include <mutex>
 #include <vector>
 #include <atomic>
+#include <memory>
 #include <stdint.h>
 
+#include "core/inc/amd_blit_dispatch.h"
 #include "core/inc/blit.h"
 
 namespace rocr {
@@ -118,48 +120,16 @@ class BlitKernel : public core::Blit {
   virtual bool GangLeader() const override { return false; }
 
  private:
-  union KernelArgs {
-    struct __ALIGNED__(16) {
-      uint64_t phase1_src_start;
-      uint64_t phase1_dst_start;
-      uint64_t phase2_src_start;
-      uint64_t phase2_dst_start;
-      uint64_t phase3_src_start;
-      uint64_t phase3_dst_start;
-      uint64_t phase4_src_start;
-      uint64_t phase4_dst_start;
-      uint64_t phase4_src_end;
-      uint64_t phase4_dst_end;
-      uint32_t num_workitems;
-    } copy_aligned;
-
-    struct __ALIGNED__(16) {
-      uint64_t phase1_src_start;
-      uint64_t phase1_dst_start;
-      uint64_t phase2_src_start;
-      uint64_t phase2_dst_start;
-      uint64_t phase2_src_end;
-      uint64_t phase2_dst_end;
-      uint32_t num_workitems;
-    } copy_misaligned;
-
-    struct __ALIGNED__(16) {
-      uint64_t phase1_dst_start;
-      uint64_t phase2_dst_start;
-      uint64_t phase2_dst_end;
-      uint32_t fill_value;
-      uint32_t num_workitems;
-    } fill;
-  };
-
-  // Index after which bytes will have been written.
-  struct BytesWritten {
-    uint64_t index;
-    uint64_t bytes;
+  /// AQL code object and size for each kernel.
+  enum class KernelType {
+    CopyAligned,
+    CopyMisaligned,
+    Fill,
   };
+  static const int kKernelTypeCount = 3;
 
   /// Reserve a slot in the queue buffer. The call will wait until the queue
-  /// buffer has a room.
+  /// buffer has a room. Safe to call from multiple threads.
   uint64_t AcquireWriteIndex(uint32_t num_packet);
 
   /// Update the queue doorbell register with ::write_index. This
@@ -167,19 +137,10 @@ class BlitKernel : public core::Blit {
   /// packet processor doesn't get invalid packet.
   void ReleaseWriteIndex(uint64_t write_index, uint32_t num_packet);
 
-  void PopulateQueue(uint64_t index, uint64_t code_handle, void* args,
-                     uint32_t grid_size_x, hsa_signal_t completion_signal);
-
-  KernelArgs* ObtainAsyncKernelCopyArg();
+  void InitDispatchTemplate(KernelType type, uint32_t num_workitems, uint64_t block_size);
 
-  void RecordBlitHistory(uint64_t size, uint64_t index);
-
-  /// AQL code object and size for each kernel.
-  enum class KernelType {
-    CopyAligned,
-    CopyMisaligned,
-    Fill,
-  };
+  void PopulateQueue(uint64_t index, const BlitDispatchTemplate& dispatch, BlitKernelArgs* args,
+                     hsa_signal_t completion_signal);
 
   struct KernelCode {
     void* code_buf_;
@@ -188,35 +149,22 @@ class BlitKernel : public core::Blit {
 
   std::map<KernelType, KernelCode> kernels_;
 
+  BlitDispatchTemplate templates_[kKernelTypeCount];
+
   /// AQL queue for submitting the vector copy kernel.
   core::Queue* queue_;
   uint32_t queue_bitmask_;
 
-  /// Pointer to the kernel argument buffer.
-  KernelArgs* kernarg_async_;
-  uint32_t kernarg_async_mask_;
-  volatile uint32_t kernarg_async_counter_;
+  /// Kernel arguments, one entry per queue slot.
+  BlitKernargSlab kernarg_slab_;
 
   /// Completion signal for every kernel dispatched.
   hsa_signal_t completion_signal_;
 
-  /// Bytes moved by commands < index.
-  /// Any record's byte value may be inexact by the size of concurrently issued operations.
-  std::vector<BytesWritten> bytes_written_;
-
-  /// Total bytes written by all commands issued.
-  uint64_t bytes_queued_;
-
-  /// Index where most recent blit operation queued.
-  uint64_t last_queued_;
-
-  /// Orders command indices and bytes_queued_ updates
-  std::mutex reservation_lock_;
-
-  /// Search resume index
-  std::atomic<uint64_t> pending_search_index_;
+  /// Bytes queued per packet, for PendingBytes.
+  BlitHistory history_;
 
-  /// Lock to synchronize access to kernarg_ and completion_signal_
+  /// Lock to synchronize access to completion_signal_
   std::mutex lock_;
 
   /// Number of CUs on the underlying agent.
@@ -64,6 +64,7 @@ class BlitSdmaBase : public core::Blit {
   static const size_t kCopyPacketSize;
   static const size_t kMaxSingleCopySize;
   static const size_t kMaxSingleFillSize;
+  static const size_t kMaxBatchCommandSize;
   virtual bool isSDMA() const override { return true; }
   virtual hsa_status_t Initialize(const core::Agent& agent, bool use_xgmi,
                                   size_t linear_copy_size_override, int rec_engine) = 0;
@@ -129,6 +130,19 @@ class BlitSdma : public BlitSdmaBase {
       std::vector<core::Signal*>& dep_signals,
       core::Signal& out_signal, std::vector<core::Signal*>& gang_signals) override;
 
+  /// @brief Submit a batch of linear copies behind one set of dependency polls
+  /// and one trailing completion sequence. Batches whose packets exceed
+  /// kMaxBatchCommandSize are split into ring segments; only the last segment
+  /// signals.
+  ///
+  /// @param copies Array of copy descriptors.
+  /// @param count Number of elements in @p copies.
+  /// @param dep_signals Arrays of dependent signal.
+  /// @param out_signal Output signal.
+  virtual hsa_status_t SubmitLinearCopyCommands(const core::LinearCopyDesc* copies, size_t count,
+                                                std::vector<core::Signal*>& dep_signals,
+                                                core::Signal& out_signal) override;
+
   virtual hsa_status_t SubmitCopyRectCommand(const hsa_pitched_ptr_t* dst,
                                              const hsa_dim3_t* dst_offset,
                                              const hsa_pitched_ptr_t* src,
@@ -215,13 +229,16 @@ class BlitSdma : public BlitSdmaBase {
 
   void BuildGetGlobalTimestampCommand(char* cmd_addr, void* write_address);
 
-  void BuildTrapCommand(char* cmd_addr, uint32_t event_id);
-
   void BuildGCRCommand(char* cmd_addr, bool invalidate);
 
+  /// @brief Submit a command buffer wrapped in dependency polls and completion packets.
+  ///
+  /// @param head Emit the dependency polls and start timestamp.
+  /// @param tail Emit the end timestamp, gang and completion signal packets.
   hsa_status_t SubmitCommand(const void* cmds, size_t cmd_size, uint64_t size,
                              const std::vector<core::Signal*>& dep_signals,
-                             core::Signal& out_signal, std::vector<core::Signal*>& gang_signals);
+                             core::Signal& out_signal, std::vector<core::Signal*>& gang_signals,
+                             bool head = true, bool tail = true);
 
   hsa_status_t SubmitBlockingCommand(const void* cmds, size_t cmd_size, uint64_t size);
 
@@ -284,10 +301,15 @@ class BlitSdma : public BlitSdmaBase {
 
   static const uint32_t timestamp_command_size_;
 
-  static const uint32_t trap_command_size_;
-
   static const uint32_t gcr_command_size_;
 
+  // Per-variant packet selection, fixed at compile time. Only engines with a
+  // monotonic hardware index take an HDP flush and only GCR engines bracket
+  // each submission with cache invalidate and writeback packets.
+  static constexpr bool kHdpFlushCapable = HwIndexMonotonic;
+
+  static const uint32_t cache_command_size_;
+
   // Max copy size of a single linear copy command packet.
   size_t max_single_linear_copy_size_;
 
@@ -43,10 +43,61 @@
 #ifndef OPENSRC_HSA_RUNTIME_CORE_INC_AMD_CORE_DUMP_HPP_
 #define OPENSRC_HSA_RUNTIME_CORE_INC_AMD_CORE_DUMP_HPP_
 
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include "inc/hsa.h"
+
 namespace rocr {
 namespace amd {
 namespace coredump {
-hsa_status_t dump_gpu_core();
+/* Controls how the core file is produced.  */
+struct DumpOptions {
+  /* Number of threads reading (and compressing) segment data.  */
+  uint32_t threads = 4;
+  /* Leave all-zero pages as holes in seekable output files.  */
+  bool sparse = true;
+  /* Write the core file as a sequence of zstd frames.  Ignored when libzstd
+     can not be loaded.  */
+  bool compress = false;
+  /* When set, stream the core file to the stdin of this shell command.  */
+  std::string pipe_command;
+};
+
+hsa_status_t dump_gpu_core(const DumpOptions& options = DumpOptions());
+
+/* Implementation details */
+namespace impl {
+enum SegmentType { LOAD, NOTE };
+struct SegmentBuilder;
+
+struct SegmentInfo {
+  SegmentType stype;
+  uint64_t vaddr = 0;
+  uint64_t size = 0;
+  uint32_t flags = 0;
+  SegmentBuilder* builder;
+};
+
+using SegmentsInfo = std::vector<SegmentInfo>;
+
+struct SegmentBuilder {
+  virtual ~SegmentBuilder() = default;
+  /* Find which segments needs to be created.  */
+  virtual hsa_status_t Collect(SegmentsInfo& segments) = 0;
+  /* Called to read a given SegmentInfo's data.  Must be safe to call from
+     several threads at once.  */
+  virtual hsa_status_t Read(void* buf, size_t buf_size, off_t offset) = 0;
+};
+
+/* Write the segments as an ELF core file to filename, or to
+   options.pipe_command if set.  A compressed file gets a ".zst" suffix.  */
+hsa_status_t build_core_dump(const std::string& filename, const SegmentsInfo& segments,
+                             const DumpOptions& options);
+}   //  namespace impl
 }   //  namespace coredump
 }   //  namespace amd
 }   //  namespace rocr
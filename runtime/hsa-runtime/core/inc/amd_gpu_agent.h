@@ -45,6 +45,7 @@
 #ifndef HSA_RUNTIME_CORE_INC_AMD_GPU_AGENT_H_
 #define HSA_RUNTIME_CORE_INC_AMD_GPU_AGENT_H_
 
+#include <atomic>
 #include <vector>
 #include <list>
 #include <map>
@@ -295,6 +296,12 @@ class GpuAgent : public GpuAgentInt {
                        core::Signal& out_signal, int engine_offset,
                        bool force_copy_on_sdma) override;
 
+  // @brief Override from core::Agent.
+  hsa_status_t DmaCopyBatch(const core::LinearCopyDesc* copies, size_t count,
+                            core::Agent& dst_agent, core::Agent& src_agent,
+                            std::vector<core::Signal*>& dep_signals,
+                            core::Signal& out_signal) override;
+
   // @brief Override from core::Agent.
   hsa_status_t DmaCopyStatus(core::Agent& dst_agent, core::Agent& src_agent,
                              uint32_t *engine_ids_mask) override;
@@ -428,6 +435,19 @@ class GpuAgent : public GpuAgentInt {
   // @brief If agent supports it, release scratch memory for all AQL queues on this agent.
   void AsyncReclaimScratchQueues();
 
+  // @brief Remove a destroyed AQL queue from the list of queues owned by this agent.
+  void RemoveAqlQueue(core::Queue* queue);
+
+  // @brief Take a pooled AQL ring buffer matching alloc_bytes and placement, nullptr if none.
+  void* AcquireRingBuffer(uint32_t alloc_bytes, uint32_t placement);
+
+  // @brief Keep the ring buffer of a destroyed queue for reuse. Returns false if the pool is
+  // full, in which case the caller releases the ring.
+  bool RecycleRingBuffer(void* ring, uint32_t alloc_bytes, uint32_t placement);
+
+  // @brief Release all pooled ring buffers.
+  void TrimRingBuffers();
+
   // @brief Returns true if scratch reclaim is enabled
   __forceinline bool AsyncScratchReclaimEnabled() const override {
     // TODO: Need to update min CP FW ucode version once it is released
@@ -501,6 +521,10 @@ class GpuAgent : public GpuAgentInt {
 
   // @brief Binds the second-level trap handler to this node.
   void BindTrapHandler();
+
+  // @brief Reserves scratch and binds the trap handler once, before the first
+  // queue of this agent is created.
+  void BringUp();
   hsa_status_t UpdateTrapHandlerWithPCS(void* pcs_hosttrap_buffers, void* stochastic_hosttrap_buffers);
 
   // @brief Override from core::Agent.
@@ -665,6 +689,10 @@ class GpuAgent : public GpuAgentInt {
   // caller must hold scratch_lock_.
   void ReleaseScratch(void* base, size_t size, bool large);
 
+  // @brief Take main scratch bound to an idle queue, waiting for its last scratch dispatch to
+  // retire. caller must hold scratch_lock_, which is released during the wait.
+  bool StealQueueMainScratch(ScratchInfo& scratch);
+
   // Bind index of peer device that is connected via xGMI links
   lazy_ptr<core::Blit>& GetXgmiBlit(const core::Agent& peer_agent);
 
@@ -698,8 +726,13 @@ class GpuAgent : public GpuAgentInt {
   } gws_queue_;
 
   // @brief list of AQL queues owned by this agent. Indexed by queue pointer
+  // Updates hold both aql_queues_lock_ and scratch_lock_ so either lock makes a walk safe.
   std::vector<core::Queue*> aql_queues_;
 
+  // @brief Held while walking aql_queues_ outside scratch_lock_. Queue destruction blocks on it so
+  // walked queues stay alive. Ordered before scratch_lock_.
+  KernelMutex aql_queues_lock_;
+
   // Sets and Tracks pending SDMA status check or request counts
   void SetCopyRequestRefCount(bool set);
   void SetCopyStatusCheckRefCount(bool set);
@@ -714,6 +747,25 @@ class GpuAgent : public GpuAgentInt {
 
   ScratchCache scratch_cache_;
 
+  // Scratch steal statistics, protected by scratch_lock_.
+  struct {
+    uint64_t attempts;
+    uint64_t successes;
+    uint64_t timeouts;
+  } scratch_steal_stats_;
+
+  // AQL ring buffers of destroyed queues, keyed by allocation size and placement.
+  KernelMutex ring_pool_lock_;
+  std::multimap<std::pair<uint32_t, uint32_t>, void*> ring_pool_;
+  size_t ring_pool_bytes_;
+
+  // Ring pool statistics, protected by ring_pool_lock_.
+  struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t trimmed;
+  } ring_pool_stats_;
+
   // System memory allocator in the nearest NUMA node.
   std::function<void*(size_t size, size_t align, core::MemoryRegion::AllocateFlags flags)>
       system_allocator_;
@@ -788,6 +840,9 @@ class GpuAgent : public GpuAgentInt {
 
   // @bried XGMI CPU<->GPU
   bool xgmi_cpu_gpu_;
+
+  // @brief Runs the BringUp() body once, however many queues race to create it.
+  KernelOnce bring_up_;
 };
 
 }  // namespace amd
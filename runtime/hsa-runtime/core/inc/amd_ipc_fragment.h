@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_IPC_FRAGMENT_H_
+#define HSA_RUNTIME_CORE_INC_AMD_IPC_FRAGMENT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rocr {
+namespace AMD {
+
+/// @brief Encoding of a fragment's offset within its block in handle[6] of an IPC handle.
+///
+/// Without dmabuf handle[6] carries the thunk's SizeInPages, so the offset must live in bits the
+/// block size never uses.  Bit 31 flags a fragment, bits 0-8 hold the offset in 4KB pages modulo
+/// 2MB and bits 24-30 hold the offset in 2MB units.  Offsets below 2MB encode exactly as older
+/// runtimes did, so handles of fragments in 2MB blocks stay interchangeable.
+namespace IpcFragment {
+
+static const uint32_t kFlag = 0x80000000;
+static const uint32_t kLowMask = 0x1FF;
+static const uint32_t kHighShift = 24;
+static const uint32_t kHighMask = 0x7F;
+static const uint32_t kFieldMask = kFlag | (kHighMask << kHighShift) | kLowMask;
+
+static const size_t kPageSize = 4096;
+static const size_t kLowSpan = (kLowMask + 1) * kPageSize;  // 2MB
+
+/// @brief Largest fragment block whose offsets can be encoded.
+static const size_t kMaxBlockSize = (kHighMask + 1) * kLowSpan;  // 256MB
+
+/// @brief Adds a fragment offset to @p word.  Fails if the offset is not page aligned, does not
+/// fit or @p word already uses bits of the encoding.
+static inline bool Encode(size_t offset, uint32_t& word) {
+  if ((offset % kPageSize) != 0 || offset >= kMaxBlockSize) return false;
+  if ((word & kFieldMask) != 0) return false;
+  const uint32_t pages = uint32_t(offset / kPageSize);
+  word |= kFlag | (((pages >> 9) & kHighMask) << kHighShift) | (pages & kLowMask);
+  return true;
+}
+
+/// @brief Removes a fragment offset from @p word.  Returns false and leaves @p word unchanged if
+/// it does not describe a fragment.
+static inline bool Decode(uint32_t& word, size_t& offset) {
+  if ((word & kFlag) == 0) return false;
+  const size_t pages = (word & kLowMask) | (((word >> kHighShift) & kHighMask) << 9);
+  offset = pages * kPageSize;
+  word &= ~kFieldMask;
+  return true;
+}
+
+}  // namespace IpcFragment
+}  // namespace AMD
+}  // namespace rocr
+
+#endif  // header guard
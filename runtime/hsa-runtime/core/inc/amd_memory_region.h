@@ -50,7 +50,7 @@
 #include "core/inc/agent.h"
 #include "core/inc/runtime.h"
 #include "core/inc/memory_region.h"
-#include "core/util/simple_heap.h"
+#include "core/util/segregated_heap.h"
 #include "core/util/locks.h"
 
 #include "inc/hsa_ext_amd.h"
@@ -120,6 +120,14 @@ class MemoryRegion : public core::MemoryRegion {
 
   hsa_status_t Unlock(void* host_ptr) const;
 
+  /// @brief Register and map a page aligned host range to @p nodes with this
+  /// region's flags. Used by the runtime's pin registry, see Lock().
+  hsa_status_t Pin(void* base, size_t size, const std::vector<uint32_t>& nodes,
+                   void** agent_base) const;
+
+  /// @brief Release a range registered by Pin().
+  void Unpin(void* base) const;
+
   HSAuint64 GetBaseAddress() const { return mem_props_.VirtualBaseAddress; }
 
   HSAuint64 GetPhysicalSize() const { return mem_props_.SizeInBytes; }
@@ -133,6 +141,10 @@ class MemoryRegion : public core::MemoryRegion {
 
   HSAuint64 GetCacheSize() const { return fragment_allocator_.cache_size(); }
 
+  /// @brief Set the fragment allocator's block size and slab limit.  Must be called before the
+  /// first fragment allocation.
+  bool ConfigureFragmentAllocator(size_t block_size, size_t slab_limit);
+
   __forceinline bool IsLocalMemory() const {
     return ((mem_props_.HeapType == HSA_HEAPTYPE_FRAME_BUFFER_PRIVATE) ||
             (mem_props_.HeapType == HSA_HEAPTYPE_FRAME_BUFFER_PUBLIC));
@@ -210,15 +222,18 @@ private:
   class BlockAllocator {
    private:
     MemoryRegion& region_;
-    static const size_t block_size_ = 2 * 1024 * 1024;  // 2MB blocks.
+    size_t block_size_;
    public:
-    explicit BlockAllocator(MemoryRegion& region) : region_(region) {}
+    static const size_t kDefaultBlockSize = 2 * 1024 * 1024;  // 2MB blocks.
+    explicit BlockAllocator(MemoryRegion& region)
+        : region_(region), block_size_(kDefaultBlockSize) {}
     void* alloc(size_t request_size, size_t& allocated_size) const;
     void free(void* ptr, size_t length) const { region_.FreeImpl(ptr, length); }
     size_t block_size() const { return block_size_; }
+    void set_block_size(size_t block_size) { block_size_ = block_size; }
   };
 
-  mutable SimpleHeap<BlockAllocator> fragment_allocator_;
+  mutable SegregatedHeap<BlockAllocator> fragment_allocator_;
 };
 
 }  // namespace amd
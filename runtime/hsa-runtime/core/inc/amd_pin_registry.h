@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_PIN_REGISTRY_H_
+#define HSA_RUNTIME_CORE_INC_AMD_PIN_REGISTRY_H_
+
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "inc/hsa.h"
+#include "core/util/locks.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace AMD {
+
+/// @brief Reference counted registry of locked host ranges.
+///
+/// Each entry is one registration of a page aligned range with KFD, mapped to a
+/// sorted set of GPU nodes on behalf of an owner (the system region whose
+/// memory flags were used). A lock fully covered by an entry of the same owner
+/// mapped to a superset of its nodes shares that entry.
+///
+/// Partial overlaps are resolved by the registration type. SVM registrations
+/// are mapped at their host address, so a lock is split into the parts served
+/// by existing entries and new entries for the gaps between them. Userptr
+/// registrations each have their own GPU address range and can't be combined:
+/// the idle entries a lock overlaps are unpinned and the union is pinned as one
+/// entry. KFD finds userptr registrations by start address, so a lock can't be
+/// pinned at the start of a userptr entry still in use.
+///
+/// Entries whose last lock is released are kept, least recently used first
+/// out, while their total size is within @p budget bytes.
+///
+/// The thunk is reached only through the injected callbacks.
+class PinRegistry {
+ public:
+  /// @brief Registers and maps [base, base + size) to @p nodes for @p owner.
+  typedef std::function<hsa_status_t(const void* owner, void* base, size_t size,
+                                     const std::vector<uint32_t>& nodes, void** agent_base)>
+      PinFn;
+  /// @brief Releases a range pinned by PinFn at @p base.
+  typedef std::function<void(const void* owner, void* base)> UnpinFn;
+
+  PinRegistry(PinFn pin, UnpinFn unpin, size_t budget);
+  ~PinRegistry();
+
+  /// @brief Locks [ptr, ptr + size) to @p nodes, reusing pinned entries where
+  /// possible. @p agent_ptr receives the agent address of @p ptr.
+  hsa_status_t Lock(const void* owner, void* ptr, size_t size, std::vector<uint32_t> nodes,
+                    void** agent_ptr);
+
+  /// @brief Drops one lock taken at @p ptr. Pointers which are not locked are
+  /// ignored, as KFD ignores them.
+  void Unlock(void* ptr);
+
+  /// @brief Unpins every entry, locked or not.
+  void Flush();
+
+  uint64_t hits() const;
+  uint64_t misses() const;
+  /// @brief Bytes pinned by entries with no remaining locks.
+  size_t cached_bytes() const;
+
+ private:
+  struct Entry;
+  typedef std::multimap<uintptr_t, Entry> entry_map_t;
+
+  struct Entry {
+    uintptr_t base;
+    uintptr_t end;
+    const void* owner;
+    std::vector<uint32_t> nodes;
+    uintptr_t agent_base;
+    uint32_t refs;
+    entry_map_t::iterator self;
+    // Position in idle_ while refs == 0.
+    std::list<Entry*>::iterator lru;
+
+    // SVM registrations are mapped at their host address and may be stitched
+    // together. Userptr registrations are mapped elsewhere in the GPU VA.
+    bool Identity() const { return agent_base == base; }
+  };
+
+  // Appends entries intersecting [start, stop) to @p out.
+  void Overlapping(uintptr_t start, uintptr_t stop, std::vector<Entry*>* out);
+
+  // Serves [base, end) from compatible SVM entries, pinning only the gaps.
+  hsa_status_t Stitch(const void* owner, uintptr_t base, uintptr_t end,
+                      const std::vector<uint32_t>& nodes, std::vector<Entry*>* spans);
+
+  // Pins the union of [base, end) and the idle entries of @p owner it overlaps.
+  hsa_status_t Extend(const void* owner, uintptr_t base, uintptr_t end,
+                      const std::vector<uint32_t>& nodes, std::vector<Entry*>* spans);
+
+  // Pins [start, stop) as a new entry holding one reference.
+  hsa_status_t Pin(const void* owner, uintptr_t start, uintptr_t stop,
+                   const std::vector<uint32_t>& nodes, Entry** entry);
+
+  void Acquire(Entry* entry);
+
+  void Release(Entry* entry);
+
+  // Unpins and forgets an entry with no locks.
+  void Retire(Entry* entry);
+
+  // Retires idle entries from the least recently used end until within budget.
+  void Reclaim();
+
+  PinFn pin_;
+  UnpinFn unpin_;
+  const size_t budget_;
+
+  mutable KernelMutex lock_;
+  // Entries keyed by base address. Ranges may overlap.
+  entry_map_t entries_;
+  // Size of the largest entry, bounds the search for covering entries.
+  size_t max_entry_size_;
+  // Idle entries, most recently used first.
+  std::list<Entry*> idle_;
+  size_t idle_bytes_;
+  // Entries backing each lock, keyed by the locked pointer.
+  std::unordered_multimap<uintptr_t, std::vector<Entry*>> locks_;
+
+  uint64_t hits_;
+  uint64_t misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(PinRegistry);
+};
+
+}  // namespace AMD
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_INC_AMD_PIN_REGISTRY_H_
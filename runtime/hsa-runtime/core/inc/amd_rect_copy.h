@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_RECT_COPY_H_
+#define HSA_RUNTIME_CORE_INC_AMD_RECT_COPY_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "inc/hsa_ext_amd.h"
+#include "core/inc/blit.h"
+
+namespace rocr {
+namespace AMD {
+
+/// @brief One SDMA rect copy produced by the rect copy planner.
+struct RectCopyDesc {
+  hsa_pitched_ptr_t dst;
+  hsa_dim3_t dst_offset;
+  hsa_pitched_ptr_t src;
+  hsa_dim3_t src_offset;
+  hsa_dim3_t range;
+};
+
+/// @brief Largest pitch and slice, in elements, a rect packet can encode.
+/// A zero max_pitch describes an engine without rect packets.
+struct RectCopyLimits {
+  uint64_t max_pitch;
+  uint64_t max_slice;
+};
+
+/// @brief Checks that a pitched copy describes a geometric sub-volume of both
+/// surfaces. Throws hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT) otherwise.
+///
+/// @param dword_aligned Also require DWORD aligned bases, pitches and slices,
+/// as the SDMA rect interface does.
+void ValidateRectCopy(const hsa_pitched_ptr_t& dst, const hsa_dim3_t& dst_offset,
+                      const hsa_pitched_ptr_t& src, const hsa_dim3_t& src_offset,
+                      const hsa_dim3_t& range, bool dword_aligned);
+
+/// @brief Decomposes a validated pitched copy into the cheapest equivalent
+/// work for an engine with the given rect limits.
+///
+/// Contiguous rows are merged into one linear span per slice, and contiguous
+/// slices into a single span. Rects the hardware cannot encode in one packet
+/// are rewritten as wide-pitch 2D rects, split per slice, or as a last resort
+/// lowered to one span per row. Exactly one of @p spans or @p rects is
+/// filled, so the result can always be submitted as one batch. An empty copy
+/// plans a single zero byte span so its completion still follows its
+/// dependencies.
+///
+/// @param limits Rect packet limits of the executing engine.
+/// @param [out] spans Linear copies, in submission order.
+/// @param [out] rects Rect copies, in submission order.
+void PlanRectCopy(const hsa_pitched_ptr_t& dst, const hsa_dim3_t& dst_offset,
+                  const hsa_pitched_ptr_t& src, const hsa_dim3_t& src_offset,
+                  const hsa_dim3_t& range, const RectCopyLimits& limits,
+                  std::vector<core::LinearCopyDesc>& spans, std::vector<RectCopyDesc>& rects);
+
+}  // namespace AMD
+}  // namespace rocr
+
+#endif  // header guard
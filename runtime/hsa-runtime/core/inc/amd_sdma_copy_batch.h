@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_SDMA_COPY_BATCH_H_
+#define HSA_RUNTIME_CORE_INC_AMD_SDMA_COPY_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "core/inc/blit.h"
+#include "core/inc/sdma_registers.h"
+
+namespace rocr {
+namespace AMD {
+
+/// @brief Linear copy packet encoding of an SDMA engine.
+struct SdmaLinearCopyFormat {
+  // Largest copy, in bytes, one packet describes.
+  size_t max_copy_size;
+  // Added to the byte count written to the packet.
+  int size_to_count_offset;
+};
+
+/// @brief Signal update closing an SDMA submission.
+struct SdmaCompletion {
+  // Signal value decremented once the submission retires.
+  void* value_location;
+  // Value stored by fences instead of the decrement when platform atomics are not available.
+  uint64_t value;
+  // Event mailbox of an interrupt signal, null for other signals.
+  uint32_t* mailbox;
+  uint32_t event_id;
+};
+
+/// @brief A run of batch packets submitted to the ring together.
+struct SdmaCopySegment {
+  size_t first_packet;
+  uint32_t num_packets;
+  uint64_t bytes;
+};
+
+/// @brief Number of linear copy packets needed for a copy of @p size bytes.
+uint32_t SdmaLinearCopyPacketCount(size_t size, const SdmaLinearCopyFormat& format);
+
+/// @brief Encodes a copy of @p size bytes into @p num_packets consecutive packets.
+void BuildSdmaLinearCopy(SDMA_PKT_COPY_LINEAR* packets, uint32_t num_packets, void* dst,
+                         const void* src, size_t size, const SdmaLinearCopyFormat& format);
+
+/// @brief Encodes a fence writing @p value to @p fence. @p set_mtype selects the GFX10 and later
+/// uncached memory type.
+void BuildSdmaFence(char* cmd, uint32_t* fence, uint32_t value, bool set_mtype);
+
+/// @brief Encodes a 64 bit atomic decrement of @p addr.
+void BuildSdmaAtomicDecrement(char* cmd, void* addr);
+
+/// @brief Encodes an interrupt carrying @p event_id.
+void BuildSdmaTrap(char* cmd, uint32_t event_id);
+
+/// @brief Bytes of completion packets BuildSdmaCompletion writes for @p completion.
+uint32_t SdmaCompletionSize(const SdmaCompletion& completion, bool platform_atomics);
+
+/// @brief Encodes the completion of a submission. The signal is decremented with an atomic, or
+/// without platform atomics by fences storing completion.value, high dword first when it is
+/// needed. Interrupt signals then get a mailbox fence and a trap. Returns the bytes written.
+uint32_t BuildSdmaCompletion(char* cmd, const SdmaCompletion& completion, bool platform_atomics,
+                             bool set_mtype);
+
+/// @brief Encodes a batch of linear copies, in order, and splits the packets into ring segments
+/// of at most @p max_segment_packets. A copy may straddle two segments. At least one segment is
+/// always produced so the batch has a segment to carry its completion.
+///
+/// @param [out] packets Copy packets of the whole batch.
+/// @param [out] segments Ring segments, in submission order.
+void PlanSdmaCopyBatch(const core::LinearCopyDesc* copies, size_t count,
+                       const SdmaLinearCopyFormat& format, uint32_t max_segment_packets,
+                       std::vector<SDMA_PKT_COPY_LINEAR>& packets,
+                       std::vector<SdmaCopySegment>& segments);
+
+}  // namespace AMD
+}  // namespace rocr
+
+#endif  // header guard
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_STAGED_COPY_H_
+#define HSA_RUNTIME_CORE_INC_AMD_STAGED_COPY_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "core/inc/agent.h"
+#include "core/inc/signal.h"
+#include "core/util/locks.h"
+#include "core/util/os.h"
+
+namespace rocr {
+namespace AMD {
+
+/// @brief Blocking copies between pageable host memory and GPU memory through
+/// a ring of pinned bounce buffers, avoiding pinning the user range.
+///
+/// Host memcpy into or out of one bounce buffer is split across helper threads
+/// and overlaps with SDMA transfers of the others. The ring and threads are
+/// created on first use and shared, so staged copies are serialized.
+class StagedCopy {
+ public:
+  StagedCopy();
+  ~StagedCopy();
+
+  /// @brief Returns true if the cost model estimates staging @p size bytes is
+  /// cheaper than pinning them.
+  bool Preferred(size_t size) const;
+
+  /// @brief Copy @p size bytes between pageable host memory and memory
+  /// accessible to @p gpu.
+  ///
+  /// @param [in] to_device True if @p src is pageable, false if @p dst is.
+  hsa_status_t Copy(void* dst, const void* src, size_t size, core::Agent* gpu, bool to_device);
+
+ private:
+  struct Slot {
+    void* buffer;
+    core::Signal* done;
+  };
+
+  struct Worker {
+    StagedCopy* owner;
+    os::Thread thread;
+    os::Semaphore start;
+    void* dst;
+    const void* src;
+    size_t size;
+  };
+
+  static void WorkerLoop(void* arg);
+
+  bool Init();
+
+  void ParallelMemcpy(void* dst, const void* src, size_t size);
+
+  // Serializes staged copies over the shared ring.
+  KernelMutex lock_;
+
+  bool initialized_;
+  size_t buffer_size_;
+  std::vector<Slot> ring_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Posted by workers when their slice is copied.
+  os::Semaphore done_;
+  std::atomic<bool> exit_;
+
+  DISALLOW_COPY_AND_ASSIGN(StagedCopy);
+};
+
+}  // namespace AMD
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_INC_AMD_STAGED_COPY_H_
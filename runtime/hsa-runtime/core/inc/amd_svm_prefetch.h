@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_SVM_PREFETCH_H_
+#define HSA_RUNTIME_CORE_INC_AMD_SVM_PREFETCH_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "inc/hsa.h"
+#include "core/util/locks.h"
+#include "core/util/os.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace AMD {
+
+/// @brief Coalesces pending SVM prefetches and migrates them from a worker
+/// thread.
+///
+/// Pending ranges are kept disjoint: a new prefetch trims the unissued parts of
+/// older ones it overlaps, so only the most recent destination of any page is
+/// migrated. Adjacent ranges of ready prefetches with the same destination are
+/// merged into one migration of at most @p batch_bytes, and only one migration
+/// is in flight at a time.
+///
+/// The thunk is reached only through the injected callbacks, so the scheduler
+/// can be driven on the host by calling Step() directly instead of Start().
+class SvmPrefetch {
+ public:
+  /// @brief Migrates [base, base + size) to @p node.
+  typedef std::function<void(void* base, size_t size, uint32_t node)> MigrateFn;
+  /// @brief Reports a prefetch whose ranges have all been migrated or superseded.
+  typedef std::function<void(hsa_signal_t completion)> CompleteFn;
+
+  /// @brief Returned by Destination() when no pending range intersects the query.
+  static const uint32_t kNoNode = uint32_t(-2);
+
+  struct Prefetch;
+
+  SvmPrefetch(MigrateFn migrate, CompleteFn complete, size_t batch_bytes);
+  ~SvmPrefetch();
+
+  /// @brief Records a page aligned prefetch of [base, base + size) to @p node.
+  /// Nothing is migrated until Ready() is called on the returned handle.
+  Prefetch* Add(uintptr_t base, size_t size, uint32_t node, hsa_signal_t completion);
+
+  /// @brief Marks a prefetch's dependencies satisfied and queues its ranges.
+  void Ready(Prefetch* prefetch);
+
+  /// @brief Drops a prefetch that was never made ready, without completing it.
+  void Cancel(Prefetch* prefetch);
+
+  /// @brief Issues one coalesced migration and completes any prefetches it
+  /// finished. Returns false if nothing was ready. Not reentrant.
+  bool Step();
+
+  /// @brief Reports the pending destination of [base, end).
+  ///
+  /// @param [out] node Common destination of the pending parts of the range, or
+  /// kNoNode if none are pending.
+  /// @param [out] holes Subranges with no pending prefetch, as (base, size).
+  ///
+  /// @retval false The pending parts of the range have different destinations.
+  bool Destination(uintptr_t base, uintptr_t end, uint32_t* node,
+                   std::vector<std::pair<uintptr_t, size_t>>* holes);
+
+  /// @brief Starts the worker thread which calls Step() as prefetches become
+  /// ready. Returns false if the thread could not be created.
+  bool Start();
+
+  struct Prefetch {
+    uintptr_t base;
+    uintptr_t end;
+    uint32_t node;
+    hsa_signal_t completion;
+    bool ready;
+    // Bytes still pending in ranges_ and bytes in the current migration.
+    size_t live;
+    size_t in_flight;
+  };
+
+ private:
+  struct Range {
+    Range(size_t Bytes, Prefetch* Owner) : bytes(Bytes), owner(Owner) {}
+    size_t bytes;
+    Prefetch* owner;
+  };
+  typedef std::map<uintptr_t, Range> range_map_t;
+
+  static void WorkerLoop(void* arg);
+
+  bool Done(const Prefetch* prefetch) const {
+    return prefetch->ready && prefetch->live == 0 && prefetch->in_flight == 0;
+  }
+
+  // Removes [base, end) from pending ranges. Prefetches left with nothing to do
+  // are appended to @p done.
+  void Trim(uintptr_t base, uintptr_t end, std::vector<Prefetch*>* done);
+
+  void Unqueue(Prefetch* prefetch);
+
+  void Finish(const std::vector<Prefetch*>& done);
+
+  MigrateFn migrate_;
+  CompleteFn complete_;
+  const size_t batch_bytes_;
+
+  KernelMutex lock_;
+  // Disjoint pending ranges keyed by base address.
+  range_map_t ranges_;
+  // Ready prefetches with pending ranges, oldest first.
+  std::deque<Prefetch*> ready_;
+
+  // Migration issued by Step() and not yet returned, empty if begin == end.
+  uintptr_t issued_begin_;
+  uintptr_t issued_end_;
+  uint32_t issued_node_;
+
+  os::Thread thread_;
+  os::Semaphore wake_;
+  std::atomic<bool> exit_;
+
+  DISALLOW_COPY_AND_ASSIGN(SvmPrefetch);
+};
+
+}  // namespace AMD
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_INC_AMD_SVM_PREFETCH_H_
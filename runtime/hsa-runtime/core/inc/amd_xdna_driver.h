@@ -42,11 +42,17 @@
 #ifndef HSA_RUNTIME_CORE_INC_AMD_XDNA_DRIVER_H_
 #define HSA_RUNTIME_CORE_INC_AMD_XDNA_DRIVER_H_
 
+#include <map>
 #include <memory>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "core/inc/amd_aie_cmd_submitter.h"
 #include "core/inc/driver.h"
 #include "core/inc/memory_region.h"
+#include "core/util/locks.h"
+#include "core/util/simple_heap.h"
 
 namespace rocr {
 namespace core {
@@ -79,6 +85,23 @@ public:
                               uint32_t node_id) override;
   hsa_status_t FreeMemory(void *mem, size_t size) override;
 
+  /// @brief Allocates memory backed by BOs of an amdxdna BO type.
+  /// AllocateMemory picks the type from the memory region.
+  hsa_status_t AllocateBoMemory(uint32_t type,
+                                core::MemoryRegion::AllocateFlags alloc_flags,
+                                void **mem, size_t size);
+
+  /// @brief Finds the buffer object backing a runtime allocation.
+  /// @param ptr Address inside an allocation made by this driver.
+  /// @param[out] handle DRM handle of the BO containing @p ptr.
+  /// @param[out] offset Byte offset of @p ptr from the start of the BO.
+  /// @return HSA_STATUS_ERROR_INVALID_ALLOCATION if @p ptr is not in a BO.
+  hsa_status_t GetBoHandle(const void *ptr, uint32_t *handle,
+                           size_t *offset) const;
+
+  /// @brief Returns the submission path shared by this driver's queues.
+  AieCommandSink &GetCommandSink() const { return *cmd_sink_; }
+
   /// @brief Creates a context on the AIE device for this queue.
   /// @param queue Queue whose on-device context is being created.
   /// @return hsa_status_t
@@ -93,11 +116,100 @@ private:
   hsa_status_t InitDeviceHeap();
   hsa_status_t FreeDeviceHeap();
 
+  /// @brief A buffer object owned by the driver.
+  struct BufferObject {
+    void *vaddr;
+    size_t size;
+    /// The BO was mmapped by the driver and must be unmapped on release.
+    bool cpu_mapped;
+  };
+
+  /// @brief Supplies whole BOs of one type to a SimpleHeap.
+  class BoBlockAllocator {
+   public:
+    /// Small BOs are carved out of blocks of this size.
+    static const size_t kBlockSize = 1024 * 1024;
+
+    BoBlockAllocator(XdnaDriver &driver, uint32_t type)
+        : driver_(driver), type_(type) {}
+    void *alloc(size_t request_size, size_t &allocated_size) const;
+    void free(void *ptr, size_t length) const;
+    size_t block_size() const { return kBlockSize; }
+
+   private:
+    XdnaDriver &driver_;
+    uint32_t type_;
+  };
+
+  /// @brief Encodes ERT packets into command BOs and executes them on a
+  /// hardware context.
+  class CommandSink : public AieCommandSink {
+   public:
+    explicit CommandSink(XdnaDriver &driver) : driver_(driver) {}
+    ~CommandSink();
+
+    hsa_status_t SubmitChain(uint32_t hw_ctx,
+                             const hsa_amd_aie_ert_packet_t *const *cmds,
+                             uint32_t count, uint64_t *seq) override;
+    hsa_status_t WaitChain(uint32_t hw_ctx, uint64_t seq) override;
+
+   private:
+    /// @brief A whole command BO. The kernel takes commands by BO handle, so
+    /// each command needs a BO of its own.
+    struct CmdBo {
+      uint32_t handle;
+      uint32_t *cmd;
+    };
+
+    /// Fits an ERT header and the largest payload the 11-bit count allows.
+    static const size_t kCmdBoSize = 8192;
+
+    /// @brief Appends the handles of the BOs that @p ert's payload points
+    /// into. May append duplicates.
+    void AddPayloadBos(const hsa_amd_aie_ert_packet_t &ert,
+                       std::vector<uint32_t> *handles) const;
+    /// @brief Takes a command BO from the free list or creates one.
+    hsa_status_t AcquireCmdBo(CmdBo *bo);
+
+    XdnaDriver &driver_;
+    /// Guards free_bos_ and in_flight_.
+    KernelMutex lock_;
+    /// Command BOs are recycled instead of created per dispatch.
+    std::vector<CmdBo> free_bos_;
+    /// BOs of each submission, keyed by hardware context and sequence number.
+    /// The chain command, if any, comes first.
+    std::map<std::pair<uint32_t, uint64_t>, std::vector<CmdBo>> in_flight_;
+  };
+
+  /// @brief Creates a BO of @p type, makes it CPU accessible and records it.
+  /// Caller holds bo_lock_.
+  hsa_status_t CreateBo(uint32_t type, size_t size, uint32_t *handle,
+                        void **mem);
+  /// @brief Unmaps and closes a BO created by CreateBo. Caller holds bo_lock_.
+  hsa_status_t ReleaseBo(uint32_t handle);
+  /// @brief Returns the sub-allocator for a BO type.
+  SimpleHeap<BoBlockAllocator> &BoHeap(uint32_t type);
+
+  /// Requests up to this size are sub-allocated from pooled BOs instead of
+  /// creating a BO each. Each BO costs two or three ioctls.
+  static const size_t kSubAllocLimit = 64 * 1024;
+
+  /// Sub-allocators for device and command buffers.
+  std::unique_ptr<SimpleHeap<BoBlockAllocator>> dev_bo_heap_;
+  std::unique_ptr<SimpleHeap<BoBlockAllocator>> cmd_bo_heap_;
+
+  /// Command submission for all queues on this driver.
+  std::unique_ptr<CommandSink> cmd_sink_;
+
   /// TODO: Remove this in the future and rely on the core Runtime
   /// object to track handle allocations. Using the VMEM API for mapping XDNA
   /// driver handles requires a bit more refactoring. So rely on the XDNA driver
   /// to manage some of this for now.
-  std::unordered_map<uint32_t, void *> vmem_handle_mappings;
+  std::unordered_map<uint32_t, BufferObject> vmem_handle_mappings;
+  /// BO handles keyed by CPU address, for FreeMemory and GetBoHandle.
+  std::map<uintptr_t, uint32_t> bo_handles_by_va_;
+  /// Guards the BO tables and sub-allocators.
+  mutable KernelMutex bo_lock_;
 
   /// @brief Virtual address range allocated for the device heap.
   ///
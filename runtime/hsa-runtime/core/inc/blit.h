@@ -46,9 +46,17 @@
 #include <stdint.h>
 
 #include "core/inc/agent.h"
+#include "core/inc/signal.h"
 
 namespace rocr {
 namespace core {
+/// @brief One element of a batched linear copy submission.
+struct LinearCopyDesc {
+  void* dst;
+  const void* src;
+  size_t size;
+};
+
 class Blit {
  public:
   explicit Blit() {}
@@ -91,6 +99,37 @@ class Blit {
       std::vector<core::Signal*>& dep_signals, core::Signal& out_signal,
       std::vector<core::Signal*>& gang_signals) = 0;
 
+  /// @brief Submit a batch of linear copies sharing one dependency list and
+  /// one completion signal. The call is non blocking. All copies start after
+  /// the dependent signals are satisfied and the out signal is decremented
+  /// once, after every copy in the batch has completed.
+  ///
+  /// The default submits the copies individually, raising the out signal so
+  /// that each completion retires one count. Engines able to place the whole
+  /// batch behind a single fence override this.
+  ///
+  /// @param copies Array of copy descriptors.
+  /// @param count Number of elements in @p copies.
+  /// @param dep_signals Arrays of dependent signal.
+  /// @param out_signal Output signal.
+  virtual hsa_status_t SubmitLinearCopyCommands(const LinearCopyDesc* copies, size_t count,
+                                                std::vector<core::Signal*>& dep_signals,
+                                                core::Signal& out_signal) {
+    if (count == 0) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+    std::vector<core::Signal*> gang_signals(0);
+    if (count > 1) out_signal.AddRelaxed(static_cast<hsa_signal_value_t>(count - 1));
+    for (size_t i = 0; i < count; ++i) {
+      hsa_status_t stat = SubmitLinearCopyCommand(copies[i].dst, copies[i].src, copies[i].size,
+                                                  dep_signals, out_signal, gang_signals);
+      if (stat != HSA_STATUS_SUCCESS) {
+        // Release the counts owned by copies that were never submitted.
+        out_signal.SubRelaxed(static_cast<hsa_signal_value_t>(count - 1 - i));
+        return stat;
+      }
+    }
+    return HSA_STATUS_SUCCESS;
+  }
+
   /// @brief Submit a linear fill command to the the underlying compute device's
   /// control block. The call is blocking until the command execution is
   /// finished.
@@ -160,6 +160,14 @@ hsa_status_t
     hsa_amd_memory_copy_engine_status(hsa_agent_t dst_agent, hsa_agent_t src_agent,
                                       uint32_t *engine_ids_mask);
 
+// Mirrors Amd Extension Apis
+hsa_status_t
+    hsa_amd_memory_async_copy_batch(const hsa_amd_copy_desc_t* copies, size_t count,
+                                    hsa_agent_t dst_agent, hsa_agent_t src_agent,
+                                    uint32_t num_dep_signals,
+                                    const hsa_signal_t* dep_signals,
+                                    hsa_signal_t completion_signal);
+
 // Mirrors Amd Extension Apis
 hsa_status_t hsa_amd_memory_async_copy_rect(
     const hsa_pitched_ptr_t* dst, const hsa_dim3_t* dst_offset, const hsa_pitched_ptr_t* src,
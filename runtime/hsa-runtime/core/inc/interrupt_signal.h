@@ -46,6 +46,7 @@
 #define HSA_RUNTME_CORE_INC_INTERRUPT_SIGNAL_H_
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "hsakmt/hsakmt.h"
@@ -66,6 +67,14 @@ namespace core {
 /// signaling.
 class InterruptSignal : private LocalSignal, public Signal {
  public:
+  /// @brief Pool of KFD signal events backing interrupt signals.
+  ///
+  /// KFD limits the number of signal events per process. Once that limit is reached, or once
+  /// HSA_SIGNAL_EVENT_SHARE_RATIO signals use each event, new signals share an event already in
+  /// use, chosen by hashing the signal. Mailbox writes and SetEvent then wake every waiter on the
+  /// shared event and each waiter rechecks its own signal. Sharing needs KFD event age tracking,
+  /// otherwise a waiter may consume a wakeup meant for another signal, so without it alloc()
+  /// returns nullptr once the driver is out of events.
   class EventPool {
    public:
     struct Deleter {
@@ -73,18 +82,36 @@ class InterruptSignal : private LocalSignal, public Signal {
     };
     using unique_event_ptr = ::std::unique_ptr<HsaEvent, Deleter>;
 
-    EventPool() : allEventsAllocated(false) {}
+    EventPool() : users_(0), allEventsAllocated(false) {}
 
-    HsaEvent* alloc();
+    /// @brief Returns an event for the signal identified by key, or nullptr if none is available.
+    HsaEvent* alloc(const void* key);
     void free(HsaEvent* evt);
     void clear() {
       events_.clear();
+      active_.clear();
+      refs_.clear();
+      users_ = 0;
       allEventsAllocated = false;
     }
 
    private:
+    struct Ref {
+      uint32_t count;
+      size_t index;  // Position in active_.
+    };
+
+    HsaEvent* Activate(HsaEvent* evt);
+    HsaEvent* Share(const void* key);
+
     HybridMutex lock_;
+    // Idle events.
     std::vector<unique_event_ptr> events_;
+    // Events held by at least one signal and their signal counts.
+    std::vector<HsaEvent*> active_;
+    std::unordered_map<HsaEvent*, Ref> refs_;
+    // Number of signals holding an event from this pool.
+    size_t users_;
     bool allEventsAllocated;
   };
 
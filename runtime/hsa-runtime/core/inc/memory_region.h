@@ -106,6 +106,10 @@ class MemoryRegion : public Checked<0x9C961F19EE175BB3> {
     AllocateGTTAccess = (1 << 9),
     AllocateContiguous = (1 << 10), // Physically contiguous memory
     AllocateUncached = (1 << 11),   // Uncached memory
+    // NUMA placement of system memory, overriding the process default.
+    AllocateNumaInterleave = (1 << 12),  // Round robin across allowed nodes
+    AllocateNumaBind = (1 << 13),        // Region's node only, no fallback
+    AllocateNumaLocal = (1 << 14),       // First touch
   };
 
   typedef uint32_t AllocateFlags;
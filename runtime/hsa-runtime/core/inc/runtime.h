@@ -45,6 +45,8 @@
 #ifndef HSA_RUNTME_CORE_INC_RUNTIME_H_
 #define HSA_RUNTME_CORE_INC_RUNTIME_H_
 
+#include <atomic>
+#include <list>
 #include <vector>
 #include <map>
 #include <memory>
@@ -63,7 +65,10 @@
 #include "core/inc/hsa_ext_amd_impl.h"
 
 #include "core/inc/agent.h"
+#include "core/inc/amd_staged_copy.h"
+#include "core/inc/amd_svm_prefetch.h"
 #include "core/inc/amd_kfd_driver.h"
+#include "core/inc/amd_pin_registry.h"
 #include "core/inc/amd_xdna_driver.h"
 #include "core/inc/exceptions.h"
 #include "core/inc/interrupt_signal.h"
@@ -71,6 +76,7 @@
 #include "core/inc/signal.h"
 #include "core/inc/svm_profiler.h"
 #include "core/util/flag.h"
+#include "core/util/interval_map.h"
 #include "core/util/locks.h"
 #include "core/util/os.h"
 #include "core/util/utils.h"
@@ -233,6 +239,14 @@ class Runtime {
   /// @retval ::HSA_STATUS_SUCCESS if memory copy is successful and completed.
   hsa_status_t CopyMemory(void* dst, const void* src, size_t size);
 
+  /// @brief Drop cached hsa_memory_copy pointer classifications and pins
+  /// overlapping [ptr, ptr + size). Must be called after any change to the
+  /// registration or ownership of the range becomes visible to PtrInfo.
+  ///
+  /// @param [in] ptr Start of the range.
+  /// @param [in] size Range size in bytes, 0 if only @p ptr is known.
+  void InvalidateCopyCaches(const void* ptr, size_t size);
+
   /// @brief Non-blocking memory copy from src to dst.
   ///
   /// @details The memory copy will be performed after all signals in
@@ -255,6 +269,24 @@ class Runtime {
                           core::Agent* src_agent, size_t size,
                           std::vector<core::Signal*>& dep_signals, core::Signal& completion_signal);
 
+  /// @brief Non-blocking copy of a batch of buffers between the same pair of
+  /// agents.
+  ///
+  /// @details Semantics match CopyMemory for each copy. Every copy waits on
+  /// @p dep_signals and @p completion_signal is decremented once, after the
+  /// whole batch has completed. Copies of 0 bytes must be filtered out by the
+  /// caller.
+  ///
+  /// @param [in] copies Array of copy descriptors.
+  /// @param [in] count Number of elements in @p copies, at least 1.
+  ///
+  /// @retval ::HSA_STATUS_SUCCESS if the copies have been submitted
+  /// successfully to the agent DMA queue.
+  hsa_status_t CopyMemoryBatch(const core::LinearCopyDesc* copies, size_t count,
+                               core::Agent* dst_agent, core::Agent* src_agent,
+                               std::vector<core::Signal*>& dep_signals,
+                               core::Signal& completion_signal);
+
   /// @brief Non-blocking memory copy from src to dst on engine_id.
   ///
   /// @details All semantics and params are dentical to CopyMemory
@@ -419,6 +451,8 @@ class Runtime {
 
   Agent* region_gpu() { return region_gpu_; }
 
+  AMD::PinRegistry* pin_registry() { return pin_registry_.get(); }
+
   const std::vector<const MemoryRegion*>& system_regions_fine() const {
     return system_regions_fine_;
   }
@@ -559,26 +593,19 @@ class Runtime {
     std::vector<void*> arg_;
   };
 
-  struct PrefetchRange;
-  typedef std::map<uintptr_t, PrefetchRange> prefetch_map_t;
+  // Pageable host range kept locked by CopyMemory between calls.
+  struct CopyPin {
+    uintptr_t base;
+    size_t size;
+    void* agent_ptr;
+    uint32_t users;
+    bool stale;  // Invalidated while in use, unlock on last release.
+  };
 
   struct PrefetchOp {
-    void* base;
-    size_t size;
-    uint32_t node_id;
     int remaining_deps;
-    hsa_signal_t completion;
     std::vector<hsa_signal_t> dep_signals;
-    prefetch_map_t::iterator prefetch_map_entry;
-  };
-
-  struct PrefetchRange {
-    PrefetchRange() {}
-    PrefetchRange(size_t Bytes, PrefetchOp* Op) : bytes(Bytes), op(Op) {}
-    size_t bytes;
-    PrefetchOp* op;
-    prefetch_map_t::iterator prev;
-    prefetch_map_t::iterator next;
+    AMD::SvmPrefetch::Prefetch* prefetch;
   };
 
   // Will be created before any user could call hsa_init but also could be
@@ -599,6 +626,28 @@ class Runtime {
   /// @brief Close connection to kernel driver and cleanup resources.
   void Unload();
 
+  /// @brief Find the owning agent of [ptr, ptr + size) for a blocking copy.
+  /// Returns true for system memory. @p need_lock is set for host memory not
+  /// known to KFD.
+  bool ClassifyCopyPtr(const void* ptr, size_t size, core::Agent*& agent, bool& need_lock);
+
+  /// @brief Return a cached lock covering [ptr, ptr + size), creating it if
+  /// the pin cache has room. Returns nullptr if the caller must lock itself.
+  CopyPin* AcquireCopyPin(void* ptr, size_t size, void** agent_ptr);
+
+  void ReleaseCopyPin(CopyPin* pin);
+
+  /// @brief Unlock removed pins and retire classifications that may cover them.
+  void UnlockCopyPins(std::list<CopyPin>& pins);
+
+  /// @brief Unlock and remove every cached pin.
+  void FlushCopyPins();
+
+  /// @brief Owner of IPC and graphics interop memory at @p ptr, @p agent for
+  /// any other pointer. Async copies name the owner when the application may
+  /// not have a handle for it.
+  core::Agent* CopyOwnerAgent(core::Agent* agent, const void* ptr);
+
   /// @brief Dynamically load extension libraries (images, finalizer) and
   /// call OnLoad method on each loaded library.
   void LoadExtensions();
@@ -691,9 +740,23 @@ class Runtime {
   // Contains the region, address, and size of previously allocated memory.
   std::map<const void*, AllocationRegion> allocation_map_;
 
-  // Pending prefetch containers.
-  KernelMutex prefetch_lock_;
-  prefetch_map_t prefetch_map_;
+  // Host ranges locked by hsa_amd_memory_lock and CopyMemory, shared between overlapping locks.
+  std::unique_ptr<AMD::PinRegistry> pin_registry_;
+
+  // Coalesces pending SVM prefetches and issues their migrations.
+  std::unique_ptr<AMD::SvmPrefetch> svm_prefetch_;
+
+  // Bumped whenever a range may change registration. Per thread CopyMemory
+  // pointer classifications are only trusted while it is unchanged.
+  static std::atomic<uint64_t> copy_cache_generation_;
+
+  // Pinned pageable ranges for CopyMemory, most recently used first.
+  KernelMutex copy_pin_lock_;
+  std::list<CopyPin> copy_pins_;
+  size_t copy_pin_bytes_;
+
+  // Bounce buffer engine for pageable copies that are cheaper to stage than to pin.
+  std::unique_ptr<AMD::StagedCopy> staged_copy_;
 
   // Allocator using ::system_region_
   std::function<void*(size_t size, size_t align, MemoryRegion::AllocateFlags flags, int agent_node_id)> system_allocator_;
@@ -782,7 +845,7 @@ class Runtime {
     size_t size;
     int use_count;
   };
-  std::map<const void*, AddressHandle> reserved_address_map_;  // Indexed by VA
+  IntervalMap<AddressHandle> reserved_address_map_;  // Indexed by VA
 
   struct MemoryHandle {
     MemoryHandle() : region(NULL), size(0), ref_count(0), thunk_handle(NULL), alloc_flag(0) {}
@@ -866,7 +929,12 @@ class Runtime {
     amdgpu_bo_handle ldrm_bo;
     std::map<Agent*, MappedHandleAllowedAgent> allowed_agents;
   };
-  std::map<const void*, MappedHandle> mapped_handle_map_;  // Indexed by VA
+  IntervalMap<MappedHandle> mapped_handle_map_;  // Indexed by VA
+
+  // Protects reserved_address_map_, memory_handle_map_ and mapped_handle_map_.  Kept apart from
+  // memory_lock_ so virtual memory calls do not serialize against regular allocations, and shared
+  // so lookups run concurrently.  Never acquire memory_lock_ while holding it.
+  KernelSharedMutex vmem_lock_;
 
   hsa_status_t VMemoryMapAllowAccess(const void *va,
                                      hsa_access_permission_t perm,
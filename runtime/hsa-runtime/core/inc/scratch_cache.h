@@ -43,12 +43,14 @@
 #ifndef HSA_RUNTIME_CORE_INC_SCRATCH_CACHE_H_
 #define HSA_RUNTIME_CORE_INC_SCRATCH_CACHE_H_
 
-#include "core/inc/amd_gpu_agent.h"
+#include "inc/hsa.h"
 #include "core/util/locks.h"
 #include "core/util/utils.h"
 
 #include <map>
 #include <functional>
+#include <unordered_map>
+#include <vector>
 
 namespace rocr {
 namespace AMD {
@@ -60,11 +62,16 @@ class ScratchCache {
     void* base;
     bool large;
     uint32_t state;
+    // Affinity key of the queue which last released the block, see allocMain.
+    const void* owner;
+    // Position in the size class free list while free.
+    size_t free_index;
 
-    node() : base(nullptr), state(FREE) {}
+    node() : base(nullptr), large(false), state(FREE), owner(nullptr), free_index(0) {}
 
     bool isFree() const { return state == FREE; }
     bool trimPending() const { return state == (ALLOC | TRIM); }
+    bool stealPending() const { return (state & STEAL) != 0; }
 
     void trim() {
       assert(!isFree() && "Trim of free scratch node.");
@@ -78,12 +85,29 @@ class ScratchCache {
       assert(isFree() && "Alloc of non-free scratch node.");
       state = ALLOC;
     }
+    void steal() {
+      assert((state == ALLOC) && "Steal of free, trimmed or stolen scratch node.");
+      state |= STEAL;
+    }
+    void endSteal() {
+      assert(stealPending() && "End of steal on scratch node not being stolen.");
+      state &= ~STEAL;
+    }
   };
 
   typedef ::std::multimap<size_t, node> map_t;
   typedef map_t::iterator ref_t;
   typedef ::std::function<void(void*, size_t, bool)> deallocator_t;
 
+  // Cache effectiveness counters.
+  struct Stats {
+    uint64_t hits;           // Requests served from the cache.
+    uint64_t affinity_hits;  // Hits which returned the block last released by the same queue.
+    uint64_t misses;         // Requests the cache could not serve.
+    uint64_t trims;          // Blocks released back to the scratch pool by trim.
+    size_t trimmed_bytes;
+  };
+
   // @brief Contains scratch memory information.
   struct ScratchInfo {
     // Size to satisfy the present dispatch without throttling.
@@ -126,39 +150,18 @@ class ScratchCache {
   ScratchCache& operator=(const ScratchCache& rhs) = delete;
   ScratchCache& operator=(ScratchCache&& rhs) = delete;
 
-  ScratchCache(deallocator_t deallocator) : dealloc(deallocator), available_bytes_(0) {}
+  ScratchCache(deallocator_t deallocator)
+      : dealloc(deallocator), available_bytes_(0), retained_bytes_(0), stats_() {}
 
   ~ScratchCache() { assert(map.empty() && "ScratchCache not empty at shutdown."); }
 
+  // Blocks are kept in per size free lists. A request is served from the free list of its size
+  // (small) or of the smallest size class which fits (large). Within that class the block its
+  // queue released last is preferred, so affinity never hands out a larger block than needed.
   bool allocMain(ScratchInfo& info) {
-    ref_t it = map.upper_bound(info.main_size - 1);
-    if (it == map.end()) return false;
-
-    // Small requests must have an exact size match and be small.
-    if (!info.large) {
-      while ((it != map.end()) && (it->first == info.main_size)) {
-        if (it->second.isFree() && (!it->second.large)) {
-          it->second.alloc();
-          info.main_queue_base = it->second.base;
-          info.main_scratch_node = it;
-          available_bytes_ -= it->first;
-          return true;
-        }
-        it++;
-      }
-      return false;
-    }
-
-    // Large requests may use a small allocation and do not require an exact size match.
-    while (it != map.end()) {
-      if (it->second.isFree()) {
-        it->second.alloc();
-        info.main_queue_base = it->second.base;
-        info.main_scratch_node = it;
-        available_bytes_ -= it->first;
-        return true;
-      }
-      it++;
+    if (allocFree(&info.main_queue_base, info.main_size, !info.large, info.main_scratch_node)) {
+      info.main_queue_base = info.main_scratch_node->second.base;
+      return true;
     }
     return false;
   }
@@ -173,14 +176,34 @@ class ScratchCache {
     }
 
     assert(!info.main_scratch_node->second.isFree() && "free called on free scratch node.");
-    auto it = info.main_scratch_node;
-    if (it->second.trimPending()) {
-      dealloc(it->second.base, it->first, it->second.large);
-      map.erase(it);
-      return;
-    }
-    it->second.free();
-    available_bytes_ += it->first;
+    assert(!info.main_scratch_node->second.stealPending() && "free called on stolen scratch node.");
+    release(&info.main_queue_base, info.main_scratch_node);
+  }
+
+  // Returns true if the main scratch bound by owner would satisfy info once reclaimed.
+  // Uses the same size rules as allocMain. size is set to the size of owner's block.
+  bool canStealMain(const ScratchInfo& owner, const ScratchInfo& info, size_t& size) {
+    // Reserved memory (map.end()) is never stolen.
+    if ((owner.main_queue_base == nullptr) || (owner.main_scratch_node == map.end())) return false;
+    const node& n = owner.main_scratch_node->second;
+    if (n.state != node::ALLOC) return false;
+
+    size = owner.main_scratch_node->first;
+    if (!info.large) return (size == info.main_size) && (!n.large);
+    return size >= info.main_size;
+  }
+
+  void stealMain(ScratchInfo& owner) { owner.main_scratch_node->second.steal(); }
+
+  void cancelStealMain(ScratchInfo& owner) { owner.main_scratch_node->second.endSteal(); }
+
+  // Hands a stolen block from owner (which must no longer be using it) over to info.
+  void transferMain(ScratchInfo& owner, ScratchInfo& info) {
+    auto it = owner.main_scratch_node;
+    it->second.endSteal();
+    info.main_queue_base = it->second.base;
+    info.main_scratch_node = it;
+    owner.main_queue_base = nullptr;
   }
 
   void insertMain(ScratchInfo& info) {
@@ -190,55 +213,45 @@ class ScratchCache {
     n.alloc();
 
     auto it = map.insert(std::make_pair(info.main_size, n));
+    retained_bytes_ += info.main_size;
     info.main_scratch_node = it;
   }
 
   bool trim(bool trim_nodes_in_use) {
     bool ret = !map.empty();
-    auto it = map.begin();
-    while (it != map.end()) {
-      if (it->second.isFree()) {
-        available_bytes_ -= it->first;
-        dealloc(it->second.base, it->first, it->second.large);
-        auto temp = it;
-        it++;
-        map.erase(temp);
-      } else {
-        if (trim_nodes_in_use) it->second.trim();
-        it++;
+    for (auto& size_class : free_) {
+      for (auto list : {&size_class.second.small, &size_class.second.large}) {
+        for (auto it : *list) {
+          available_bytes_ -= it->first;
+          retained_bytes_ -= it->first;
+          stats_.trims++;
+          stats_.trimmed_bytes += it->first;
+          forget(it);
+          dealloc(it->second.base, it->first, it->second.large);
+          map.erase(it);
+        }
       }
     }
+    free_.clear();
+
+    if (trim_nodes_in_use) {
+      for (auto& entry : map) entry.second.trim();
+    }
     return ret;
   }
 
   bool allocAlt(ScratchInfo& info) {
-    ref_t it = map.upper_bound(info.alt_size - 1);
-    if (it == map.end()) return false;
-
     // Alt requests should have exact size
-    while ((it != map.end()) && (it->first == info.alt_size)) {
-      if (it->second.isFree() && (!it->second.large)) {
-        it->second.alloc();
-        info.alt_queue_base = it->second.base;
-        info.alt_scratch_node = it;
-        available_bytes_ -= it->first;
-        return true;
-      }
-      it++;
+    if (allocFree(&info.alt_queue_base, info.alt_size, true, info.alt_scratch_node)) {
+      info.alt_queue_base = info.alt_scratch_node->second.base;
+      return true;
     }
     return false;
   }
 
   void freeAlt(ScratchInfo& info) {
     assert(!info.alt_scratch_node->second.isFree() && "free called on free scratch node.");
-    auto it = info.alt_scratch_node;
-    if (it->second.trimPending()) {
-      dealloc(it->second.base, it->first, it->second.large);
-      map.erase(it);
-      return;
-    }
-    it->second.free();
-    available_bytes_ += it->first;
+    release(&info.alt_queue_base, info.alt_scratch_node);
   }
 
   void insertAlt(ScratchInfo& info) {
@@ -248,11 +261,15 @@ class ScratchCache {
     n.alloc();
 
     auto it = map.insert(std::make_pair(info.alt_size, n));
+    retained_bytes_ += info.alt_size;
     info.alt_scratch_node = it;
   }
 
   size_t free_bytes() const { return available_bytes_; }
   size_t reserved_bytes() const { return reserved_.first; }
+  // Bytes held by cached blocks, free or in use, excluding reserved memory.
+  size_t retained_bytes() const { return retained_bytes_; }
+  const Stats& stats() const { return stats_; }
 
   void reserve(size_t bytes, void* base) {
     assert(!reserved_.first && "Already reserved memory.");
@@ -291,9 +308,105 @@ class ScratchCache {
   }
 
  private:
+  // Free blocks of one size. Small requests may only use small blocks.
+  struct SizeClass {
+    std::vector<ref_t> small;
+    std::vector<ref_t> large;
+  };
+
+  std::vector<ref_t>& freeList(ref_t it) {
+    SizeClass& size_class = free_[it->first];
+    return it->second.large ? size_class.large : size_class.small;
+  }
+
+  bool fits(ref_t it, size_t size, bool exact) const {
+    if (!it->second.isFree()) return false;
+    if (exact) return (it->first == size) && (!it->second.large);
+    return it->first >= size;
+  }
+
+  bool allocFree(const void* key, size_t size, bool exact, ref_t& ret) {
+    ref_t it = map.end();
+
+    // Empty classes are erased so the first class at or above size has a free block.
+    auto size_class = exact ? free_.find(size) : free_.lower_bound(size);
+    if (size_class != free_.end()) {
+      auto last = affinity_.find(key);
+      if ((last != affinity_.end()) && (last->second->first == size_class->first) &&
+          fits(last->second, size, exact)) {
+        it = last->second;
+        stats_.affinity_hits++;
+      } else if (exact) {
+        if (!size_class->second.small.empty()) it = size_class->second.small.back();
+      } else {
+        auto& list = size_class->second.large.empty() ? size_class->second.small
+                                                      : size_class->second.large;
+        it = list.back();
+      }
+    }
+
+    if (it == map.end()) {
+      stats_.misses++;
+      return false;
+    }
+
+    stats_.hits++;
+    unlinkFree(it);
+    forget(it);
+    it->second.alloc();
+    available_bytes_ -= it->first;
+    ret = it;
+    return true;
+  }
+
+  void release(const void* key, ref_t it) {
+    if (it->second.trimPending()) {
+      retained_bytes_ -= it->first;
+      dealloc(it->second.base, it->first, it->second.large);
+      map.erase(it);
+      return;
+    }
+    it->second.free();
+    available_bytes_ += it->first;
+
+    auto& list = freeList(it);
+    it->second.free_index = list.size();
+    list.push_back(it);
+
+    it->second.owner = key;
+    affinity_[key] = it;
+  }
+
+  void unlinkFree(ref_t it) {
+    auto size_class = free_.find(it->first);
+    assert(size_class != free_.end() && "Free scratch node missing from size class.");
+    auto& list = it->second.large ? size_class->second.large : size_class->second.small;
+    const size_t index = it->second.free_index;
+    list[index] = list.back();
+    list[index]->second.free_index = index;
+    list.pop_back();
+    if (size_class->second.small.empty() && size_class->second.large.empty())
+      free_.erase(size_class);
+  }
+
+  // Drop any affinity to it.
+  void forget(ref_t it) {
+    if (it->second.owner == nullptr) return;
+    auto last = affinity_.find(it->second.owner);
+    if ((last != affinity_.end()) && (last->second == it)) affinity_.erase(last);
+    it->second.owner = nullptr;
+  }
+
   map_t map;
   deallocator_t dealloc;
   size_t available_bytes_;
+  size_t retained_bytes_;
+
+  // Size classes with at least one free block.
+  std::map<size_t, SizeClass> free_;
+  // Block most recently released by each queue (keyed by its ScratchInfo base field).
+  std::unordered_map<const void*, ref_t> affinity_;
+  Stats stats_;
 
   std::pair<size_t, node> reserved_;
 };
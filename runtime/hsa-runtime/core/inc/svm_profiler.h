@@ -43,27 +43,117 @@
 #ifndef HSA_RUNTME_CORE_INC_SVM_PROFILER_H_
 #define HSA_RUNTME_CORE_INC_SVM_PROFILER_H_
 
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <string>
 #include <thread>
+#include <stdint.h>
+#include <stdio.h>
 #include "core/util/os.h"
 
 namespace rocr {
 namespace AMD {
 
+    /* Fixed-size record of one SMI event, used by the binary trace format
+       (HSA_SVM_PROFILE_FORMAT=binary).  A binary trace is an SvmTraceHeader,
+       header.agent_count SvmTraceAgent entries and then a stream of records.
+       Records of different GPUs are not interleaved in time order, decoders
+       must sort by timestamp.  Addresses and sizes are in bytes, agents are KFD
+       gpu_ids (0 for the CPU).  */
+    struct SvmTraceRecord {
+      uint64_t timestamp;
+      uint64_t address;
+      uint64_t size;
+      uint32_t pid;
+      uint32_t from;      // Source agent, or the only agent of the event.
+      uint32_t to;        // Destination agent for migrations.
+      uint16_t event;     // HSA_SMI_EVENT or SVM_TRACE_EVENT_*.
+      uint8_t trigger;
+      char mode;          // 'R'/'W' for faults, 'M'/'U' for fault completion.
+    };
+    static_assert(sizeof(SvmTraceRecord) == 40, "SvmTraceRecord layout changed.");
+
+    // Reports records lost to a full ring, size holds the number of records lost.
+    static const uint16_t SVM_TRACE_EVENT_DROPPED = 0xFFFF;
+    // Reports a failed SMI read, address holds the read result and size the errno.
+    static const uint16_t SVM_TRACE_EVENT_ERROR = 0xFFFE;
+
+    static const char kSvmTraceMagic[8] = {'R', 'O', 'C', 'R', 'S', 'V', 'M', 'T'};
+    static const uint32_t kSvmTraceVersion = 1;
+    // SvmTraceAgent::enumeration_index of the CPU.
+    static const uint32_t kSvmTraceCpuIndex = UINT32_MAX;
+    // Largest agent table accepted by the decoder.
+    static const uint32_t kSvmTraceMaxAgents = 4096;
+
+    struct SvmTraceHeader {
+      char magic[8];      // "ROCRSVMT"
+      uint32_t version;
+      uint32_t record_size;
+      uint32_t agent_count;
+      uint32_t reserved;
+    };
+
+    struct SvmTraceAgent {
+      uint32_t gpu_id;
+      uint32_t node_id;
+      uint32_t enumeration_index;
+      uint32_t reserved;
+      uint64_t handle;
+    };
+
+    /* Decodes one SMI event line, without its newline.  Returns false for malformed lines.  */
+    bool ParseSmiRecord(const char* line, SvmTraceRecord& record);
+
+    /* Prints record as a line of the text trace, agents resolves gpu_ids to agent names.  */
+    void PrintSvmTraceRecord(FILE* file, const SvmTraceRecord& record,
+                             const std::vector<SvmTraceAgent>& agents);
+
+    /* Converts a binary trace to the text trace in time order.  Returns false if the trace is
+       malformed or truncated.  */
+    bool DecodeSvmTrace(FILE* in, FILE* out);
+
+    /* Single producer, single consumer ring of trace records.  */
+    class SvmTraceRing {
+    public:
+      explicit SvmTraceRing(size_t capacity);
+
+      // Producer side, returns false and counts a drop if the ring is full.
+      bool Push(const SvmTraceRecord& record);
+
+      // Consumer side, copies out up to max records.
+      size_t Pop(SvmTraceRecord* records, size_t max);
+
+      uint64_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+    private:
+      std::vector<SvmTraceRecord> records_;
+      const size_t mask_;
+      std::atomic<uint64_t> head_;
+      std::atomic<uint64_t> tail_;
+      std::atomic<uint64_t> dropped_;
+    };
+
     class SvmProfileControl {
     public:
       SvmProfileControl();
       ~SvmProfileControl();
 
     private:
-      template <typename... Args> std::string format(const char* format, Args... arg);
       void PollSmi();
       static void PollSmiRun(void* profileControl);
+      void WriteTrace();
+      static void WriteTraceRun(void* profileControl);
+      size_t DrainTrace(FILE* file, std::vector<SvmTraceRecord>& records);
       int event;
       bool exit;
+      bool binary_;
       os::Thread poll_smi_thread_;
-      std::vector<char> format_buffer;
+      os::Thread write_trace_thread_;
+      std::atomic<bool> poll_done_;
+      // Agents by KFD gpu_id, captured at startup so the poll thread needs no runtime lookups.
+      std::vector<SvmTraceAgent> agents_;
+      std::vector<std::unique_ptr<SvmTraceRing>> rings_;
     };
 
 } // namespace AMD
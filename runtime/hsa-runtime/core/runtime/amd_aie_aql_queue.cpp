@@ -113,6 +113,8 @@ hsa_status_t AieAqlQueue::Inactivate() {
   hsa_status_t status(HSA_STATUS_SUCCESS);
 
   if (active) {
+    // Retire outstanding chains before their hardware context goes away.
+    submitter_.reset();
     status = core::Runtime::runtime_singleton_->AgentDriver(agent_.driver_type)
                  .DestroyQueue(*this);
     hw_ctx_handle_ = std::numeric_limits<uint32_t>::max();
@@ -195,6 +197,10 @@ uint64_t AieAqlQueue::AddWriteIndexAcqRel(uint64_t value) {
 }
 
 void AieAqlQueue::StoreRelaxed(hsa_signal_value_t value) {
+  if (submitter_) {
+    submitter_->Submit();
+    return;
+  }
   atomic::Store(signal_.hardware_doorbell_ptr, uint64_t(value),
                 std::memory_order_release);
 }
@@ -0,0 +1,304 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_aie_cmd_submitter.h"
+
+#include "core/inc/signal.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace AMD {
+
+namespace {
+// Number of dependency slots in barrier-AND/OR packets.
+const uint32_t kBarrierDepCount = 5;
+} // namespace
+
+AieCommandSubmitter::AieCommandSubmitter(AieCommandSink &sink,
+                                         amd_queue_t &queue, uint32_t hw_ctx)
+    : sink_(sink), queue_(queue),
+      ring_(reinterpret_cast<core::AqlPacket *>(queue.hsa_queue.base_address)),
+      mask_(queue.hsa_queue.size - 1), hw_ctx_(hw_ctx),
+      submit_index_(atomic::Load(&queue.read_dispatch_id,
+                                 std::memory_order_relaxed)),
+      stop_(false) {
+  pending_ = os::CreateSemaphore();
+  if (pending_ == nullptr) {
+    throw AMD::hsa_exception(HSA_STATUS_ERROR_OUT_OF_RESOURCES,
+                             "Could not create AIE submission semaphore.");
+  }
+
+  retire_thread_ = os::CreateThread(RetireThread, this);
+  if (retire_thread_ == nullptr) {
+    os::DestroySemaphore(pending_);
+    throw AMD::hsa_exception(HSA_STATUS_ERROR_OUT_OF_RESOURCES,
+                             "Could not create AIE retire thread.");
+  }
+}
+
+AieCommandSubmitter::~AieCommandSubmitter() {
+  stop_.store(true, std::memory_order_release);
+  os::PostSemaphore(pending_);
+  os::WaitForThread(retire_thread_);
+  os::CloseThread(retire_thread_);
+  os::DestroySemaphore(pending_);
+}
+
+bool AieCommandSubmitter::IsChainable(const hsa_amd_aie_ert_packet_t &ert) {
+  switch (ert.opcode) {
+  case HSA_AMD_AIE_ERT_START_CU:
+  case HSA_AMD_AIE_ERT_START_DPU:
+  case HSA_AMD_AIE_ERT_START_NPU:
+  case HSA_AMD_AIE_ERT_START_NPU_PREEMPT:
+    return true;
+  default:
+    // Control commands and nested chains are submitted on their own.
+    return false;
+  }
+}
+
+void AieCommandSubmitter::Submit() {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+
+  if (blocked_) {
+    // The retire thread resumes translation once the barrier is retired.
+    return;
+  }
+
+  const uint64_t write_index(
+      atomic::Load(&queue_.write_dispatch_id, std::memory_order_acquire));
+  const hsa_amd_aie_ert_packet_t *chain[kMaxChainLength];
+  uint32_t chain_count(0);
+  uint64_t chain_first(submit_index_);
+
+  while (submit_index_ < write_index) {
+    const core::AqlPacket &pkt(ring_[submit_index_ & mask_]);
+    const uint16_t header(
+        atomic::Load(&pkt.packet.header, std::memory_order_acquire));
+    const uint8_t type(core::AqlPacket::type(header));
+
+    // A reserved slot becomes a packet once the producer publishes its
+    // header. The producer rings the doorbell again after that.
+    if (type == HSA_PACKET_TYPE_INVALID) {
+      break;
+    }
+
+    const hsa_amd_aie_ert_packet_t &ert(
+        reinterpret_cast<const hsa_amd_aie_ert_packet_t &>(pkt));
+    if (type == HSA_PACKET_TYPE_VENDOR_SPECIFIC &&
+        ert.header.AmdFormat == HSA_AMD_PACKET_TYPE_AIE_ERT) {
+      if (!IsChainable(ert)) {
+        FlushChain(chain, chain_count, chain_first);
+      }
+      if (chain_count == 0) {
+        chain_first = submit_index_;
+      }
+      chain[chain_count++] = &ert;
+      ++submit_index_;
+      if (!IsChainable(ert) || chain_count == kMaxChainLength) {
+        FlushChain(chain, chain_count, chain_first);
+      }
+      continue;
+    }
+
+    // Everything else is processed by the retire thread, in queue order.
+    FlushChain(chain, chain_count, chain_first);
+    PushBatch(Batch{submit_index_, 1, false, 0});
+    ++submit_index_;
+
+    if (type == HSA_PACKET_TYPE_BARRIER_AND ||
+        type == HSA_PACKET_TYPE_BARRIER_OR) {
+      blocked_ = true;
+      break;
+    }
+  }
+
+  FlushChain(chain, chain_count, chain_first);
+}
+
+void AieCommandSubmitter::FlushChain(const hsa_amd_aie_ert_packet_t **chain,
+                                     uint32_t &count, uint64_t first) {
+  if (count == 0) {
+    return;
+  }
+
+  uint64_t seq(0);
+  hsa_status_t status(sink_.SubmitChain(hw_ctx_, chain, count, &seq));
+  if (status != HSA_STATUS_SUCCESS) {
+    // Retire the packets anyway so the queue keeps draining.
+    debug_print("AIE command chain submission failed: %d\n", status);
+  }
+
+  PushBatch(Batch{first, count, status == HSA_STATUS_SUCCESS, seq});
+  count = 0;
+}
+
+void AieCommandSubmitter::PushBatch(const Batch &batch) {
+  batches_.push_back(batch);
+  os::PostSemaphore(pending_);
+}
+
+bool AieCommandSubmitter::WaitBarrier(const core::AqlPacket &pkt) {
+  const uint8_t type(core::AqlPacket::type(pkt.packet.header));
+  const bool wait_all(type == HSA_PACKET_TYPE_BARRIER_AND);
+  const hsa_signal_t *deps(wait_all ? pkt.barrier_and.dep_signal
+                                    : pkt.barrier_or.dep_signal);
+
+  hsa_signal_t signals[kBarrierDepCount];
+  hsa_signal_condition_t conds[kBarrierDepCount];
+  hsa_signal_value_t values[kBarrierDepCount];
+  uint32_t count(0);
+  for (uint32_t i = 0; i < kBarrierDepCount; ++i) {
+    if (deps[i].handle == 0) {
+      continue;
+    }
+    signals[count] = deps[i];
+    conds[count] = HSA_SIGNAL_CONDITION_EQ;
+    values[count] = 0;
+    ++count;
+  }
+
+  // Wait in short slices so a stopped submitter does not hang on a barrier
+  // that will never be satisfied.
+  const uint64_t slice(os::SystemClockFrequency() / 1000);
+
+  if (wait_all) {
+    for (uint32_t i = 0; i < count; ++i) {
+      core::Signal *signal(core::Signal::Convert(signals[i]));
+      while (signal->WaitAcquire(HSA_SIGNAL_CONDITION_EQ, 0, slice,
+                                 HSA_WAIT_STATE_BLOCKED) != 0) {
+        if (stop_.load(std::memory_order_acquire)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // A barrier-OR without dependencies completes immediately.
+  if (count == 0) {
+    return true;
+  }
+
+  hsa_signal_value_t value;
+  while (core::Signal::WaitAny(count, signals, conds, values, slice,
+                               HSA_WAIT_STATE_BLOCKED, &value) >= count) {
+    if (stop_.load(std::memory_order_acquire)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AieCommandSubmitter::Retire(const Batch &batch) {
+  const core::AqlPacket &first(ring_[batch.first & mask_]);
+  const uint8_t type(core::AqlPacket::type(first.packet.header));
+  hsa_signal_t completion{0};
+
+  if (batch.on_device) {
+    hsa_status_t status(sink_.WaitChain(hw_ctx_, batch.seq));
+    if (status != HSA_STATUS_SUCCESS) {
+      debug_print("AIE command chain failed: %d\n", status);
+    }
+  } else if (type != HSA_PACKET_TYPE_VENDOR_SPECIFIC) {
+    // ERT packets keep their payload where AQL packets keep the completion
+    // signal, so only host-processed packets carry one. A barrier abandoned
+    // at shutdown is not signaled.
+    if ((type != HSA_PACKET_TYPE_BARRIER_AND &&
+         type != HSA_PACKET_TYPE_BARRIER_OR) ||
+        WaitBarrier(first)) {
+      completion = first.barrier_and.completion_signal;
+    }
+  }
+
+  // Release the slots before signaling so waiters may reuse them immediately.
+  for (uint32_t i = 0; i < batch.count; ++i) {
+    core::AqlPacket &pkt(ring_[(batch.first + i) & mask_]);
+    atomic::Store(&pkt.packet.header,
+                  uint16_t(HSA_PACKET_TYPE_INVALID << HSA_PACKET_HEADER_TYPE),
+                  std::memory_order_relaxed);
+  }
+  atomic::Store(&queue_.read_dispatch_id, batch.first + batch.count,
+                std::memory_order_release);
+
+  if (completion.handle != 0) {
+    core::Signal::Convert(completion)->SubRelease(1);
+  }
+
+  if ((type == HSA_PACKET_TYPE_BARRIER_AND ||
+       type == HSA_PACKET_TYPE_BARRIER_OR) &&
+      !stop_.load(std::memory_order_acquire)) {
+    {
+      ScopedAcquire<KernelMutex> lock(&lock_);
+      blocked_ = false;
+    }
+    // Pick up whatever was published behind the barrier.
+    Submit();
+  }
+}
+
+void AieCommandSubmitter::RetireThread(void *arg) {
+  AieCommandSubmitter *submitter(reinterpret_cast<AieCommandSubmitter *>(arg));
+
+  while (true) {
+    os::WaitSemaphore(submitter->pending_);
+
+    Batch batch;
+    {
+      ScopedAcquire<KernelMutex> lock(&submitter->lock_);
+      if (submitter->batches_.empty()) {
+        // Only the stop request posts without a batch.
+        if (submitter->stop_.load(std::memory_order_acquire)) {
+          return;
+        }
+        continue;
+      }
+      batch = submitter->batches_.front();
+      submitter->batches_.pop_front();
+    }
+
+    submitter->Retire(batch);
+  }
+}
+
+} // namespace AMD
+} // namespace rocr
@@ -354,6 +354,10 @@ AqlQueue::AqlQueue(GpuAgent* agent, size_t req_size_pkts, HSAuint32 node_id, Scr
 }
 
 AqlQueue::~AqlQueue() {
+  // Stop the agent from stealing this queue's scratch and wait out a steal already in progress.
+  agent_->RemoveAqlQueue(this);
+  { ScopedAcquire<KernelMutex> lock(&main_scratch_lock_); }
+
   // Remove error handler synchronously.
   // Sequences error handler callbacks with queue destroy.
   dynamicScratchState |= ERROR_HANDLER_TERMINATE;
@@ -594,7 +598,22 @@ uint32_t AqlQueue::ComputeRingBufferMaxPkts() {
   return uint32_t(max_bytes / sizeof(core::AqlPacket));
 }
 
+AqlQueue::RingPlacement AqlQueue::GetRingPlacement() const {
+  if ((agent_->profile() == HSA_PROFILE_FULL) && queue_full_workaround_) return RingSharedMapping;
+  if (core::Runtime::runtime_singleton_->flag().dev_mem_queue()) return RingDevice;
+  return RingSystem;
+}
+
 void AqlQueue::AllocRegisteredRingBuffer(uint32_t queue_size_pkts) {
+  // Reuse a ring released by an earlier queue. The caller resets its packet headers.
+  const uint32_t pooled_bytes =
+      uint32_t(queue_size_pkts * sizeof(core::AqlPacket)) * (queue_full_workaround_ ? 2 : 1);
+  ring_buf_ = agent_->AcquireRingBuffer(pooled_bytes, GetRingPlacement());
+  if (ring_buf_ != nullptr) {
+    ring_buf_alloc_bytes_ = pooled_bytes;
+    return;
+  }
+
   if ((agent_->profile() == HSA_PROFILE_FULL) && queue_full_workaround_) {
     // Compute the physical and virtual size of the queue.
     uint32_t ring_buf_phys_size_bytes =
@@ -747,27 +766,35 @@ void AqlQueue::AllocRegisteredRingBuffer(uint32_t queue_size_pkts) {
 }
 
 void AqlQueue::FreeRegisteredRingBuffer() {
-  if ((agent_->profile() == HSA_PROFILE_FULL) && queue_full_workaround_) {
+  if (ring_buf_ != nullptr) {
+    const RingPlacement placement = GetRingPlacement();
+    if (!agent_->RecycleRingBuffer(ring_buf_, ring_buf_alloc_bytes_, placement))
+      FreeRingBuffer(agent_, ring_buf_, ring_buf_alloc_bytes_, placement);
+  }
+
+  ring_buf_ = NULL;
+  ring_buf_alloc_bytes_ = 0;
+}
+
+void AqlQueue::FreeRingBuffer(GpuAgent* agent, void* ring, uint32_t alloc_bytes,
+                              uint32_t placement) {
+  switch (placement) {
+    case RingSharedMapping:
 #ifdef __linux__
-    munmap(ring_buf_, ring_buf_alloc_bytes_);
+      munmap(ring, alloc_bytes);
 #endif
 #ifdef _WIN32
-    UnmapViewOfFile(ring_buf_);
-    UnmapViewOfFile(
-        (void*)(uintptr_t(ring_buf_) + (ring_buf_alloc_bytes_ / 2)));
+      UnmapViewOfFile(ring);
+      UnmapViewOfFile((void*)(uintptr_t(ring) + (alloc_bytes / 2)));
 #endif
-  } else {
-    if (ring_buf_) {
-      if (core::Runtime::runtime_singleton_->flag().dev_mem_queue()) {
-        agent_->finegrain_deallocator()(ring_buf_);
-      } else {
-        agent_->system_deallocator()(ring_buf_);
-      }
-    }
+      break;
+    case RingDevice:
+      agent->finegrain_deallocator()(ring);
+      break;
+    default:
+      agent->system_deallocator()(ring);
+      break;
   }
-
-  ring_buf_ = NULL;
-  ring_buf_alloc_bytes_ = 0;
 }
 
 void AqlQueue::CloseRingBufferFD(const char* ring_buf_shm_path, int fd) const {
@@ -865,6 +892,7 @@ void AqlQueue::FreeMainScratchSpace() {
 }
 
 void AqlQueue::AsyncReclaimMainScratch() {
+  ScopedAcquire<KernelMutex> lock(&main_scratch_lock_);
   auto& scratch = queue_scratch_;
   if (!scratch.async_reclaim || !scratch.main_size) return;
 
@@ -887,7 +915,59 @@ void AqlQueue::AsyncReclaimMainScratch() {
                                                    HSA_AMD_EVENT_SCRATCH_ALLOC_FLAG_NONE);
       return;
     }
+    os::YieldThread();
+  }
+}
+
+bool AqlQueue::MainScratchStealable() {
+  const auto& scratch = queue_scratch_;
+  if (!scratch.async_reclaim || (scratch.main_queue_base == nullptr)) return false;
+  return LoadReadIndexAcquire() == LoadWriteIndexAcquire();
+}
+
+bool AqlQueue::WaitMainScratchIdle(uint64_t timeout_us) {
+  assert(queue_scratch_.main_queue_base && "Surrender of scratch which is not bound.");
+
+  tool::notify_event_scratch_async_reclaim_start(public_handle(),
+                                                 HSA_AMD_EVENT_SCRATCH_ALLOC_FLAG_NONE);
+
+  // Same handshake as AsyncReclaimMainScratch. If the wait times out the queue keeps its block
+  // and the next dispatch needing scratch will fault and re-acquire it.
+  amd_queue_.scratch_wave64_lane_byte_size = 0;
+  uint64_t last_used =
+      atomic::Exchange(&amd_queue_.scratch_last_used_index, UINT64_MAX, std::memory_order_relaxed);
+
+  const uint64_t start = os::ReadAccurateClock();
+  const uint64_t timeout = timeout_us * os::AccurateClockFrequency() / 1000000;
+  bool idle;
+  while (true) {
+    uint64_t last = amd_queue_.scratch_last_used_index;
+    idle = std::min(last, last_used) < amd_queue_.read_dispatch_id;
+    if (idle || (os::ReadAccurateClock() - start > timeout)) break;
+    os::YieldThread();
   }
+
+  // Put back the last use index unless CP recorded a new one, so that a later reclaim of the
+  // block still sees the outstanding dispatch.
+  if (!idle)
+    atomic::Cas(&amd_queue_.scratch_last_used_index, last_used, uint64_t(UINT64_MAX),
+                std::memory_order_relaxed);
+
+  tool::notify_event_scratch_async_reclaim_end(public_handle(),
+                                               HSA_AMD_EVENT_SCRATCH_ALLOC_FLAG_NONE);
+  return idle;
+}
+
+void AqlQueue::SurrenderMainScratch(ScratchInfo& surrendered) {
+  auto& scratch = queue_scratch_;
+  surrendered = scratch;
+  scratch.main_queue_base = nullptr;
+  scratch.main_size = 0;
+  scratch.main_size_per_thread = 0;
+  scratch.main_queue_process_offset = 0;
+  InitScratchSRD();
+
+  HSA::hsa_signal_store_relaxed(amd_queue_.queue_inactive_signal, 0);
 }
 
 void AqlQueue::FreeAltScratchSpace() {
@@ -1077,6 +1157,7 @@ void AqlQueue::HandleInsufficientScratch(hsa_signal_value_t& error_code,
   }
 
   // Use PRIMARY scratch
+  ScopedAcquire<KernelMutex> lock(&main_scratch_lock_);
   agent_->ReleaseQueueMainScratch(scratch);
   scratch.main_size = device_size;
   scratch.main_size_per_thread = size_per_thread;
@@ -1149,6 +1230,7 @@ bool AqlQueue::DynamicQueueEventsHandler(hsa_signal_value_t error_code, void* ar
       tool::notify_event_scratch_free_start(queue->public_handle(),
                                             HSA_AMD_EVENT_SCRATCH_ALLOC_FLAG_USE_ONCE);
 
+      ScopedAcquire<KernelMutex> lock(&queue->main_scratch_lock_);
       auto& scratch = queue->queue_scratch_;
       queue->agent_->ReleaseQueueMainScratch(scratch);
       scratch.main_queue_base = nullptr;
@@ -1324,9 +1406,15 @@ bool AqlQueue::ExceptionHandler(hsa_signal_value_t error_code, void* arg) {
   if (!core::Runtime::runtime_singleton_->KfdVersion().supports_core_dump &&
       queue->agent_->isa()->GetMajorVersion() != 11) {
 
+    amd::coredump::DumpOptions options;
+    options.threads = core::Runtime::runtime_singleton_->flag().coredump_threads();
+    options.sparse = core::Runtime::runtime_singleton_->flag().coredump_sparse();
+    options.compress = core::Runtime::runtime_singleton_->flag().coredump_compress();
+    options.pipe_command = core::Runtime::runtime_singleton_->flag().coredump_pipe();
+
     if (pcs::PcsRuntime::instance()->SessionsActive())
       fprintf(stderr, "GPU core dump skipped because PC Sampling active\n");
-    else if (amd::coredump::dump_gpu_core())
+    else if (amd::coredump::dump_gpu_core(options))
       fprintf(stderr, "GPU core dump failed\n");
     // supports_core_dump flag is overwritten to avoid generate core dump file again
     // caught by a different exception handler. Such as VMFaultHandler.
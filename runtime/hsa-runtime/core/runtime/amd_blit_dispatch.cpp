@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_blit_dispatch.h"
+
+#include <string.h>
+#include <algorithm>
+
+namespace rocr {
+namespace AMD {
+
+void BlitDispatchTemplate::Init(uint64_t kernel_object, uint32_t workitems, uint64_t block) {
+  memset(&packet, 0, sizeof(packet));
+
+  packet.header = HSA_PACKET_TYPE_INVALID;
+  packet.kernel_object = kernel_object;
+
+  // Setup working size.
+  const int kNumDimension = 1;
+  packet.setup = kNumDimension << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS;
+  packet.grid_size_x = AlignUp(workitems, 64);
+  packet.grid_size_y = packet.grid_size_z = 1;
+  packet.workgroup_size_x = 64;
+  packet.workgroup_size_y = packet.workgroup_size_z = 1;
+
+  num_workitems = workitems;
+  block_size = block;
+}
+
+hsa_kernel_dispatch_packet_t BlitDispatchTemplate::Build(const BlitKernelArgs* args,
+                                                         hsa_signal_t completion_signal) const {
+  assert(IsMultipleOf(args, 16));
+  hsa_kernel_dispatch_packet_t ret = packet;
+  ret.kernarg_address = const_cast<BlitKernelArgs*>(args);
+  ret.completion_signal = completion_signal;
+  return ret;
+}
+
+void BlitDispatchTemplate::SetCopyAlignedArgs(uintptr_t dst, uintptr_t src, uint64_t size,
+                                              BlitKernelArgs* args) const {
+  // Phase 1 (byte copy) ends when destination is 0x100-aligned.
+  uint64_t phase1_size = std::min(size, uint64_t(0x100 - (dst & 0xFF)) & 0xFF);
+
+  // Phase 2 (unrolled dwordx4 copy) ends when last whole block fits.
+  uint64_t phase2_size = ((size - phase1_size) / block_size) * block_size;
+
+  // Phase 3 (dword copy) ends when last whole dword fits.
+  uint64_t phase3_size =
+      ((size - phase1_size - phase2_size) / sizeof(uint32_t)) * sizeof(uint32_t);
+
+  args->copy_aligned.phase1_src_start = src;
+  args->copy_aligned.phase1_dst_start = dst;
+  args->copy_aligned.phase2_src_start = src + phase1_size;
+  args->copy_aligned.phase2_dst_start = dst + phase1_size;
+  args->copy_aligned.phase3_src_start = src + phase1_size + phase2_size;
+  args->copy_aligned.phase3_dst_start = dst + phase1_size + phase2_size;
+  args->copy_aligned.phase4_src_start = src + phase1_size + phase2_size + phase3_size;
+  args->copy_aligned.phase4_dst_start = dst + phase1_size + phase2_size + phase3_size;
+  args->copy_aligned.phase4_src_end = src + size;
+  args->copy_aligned.phase4_dst_end = dst + size;
+  args->copy_aligned.num_workitems = num_workitems;
+}
+
+void BlitDispatchTemplate::SetCopyMisalignedArgs(uintptr_t dst, uintptr_t src, uint64_t size,
+                                                 BlitKernelArgs* args) const {
+  // Phase 1 (unrolled byte copy) ends when last whole block fits.
+  uint64_t phase1_size = (size / block_size) * block_size;
+
+  args->copy_misaligned.phase1_src_start = src;
+  args->copy_misaligned.phase1_dst_start = dst;
+  args->copy_misaligned.phase2_src_start = src + phase1_size;
+  args->copy_misaligned.phase2_dst_start = dst + phase1_size;
+  args->copy_misaligned.phase2_src_end = src + size;
+  args->copy_misaligned.phase2_dst_end = dst + size;
+  args->copy_misaligned.num_workitems = num_workitems;
+}
+
+void BlitDispatchTemplate::SetFillArgs(uintptr_t dst, uint32_t value, uint64_t size,
+                                       BlitKernelArgs* args) const {
+  // Phase 1 (unrolled dwordx4 copy) ends when last whole block fits.
+  uint64_t phase1_size = (size / block_size) * block_size;
+
+  args->fill.phase1_dst_start = dst;
+  args->fill.phase2_dst_start = dst + phase1_size;
+  args->fill.phase2_dst_end = dst + size;
+  args->fill.fill_value = value;
+  args->fill.num_workitems = num_workitems;
+}
+
+void BlitHistory::Init(uint32_t slots) {
+  mask_ = slots - 1;
+  bytes_written_.reset(new BytesWritten[slots]);
+  for (uint32_t i = 0; i < slots; i++) {
+    bytes_written_[i].index.store(uint64_t(-1), std::memory_order_relaxed);
+    bytes_written_[i].bytes.store(uint64_t(-1), std::memory_order_relaxed);
+  }
+}
+
+void BlitHistory::Record(uint64_t size, uint64_t index) {
+  uint64_t queued = bytes_queued_.fetch_add(size, std::memory_order_relaxed);
+  BytesWritten& record = bytes_written_[index & mask_];
+  record.index.store(uint64_t(-1), std::memory_order_relaxed);
+  record.bytes.store(queued, std::memory_order_release);
+  record.index.store(index, std::memory_order_release);
+
+  uint64_t last = last_queued_.load(std::memory_order_relaxed);
+  while (last < index) {
+    if (last_queued_.compare_exchange_weak(last, index, std::memory_order_relaxed)) break;
+  }
+}
+
+uint64_t BlitHistory::PendingBytes(uint64_t read) {
+  uint64_t index = pending_search_index_.load();
+  uint64_t last = last_queued_.load(std::memory_order_relaxed);
+  // If the last blit command has been run then the blit is empty.
+  if (read > last) return 0;
+
+  index = Max(index, read);
+  while (index <= last) {
+    // Ensure any record we use was not wrapped or is not being rewritten.
+    BytesWritten& record = bytes_written_[index & mask_];
+    if (index == record.index.load(std::memory_order_acquire)) {
+      uint64_t bytes = record.bytes.load(std::memory_order_acquire);
+      if (index != record.index.load(std::memory_order_acquire)) {
+        index++;
+        continue;
+      }
+      uint64_t ret = bytes_queued_.load(std::memory_order_relaxed) - bytes;
+
+      // Store max search index.
+      uint64_t old = pending_search_index_.load();
+      while (old < index) {
+        if (pending_search_index_.compare_exchange_strong(old, index)) break;
+      }
+
+      return ret;
+    }
+    index++;
+  }
+  debug_warning(false && "Race between PendingBytes and blit submission detected.");
+  // Zero is a valid return in this case since the command which was last when the search started is
+  // now complete.
+  return 0;
+}
+
+}  // namespace AMD
+}  // namespace rocr
@@ -905,12 +905,6 @@ static unsigned extractAqlBits(unsigned v, unsigned pos, unsigned width) {
 BlitKernel::BlitKernel(core::Queue* queue)
     : core::Blit(),
       queue_(queue),
-      kernarg_async_(NULL),
-      kernarg_async_mask_(0),
-      kernarg_async_counter_(0),
-      bytes_queued_(0),
-      last_queued_(0),
-      pending_search_index_(0),
       num_cus_(0) {
   completion_signal_.handle = 0;
 }
@@ -920,8 +914,7 @@ BlitKernel::~BlitKernel() {}
 hsa_status_t BlitKernel::Initialize(const core::Agent& agent) {
   queue_bitmask_ = queue_->public_handle()->size - 1;
 
-  bytes_written_.resize(queue_->public_handle()->size);
-  memset(&bytes_written_[0], -1, bytes_written_.size() * sizeof(BytesWritten));
+  history_.Init(queue_->public_handle()->size);
 
   hsa_status_t status = HSA::hsa_signal_create(1, 0, NULL, &completion_signal_);
   if (HSA_STATUS_SUCCESS != status) {
@@ -929,11 +922,11 @@ hsa_status_t BlitKernel::Initialize(const core::Agent& agent) {
   }
 
   const AMD::GpuAgent& gpuAgent = static_cast<const AMD::GpuAgent&>(agent);
-  kernarg_async_ = reinterpret_cast<KernelArgs*>(
-      gpuAgent.system_allocator()(queue_->public_handle()->size * AlignUp(sizeof(KernelArgs), 16),
-                                  16, core::MemoryRegion::AllocateNoFlags));
-
-  kernarg_async_mask_ = queue_->public_handle()->size - 1;
+  void* slab = gpuAgent.system_allocator()(
+      BlitKernargSlab::Bytes(queue_->public_handle()->size), 16,
+      core::MemoryRegion::AllocateNoFlags);
+  if (slab == NULL) return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
+  kernarg_slab_.Init(slab, queue_->public_handle()->size);
 
   // Obtain the number of compute units in the underlying agent.
   num_cus_ = gpuAgent.properties().NumFComputeCores / 4;
@@ -950,6 +943,17 @@ hsa_status_t BlitKernel::Initialize(const core::Agent& agent) {
                             kernel.code_buf_size_);
   }
 
+  // Launch shapes are fixed per kernel, build their dispatch packets once.
+  const uint32_t copy_workitems = 64 * 4 * num_cus_;
+  const uint32_t fill_workitems = 64 * num_cus_;
+  InitDispatchTemplate(KernelType::CopyAligned, copy_workitems,
+                       uint64_t(copy_workitems) * sizeof(uint32_t) * kCopyAlignedUnroll *
+                           kCopyAlignedVecWidth);
+  InitDispatchTemplate(KernelType::CopyMisaligned, copy_workitems,
+                       uint64_t(copy_workitems) * sizeof(uint8_t) * kCopyMisalignedUnroll);
+  InitDispatchTemplate(KernelType::Fill, fill_workitems,
+                       uint64_t(fill_workitems) * sizeof(uint32_t) * kFillUnroll * kFillVecWidth);
+
   if (agent.profiling_enabled()) {
     return EnableProfiling(true);
   }
@@ -967,8 +971,8 @@ hsa_status_t BlitKernel::Destroy(const core::Agent& agent) {
                            kernel_pair.second.code_buf_size_);
   }
 
-  if (kernarg_async_ != NULL) {
-    gpuAgent.system_deallocator()(kernarg_async_);
+  if (kernarg_slab_.base() != NULL) {
+    gpuAgent.system_deallocator()(kernarg_slab_.base());
   }
 
   if (completion_signal_.handle != 0) {
@@ -1013,12 +1017,8 @@ hsa_status_t BlitKernel::SubmitLinearCopyCommand(
   const uint32_t num_barrier_packet = uint32_t((dep_signals.size() + 4) / 5);
   const uint32_t total_num_packet = num_barrier_packet + 1;
 
-  uint64_t write_index;
-  {
-    std::lock_guard<std::mutex> lock(reservation_lock_);
-    write_index = AcquireWriteIndex(total_num_packet);
-    RecordBlitHistory(size, write_index + total_num_packet - 1);
-  }
+  uint64_t write_index = AcquireWriteIndex(total_num_packet);
+  history_.Record(size, write_index + total_num_packet - 1);
 
   uint64_t write_index_temp = write_index;
 
@@ -1072,74 +1072,21 @@ hsa_status_t BlitKernel::SubmitLinearCopyCommand(
   }
 
   // Insert dispatch packet for copy kernel.
-  KernelArgs* args = ObtainAsyncKernelCopyArg();
-  KernelCode* kernel_code = nullptr;
-  int num_workitems = 0;
+  BlitKernelArgs* args = kernarg_slab_.At(write_index);
+  const BlitDispatchTemplate* dispatch = nullptr;
 
-  bool aligned = ((uintptr_t(src) & 0x3) == (uintptr_t(dst) & 0x3));
-
-  if (aligned) {
+  if ((uintptr_t(src) & 0x3) == (uintptr_t(dst) & 0x3)) {
     // Use dword-based aligned kernel.
-    kernel_code = &kernels_[KernelType::CopyAligned];
-
-    // Compute the size of each copy phase.
-    num_workitems = 64 * 4 * num_cus_;
-
-    // Phase 1 (byte copy) ends when destination is 0x100-aligned.
-    uintptr_t src_start = uintptr_t(src);
-    uintptr_t dst_start = uintptr_t(dst);
-    uint64_t phase1_size =
-        std::min(size, uint64_t(0x100 - (dst_start & 0xFF)) & 0xFF);
-
-    // Phase 2 (unrolled dwordx4 copy) ends when last whole block fits.
-    uint64_t phase2_block = num_workitems * sizeof(uint32_t) *
-                            kCopyAlignedUnroll * kCopyAlignedVecWidth;
-    uint64_t phase2_size = ((size - phase1_size) / phase2_block) * phase2_block;
-
-    // Phase 3 (dword copy) ends when last whole dword fits.
-    uint64_t phase3_size =
-        ((size - phase1_size - phase2_size) / sizeof(uint32_t)) *
-        sizeof(uint32_t);
-
-    args->copy_aligned.phase1_src_start = src_start;
-    args->copy_aligned.phase1_dst_start = dst_start;
-    args->copy_aligned.phase2_src_start = src_start + phase1_size;
-    args->copy_aligned.phase2_dst_start = dst_start + phase1_size;
-    args->copy_aligned.phase3_src_start = src_start + phase1_size + phase2_size;
-    args->copy_aligned.phase3_dst_start = dst_start + phase1_size + phase2_size;
-    args->copy_aligned.phase4_src_start =
-        src_start + phase1_size + phase2_size + phase3_size;
-    args->copy_aligned.phase4_dst_start =
-        dst_start + phase1_size + phase2_size + phase3_size;
-    args->copy_aligned.phase4_src_end = src_start + size;
-    args->copy_aligned.phase4_dst_end = dst_start + size;
-    args->copy_aligned.num_workitems = num_workitems;
+    dispatch = &templates_[int(KernelType::CopyAligned)];
+    dispatch->SetCopyAlignedArgs(uintptr_t(dst), uintptr_t(src), size, args);
   } else {
     // Use byte-based misaligned kernel.
-    kernel_code = &kernels_[KernelType::CopyMisaligned];
-
-    // Compute the size of each copy phase.
-    num_workitems = 64 * 4 * num_cus_;
-
-    // Phase 1 (unrolled byte copy) ends when last whole block fits.
-    uintptr_t src_start = uintptr_t(src);
-    uintptr_t dst_start = uintptr_t(dst);
-    uint64_t phase1_block =
-        num_workitems * sizeof(uint8_t) * kCopyMisalignedUnroll;
-    uint64_t phase1_size = (size / phase1_block) * phase1_block;
-
-    args->copy_misaligned.phase1_src_start = src_start;
-    args->copy_misaligned.phase1_dst_start = dst_start;
-    args->copy_misaligned.phase2_src_start = src_start + phase1_size;
-    args->copy_misaligned.phase2_dst_start = dst_start + phase1_size;
-    args->copy_misaligned.phase2_src_end = src_start + size;
-    args->copy_misaligned.phase2_dst_end = dst_start + size;
-    args->copy_misaligned.num_workitems = num_workitems;
+    dispatch = &templates_[int(KernelType::CopyMisaligned)];
+    dispatch->SetCopyMisalignedArgs(uintptr_t(dst), uintptr_t(src), size, args);
   }
 
   hsa_signal_t signal = {(core::Signal::Convert(&out_signal)).handle};
-  PopulateQueue(write_index, uintptr_t(kernel_code->code_buf_), args,
-                num_workitems, signal);
+  PopulateQueue(write_index, *dispatch, args, signal);
 
   // Submit barrier(s) and dispatch packets.
   ReleaseWriteIndex(write_index_temp, total_num_packet);
@@ -1156,36 +1103,19 @@ hsa_status_t BlitKernel::SubmitLinearFillCommand(void* ptr, uint32_t value,
     return HSA_STATUS_ERROR;
   }
 
-  // Compute the size of each fill phase.
-  int num_workitems = 64 * num_cus_;
-
-  // Phase 1 (unrolled dwordx4 copy) ends when last whole block fits.
-  uintptr_t dst_start = uintptr_t(ptr);
+  const BlitDispatchTemplate& dispatch = templates_[int(KernelType::Fill)];
   uint64_t fill_size = count * sizeof(uint32_t);
 
-  uint64_t phase1_block =
-      num_workitems * sizeof(uint32_t) * kFillUnroll * kFillVecWidth;
-  uint64_t phase1_size = (fill_size / phase1_block) * phase1_block;
-
-  KernelArgs* args = ObtainAsyncKernelCopyArg();
-  args->fill.phase1_dst_start = dst_start;
-  args->fill.phase2_dst_start = dst_start + phase1_size;
-  args->fill.phase2_dst_end = dst_start + fill_size;
-  args->fill.fill_value = value;
-  args->fill.num_workitems = num_workitems;
-
   // Submit dispatch packet.
   HSA::hsa_signal_store_relaxed(completion_signal_, 1);
 
-  uint64_t write_index;
-  {
-    std::lock_guard<std::mutex> lock(reservation_lock_);
-    write_index = AcquireWriteIndex(1);
-    RecordBlitHistory(fill_size, write_index);
-  }
+  uint64_t write_index = AcquireWriteIndex(1);
+  history_.Record(fill_size, write_index);
 
-  PopulateQueue(write_index, uintptr_t(kernels_[KernelType::Fill].code_buf_),
-                args, num_workitems, completion_signal_);
+  BlitKernelArgs* args = kernarg_slab_.At(write_index);
+  dispatch.SetFillArgs(uintptr_t(ptr), value, fill_size, args);
+
+  PopulateQueue(write_index, dispatch, args, completion_signal_);
 
   ReleaseWriteIndex(write_index, 1);
 
@@ -1223,31 +1153,19 @@ void BlitKernel::ReleaseWriteIndex(uint64_t write_index, uint32_t num_packet) {
   doorbell->StoreRelease(write_index + num_packet - 1);
 }
 
-void BlitKernel::PopulateQueue(uint64_t index, uint64_t code_handle, void* args,
-                               uint32_t grid_size_x,
-                               hsa_signal_t completion_signal) {
-  assert(IsMultipleOf(args, 16));
-
-  hsa_kernel_dispatch_packet_t packet = {0};
+void BlitKernel::InitDispatchTemplate(KernelType type, uint32_t num_workitems,
+                                      uint64_t block_size) {
+  templates_[int(type)].Init(uintptr_t(kernels_[type].code_buf_), num_workitems, block_size);
+}
 
+void BlitKernel::PopulateQueue(uint64_t index, const BlitDispatchTemplate& dispatch,
+                               BlitKernelArgs* args, hsa_signal_t completion_signal) {
   static const uint16_t kDispatchPacketHeader =
       (HSA_PACKET_TYPE_KERNEL_DISPATCH << HSA_PACKET_HEADER_TYPE) |
       (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_SCACQUIRE_FENCE_SCOPE) |
       (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_SCRELEASE_FENCE_SCOPE);
 
-  packet.header = kInvalidPacketHeader;
-  packet.kernel_object = code_handle;
-  packet.kernarg_address = args;
-
-  // Setup working size.
-  const int kNumDimension = 1;
-  packet.setup = kNumDimension << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS;
-  packet.grid_size_x = AlignUp(static_cast<uint32_t>(grid_size_x), 64);
-  packet.grid_size_y = packet.grid_size_z = 1;
-  packet.workgroup_size_x = 64;
-  packet.workgroup_size_y = packet.workgroup_size_z = 1;
-
-  packet.completion_signal = completion_signal;
+  hsa_kernel_dispatch_packet_t packet = dispatch.Build(args, completion_signal);
 
   // Populate queue buffer with AQL packet.
   hsa_kernel_dispatch_packet_t* queue_buffer =
@@ -1285,50 +1203,8 @@ void BlitKernel::PopulateQueue(uint64_t index, uint64_t code_handle, void* args,
     completion_signal, queue_->LoadReadIndexRelaxed(), index);
 }
 
-BlitKernel::KernelArgs* BlitKernel::ObtainAsyncKernelCopyArg() {
-  const uint32_t index =
-      atomic::Add(&kernarg_async_counter_, 1U, std::memory_order_acquire) & kernarg_async_mask_;
-
-  KernelArgs* arg = &kernarg_async_[index];
-  assert(IsMultipleOf(arg, 16));
-  return arg;
-}
-
-void BlitKernel::RecordBlitHistory(uint64_t size, uint64_t index) {
-  uint64_t queued = bytes_queued_;
-  bytes_queued_ += size;
-  bytes_written_[index & queue_bitmask_].bytes = queued;
-  bytes_written_[index & queue_bitmask_].index = index;
-  last_queued_ = index;
-}
-
 uint64_t BlitKernel::PendingBytes() {
-  uint64_t read = queue_->LoadReadIndexRelaxed();
-  uint64_t index = pending_search_index_.load();
-  uint64_t last = last_queued_;
-  // If the last blit command has been run then the blit is empty.
-  if (read > last) return 0;
-
-  index = Max(index, read);
-  while (index <= last) {
-    // Ensure any record we use was not wrapped.
-    if (index == bytes_written_[index & queue_bitmask_].index) {
-      uint64_t ret = bytes_queued_ - bytes_written_[index & queue_bitmask_].bytes;
-
-      // Store max search index.
-      uint64_t old = pending_search_index_.load();
-      while (old < index) {
-        if (pending_search_index_.compare_exchange_strong(old, index)) break;
-      }
-
-      return ret;
-    }
-    index++;
-  }
-  debug_warning(false && "Race between PendingBytes and blit submission detected.");
-  // Zero is a valid return in this case since the command which was last when the search started is
-  // now complete.
-  return 0;
+  return history_.PendingBytes(queue_->LoadReadIndexRelaxed());
 }
 
 }  // namespace amd
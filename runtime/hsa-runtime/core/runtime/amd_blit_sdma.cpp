@@ -50,6 +50,8 @@
 
 #include "core/inc/amd_gpu_agent.h"
 #include "core/inc/amd_memory_region.h"
+#include "core/inc/amd_rect_copy.h"
+#include "core/inc/amd_sdma_copy_batch.h"
 #include "core/inc/runtime.h"
 #include "core/inc/sdma_registers.h"
 #include "core/inc/signal.h"
@@ -74,6 +76,7 @@ const size_t BlitSdmaBase::kQueueSize = 1024 * 1024;
 const size_t BlitSdmaBase::kCopyPacketSize = sizeof(SDMA_PKT_COPY_LINEAR);
 const size_t BlitSdmaBase::kMaxSingleCopySize = SDMA_PKT_COPY_LINEAR::kMaxSize_;
 const size_t BlitSdmaBase::kMaxSingleFillSize = SDMA_PKT_CONSTANT_FILL::kMaxSize_;
+const size_t BlitSdmaBase::kMaxBatchCommandSize = BlitSdmaBase::kQueueSize / 8;
 
 // Initialize size of various sDMA commands use by this module
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
@@ -106,11 +109,11 @@ const uint32_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset,
 
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 const uint32_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset,
-                        useGCR>::trap_command_size_ = sizeof(SDMA_PKT_TRAP);
+                        useGCR>::gcr_command_size_ = sizeof(SDMA_PKT_GCR);
 
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 const uint32_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset,
-                        useGCR>::gcr_command_size_ = sizeof(SDMA_PKT_GCR);
+                        useGCR>::cache_command_size_ = useGCR ? 2 * sizeof(SDMA_PKT_GCR) : 0;
 
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::BlitSdma()
@@ -275,10 +278,11 @@ hsa_status_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset,
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 hsa_status_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::SubmitCommand(
     const void* cmd, size_t cmd_size, uint64_t size, const std::vector<core::Signal*>& dep_signals,
-    core::Signal& out_signal, std::vector<core::Signal*>& gang_signals) {
+    core::Signal& out_signal, std::vector<core::Signal*>& gang_signals, bool head, bool tail) {
 
   // The signal is 64 bit value, and poll checks for 32 bit value. So we
   // need to use two poll operations per dependent signal.
+  assert((head || dep_signals.empty()) && "Dependencies belong to the head segment");
   const uint32_t num_poll_command =
       static_cast<uint32_t>(2 * dep_signals.size());
   const uint32_t total_poll_command_size =
@@ -297,46 +301,38 @@ hsa_status_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>:
   // destruction.
   uint32_t total_gang_complete_command_size = poll_command_size_ +
          (platform_atomic_support_ ? atomic_command_size_ : fence_command_size_);
-  uint32_t total_gang_command_size = gang_leader_ ?
+  uint32_t total_gang_command_size = (tail && gang_leader_) ?
           static_cast<uint32_t>(gang_signals.size()) * total_gang_complete_command_size : 0;
 
-  if (profiling_enabled && (gang_leader_ || gang_signals.empty())) {
+  const bool timestamp_enabled = profiling_enabled && (gang_leader_ || gang_signals.empty());
+  if (timestamp_enabled) {
     out_signal.GetSdmaTsAddresses(start_ts_addr, end_ts_addr);
-    total_timestamp_command_size = 2 * timestamp_command_size_;
+    total_timestamp_command_size = (uint32_t(head) + uint32_t(tail)) * timestamp_command_size_;
   }
 
   // On agent that does not support platform atomic, we replace it with
-  // one or two fence packet(s) to update the signal value. The reason fence
-  // is used and not write packet is because the SDMA engine may overlap a
-  // serial copy/write packets.
-  const uint64_t completion_signal_value =
-      static_cast<uint64_t>(out_signal.LoadRelaxed() - 1);
-  const size_t sync_command_size = (platform_atomic_support_)
-                                       ? atomic_command_size_
-                                       : (completion_signal_value > UINT32_MAX)
-                                             ? 2 * fence_command_size_
-                                             : fence_command_size_;
-
-  // If the signal is an interrupt signal, we also need to make SDMA engine to
-  // send interrupt packet to IH.
-  const size_t interrupt_command_size =
-      (out_signal.signal_.event_mailbox_ptr != 0)
-          ? (fence_command_size_ + trap_command_size_)
-          : 0;
+  // one or two fence packet(s) to update the signal value. If the signal is an
+  // interrupt signal, we also need to make SDMA engine to send interrupt packet
+  // to IH.
+  SdmaCompletion completion;
+  completion.value_location = out_signal.ValueLocation();
+  completion.value = static_cast<uint64_t>(out_signal.LoadRelaxed() - 1);
+  completion.mailbox = reinterpret_cast<uint32_t*>(out_signal.signal_.event_mailbox_ptr);
+  completion.event_id = static_cast<uint32_t>(out_signal.signal_.event_id);
+  const size_t completion_command_size =
+      tail ? SdmaCompletionSize(completion, platform_atomic_support_) : 0;
 
   // Add space for acquire or release Hdp flush command
-  uint32_t flush_cmd_size = 0;
-  if (core::Runtime::runtime_singleton_->flag().enable_sdma_hdp_flush()) {
-    if ((HwIndexMonotonic) && (hdp_flush_support_)) {
-      flush_cmd_size = flush_command_size_;
-    }
-  }
+  const bool hdp_flush = kHdpFlushCapable && hdp_flush_support_ &&
+      core::Runtime::runtime_singleton_->flag().enable_sdma_hdp_flush();
+  uint32_t flush_cmd_size = hdp_flush ? flush_command_size_ : 0;
 
   // Add space for cache flush.
-  if (useGCR) flush_cmd_size += gcr_command_size_ * 2;
+  flush_cmd_size += cache_command_size_;
 
-  const uint32_t total_command_size = total_poll_command_size + cmd_size + sync_command_size +
-      total_timestamp_command_size + interrupt_command_size + flush_cmd_size + total_gang_command_size;
+  const uint32_t total_command_size = total_poll_command_size + cmd_size +
+      completion_command_size + total_timestamp_command_size + flush_cmd_size +
+      total_gang_command_size;
   const uint32_t pad_size = total_command_size < min_submission_size_ ?
                             min_submission_size_ - total_command_size : 0;
 
@@ -370,7 +366,7 @@ hsa_status_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>:
     wrapped_index += poll_command_size_;
   }
 
-  if (profiling_enabled && (gang_leader_ || gang_signals.empty())) {
+  if (timestamp_enabled && head) {
     BuildGetGlobalTimestampCommand(command_addr, reinterpret_cast<void*>(start_ts_addr));
     command_addr += timestamp_command_size_;
     bytes_written_[wrapped_index] = prior_bytes;
@@ -378,13 +374,11 @@ hsa_status_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>:
   }
 
   // Issue a Hdp flush cmd
-  if (core::Runtime::runtime_singleton_->flag().enable_sdma_hdp_flush()) {
-    if ((HwIndexMonotonic) && (hdp_flush_support_)) {
-      BuildHdpFlushCommand(command_addr);
-      command_addr += flush_command_size_;
-      bytes_written_[wrapped_index] = prior_bytes;
-      wrapped_index += flush_command_size_;
-    }
+  if (hdp_flush) {
+    BuildHdpFlushCommand(command_addr);
+    command_addr += flush_command_size_;
+    bytes_written_[wrapped_index] = prior_bytes;
+    wrapped_index += flush_command_size_;
   }
 
   // Issue cache invalidate
@@ -409,76 +403,48 @@ hsa_status_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>:
     wrapped_index += gcr_command_size_;
   }
 
-  if (profiling_enabled && (gang_leader_ || gang_signals.empty())) {
-    assert(IsMultipleOf(end_ts_addr, 32));
-    BuildGetGlobalTimestampCommand(command_addr,
-                                   reinterpret_cast<void*>(end_ts_addr));
-    command_addr += timestamp_command_size_;
-    bytes_written_[wrapped_index] = post_bytes;
-    wrapped_index += timestamp_command_size_;
-  }
-
-  // Wait for non-leaders gang items to complete
-  if (gang_leader_) {
-    for (int i = 0; i < gang_signals.size(); i++) {
-      uint32_t* gang_signal_addr =
-          reinterpret_cast<uint32_t*>(gang_signals[i]->ValueLocation());
-      BuildPollCommand(command_addr, gang_signal_addr, 1);
-      command_addr += poll_command_size_;
-      bytes_written_[wrapped_index] = prior_bytes;
-      wrapped_index += poll_command_size_;
-
-      // After non-leader gang-items have completed, decrement the gang signal value.
-      if (platform_atomic_support_) {
-        BuildAtomicDecrementCommand(command_addr, gang_signal_addr);
-        command_addr += atomic_command_size_;
-        bytes_written_[wrapped_index] = post_bytes;
-        wrapped_index += atomic_command_size_;
-      } else {
-        BuildFenceCommand(command_addr, gang_signal_addr, 0);
-        command_addr += fence_command_size_;
-        bytes_written_[wrapped_index] = post_bytes;
-        wrapped_index += fence_command_size_;
-      }
-    }
-  }
-
-  // After transfer is completed, decrement the signal value.
-  if (platform_atomic_support_) {
-    BuildAtomicDecrementCommand(command_addr, out_signal.ValueLocation());
-    command_addr += atomic_command_size_;
-    bytes_written_[wrapped_index] = post_bytes;
-    wrapped_index += atomic_command_size_;
-  } else {
-    uint32_t* signal_value_location = reinterpret_cast<uint32_t*>(out_signal.ValueLocation());
-    if (completion_signal_value > UINT32_MAX) {
-      BuildFenceCommand(command_addr, signal_value_location + 1,
-                        static_cast<uint32_t>(completion_signal_value >> 32));
-      command_addr += fence_command_size_;
+  // Only the tail segment carries the end timestamp and completion packets.
+  if (tail) {
+    if (timestamp_enabled) {
+      assert(IsMultipleOf(end_ts_addr, 32));
+      BuildGetGlobalTimestampCommand(command_addr,
+                                     reinterpret_cast<void*>(end_ts_addr));
+      command_addr += timestamp_command_size_;
       bytes_written_[wrapped_index] = post_bytes;
-      wrapped_index += fence_command_size_;
+      wrapped_index += timestamp_command_size_;
     }
 
-    BuildFenceCommand(command_addr, signal_value_location,
-                      static_cast<uint32_t>(completion_signal_value));
-    command_addr += fence_command_size_;
-    bytes_written_[wrapped_index] = post_bytes;
-    wrapped_index += fence_command_size_;
-  }
-
-  // Update mailbox event and send interrupt to IH.
-  if (out_signal.signal_.event_mailbox_ptr != 0) {
-    BuildFenceCommand(command_addr,
-                      reinterpret_cast<uint32_t*>(out_signal.signal_.event_mailbox_ptr),
-                      static_cast<uint32_t>(out_signal.signal_.event_id));
-    command_addr += fence_command_size_;
-    bytes_written_[wrapped_index] = post_bytes;
-    wrapped_index += fence_command_size_;
+    // Wait for non-leaders gang items to complete
+    if (gang_leader_) {
+      for (int i = 0; i < gang_signals.size(); i++) {
+        uint32_t* gang_signal_addr =
+            reinterpret_cast<uint32_t*>(gang_signals[i]->ValueLocation());
+        BuildPollCommand(command_addr, gang_signal_addr, 1);
+        command_addr += poll_command_size_;
+        bytes_written_[wrapped_index] = prior_bytes;
+        wrapped_index += poll_command_size_;
+
+        // After non-leader gang-items have completed, decrement the gang signal value.
+        if (platform_atomic_support_) {
+          BuildAtomicDecrementCommand(command_addr, gang_signal_addr);
+          command_addr += atomic_command_size_;
+          bytes_written_[wrapped_index] = post_bytes;
+          wrapped_index += atomic_command_size_;
+        } else {
+          BuildFenceCommand(command_addr, gang_signal_addr, 0);
+          command_addr += fence_command_size_;
+          bytes_written_[wrapped_index] = post_bytes;
+          wrapped_index += fence_command_size_;
+        }
+      }
+    }
 
-    BuildTrapCommand(command_addr, out_signal.signal_.event_id);
-    command_addr += trap_command_size_;
-    bytes_written_[wrapped_index] = post_bytes;
-    wrapped_index += trap_command_size_;
+    // After transfer is completed, decrement the signal value.
+    const uint32_t size = BuildSdmaCompletion(command_addr, completion, platform_atomic_support_,
+                                              agent_->isa()->GetMajorVersion() >= 10);
+    command_addr += size;
+    bytes_written_.fill(wrapped_index, wrapped_index + size, post_bytes);
+    wrapped_index += size;
   }
 
   // Pad size is DWORD aligned since all commands are dword aligned.
@@ -530,74 +496,79 @@ hsa_status_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset,
                        out_signal, gang_signals);
 }
 
+template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
+hsa_status_t BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::
+    SubmitLinearCopyCommands(const core::LinearCopyDesc* copies, size_t count,
+                             std::vector<core::Signal*>& dep_signals, core::Signal& out_signal) {
+  if (count == 0) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+
+  const SdmaLinearCopyFormat format = {
+      max_single_linear_copy_size_ ? max_single_linear_copy_size_ : kMaxSingleCopySize,
+      SizeToCountOffset};
+  const uint32_t max_segment_commands =
+      static_cast<uint32_t>(kMaxBatchCommandSize / linear_copy_command_size_);
+
+  std::vector<SDMA_PKT_COPY_LINEAR> buff;
+  std::vector<SdmaCopySegment> segments;
+  PlanSdmaCopyBatch(copies, count, format, max_segment_commands, buff, segments);
+
+  // Only the last segment carries completion packets. The ring executes segments in order so
+  // its completion covers every copy.
+  std::vector<core::Signal*> no_signals(0);
+  std::vector<core::Signal*> gang_signals(0);
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const bool head = (i == 0);
+    const bool tail = (i + 1 == segments.size());
+    hsa_status_t stat =
+        SubmitCommand(buff.data() + segments[i].first_packet,
+                      segments[i].num_packets * linear_copy_command_size_, segments[i].bytes,
+                      head ? dep_signals : no_signals, out_signal, gang_signals, head, tail);
+    if (stat != HSA_STATUS_SUCCESS) return stat;
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 hsa_status_t
 BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::SubmitCopyRectCommand(
     const hsa_pitched_ptr_t* dst, const hsa_dim3_t* dst_offset, const hsa_pitched_ptr_t* src,
     const hsa_dim3_t* src_offset, const hsa_dim3_t* range, std::vector<core::Signal*>& dep_signals,
     core::Signal& out_signal) {
-  // Hardware requires DWORD alignment for base address, pitches
-  // Also confirm that we have a geometric rect (copied block does not wrap an edge).
-  if (((uintptr_t)dst->base) % 4 != 0 || ((uintptr_t)src->base) % 4 != 0)
-    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT,
-                             "Copy rect base address not aligned.");
-  if (((uintptr_t)dst->pitch) % 4 != 0 || ((uintptr_t)src->pitch) % 4 != 0)
-    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect pitch not aligned.");
-  if (((uintptr_t)dst->slice) % 4 != 0 || ((uintptr_t)src->slice) % 4 != 0)
-    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect slice not aligned.");
-  if (uint64_t(src_offset->x) + range->x > src->pitch ||
-      uint64_t(dst_offset->x) + range->x > dst->pitch)
-    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect width out of range.");
-  if ((src->slice != 0) && (uint64_t(src_offset->y) + range->y) > src->slice / src->pitch)
-    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect height out of range.");
-  if ((dst->slice != 0) && (uint64_t(dst_offset->y) + range->y) > dst->slice / dst->pitch)
-    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect height out of range.");
-  if (range->z > 1 && (src->slice == 0 || dst->slice == 0))
-    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect slice needed.");
+  ValidateRectCopy(*dst, *dst_offset, *src, *src_offset, *range, true);
 
   // GFX12 or later use a different packet format that is incompatible (fields changed in size and location).
   const bool isGFX12Plus = (agent_->isa()->GetMajorVersion() >= 12);
 
   // Common and GFX12 packet must match in size to use same code for vector/append.
-  static_assert(sizeof(SDMA_PKT_COPY_LINEAR_RECT) == sizeof(SDMA_PKT_COPY_LINEAR_RECT_GFX12));
+  static_assert(sizeof(SDMA_PKT_COPY_LINEAR_RECT) == sizeof(SDMA_PKT_COPY_LINEAR_RECT_GFX12),
+                "SDMA rect packet size mismatch");
+
+  RectCopyLimits limits;
+  limits.max_pitch = 1ull << (isGFX12Plus ? SDMA_PKT_COPY_LINEAR_RECT_GFX12::pitch_bits
+                                          : SDMA_PKT_COPY_LINEAR_RECT::pitch_bits);
+  limits.max_slice = 1ull << (isGFX12Plus ? SDMA_PKT_COPY_LINEAR_RECT_GFX12::slice_bits
+                                          : SDMA_PKT_COPY_LINEAR_RECT::slice_bits);
 
-  const uint max_pitch = 1 << (isGFX12Plus ? SDMA_PKT_COPY_LINEAR_RECT_GFX12::pitch_bits : SDMA_PKT_COPY_LINEAR_RECT::pitch_bits);
+  std::vector<core::LinearCopyDesc> spans;
+  std::vector<RectCopyDesc> rects;
+  PlanRectCopy(*dst, *dst_offset, *src, *src_offset, *range, limits, spans, rects);
+
+  // Contiguous rows and slices, or rects the packet cannot encode, go out as linear copies.
+  if (!spans.empty())
+    return SubmitLinearCopyCommands(&spans[0], spans.size(), dep_signals, out_signal);
 
   std::vector<SDMA_PKT_COPY_LINEAR_RECT> pkts;
-  std::vector<uint64_t> bytes_moved;
   auto append = [&](size_t size) {
     assert(size == sizeof(SDMA_PKT_COPY_LINEAR_RECT) && "SDMA packet size missmatch");
     pkts.emplace_back(SDMA_PKT_COPY_LINEAR_RECT());
     return &pkts.back();
   };
 
-  // Do wide pitch 2D copies along X-Z
-  if (range->z == 1 && (src->pitch > max_pitch || dst->pitch > max_pitch)) {
-    hsa_pitched_ptr_t Src = *src;
-    hsa_pitched_ptr_t Dst = *dst;
-    hsa_dim3_t Soff = *src_offset;
-    hsa_dim3_t Doff = *dst_offset;
-    hsa_dim3_t Range = *range;
-
-    Src.base = static_cast<char*>(Src.base) + Soff.z * Src.slice + Soff.y * Src.pitch;
-    Dst.base = static_cast<char*>(Dst.base) + Doff.z * Dst.slice + Doff.y * Dst.pitch;
-    Soff.y = Soff.z = 0;
-    Doff.y = Doff.z = 0;
+  for (const RectCopyDesc& rect : rects)
+    BuildCopyRectCommand(append, &rect.dst, &rect.dst_offset, &rect.src, &rect.src_offset,
+                         &rect.range);
 
-    Src.slice = Src.pitch;
-    Src.pitch = 0;
-    Dst.slice = Dst.pitch;
-    Dst.pitch = 0;
-
-    Range.z = Range.y;
-    Range.y = 1;
-
-    BuildCopyRectCommand(append, &Dst, &Doff, &Src, &Soff, &Range);
-  } else {
-    BuildCopyRectCommand(append, dst, dst_offset, src, src_offset, range);
-  }
-
-  uint64_t size = range->x * range->y * range->z;
+  uint64_t size = uint64_t(range->x) * range->y * range->z;
 
   std::vector<core::Signal*> gang_signals(0);
 
@@ -769,62 +740,17 @@ bool BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::CanWrit
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 void BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::BuildFenceCommand(
     char* fence_command_addr, uint32_t* fence, uint32_t fence_value) {
-  assert(fence_command_addr != NULL);
-  SDMA_PKT_FENCE* packet_addr =
-      reinterpret_cast<SDMA_PKT_FENCE*>(fence_command_addr);
-
-  memset(packet_addr, 0, sizeof(SDMA_PKT_FENCE));
-
-  packet_addr->HEADER_UNION.op = SDMA_OP_FENCE;
-
-  if (agent_->isa()->GetMajorVersion() >= 10) {
-    packet_addr->HEADER_UNION.mtype = 3;
-  }
-
-  packet_addr->ADDR_LO_UNION.addr_31_0 = ptrlow32(fence);
-
-  packet_addr->ADDR_HI_UNION.addr_63_32 = ptrhigh32(fence);
-
-  packet_addr->DATA_UNION.data = fence_value;
+  BuildSdmaFence(fence_command_addr, fence, fence_value, agent_->isa()->GetMajorVersion() >= 10);
 }
 
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 void BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::BuildCopyCommand(
     char* cmd_addr, uint32_t num_copy_command, void* dst, const void* src, size_t size) {
-  size_t cur_size = 0;
-  const size_t max_copy_size = max_single_linear_copy_size_ ? max_single_linear_copy_size_ :
-                                                              kMaxSingleCopySize;
-  for (uint32_t i = 0; i < num_copy_command; ++i) {
-    const uint32_t copy_size =
-        static_cast<uint32_t>(std::min((size - cur_size), max_copy_size));
-
-    void* cur_dst = static_cast<char*>(dst) + cur_size;
-    const void* cur_src = static_cast<const char*>(src) + cur_size;
-
-    SDMA_PKT_COPY_LINEAR* packet_addr =
-        reinterpret_cast<SDMA_PKT_COPY_LINEAR*>(cmd_addr);
-
-    memset(packet_addr, 0, sizeof(SDMA_PKT_COPY_LINEAR));
-
-    packet_addr->HEADER_UNION.op = SDMA_OP_COPY;
-    packet_addr->HEADER_UNION.sub_op = SDMA_SUBOP_COPY_LINEAR;
-
-    if (max_copy_size == (1 << 30) -1)
-      packet_addr->COUNT_UNION.count_ext.count = copy_size + SizeToCountOffset;
-    else
-      packet_addr->COUNT_UNION.count.count = copy_size + SizeToCountOffset;
-
-    packet_addr->SRC_ADDR_LO_UNION.src_addr_31_0 = ptrlow32(cur_src);
-    packet_addr->SRC_ADDR_HI_UNION.src_addr_63_32 = ptrhigh32(cur_src);
-
-    packet_addr->DST_ADDR_LO_UNION.dst_addr_31_0 = ptrlow32(cur_dst);
-    packet_addr->DST_ADDR_HI_UNION.dst_addr_63_32 = ptrhigh32(cur_dst);
-
-    cmd_addr += linear_copy_command_size_;
-    cur_size += copy_size;
-  }
-
-  assert(cur_size == size);
+  const SdmaLinearCopyFormat format = {
+      max_single_linear_copy_size_ ? max_single_linear_copy_size_ : kMaxSingleCopySize,
+      SizeToCountOffset};
+  BuildSdmaLinearCopy(reinterpret_cast<SDMA_PKT_COPY_LINEAR*>(cmd_addr), num_copy_command, dst,
+                      src, size, format);
 }
 
 /*
@@ -1035,18 +961,7 @@ void BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::BuildPo
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 void BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset,
               useGCR>::BuildAtomicDecrementCommand(char* cmd_addr, void* addr) {
-  SDMA_PKT_ATOMIC* packet_addr = reinterpret_cast<SDMA_PKT_ATOMIC*>(cmd_addr);
-
-  memset(packet_addr, 0, sizeof(SDMA_PKT_ATOMIC));
-
-  packet_addr->HEADER_UNION.op = SDMA_OP_ATOMIC;
-  packet_addr->HEADER_UNION.operation = SDMA_ATOMIC_ADD64;
-
-  packet_addr->ADDR_LO_UNION.addr_31_0 = ptrlow32(addr);
-  packet_addr->ADDR_HI_UNION.addr_63_32 = ptrhigh32(addr);
-
-  packet_addr->SRC_DATA_LO_UNION.src_data_31_0 = 0xffffffff;
-  packet_addr->SRC_DATA_HI_UNION.src_data_63_32 = 0xffffffff;
+  BuildSdmaAtomicDecrement(cmd_addr, addr);
 }
 
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
@@ -1064,18 +979,6 @@ void BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset,
   packet_addr->ADDR_HI_UNION.addr_63_32 = ptrhigh32(write_address);
 }
 
-template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
-void BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::BuildTrapCommand(
-    char* cmd_addr, uint32_t event_id) {
-  SDMA_PKT_TRAP* packet_addr =
-      reinterpret_cast<SDMA_PKT_TRAP*>(cmd_addr);
-
-  memset(packet_addr, 0, sizeof(SDMA_PKT_TRAP));
-
-  packet_addr->HEADER_UNION.op = SDMA_OP_TRAP;
-  packet_addr->INT_CONTEXT_UNION.int_ctx = event_id;
-}
-
 template <typename RingIndexTy, bool HwIndexMonotonic, int SizeToCountOffset, bool useGCR>
 void BlitSdma<RingIndexTy, HwIndexMonotonic, SizeToCountOffset, useGCR>::BuildHdpFlushCommand(
     char* cmd_addr) {
@@ -59,6 +59,7 @@
 #include "core/inc/amd_blit_sdma.h"
 #include "core/inc/amd_gpu_pm4.h"
 #include "core/inc/amd_memory_region.h"
+#include "core/inc/amd_rect_copy.h"
 #include "core/inc/default_signal.h"
 #include "core/inc/interrupt_signal.h"
 #include "core/inc/isa.h"
@@ -117,6 +118,9 @@ GpuAgent::GpuAgent(HSAuint32 node, const HsaNodeProperties& node_props, bool xna
       scratch_limit_async_threshold_(0),
       scratch_cache_(
           [this](void* base, size_t size, bool large) { ReleaseScratch(base, size, large); }),
+      scratch_steal_stats_(),
+      ring_pool_bytes_(0),
+      ring_pool_stats_(),
       trap_handler_tma_region_(NULL),
       pcs_hosttrap_data_(),
       xgmi_cpu_gpu_(false) {
@@ -249,6 +253,29 @@ GpuAgent::~GpuAgent() {
     _aligned_free(reinterpret_cast<void*>(ape1_base_));
   }
 
+  if (scratch_steal_stats_.attempts != 0 &&
+      core::Runtime::runtime_singleton_->flag().enable_queue_fault_message())
+    debug_print("Node %u scratch steals: %lu attempted, %lu succeeded, %lu timed out.\n",
+                node_id(), scratch_steal_stats_.attempts, scratch_steal_stats_.successes,
+                scratch_steal_stats_.timeouts);
+
+  if (core::Runtime::runtime_singleton_->flag().enable_queue_fault_message()) {
+    const ScratchCache::Stats& stats = scratch_cache_.stats();
+    const uint64_t requests = stats.hits + stats.misses;
+    if (requests != 0)
+      debug_print("Node %u scratch cache: %lu/%lu hits (%lu queue affinity), %lu blocks (%zu "
+                  "bytes) trimmed, %zu bytes retained.\n",
+                  node_id(), stats.hits, requests, stats.affinity_hits, stats.trims,
+                  stats.trimmed_bytes, scratch_cache_.retained_bytes());
+  }
+
+  if (core::Runtime::runtime_singleton_->flag().enable_queue_fault_message() &&
+      (ring_pool_stats_.hits + ring_pool_stats_.misses != 0))
+    debug_print("Node %u queue ring pool: %lu/%lu hits, %lu rings trimmed.\n", node_id(),
+                ring_pool_stats_.hits, ring_pool_stats_.hits + ring_pool_stats_.misses,
+                ring_pool_stats_.trimmed);
+  TrimRingBuffers();
+
   scratch_cache_.trim(true);
   scratch_cache_.free_reserve();
 
@@ -495,6 +522,8 @@ void GpuAgent::InitRegionList() {
           regions_.push_back(region);
 
           if (region->IsLocalMemory()) {
+            const size_t first_local = regions_.size() - 1;
+
             // Extended Fine-Grain memory
             if (!(isa_->GetMajorVersion() == 12 && isa_->GetMinorVersion() == 0))
               regions_.push_back(
@@ -506,6 +535,17 @@ void GpuAgent::InitRegionList() {
 
             regions_.push_back(new MemoryRegion(true, false, false, false, user_visible, this,
                                                 mem_props[mem_idx]));
+
+            // Apply fragment allocator tuning to the VRAM pools of this bank.
+            const auto& flag = core::Runtime::runtime_singleton_->flag();
+            for (size_t i = first_local; i < regions_.size(); i++) {
+              MemoryRegion* local =
+                  const_cast<MemoryRegion*>(static_cast<const MemoryRegion*>(regions_[i]));
+              if (!local->ConfigureFragmentAllocator(flag.fragment_block_size(enum_index_),
+                                                     flag.fragment_slab_limit(enum_index_)))
+                debug_print("Invalid fragment allocator tuning for GPU %u, using defaults.\n",
+                            enum_index_);
+            }
           }
           break;
         }
@@ -927,13 +967,24 @@ void GpuAgent::PreloadBlits() {
 hsa_status_t GpuAgent::PostToolsInit() {
   // Defer memory allocation until agents have been discovered.
   InitAllocators();
-  InitScratchPool();
-  BindTrapHandler();
+  // Only installs the lazy constructors, internal queues and blits are created on first use.
   InitDma();
 
+  // Scratch and the trap handler are only needed once the agent gets a queue. Debuggers expect
+  // the trap handler to be bound as soon as the runtime is enabled.
+  const Flag& flag = core::Runtime::runtime_singleton_->flag();
+  if (!flag.lazy_agent_init() || flag.debug()) BringUp();
+
   return HSA_STATUS_SUCCESS;
 }
 
+void GpuAgent::BringUp() {
+  bring_up_.Run([this]() {
+    InitScratchPool();
+    BindTrapHandler();
+  });
+}
+
 hsa_status_t GpuAgent::DmaCopy(void* dst, const void* src, size_t size) {
   return blits_[BlitDevToDev]->SubmitLinearCopyCommand(dst, src, size);
 }
@@ -1161,6 +1212,34 @@ hsa_status_t GpuAgent::DmaCopyOnEngine(void* dst, core::Agent& dst_agent,
   return stat;
 }
 
+hsa_status_t GpuAgent::DmaCopyBatch(const core::LinearCopyDesc* copies, size_t count,
+                                    core::Agent& dst_agent, core::Agent& src_agent,
+                                    std::vector<core::Signal*>& dep_signals,
+                                    core::Signal& out_signal) {
+  assert(((src_agent.device_type() == core::Agent::kAmdGpuDevice) ||
+          (dst_agent.device_type() == core::Agent::kAmdGpuDevice)) &&
+         ("Both devices are CPU agents which is not expected"));
+
+  if (count == 0) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) size += copies[i].size;
+
+  SetCopyRequestRefCount(true);
+  MAKE_SCOPE_GUARD([&]() { SetCopyRequestRefCount(false); });
+
+  // Batches target many small copies so they are never ganged.
+  lazy_ptr<core::Blit>& blit = GetBlitObject(dst_agent, src_agent, size);
+
+  if (profiling_enabled()) {
+    // Track the agent so we could translate the resulting timestamp to system
+    // domain correctly.
+    out_signal.async_copy_agent(core::Agent::Convert(this->public_handle()));
+  }
+
+  return blit->SubmitLinearCopyCommands(copies, count, dep_signals, out_signal);
+}
+
 bool GpuAgent::DmaEngineIsFree(uint32_t engine_offset) {
   SetCopyStatusCheckRefCount(true);
   MAKE_SCOPE_GUARD([&]() { SetCopyStatusCheckRefCount(false); });
@@ -1229,16 +1308,27 @@ hsa_status_t GpuAgent::DmaCopyRect(const hsa_pitched_ptr_t* dst, const hsa_dim3_
   lazy_ptr<core::Blit>& blit = GetBlitObject((dir == hsaHostToDevice) ? BlitHostToDev :
                                                                         BlitDevToHost);
 
-  if (!blit->isSDMA()) {
-    return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
-  }
-
   if (profiling_enabled()) {
     // Track the agent so we could translate the resulting timestamp to system
     // domain correctly.
     out_signal.async_copy_agent(core::Agent::Convert(this->public_handle()));
   }
 
+  if (!blit->isSDMA()) {
+    // Blit kernels have no rect support, lower the copy to linear spans.
+    ValidateRectCopy(*dst, *dst_offset, *src, *src_offset, *range, false);
+    const RectCopyLimits no_rect = {0, 0};
+    std::vector<core::LinearCopyDesc> spans;
+    std::vector<RectCopyDesc> rects;
+    PlanRectCopy(*dst, *dst_offset, *src, *src_offset, *range, no_rect, spans, rects);
+    assert(rects.empty() && "Rect copy planned for an engine without rect support.");
+    if (spans.empty()) {
+      out_signal.SubRelaxed(1);
+      return HSA_STATUS_SUCCESS;
+    }
+    return blit->SubmitLinearCopyCommands(&spans[0], spans.size(), dep_signals, out_signal);
+  }
+
   BlitSdmaBase* sdmaBlit = static_cast<BlitSdmaBase*>((*blit).get());
   hsa_status_t stat = sdmaBlit->SubmitCopyRectCommand(dst, dst_offset, src, src_offset, range,
                                                       dep_signals, out_signal);
@@ -1624,6 +1714,8 @@ hsa_status_t GpuAgent::QueueCreate(size_t size, hsa_queue_type32_t queue_type,
                                    void* data, uint32_t private_segment_size,
                                    uint32_t group_segment_size,
                                    core::Queue** queue) {
+  BringUp();
+
   // Handle GWS queues.
   if (queue_type == HSA_QUEUE_TYPE_COOPERATIVE) {
     ScopedAcquire<KernelMutex> lock(&gws_queue_.lock_);
@@ -1696,7 +1788,11 @@ hsa_status_t GpuAgent::QueueCreate(size_t size, hsa_queue_type32_t queue_type,
   auto aql_queue =
       new AqlQueue(this, size, node_id(), scratch, event_callback, data, is_kv_device_);
   *queue = aql_queue;
-  aql_queues_.push_back(aql_queue);
+  {
+    ScopedAcquire<KernelMutex> queues_lock(&aql_queues_lock_);
+    ScopedAcquire<KernelMutex> lock(&scratch_lock_);
+    aql_queues_.push_back(aql_queue);
+  }
 
   if (doorbell_queue_map_) {
     // Calculate index of the queue doorbell within the doorbell aperture.
@@ -1777,7 +1873,7 @@ void GpuAgent::AcquireQueueMainScratch(ScratchInfo& scratch) {
     attempt a new allocation
     trim unused blocks from cache
     attempt a new allocation
-    check cache for sufficient used block, steal and wait (not implemented)
+    check cache for sufficient used block, steal and wait
     trim used blocks from cache, evaluate retry
     reduce occupancy
   */
@@ -1828,6 +1924,9 @@ void GpuAgent::AcquireQueueMainScratch(ScratchInfo& scratch) {
       }
     }
 
+    // Take a block bound to an idle queue.
+    if (use_reclaim && StealQueueMainScratch(scratch)) return;
+
     // Retry if large may yield needed space.
     if (scratch_used_large_ != 0) {
       if (AddScratchNotifier(scratch.queue_retry, 0x8000000000000000ull)) scratch.retry = true;
@@ -1899,6 +1998,62 @@ void GpuAgent::ReleaseQueueMainScratch(ScratchInfo& scratch) {
   scratch.main_queue_base = nullptr;
 }
 
+bool GpuAgent::StealQueueMainScratch(ScratchInfo& scratch) {
+  const uint64_t timeout_us = core::Runtime::runtime_singleton_->flag().scratch_steal_wait_us();
+  if (timeout_us == 0) return false;
+
+  // Pick the smallest sufficient block.
+  AqlQueue* victim = nullptr;
+  size_t victim_size = 0;
+  for (auto iter : aql_queues_) {
+    auto aqlQueue = static_cast<AqlQueue*>(iter);
+    size_t size;
+    if (!aqlQueue->MainScratchStealable() ||
+        !scratch_cache_.canStealMain(aqlQueue->queue_scratch(), scratch, size))
+      continue;
+    if ((victim == nullptr) || (size < victim_size)) {
+      victim = aqlQueue;
+      victim_size = size;
+    }
+  }
+  if (victim == nullptr) return false;
+
+  // The victim's lock keeps its own scratch handlers and async reclaim away from the block until
+  // the steal resolves. Never block on it here, scratch_lock_ is ordered after it. A busy victim
+  // is changing its binding anyway.
+  KernelMutex& victim_lock = victim->main_scratch_lock();
+  if (!victim_lock.Try()) return false;
+  MAKE_SCOPE_GUARD([&]() { victim_lock.Release(); });
+
+  scratch_steal_stats_.attempts++;
+
+  // STEAL keeps the node from being handed out or stolen again while scratch_lock_ is dropped for
+  // the wait. The victim's destructor waits for its lock after leaving aql_queues_.
+  ScratchInfo owner = victim->queue_scratch();
+  scratch_cache_.stealMain(owner);
+  scratch_lock_.Release();
+  bool idle = victim->WaitMainScratchIdle(timeout_us);
+  scratch_lock_.Acquire();
+
+  if (!idle) {
+    scratch_cache_.cancelStealMain(owner);
+    scratch_steal_stats_.timeouts++;
+    if (core::Runtime::runtime_singleton_->flag().enable_queue_fault_message())
+      debug_print("Scratch steal of %zu bytes timed out after %lu us.\n", victim_size,
+                  timeout_us);
+    return false;
+  }
+
+  victim->SurrenderMainScratch(owner);
+  scratch_cache_.transferMain(owner, scratch);
+  scratch_steal_stats_.successes++;
+  if (core::Runtime::runtime_singleton_->flag().enable_queue_fault_message())
+    debug_print("Stole %zu bytes of scratch from queue %p (%lu/%lu steals succeeded).\n",
+                victim_size, victim, scratch_steal_stats_.successes,
+                scratch_steal_stats_.attempts);
+  return true;
+}
+
 void GpuAgent::AcquireQueueAltScratch(ScratchInfo& scratch) {
   assert(scratch.async_reclaim && "Acquire Alt Scratch when FW does not support it");
   assert(scratch.alt_queue_base == nullptr &&
@@ -1991,8 +2146,53 @@ void GpuAgent::ReleaseScratch(void* base, size_t size, bool large) {
   ClearScratchNotifiers();
 }
 
+void GpuAgent::RemoveAqlQueue(core::Queue* queue) {
+  ScopedAcquire<KernelMutex> queues_lock(&aql_queues_lock_);
+  ScopedAcquire<KernelMutex> lock(&scratch_lock_);
+  auto it = std::find(aql_queues_.begin(), aql_queues_.end(), queue);
+  if (it != aql_queues_.end()) aql_queues_.erase(it);
+}
+
+void* GpuAgent::AcquireRingBuffer(uint32_t alloc_bytes, uint32_t placement) {
+  ScopedAcquire<KernelMutex> lock(&ring_pool_lock_);
+  auto it = ring_pool_.find(std::make_pair(alloc_bytes, placement));
+  if (it == ring_pool_.end()) {
+    ring_pool_stats_.misses++;
+    return nullptr;
+  }
+  void* ring = it->second;
+  ring_pool_.erase(it);
+  ring_pool_bytes_ -= alloc_bytes;
+  ring_pool_stats_.hits++;
+  return ring;
+}
+
+bool GpuAgent::RecycleRingBuffer(void* ring, uint32_t alloc_bytes, uint32_t placement) {
+  ScopedAcquire<KernelMutex> lock(&ring_pool_lock_);
+  const size_t limit = core::Runtime::runtime_singleton_->flag().queue_ring_pool_size();
+  if (ring_pool_bytes_ + alloc_bytes > limit) return false;
+  ring_pool_.insert(std::make_pair(std::make_pair(alloc_bytes, placement), ring));
+  ring_pool_bytes_ += alloc_bytes;
+  return true;
+}
+
+void GpuAgent::TrimRingBuffers() {
+  std::multimap<std::pair<uint32_t, uint32_t>, void*> rings;
+  {
+    ScopedAcquire<KernelMutex> lock(&ring_pool_lock_);
+    rings.swap(ring_pool_);
+    ring_pool_bytes_ = 0;
+    ring_pool_stats_.trimmed += rings.size();
+  }
+  // Release outside the lock since freeing takes the memory region locks.
+  for (auto& ring : rings)
+    AqlQueue::FreeRingBuffer(this, ring.second, ring.first.first, ring.first.second);
+}
+
 // Go through all the AQL queues and try to release scratch memory
 void GpuAgent::AsyncReclaimScratchQueues() {
+  // Reclaiming takes scratch_lock_, aql_queues_lock_ keeps the queues from being destroyed.
+  ScopedAcquire<KernelMutex> lock(&aql_queues_lock_);
   for (auto iter : aql_queues_) {
     auto aqlQueue = static_cast<AqlQueue*>(iter);
     aqlQueue->AsyncReclaimMainScratch();
@@ -2005,6 +2205,7 @@ hsa_status_t GpuAgent::SetAsyncScratchThresholds(size_t use_once_limit) {
 
   scratch_limit_async_threshold_ = use_once_limit;
 
+  ScopedAcquire<KernelMutex> lock(&aql_queues_lock_);
   for (auto iter : aql_queues_) {
     auto aqlQueue = static_cast<AqlQueue*>(iter);
     aqlQueue->CheckScratchLimits();
@@ -2143,6 +2344,9 @@ void GpuAgent::SyncClocks() {
 }
 
 hsa_status_t GpuAgent::UpdateTrapHandlerWithPCS(void* pcs_hosttrap_buffers, void* pcs_stochastic_buffers) {
+  // Keep a later first bind from replacing the PC sampling trap handler.
+  BringUp();
+
   // Assemble the trap handler source code.
   void* tma_addr = nullptr;
   uint64_t tma_size = 0;
@@ -2385,6 +2589,7 @@ lazy_ptr<core::Blit>& GpuAgent::GetBlitObject(const core::Agent& dst_agent,
 
 void GpuAgent::Trim() {
   Agent::Trim();
+  TrimRingBuffers();
   AsyncReclaimScratchQueues();
   ScopedAcquire<KernelMutex> lock(&scratch_lock_);
   scratch_cache_.trim(false);
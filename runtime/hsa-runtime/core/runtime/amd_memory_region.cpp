@@ -48,6 +48,7 @@
 #include "core/inc/runtime.h"
 #include "core/inc/amd_cpu_agent.h"
 #include "core/inc/amd_gpu_agent.h"
+#include "core/inc/amd_ipc_fragment.h"
 #include "core/util/utils.h"
 #include "core/inc/exceptions.h"
 #include <unistd.h>
@@ -374,6 +375,21 @@ hsa_status_t MemoryRegion::GetPoolInfo(hsa_amd_memory_pool_info_t attribute,
           break;
       }
       break;
+    case HSA_AMD_MEMORY_POOL_INFO_FRAGMENTATION: {
+      ScopedAcquire<KernelMutex> lock(&owner()->agent_memory_lock_);
+      *((size_t*)value) = fragment_allocator_.fragmented_size();
+      break;
+    }
+    case HSA_AMD_MEMORY_POOL_INFO_CACHED_SIZE: {
+      ScopedAcquire<KernelMutex> lock(&owner()->agent_memory_lock_);
+      *((size_t*)value) = fragment_allocator_.cache_size();
+      break;
+    }
+    case HSA_AMD_MEMORY_POOL_INFO_HIGH_WATER_MARK: {
+      ScopedAcquire<KernelMutex> lock(&owner()->agent_memory_lock_);
+      *((size_t*)value) = fragment_allocator_.high_water_mark();
+      break;
+    }
     default:
       return HSA_STATUS_ERROR_INVALID_ARGUMENT;
   }
@@ -614,39 +630,50 @@ hsa_status_t MemoryRegion::Lock(uint32_t num_agents, const hsa_agent_t* agents,
     return HSA_STATUS_SUCCESS;
   }
 
+  // Overlapping and repeated locks share registrations through the pin registry.
+  return core::Runtime::runtime_singleton_->pin_registry()->Lock(this, host_ptr, size,
+                                                                 std::move(whitelist_nodes),
+                                                                 agent_ptr);
+}
+
+hsa_status_t MemoryRegion::Unlock(void* host_ptr) const {
+  if (!IsSystem()) {
+    return HSA_STATUS_ERROR;
+  }
+
+  if (full_profile()) {
+    return HSA_STATUS_SUCCESS;
+  }
+
+  core::Runtime::runtime_singleton_->pin_registry()->Unlock(host_ptr);
+
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t MemoryRegion::Pin(void* base, size_t size, const std::vector<uint32_t>& nodes,
+                               void** agent_base) const {
   // Call kernel driver to register and pin the memory.
-  if (RegisterMemory(host_ptr, size, mem_flag_)) {
+  if (RegisterMemory(base, size, mem_flag_)) {
     uint64_t alternate_va = 0;
-    if (MakeKfdMemoryResident(whitelist_nodes.size(), &whitelist_nodes[0],
-                              host_ptr, size, &alternate_va, map_flag_)) {
+    if (MakeKfdMemoryResident(nodes.size(), &nodes[0], base, size, &alternate_va, map_flag_)) {
       if (alternate_va != 0) {
-        *agent_ptr = reinterpret_cast<void*>(alternate_va);
+        *agent_base = reinterpret_cast<void*>(alternate_va);
       } else {
-        *agent_ptr = host_ptr;
+        *agent_base = base;
       }
 
       return HSA_STATUS_SUCCESS;
     }
-    AMD::MemoryRegion::DeregisterMemory(host_ptr);
+    AMD::MemoryRegion::DeregisterMemory(base);
     return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
   }
 
   return HSA_STATUS_ERROR;
 }
 
-hsa_status_t MemoryRegion::Unlock(void* host_ptr) const {
-  if (!IsSystem()) {
-    return HSA_STATUS_ERROR;
-  }
-
-  if (full_profile()) {
-    return HSA_STATUS_SUCCESS;
-  }
-
-  MakeKfdMemoryUnresident(host_ptr);
-  DeregisterMemory(host_ptr);
-
-  return HSA_STATUS_SUCCESS;
+void MemoryRegion::Unpin(void* base) const {
+  MakeKfdMemoryUnresident(base);
+  DeregisterMemory(base);
 }
 
 hsa_status_t MemoryRegion::AssignAgent(void* ptr, size_t size,
@@ -657,9 +684,21 @@ hsa_status_t MemoryRegion::AssignAgent(void* ptr, size_t size,
 
 void MemoryRegion::Trim() const { fragment_allocator_.trim(); }
 
+bool MemoryRegion::ConfigureFragmentAllocator(size_t block_size, size_t slab_limit) {
+  // Blocks must stay 2MB aligned, and fragment offsets encodable, for IPC export of fragments.
+  if (!IsMultipleOf(block_size, BlockAllocator::kDefaultBlockSize) ||
+      (block_size > IpcFragment::kMaxBlockSize))
+    return false;
+  ScopedAcquire<KernelMutex> lock(&owner()->agent_memory_lock_);
+  return fragment_allocator_.configure(block_size, AlignUp(slab_limit, kPageSize_));
+}
+
 void* MemoryRegion::BlockAllocator::alloc(size_t request_size, size_t& allocated_size) const {
   void* ret;
-  size_t bsize = AlignUp(request_size, block_size());
+  // Heap blocks are exactly one block.  Direct allocations only need the 2MB fragment granularity,
+  // rounding them to a (possibly much larger) block would waste the tail.
+  size_t bsize = (request_size <= block_size()) ? block_size()
+                                                : AlignUp(request_size, kDefaultBlockSize);
 
   hsa_status_t err = region_.AllocateImpl(
       bsize, core::MemoryRegion::AllocateRestrict | core::MemoryRegion::AllocateDirect, &ret, 0);
@@ -0,0 +1,288 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_pin_registry.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace rocr {
+namespace AMD {
+
+static const size_t kPinPageSize = 4096;
+
+PinRegistry::PinRegistry(PinFn pin, UnpinFn unpin, size_t budget)
+    : pin_(pin),
+      unpin_(unpin),
+      budget_(budget),
+      max_entry_size_(0),
+      idle_bytes_(0),
+      hits_(0),
+      misses_(0) {}
+
+PinRegistry::~PinRegistry() { Flush(); }
+
+hsa_status_t PinRegistry::Lock(const void* owner, void* ptr, size_t size,
+                               std::vector<uint32_t> nodes, void** agent_ptr) {
+  std::sort(nodes.begin(), nodes.end());
+  nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+  const uintptr_t base = AlignDown(addr, kPinPageSize);
+  const uintptr_t end = AlignUp(addr + size, kPinPageSize);
+
+  ScopedAcquire<KernelMutex> lock(&lock_);
+
+  std::vector<Entry*> overlap;
+  Overlapping(base, end, &overlap);
+
+  bool stitch = false;
+  for (auto entry : overlap) {
+    if ((entry->owner != owner) ||
+        !std::includes(entry->nodes.begin(), entry->nodes.end(), nodes.begin(), nodes.end()))
+      continue;
+    if ((entry->base <= base) && (end <= entry->end)) {
+      hits_++;
+      Acquire(entry);
+      locks_.emplace(addr, std::vector<Entry*>(1, entry));
+      *agent_ptr = reinterpret_cast<void*>(entry->agent_base + (addr - entry->base));
+      return HSA_STATUS_SUCCESS;
+    }
+    stitch |= entry->Identity();
+  }
+
+  std::vector<Entry*> spans;
+  hsa_status_t err = stitch ? Stitch(owner, base, end, nodes, &spans)
+                            : Extend(owner, base, end, nodes, &spans);
+  if (err != HSA_STATUS_SUCCESS) {
+    for (auto entry : spans) Release(entry);
+    Reclaim();
+    return err;
+  }
+
+  const Entry* first = spans.front();
+  *agent_ptr = reinterpret_cast<void*>(first->agent_base + (addr - first->base));
+  locks_.emplace(addr, std::move(spans));
+  return HSA_STATUS_SUCCESS;
+}
+
+void PinRegistry::Unlock(void* ptr) {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  auto it = locks_.find(reinterpret_cast<uintptr_t>(ptr));
+  if (it == locks_.end()) return;
+  for (auto entry : it->second) Release(entry);
+  locks_.erase(it);
+  Reclaim();
+}
+
+void PinRegistry::Flush() {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  for (auto& entry : entries_) unpin_(entry.second.owner, reinterpret_cast<void*>(entry.first));
+  entries_.clear();
+  idle_.clear();
+  idle_bytes_ = 0;
+  locks_.clear();
+  max_entry_size_ = 0;
+}
+
+uint64_t PinRegistry::hits() const {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  return hits_;
+}
+
+uint64_t PinRegistry::misses() const {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  return misses_;
+}
+
+size_t PinRegistry::cached_bytes() const {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  return idle_bytes_;
+}
+
+void PinRegistry::Overlapping(uintptr_t start, uintptr_t stop, std::vector<Entry*>* out) {
+  // No entry starting before start - max_entry_size_ can reach start.
+  auto it = entries_.lower_bound(start > max_entry_size_ ? start - max_entry_size_ : 0);
+  for (; (it != entries_.end()) && (it->first < stop); it++) {
+    if (it->second.end > start) out->push_back(&it->second);
+  }
+}
+
+hsa_status_t PinRegistry::Stitch(const void* owner, uintptr_t base, uintptr_t end,
+                                 const std::vector<uint32_t>& nodes,
+                                 std::vector<Entry*>* spans) {
+  bool pinned = false;
+  uintptr_t cursor = base;
+  while (cursor < end) {
+    // Extend through the compatible entry reaching furthest, else pin up to the next one.
+    Entry* best = nullptr;
+    uintptr_t next = end;
+    std::vector<Entry*> overlap;
+    Overlapping(cursor, end, &overlap);
+    for (auto entry : overlap) {
+      if ((entry->owner != owner) || !entry->Identity() ||
+          !std::includes(entry->nodes.begin(), entry->nodes.end(), nodes.begin(), nodes.end()))
+        continue;
+      if (entry->base <= cursor) {
+        if ((best == nullptr) || (entry->end > best->end)) best = entry;
+      } else {
+        next = Min(next, entry->base);
+      }
+    }
+
+    if (best != nullptr) {
+      Acquire(best);
+    } else {
+      hsa_status_t err = Pin(owner, cursor, next, nodes, &best);
+      if (err != HSA_STATUS_SUCCESS) return err;
+      pinned = true;
+      // Only mappings at the host address can be stitched.
+      if (!best->Identity()) {
+        spans->push_back(best);
+        return HSA_STATUS_ERROR;
+      }
+    }
+    spans->push_back(best);
+    cursor = best->end;
+  }
+
+  if (pinned)
+    misses_++;
+  else
+    hits_++;
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t PinRegistry::Extend(const void* owner, uintptr_t base, uintptr_t end,
+                                 const std::vector<uint32_t>& nodes,
+                                 std::vector<Entry*>* spans) {
+  misses_++;
+
+  uintptr_t start = base;
+  uintptr_t stop = end;
+  std::vector<uint32_t> pin_nodes = nodes;
+  // Absorbing an entry may reach further ones, repeat until the union is stable.
+  bool grown = true;
+  while (grown) {
+    grown = false;
+    std::vector<Entry*> overlap;
+    Overlapping(start, stop, &overlap);
+    for (auto entry : overlap) {
+      if ((entry->refs != 0) || (entry->owner != owner)) continue;
+      start = Min(start, entry->base);
+      stop = Max(stop, entry->end);
+      std::vector<uint32_t> merged;
+      std::set_union(pin_nodes.begin(), pin_nodes.end(), entry->nodes.begin(),
+                     entry->nodes.end(), std::back_inserter(merged));
+      pin_nodes.swap(merged);
+      Retire(entry);
+      grown = true;
+    }
+  }
+
+  Entry* entry;
+  hsa_status_t err = Pin(owner, start, stop, pin_nodes, &entry);
+  if (err != HSA_STATUS_SUCCESS) return err;
+  spans->push_back(entry);
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t PinRegistry::Pin(const void* owner, uintptr_t start, uintptr_t stop,
+                              const std::vector<uint32_t>& nodes, Entry** entry) {
+  // KFD would take a second userptr registration at the same address for the first.
+  auto range = entries_.equal_range(start);
+  for (auto it = range.first; it != range.second;) {
+    Entry* cur = &(it++)->second;
+    if (cur->refs == 0)
+      Retire(cur);
+    else if (!cur->Identity())
+      return HSA_STATUS_ERROR;
+  }
+
+  void* agent_base;
+  hsa_status_t err = pin_(owner, reinterpret_cast<void*>(start), stop - start, nodes, &agent_base);
+  if (err != HSA_STATUS_SUCCESS) return err;
+
+  auto it = entries_.emplace(start, Entry());
+  Entry& pin = it->second;
+  pin.base = start;
+  pin.end = stop;
+  pin.owner = owner;
+  pin.nodes = nodes;
+  pin.agent_base = reinterpret_cast<uintptr_t>(agent_base);
+  pin.refs = 1;
+  pin.self = it;
+  pin.lru = idle_.end();
+  max_entry_size_ = Max(max_entry_size_, size_t(stop - start));
+  *entry = &pin;
+  return HSA_STATUS_SUCCESS;
+}
+
+void PinRegistry::Acquire(Entry* entry) {
+  if (entry->refs++ != 0) return;
+  idle_.erase(entry->lru);
+  entry->lru = idle_.end();
+  idle_bytes_ -= entry->end - entry->base;
+}
+
+void PinRegistry::Release(Entry* entry) {
+  assert(entry->refs != 0 && "Pinned range released too many times.");
+  if (--entry->refs != 0) return;
+  idle_.push_front(entry);
+  entry->lru = idle_.begin();
+  idle_bytes_ += entry->end - entry->base;
+}
+
+void PinRegistry::Retire(Entry* entry) {
+  assert(entry->refs == 0 && "Retiring a locked range.");
+  idle_.erase(entry->lru);
+  idle_bytes_ -= entry->end - entry->base;
+  unpin_(entry->owner, reinterpret_cast<void*>(entry->base));
+  entries_.erase(entry->self);
+}
+
+void PinRegistry::Reclaim() {
+  while ((idle_bytes_ > budget_) && !idle_.empty()) Retire(idle_.back());
+}
+
+}  // namespace AMD
+}  // namespace rocr
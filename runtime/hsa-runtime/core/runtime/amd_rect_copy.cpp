@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_rect_copy.h"
+
+#include "core/inc/exceptions.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace AMD {
+
+namespace {
+// Slices at least this large copy faster as linear spans than as rect tiles.
+const uint64_t kMinSliceSpanSize = 64 * 1024;
+
+// log2 of the largest element (up to 16 bytes) that evenly divides width, as
+// used by the SDMA rect packet. width | 16 also maps 0 to the largest element.
+int MaxAlignedElement(uint64_t width) { return __builtin_ctzll(width | 16); }
+
+char* RowAddress(const hsa_pitched_ptr_t& ptr, const hsa_dim3_t& offset, uint64_t y, uint64_t z) {
+  return static_cast<char*>(ptr.base) + offset.x + (offset.y + y) * ptr.pitch +
+      (offset.z + z) * ptr.slice;
+}
+
+void AddSpan(std::vector<core::LinearCopyDesc>& spans, void* dst, const void* src, size_t size) {
+  core::LinearCopyDesc span = {dst, src, size};
+  spans.push_back(span);
+}
+
+// Mirrors the encodability checks of BlitSdma::BuildCopyRectCommand.
+bool RectFits(const RectCopyDesc& rect, const RectCopyLimits& limits) {
+  const hsa_pitched_ptr_t& src = rect.src;
+  const hsa_pitched_ptr_t& dst = rect.dst;
+
+  if (limits.max_pitch == 0) return false;
+
+  // Base addresses, pitches and slices must be DWORD aligned.
+  if ((reinterpret_cast<uintptr_t>(src.base) | reinterpret_cast<uintptr_t>(dst.base) | src.pitch |
+       dst.pitch | src.slice | dst.slice) % 4 != 0)
+    return false;
+
+  int max_ele = Min(MaxAlignedElement(src.pitch), MaxAlignedElement(dst.pitch));
+  if (rect.range.z != 1)
+    max_ele = Min(max_ele, MaxAlignedElement(src.slice), MaxAlignedElement(dst.slice));
+  const int min_ele =
+      Min(max_ele, MaxAlignedElement(rect.range.x), MaxAlignedElement(rect.src_offset.x % 4),
+          MaxAlignedElement(rect.dst_offset.x % 4));
+
+  if ((src.pitch >> min_ele) > limits.max_pitch || (dst.pitch >> min_ele) > limits.max_pitch)
+    return false;
+  if (rect.range.z != 1 &&
+      ((src.slice >> min_ele) > limits.max_slice || (dst.slice >> min_ele) > limits.max_slice))
+    return false;
+  return true;
+}
+
+// Adds a single-slice rect, swapping Y into Z when the pitch only fits the
+// wider slice field. Returns false when neither form is encodable.
+bool AddRect2D(std::vector<RectCopyDesc>& rects, const RectCopyDesc& rect,
+               const RectCopyLimits& limits) {
+  assert(rect.range.z == 1 && "2D rect expected.");
+  if (RectFits(rect, limits)) {
+    rects.push_back(rect);
+    return true;
+  }
+
+  RectCopyDesc wide = rect;
+  wide.src.base = RowAddress(rect.src, rect.src_offset, 0, 0) - rect.src_offset.x;
+  wide.dst.base = RowAddress(rect.dst, rect.dst_offset, 0, 0) - rect.dst_offset.x;
+  wide.src_offset.y = wide.src_offset.z = 0;
+  wide.dst_offset.y = wide.dst_offset.z = 0;
+  wide.src.slice = rect.src.pitch;
+  wide.src.pitch = 0;
+  wide.dst.slice = rect.dst.pitch;
+  wide.dst.pitch = 0;
+  wide.range.z = rect.range.y;
+  wide.range.y = 1;
+  if (!RectFits(wide, limits)) return false;
+  rects.push_back(wide);
+  return true;
+}
+}  // namespace
+
+void ValidateRectCopy(const hsa_pitched_ptr_t& dst, const hsa_dim3_t& dst_offset,
+                      const hsa_pitched_ptr_t& src, const hsa_dim3_t& src_offset,
+                      const hsa_dim3_t& range, bool dword_aligned) {
+  if (dword_aligned) {
+    if (((uintptr_t)dst.base) % 4 != 0 || ((uintptr_t)src.base) % 4 != 0)
+      throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT,
+                               "Copy rect base address not aligned.");
+    if (((uintptr_t)dst.pitch) % 4 != 0 || ((uintptr_t)src.pitch) % 4 != 0)
+      throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect pitch not aligned.");
+    if (((uintptr_t)dst.slice) % 4 != 0 || ((uintptr_t)src.slice) % 4 != 0)
+      throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect slice not aligned.");
+  }
+  if (uint64_t(src_offset.x) + range.x > src.pitch ||
+      uint64_t(dst_offset.x) + range.x > dst.pitch)
+    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect width out of range.");
+  if ((src.slice != 0) && (uint64_t(src_offset.y) + range.y) > src.slice / src.pitch)
+    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect height out of range.");
+  if ((dst.slice != 0) && (uint64_t(dst_offset.y) + range.y) > dst.slice / dst.pitch)
+    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect height out of range.");
+  if (range.z > 1 && (src.slice == 0 || dst.slice == 0))
+    throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_ARGUMENT, "Copy rect slice needed.");
+}
+
+void PlanRectCopy(const hsa_pitched_ptr_t& dst, const hsa_dim3_t& dst_offset,
+                  const hsa_pitched_ptr_t& src, const hsa_dim3_t& src_offset,
+                  const hsa_dim3_t& range, const RectCopyLimits& limits,
+                  std::vector<core::LinearCopyDesc>& spans, std::vector<RectCopyDesc>& rects) {
+  spans.clear();
+  rects.clear();
+
+  // Nothing to copy, a single empty span keeps the dependency and signal ordering.
+  if (range.x == 0 || range.y == 0 || range.z == 0) {
+    AddSpan(spans, RowAddress(dst, dst_offset, 0, 0), RowAddress(src, src_offset, 0, 0), 0);
+    return;
+  }
+
+  const RectCopyDesc whole = {dst, dst_offset, src, src_offset, range};
+  const uint64_t row = range.x;
+
+  // Rows are contiguous when each row ends where the next begins in both surfaces.
+  if (range.y == 1 || (src.pitch == row && dst.pitch == row)) {
+    const uint64_t slice = row * range.y;
+    if (range.z == 1 || (src.slice == slice && dst.slice == slice)) {
+      AddSpan(spans, RowAddress(dst, dst_offset, 0, 0), RowAddress(src, src_offset, 0, 0),
+              slice * range.z);
+      return;
+    }
+    if (slice >= kMinSliceSpanSize || !RectFits(whole, limits)) {
+      for (uint64_t z = 0; z < range.z; z++)
+        AddSpan(spans, RowAddress(dst, dst_offset, 0, z), RowAddress(src, src_offset, 0, z),
+                slice);
+      return;
+    }
+  }
+
+  if (limits.max_pitch != 0) {
+    if (range.z == 1) {
+      if (AddRect2D(rects, whole, limits)) return;
+    } else if (RectFits(whole, limits)) {
+      rects.push_back(whole);
+      return;
+    } else {
+      // Pitch or slice does not fit a 3D packet, copy slice by slice.
+      RectCopyDesc plane = whole;
+      plane.range.z = 1;
+      bool fits = true;
+      for (uint32_t z = 0; fits && z < range.z; z++) {
+        plane.src_offset.z = src_offset.z + z;
+        plane.dst_offset.z = dst_offset.z + z;
+        fits = AddRect2D(rects, plane, limits);
+      }
+      if (fits) return;
+      rects.clear();
+    }
+  }
+
+  // No rect form is encodable on this engine, copy row by row.
+  spans.reserve(uint64_t(range.y) * range.z);
+  for (uint64_t z = 0; z < range.z; z++)
+    for (uint64_t y = 0; y < range.y; y++)
+      AddSpan(spans, RowAddress(dst, dst_offset, y, z), RowAddress(src, src_offset, y, z), row);
+}
+
+}  // namespace AMD
+}  // namespace rocr
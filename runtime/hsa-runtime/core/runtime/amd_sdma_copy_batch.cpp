@@ -0,0 +1,223 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_sdma_copy_batch.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace rocr {
+namespace AMD {
+
+static inline uint32_t ptrlow32(const void* p) {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(p));
+}
+
+static inline uint32_t ptrhigh32(const void* p) {
+#if defined(HSA_LARGE_MODEL)
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(p) >> 32);
+#else
+  return 0;
+#endif
+}
+
+uint32_t SdmaLinearCopyPacketCount(size_t size, const SdmaLinearCopyFormat& format) {
+  return static_cast<uint32_t>((size + format.max_copy_size - 1) / format.max_copy_size);
+}
+
+void BuildSdmaLinearCopy(SDMA_PKT_COPY_LINEAR* packets, uint32_t num_packets, void* dst,
+                         const void* src, size_t size, const SdmaLinearCopyFormat& format) {
+  size_t cur_size = 0;
+  for (uint32_t i = 0; i < num_packets; ++i) {
+    const uint32_t copy_size =
+        static_cast<uint32_t>(std::min((size - cur_size), format.max_copy_size));
+
+    void* cur_dst = static_cast<char*>(dst) + cur_size;
+    const void* cur_src = static_cast<const char*>(src) + cur_size;
+
+    SDMA_PKT_COPY_LINEAR* packet_addr = &packets[i];
+
+    memset(packet_addr, 0, sizeof(SDMA_PKT_COPY_LINEAR));
+
+    packet_addr->HEADER_UNION.op = SDMA_OP_COPY;
+    packet_addr->HEADER_UNION.sub_op = SDMA_SUBOP_COPY_LINEAR;
+
+    if (format.max_copy_size == (1 << 30) - 1)
+      packet_addr->COUNT_UNION.count_ext.count = copy_size + format.size_to_count_offset;
+    else
+      packet_addr->COUNT_UNION.count.count = copy_size + format.size_to_count_offset;
+
+    packet_addr->SRC_ADDR_LO_UNION.src_addr_31_0 = ptrlow32(cur_src);
+    packet_addr->SRC_ADDR_HI_UNION.src_addr_63_32 = ptrhigh32(cur_src);
+
+    packet_addr->DST_ADDR_LO_UNION.dst_addr_31_0 = ptrlow32(cur_dst);
+    packet_addr->DST_ADDR_HI_UNION.dst_addr_63_32 = ptrhigh32(cur_dst);
+
+    cur_size += copy_size;
+  }
+
+  assert(cur_size == size);
+}
+
+void BuildSdmaFence(char* cmd, uint32_t* fence, uint32_t value, bool set_mtype) {
+  assert(cmd != NULL);
+  SDMA_PKT_FENCE* packet_addr = reinterpret_cast<SDMA_PKT_FENCE*>(cmd);
+
+  memset(packet_addr, 0, sizeof(SDMA_PKT_FENCE));
+
+  packet_addr->HEADER_UNION.op = SDMA_OP_FENCE;
+  if (set_mtype) packet_addr->HEADER_UNION.mtype = 3;
+
+  packet_addr->ADDR_LO_UNION.addr_31_0 = ptrlow32(fence);
+  packet_addr->ADDR_HI_UNION.addr_63_32 = ptrhigh32(fence);
+
+  packet_addr->DATA_UNION.data = value;
+}
+
+void BuildSdmaAtomicDecrement(char* cmd, void* addr) {
+  SDMA_PKT_ATOMIC* packet_addr = reinterpret_cast<SDMA_PKT_ATOMIC*>(cmd);
+
+  memset(packet_addr, 0, sizeof(SDMA_PKT_ATOMIC));
+
+  packet_addr->HEADER_UNION.op = SDMA_OP_ATOMIC;
+  packet_addr->HEADER_UNION.operation = SDMA_ATOMIC_ADD64;
+
+  packet_addr->ADDR_LO_UNION.addr_31_0 = ptrlow32(addr);
+  packet_addr->ADDR_HI_UNION.addr_63_32 = ptrhigh32(addr);
+
+  packet_addr->SRC_DATA_LO_UNION.src_data_31_0 = 0xffffffff;
+  packet_addr->SRC_DATA_HI_UNION.src_data_63_32 = 0xffffffff;
+}
+
+void BuildSdmaTrap(char* cmd, uint32_t event_id) {
+  SDMA_PKT_TRAP* packet_addr = reinterpret_cast<SDMA_PKT_TRAP*>(cmd);
+
+  memset(packet_addr, 0, sizeof(SDMA_PKT_TRAP));
+
+  packet_addr->HEADER_UNION.op = SDMA_OP_TRAP;
+  packet_addr->INT_CONTEXT_UNION.int_ctx = event_id;
+}
+
+uint32_t SdmaCompletionSize(const SdmaCompletion& completion, bool platform_atomics) {
+  uint32_t size = platform_atomics ? sizeof(SDMA_PKT_ATOMIC)
+      : (completion.value > UINT32_MAX) ? 2 * sizeof(SDMA_PKT_FENCE)
+                                        : sizeof(SDMA_PKT_FENCE);
+  if (completion.mailbox != nullptr) size += sizeof(SDMA_PKT_FENCE) + sizeof(SDMA_PKT_TRAP);
+  return size;
+}
+
+uint32_t BuildSdmaCompletion(char* cmd, const SdmaCompletion& completion, bool platform_atomics,
+                             bool set_mtype) {
+  char* const start = cmd;
+
+  // The fence replacing the atomic is not a write packet since the SDMA engine may overlap
+  // serial copy/write packets.
+  if (platform_atomics) {
+    BuildSdmaAtomicDecrement(cmd, completion.value_location);
+    cmd += sizeof(SDMA_PKT_ATOMIC);
+  } else {
+    uint32_t* value_location = reinterpret_cast<uint32_t*>(completion.value_location);
+    if (completion.value > UINT32_MAX) {
+      BuildSdmaFence(cmd, value_location + 1, static_cast<uint32_t>(completion.value >> 32),
+                     set_mtype);
+      cmd += sizeof(SDMA_PKT_FENCE);
+    }
+    BuildSdmaFence(cmd, value_location, static_cast<uint32_t>(completion.value), set_mtype);
+    cmd += sizeof(SDMA_PKT_FENCE);
+  }
+
+  // Update mailbox event and send interrupt to IH.
+  if (completion.mailbox != nullptr) {
+    BuildSdmaFence(cmd, completion.mailbox, completion.event_id, set_mtype);
+    cmd += sizeof(SDMA_PKT_FENCE);
+    BuildSdmaTrap(cmd, completion.event_id);
+    cmd += sizeof(SDMA_PKT_TRAP);
+  }
+
+  assert(uint32_t(cmd - start) == SdmaCompletionSize(completion, platform_atomics));
+  return static_cast<uint32_t>(cmd - start);
+}
+
+void PlanSdmaCopyBatch(const core::LinearCopyDesc* copies, size_t count,
+                       const SdmaLinearCopyFormat& format, uint32_t max_segment_packets,
+                       std::vector<SDMA_PKT_COPY_LINEAR>& packets,
+                       std::vector<SdmaCopySegment>& segments) {
+  size_t total_packets = 0;
+  for (size_t i = 0; i < count; ++i)
+    total_packets += SdmaLinearCopyPacketCount(copies[i].size, format);
+
+  packets.resize(total_packets);
+  segments.clear();
+
+  SdmaCopySegment segment = {0, 0, 0};
+  size_t next = 0;
+  for (size_t i = 0; i < count; ++i) {
+    size_t done = 0;
+    while (done < copies[i].size) {
+      if (segment.num_packets == max_segment_packets) {
+        segments.push_back(segment);
+        segment.first_packet = next;
+        segment.num_packets = 0;
+        segment.bytes = 0;
+      }
+
+      const size_t remain = copies[i].size - done;
+      const uint32_t num_packets = std::min(max_segment_packets - segment.num_packets,
+                                            SdmaLinearCopyPacketCount(remain, format));
+      const size_t chunk = std::min(remain, num_packets * format.max_copy_size);
+
+      BuildSdmaLinearCopy(&packets[next], num_packets, static_cast<char*>(copies[i].dst) + done,
+                          static_cast<const char*>(copies[i].src) + done, chunk, format);
+      next += num_packets;
+      segment.num_packets += num_packets;
+      segment.bytes += chunk;
+      done += chunk;
+    }
+  }
+  segments.push_back(segment);
+  assert(next == total_packets);
+}
+
+}  // namespace AMD
+}  // namespace rocr
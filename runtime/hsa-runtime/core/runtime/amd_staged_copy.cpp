@@ -0,0 +1,240 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_staged_copy.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/inc/interrupt_signal.h"
+#include "core/inc/runtime.h"
+
+namespace rocr {
+namespace AMD {
+
+// Chunks below this are copied by the calling thread alone.
+static const size_t kMinParallelBytes = 256 * 1024;
+
+// Fixed cost of registering, mapping, unmapping and deregistering a range.
+static const double kPinSetupNs = 20000.0;
+// Fixed cost of a staged copy: signal resets, SDMA submission and helper wakeup.
+static const double kStageSetupNs = 5000.0;
+
+StagedCopy::StagedCopy()
+    : initialized_(false),
+      buffer_size_(core::Runtime::runtime_singleton_->flag().copy_staging_buffer_size()),
+      done_(nullptr),
+      exit_(false) {}
+
+StagedCopy::~StagedCopy() {
+  if (!initialized_) return;
+
+  exit_ = true;
+  for (auto& worker : workers_) os::PostSemaphore(worker->start);
+  for (auto& worker : workers_) {
+    os::WaitForThread(worker->thread);
+    os::CloseThread(worker->thread);
+    os::DestroySemaphore(worker->start);
+  }
+  workers_.clear();
+  if (done_ != nullptr) os::DestroySemaphore(done_);
+
+  for (auto& slot : ring_) {
+    if (slot.done != nullptr) slot.done->DestroySignal();
+    if (slot.buffer != nullptr) core::Runtime::runtime_singleton_->system_deallocator()(slot.buffer);
+  }
+  ring_.clear();
+}
+
+bool StagedCopy::Preferred(size_t size) const {
+  const Flag& flag = core::Runtime::runtime_singleton_->flag();
+  if (flag.copy_staging_buffers() == 0) return false;
+
+  // MB/s is bytes per ms, so divide by 1e6 for bytes per ns.
+  const double memcpy_rate = double(flag.copy_memcpy_mbps()) / 1e6 *
+      (size < kMinParallelBytes ? 1 : flag.copy_staging_threads() + 1);
+  const double dma_rate = double(flag.copy_dma_mbps()) / 1e6;
+  const double pages = double((size + 4095) / 4096);
+
+  const double pin_ns = kPinSetupNs + pages * flag.copy_pin_ns_per_page() + size / dma_rate;
+  // The first buffer fills before any DMA starts, after that the slower side sets the pace.
+  const double stage_ns = kStageSetupNs + std::min(size, buffer_size_) / memcpy_rate +
+      std::max(size / memcpy_rate, size / dma_rate);
+  return stage_ns < pin_ns;
+}
+
+bool StagedCopy::Init() {
+  if (initialized_) return !ring_.empty();
+  initialized_ = true;
+
+  const Flag& flag = core::Runtime::runtime_singleton_->flag();
+  auto& allocator = core::Runtime::runtime_singleton_->system_allocator();
+
+  for (uint32_t i = 0; i < flag.copy_staging_buffers(); i++) {
+    Slot slot;
+    slot.buffer = allocator(buffer_size_, 4096, core::MemoryRegion::AllocateNoFlags, 0);
+    if (slot.buffer == nullptr) break;
+    slot.done = new core::InterruptSignal(0);
+    ring_.push_back(slot);
+  }
+  if (ring_.empty()) return false;
+
+  done_ = os::CreateSemaphore();
+  if (done_ == nullptr) return true;
+
+  for (uint32_t i = 0; i < flag.copy_staging_threads(); i++) {
+    std::unique_ptr<Worker> worker(new Worker());
+    worker->owner = this;
+    worker->start = os::CreateSemaphore();
+    if (worker->start == nullptr) break;
+    worker->thread = os::CreateThread(WorkerLoop, worker.get());
+    if (worker->thread == nullptr) {
+      os::DestroySemaphore(worker->start);
+      break;
+    }
+    workers_.push_back(std::move(worker));
+  }
+  return true;
+}
+
+void StagedCopy::WorkerLoop(void* arg) {
+  Worker* worker = reinterpret_cast<Worker*>(arg);
+  while (true) {
+    os::WaitSemaphore(worker->start);
+    if (worker->owner->exit_) return;
+    memcpy(worker->dst, worker->src, worker->size);
+    os::PostSemaphore(worker->owner->done_);
+  }
+}
+
+void StagedCopy::ParallelMemcpy(void* dst, const void* src, size_t size) {
+  if ((size < kMinParallelBytes) || workers_.empty()) {
+    memcpy(dst, src, size);
+    return;
+  }
+
+  const size_t slice = AlignUp(size / (workers_.size() + 1), 4096);
+  size_t offset = 0;
+  uint32_t posted = 0;
+  for (auto& worker : workers_) {
+    if (offset + slice >= size) break;
+    worker->dst = reinterpret_cast<uint8_t*>(dst) + offset;
+    worker->src = reinterpret_cast<const uint8_t*>(src) + offset;
+    worker->size = slice;
+    os::PostSemaphore(worker->start);
+    posted++;
+    offset += slice;
+  }
+
+  memcpy(reinterpret_cast<uint8_t*>(dst) + offset, reinterpret_cast<const uint8_t*>(src) + offset,
+         size - offset);
+  for (uint32_t i = 0; i < posted; i++) os::WaitSemaphore(done_);
+}
+
+hsa_status_t StagedCopy::Copy(void* dst, const void* src, size_t size, core::Agent* gpu,
+                              bool to_device) {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  if (!Init()) return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
+
+  core::Agent* cpu = core::Runtime::runtime_singleton_->cpu_agents()[0];
+  std::vector<core::Signal*> no_deps;
+  const size_t count = ring_.size();
+  const size_t chunks = (size + buffer_size_ - 1) / buffer_size_;
+
+  const auto& wait = [](Slot& slot) {
+    slot.done->WaitRelaxed(HSA_SIGNAL_CONDITION_EQ, 0, UINT64_MAX, HSA_WAIT_STATE_BLOCKED);
+  };
+
+  // Submit the DMA of chunk i between its bounce buffer and the device side.
+  const auto& submit = [&](size_t i) {
+    Slot& slot = ring_[i % count];
+    const size_t offset = i * buffer_size_;
+    const size_t bytes = std::min(buffer_size_, size - offset);
+    slot.done->StoreRelaxed(1);
+    hsa_status_t err = to_device
+        ? gpu->DmaCopy(reinterpret_cast<uint8_t*>(dst) + offset, *gpu, slot.buffer, *cpu, bytes,
+                       no_deps, *slot.done)
+        : gpu->DmaCopy(slot.buffer, *cpu, reinterpret_cast<const uint8_t*>(src) + offset, *gpu,
+                       bytes, no_deps, *slot.done);
+    if (err != HSA_STATUS_SUCCESS) slot.done->StoreRelaxed(0);
+    return err;
+  };
+
+  // Buffers must be idle before they are reused by the next copy.
+  MAKE_SCOPE_GUARD([&]() {
+    for (auto& slot : ring_) wait(slot);
+  });
+
+  hsa_status_t err;
+  if (to_device) {
+    for (size_t i = 0; i < chunks; i++) {
+      Slot& slot = ring_[i % count];
+      const size_t offset = i * buffer_size_;
+      wait(slot);
+      ParallelMemcpy(slot.buffer, reinterpret_cast<const uint8_t*>(src) + offset,
+                     std::min(buffer_size_, size - offset));
+      err = submit(i);
+      if (err != HSA_STATUS_SUCCESS) return err;
+    }
+    return HSA_STATUS_SUCCESS;
+  }
+
+  for (size_t i = 0; i < std::min(count, chunks); i++) {
+    err = submit(i);
+    if (err != HSA_STATUS_SUCCESS) return err;
+  }
+  for (size_t i = 0; i < chunks; i++) {
+    Slot& slot = ring_[i % count];
+    const size_t offset = i * buffer_size_;
+    wait(slot);
+    ParallelMemcpy(reinterpret_cast<uint8_t*>(dst) + offset, slot.buffer,
+                   std::min(buffer_size_, size - offset));
+    if (i + count < chunks) {
+      err = submit(i + count);
+      if (err != HSA_STATUS_SUCCESS) return err;
+    }
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+}  // namespace AMD
+}  // namespace rocr
@@ -0,0 +1,339 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_svm_prefetch.h"
+
+#include <algorithm>
+#include <set>
+
+namespace rocr {
+namespace AMD {
+
+SvmPrefetch::SvmPrefetch(MigrateFn migrate, CompleteFn complete, size_t batch_bytes)
+    : migrate_(migrate),
+      complete_(complete),
+      batch_bytes_(batch_bytes),
+      issued_begin_(0),
+      issued_end_(0),
+      issued_node_(kNoNode),
+      thread_(nullptr),
+      wake_(nullptr),
+      exit_(false) {
+  assert(batch_bytes_ != 0 && "SVM prefetch batch size must be non-zero.");
+}
+
+SvmPrefetch::~SvmPrefetch() {
+  if (thread_ != nullptr) {
+    exit_ = true;
+    os::PostSemaphore(wake_);
+    os::WaitForThread(thread_);
+    os::CloseThread(thread_);
+    os::DestroySemaphore(wake_);
+  }
+
+  // Prefetches still pending at teardown are dropped without completion.
+  std::set<Prefetch*> pending(ready_.begin(), ready_.end());
+  for (auto& range : ranges_) pending.insert(range.second.owner);
+  for (auto prefetch : pending) delete prefetch;
+}
+
+bool SvmPrefetch::Start() {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  if (thread_ != nullptr) return true;
+
+  wake_ = os::CreateSemaphore();
+  if (wake_ == nullptr) return false;
+  thread_ = os::CreateThread(WorkerLoop, this);
+  if (thread_ == nullptr) {
+    os::DestroySemaphore(wake_);
+    wake_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void SvmPrefetch::WorkerLoop(void* arg) {
+  SvmPrefetch* self = reinterpret_cast<SvmPrefetch*>(arg);
+  while (true) {
+    os::WaitSemaphore(self->wake_);
+    if (self->exit_) return;
+    while (!self->exit_ && self->Step()) {
+    }
+  }
+}
+
+SvmPrefetch::Prefetch* SvmPrefetch::Add(uintptr_t base, size_t size, uint32_t node,
+                                        hsa_signal_t completion) {
+  assert(size != 0 && "Empty SVM prefetch.");
+
+  Prefetch* prefetch = new Prefetch();
+  prefetch->base = base;
+  prefetch->end = base + size;
+  prefetch->node = node;
+  prefetch->completion = completion;
+  prefetch->ready = false;
+  prefetch->live = size;
+  prefetch->in_flight = 0;
+
+  std::vector<Prefetch*> done;
+  {
+    ScopedAcquire<KernelMutex> lock(&lock_);
+    Trim(prefetch->base, prefetch->end, &done);
+    auto ret = ranges_.emplace(base, Range(size, prefetch));
+    assert(ret.second && "Prefetch range insert failed.");
+  }
+  Finish(done);
+  return prefetch;
+}
+
+void SvmPrefetch::Ready(Prefetch* prefetch) {
+  std::vector<Prefetch*> done;
+  {
+    ScopedAcquire<KernelMutex> lock(&lock_);
+    prefetch->ready = true;
+    if (Done(prefetch)) {
+      // Entirely superseded while waiting on its dependencies.
+      done.push_back(prefetch);
+    } else {
+      ready_.push_back(prefetch);
+      if (thread_ != nullptr) os::PostSemaphore(wake_);
+    }
+  }
+  Finish(done);
+}
+
+void SvmPrefetch::Cancel(Prefetch* prefetch) {
+  assert(!prefetch->ready && "Cancelling a queued SVM prefetch.");
+  {
+    ScopedAcquire<KernelMutex> lock(&lock_);
+    auto it = ranges_.lower_bound(prefetch->base);
+    while (it != ranges_.end() && it->first < prefetch->end) {
+      if (it->second.owner == prefetch)
+        it = ranges_.erase(it);
+      else
+        it++;
+    }
+  }
+  delete prefetch;
+}
+
+void SvmPrefetch::Trim(uintptr_t base, uintptr_t end, std::vector<Prefetch*>* done) {
+  auto it = ranges_.upper_bound(base);
+  if (it != ranges_.begin()) it--;
+
+  while (it != ranges_.end() && it->first < end) {
+    uintptr_t rbase = it->first;
+    uintptr_t rend = rbase + it->second.bytes;
+    Prefetch* owner = it->second.owner;
+
+    uintptr_t ibase = Max(rbase, base);
+    uintptr_t iend = Min(rend, end);
+    if (ibase >= iend) {
+      it++;
+      continue;
+    }
+
+    owner->live -= iend - ibase;
+
+    // Keep the tail beyond the trimmed range.
+    if (iend < rend) {
+      auto ret = ranges_.emplace(iend, Range(rend - iend, owner));
+      assert(ret.second && "Prefetch map insert failed during range split.");
+    }
+
+    // Keep the head before the trimmed range.
+    if (rbase < ibase) {
+      it->second.bytes = ibase - rbase;
+      it++;
+    } else {
+      it = ranges_.erase(it);
+    }
+
+    if (Done(owner)) {
+      Unqueue(owner);
+      done->push_back(owner);
+    }
+  }
+}
+
+void SvmPrefetch::Unqueue(Prefetch* prefetch) {
+  auto it = std::find(ready_.begin(), ready_.end(), prefetch);
+  if (it != ready_.end()) ready_.erase(it);
+}
+
+void SvmPrefetch::Finish(const std::vector<Prefetch*>& done) {
+  for (auto prefetch : done) {
+    complete_(prefetch->completion);
+    delete prefetch;
+  }
+}
+
+bool SvmPrefetch::Step() {
+  std::vector<std::pair<Prefetch*, size_t>> batch;
+  uintptr_t begin, end;
+  uint32_t node;
+
+  {
+    ScopedAcquire<KernelMutex> lock(&lock_);
+    if (ready_.empty()) return false;
+
+    Prefetch* prefetch = ready_.front();
+    node = prefetch->node;
+
+    auto it = ranges_.lower_bound(prefetch->base);
+    while (it->second.owner != prefetch) it++;
+    assert(it->first < prefetch->end && "Ready prefetch has no pending range.");
+
+    auto take = [&](Prefetch* owner, size_t bytes) {
+      owner->live -= bytes;
+      owner->in_flight += bytes;
+      batch.push_back(std::make_pair(owner, bytes));
+    };
+
+    auto mergeable = [&](range_map_t::iterator range) {
+      return range->second.owner->ready && range->second.owner->node == node;
+    };
+
+    // Oldest ready range, split if larger than a batch.
+    begin = it->first;
+    size_t bytes = Min(it->second.bytes, batch_bytes_);
+    end = begin + bytes;
+    if (bytes < it->second.bytes)
+      ranges_.emplace(end, Range(it->second.bytes - bytes, prefetch));
+    take(prefetch, bytes);
+    ranges_.erase(it);
+
+    // Grow downward through abutting ranges headed for the same node.
+    while (end - begin < batch_bytes_) {
+      it = ranges_.lower_bound(begin);
+      if (it == ranges_.begin()) break;
+      it--;
+      if (it->first + it->second.bytes != begin || !mergeable(it)) break;
+
+      bytes = Min(it->second.bytes, batch_bytes_ - (end - begin));
+      begin -= bytes;
+      take(it->second.owner, bytes);
+      if (bytes < it->second.bytes)
+        it->second.bytes -= bytes;
+      else
+        ranges_.erase(it);
+    }
+
+    // Then upward.
+    while (end - begin < batch_bytes_) {
+      it = ranges_.find(end);
+      if (it == ranges_.end() || !mergeable(it)) break;
+
+      bytes = Min(it->second.bytes, batch_bytes_ - (end - begin));
+      take(it->second.owner, bytes);
+      if (bytes < it->second.bytes)
+        ranges_.emplace(end + bytes, Range(it->second.bytes - bytes, it->second.owner));
+      ranges_.erase(it);
+      end += bytes;
+    }
+
+    issued_begin_ = begin;
+    issued_end_ = end;
+    issued_node_ = node;
+  }
+
+  migrate_(reinterpret_cast<void*>(begin), end - begin, node);
+
+  std::vector<Prefetch*> done;
+  {
+    ScopedAcquire<KernelMutex> lock(&lock_);
+    issued_begin_ = issued_end_ = 0;
+    for (auto& part : batch) {
+      Prefetch* owner = part.first;
+      owner->in_flight -= part.second;
+      if (Done(owner) && std::find(done.begin(), done.end(), owner) == done.end()) {
+        Unqueue(owner);
+        done.push_back(owner);
+      }
+    }
+  }
+  Finish(done);
+  return true;
+}
+
+bool SvmPrefetch::Destination(uintptr_t base, uintptr_t end, uint32_t* node,
+                              std::vector<std::pair<uintptr_t, size_t>>* holes) {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  *node = kNoNode;
+
+  auto pending = [&](uint32_t dest) {
+    if (*node == kNoNode) *node = dest;
+    return *node == dest;
+  };
+
+  // Parts of a gap under the migration in flight are still pending.
+  auto gap = [&](uintptr_t gbase, uintptr_t gend) {
+    if (gbase >= gend) return true;
+    uintptr_t ibase = Max(gbase, issued_begin_);
+    uintptr_t iend = Min(gend, issued_end_);
+    if (ibase >= iend) {
+      holes->push_back(std::make_pair(gbase, gend - gbase));
+      return true;
+    }
+    if (gbase < ibase) holes->push_back(std::make_pair(gbase, ibase - gbase));
+    if (iend < gend) holes->push_back(std::make_pair(iend, gend - iend));
+    return pending(issued_node_);
+  };
+
+  auto it = ranges_.upper_bound(base);
+  if (it != ranges_.begin()) it--;
+
+  uintptr_t cursor = base;
+  for (; it != ranges_.end() && it->first < end; it++) {
+    uintptr_t ibase = Max(it->first, cursor);
+    uintptr_t iend = Min(it->first + it->second.bytes, end);
+    if (ibase >= iend) continue;
+
+    if (!gap(cursor, ibase)) return false;
+    if (!pending(it->second.owner->node)) return false;
+    cursor = iend;
+  }
+  return gap(cursor, end);
+}
+
+}  // namespace AMD
+}  // namespace rocr
@@ -0,0 +1,328 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/host_signal.h"
+
+#include "core/util/timer.h"
+
+namespace rocr {
+namespace core {
+
+int HostSignal::rtti_id_ = 0;
+
+HostSignal::HostSignal(hsa_signal_value_t initial_value)
+    : LocalSignal(initial_value, false), Signal(signal()), sequence_(0), sleepers_(0) {
+  signal_.kind = AMD_SIGNAL_KIND_USER;
+  signal_.event_mailbox_ptr = uint64_t(NULL);
+}
+
+hsa_signal_value_t HostSignal::LoadRelaxed() {
+  return hsa_signal_value_t(
+      atomic::Load(&signal_.value, std::memory_order_relaxed));
+}
+
+hsa_signal_value_t HostSignal::LoadAcquire() {
+  return hsa_signal_value_t(
+      atomic::Load(&signal_.value, std::memory_order_acquire));
+}
+
+void HostSignal::StoreRelaxed(hsa_signal_value_t value) {
+  atomic::Store(&signal_.value, int64_t(value), std::memory_order_relaxed);
+  Wake();
+}
+
+void HostSignal::StoreRelease(hsa_signal_value_t value) {
+  atomic::Store(&signal_.value, int64_t(value), std::memory_order_release);
+  Wake();
+}
+
+hsa_signal_value_t HostSignal::WaitRelaxed(hsa_signal_condition_t condition,
+                                           hsa_signal_value_t compare_value, uint64_t timeout,
+                                           hsa_wait_state_t wait_hint) {
+  Retain();
+  MAKE_SCOPE_GUARD([&]() { Release(); });
+
+  waiting_++;
+  MAKE_SCOPE_GUARD([&]() { waiting_--; });
+
+  int64_t value;
+
+  timer::fast_clock::time_point start_time = timer::fast_clock::now();
+
+  // Spin briefly before sleeping. Futex wakeups are cheap so this is much shorter than the
+  // polling window used for KFD events.
+  const timer::fast_clock::duration kMaxElapsed = std::chrono::microseconds(20);
+
+  uint64_t hsa_freq;
+  HSA::hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &hsa_freq);
+  const timer::fast_clock::duration fast_timeout =
+      timer::duration_from_seconds<timer::fast_clock::duration>(
+          double(timeout) / double(hsa_freq));
+
+  bool condition_met = false;
+
+  while (true) {
+    if (!IsValid()) return 0;
+
+    // Sample the sequence before the value so that an update after this point either is seen
+    // below or changes the sequence and prevents sleeping.
+    const uint32_t sequence = atomic::Load(&sequence_, std::memory_order_acquire);
+    value = atomic::Load(&signal_.value, std::memory_order_relaxed);
+
+    switch (condition) {
+      case HSA_SIGNAL_CONDITION_EQ: {
+        condition_met = (value == compare_value);
+        break;
+      }
+      case HSA_SIGNAL_CONDITION_NE: {
+        condition_met = (value != compare_value);
+        break;
+      }
+      case HSA_SIGNAL_CONDITION_GTE: {
+        condition_met = (value >= compare_value);
+        break;
+      }
+      case HSA_SIGNAL_CONDITION_LT: {
+        condition_met = (value < compare_value);
+        break;
+      }
+      default:
+        return 0;
+    }
+    if (condition_met) return hsa_signal_value_t(value);
+
+    timer::fast_clock::time_point time = timer::fast_clock::now();
+    if (time - start_time > fast_timeout) {
+      value = atomic::Load(&signal_.value, std::memory_order_relaxed);
+      return hsa_signal_value_t(value);
+    }
+
+    if (wait_hint == HSA_WAIT_STATE_ACTIVE) {
+      os::YieldThread();
+      continue;
+    }
+
+    if (time - start_time < kMaxElapsed) continue;
+
+    auto time_remaining = fast_timeout - (time - start_time);
+    uint64_t wait_ns = timer::duration_cast<std::chrono::nanoseconds>(time_remaining).count();
+
+    atomic::Increment(&sleepers_, std::memory_order_seq_cst);
+    os::FutexWait(&sequence_, sequence, wait_ns);
+    atomic::Decrement(&sleepers_, std::memory_order_seq_cst);
+  }
+}
+
+hsa_signal_value_t HostSignal::WaitAcquire(hsa_signal_condition_t condition,
+                                           hsa_signal_value_t compare_value, uint64_t timeout,
+                                           hsa_wait_state_t wait_hint) {
+  hsa_signal_value_t ret = WaitRelaxed(condition, compare_value, timeout, wait_hint);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return ret;
+}
+
+void HostSignal::AndRelaxed(hsa_signal_value_t value) {
+  atomic::And(&signal_.value, int64_t(value), std::memory_order_relaxed);
+  Wake();
+}
+
+void HostSignal::AndAcquire(hsa_signal_value_t value) {
+  atomic::And(&signal_.value, int64_t(value), std::memory_order_acquire);
+  Wake();
+}
+
+void HostSignal::AndRelease(hsa_signal_value_t value) {
+  atomic::And(&signal_.value, int64_t(value), std::memory_order_release);
+  Wake();
+}
+
+void HostSignal::AndAcqRel(hsa_signal_value_t value) {
+  atomic::And(&signal_.value, int64_t(value), std::memory_order_acq_rel);
+  Wake();
+}
+
+void HostSignal::OrRelaxed(hsa_signal_value_t value) {
+  atomic::Or(&signal_.value, int64_t(value), std::memory_order_relaxed);
+  Wake();
+}
+
+void HostSignal::OrAcquire(hsa_signal_value_t value) {
+  atomic::Or(&signal_.value, int64_t(value), std::memory_order_acquire);
+  Wake();
+}
+
+void HostSignal::OrRelease(hsa_signal_value_t value) {
+  atomic::Or(&signal_.value, int64_t(value), std::memory_order_release);
+  Wake();
+}
+
+void HostSignal::OrAcqRel(hsa_signal_value_t value) {
+  atomic::Or(&signal_.value, int64_t(value), std::memory_order_acq_rel);
+  Wake();
+}
+
+void HostSignal::XorRelaxed(hsa_signal_value_t value) {
+  atomic::Xor(&signal_.value, int64_t(value), std::memory_order_relaxed);
+  Wake();
+}
+
+void HostSignal::XorAcquire(hsa_signal_value_t value) {
+  atomic::Xor(&signal_.value, int64_t(value), std::memory_order_acquire);
+  Wake();
+}
+
+void HostSignal::XorRelease(hsa_signal_value_t value) {
+  atomic::Xor(&signal_.value, int64_t(value), std::memory_order_release);
+  Wake();
+}
+
+void HostSignal::XorAcqRel(hsa_signal_value_t value) {
+  atomic::Xor(&signal_.value, int64_t(value), std::memory_order_acq_rel);
+  Wake();
+}
+
+void HostSignal::AddRelaxed(hsa_signal_value_t value) {
+  atomic::Add(&signal_.value, int64_t(value), std::memory_order_relaxed);
+  Wake();
+}
+
+void HostSignal::AddAcquire(hsa_signal_value_t value) {
+  atomic::Add(&signal_.value, int64_t(value), std::memory_order_acquire);
+  Wake();
+}
+
+void HostSignal::AddRelease(hsa_signal_value_t value) {
+  atomic::Add(&signal_.value, int64_t(value), std::memory_order_release);
+  Wake();
+}
+
+void HostSignal::AddAcqRel(hsa_signal_value_t value) {
+  atomic::Add(&signal_.value, int64_t(value), std::memory_order_acq_rel);
+  Wake();
+}
+
+void HostSignal::SubRelaxed(hsa_signal_value_t value) {
+  atomic::Sub(&signal_.value, int64_t(value), std::memory_order_relaxed);
+  Wake();
+}
+
+void HostSignal::SubAcquire(hsa_signal_value_t value) {
+  atomic::Sub(&signal_.value, int64_t(value), std::memory_order_acquire);
+  Wake();
+}
+
+void HostSignal::SubRelease(hsa_signal_value_t value) {
+  atomic::Sub(&signal_.value, int64_t(value), std::memory_order_release);
+  Wake();
+}
+
+void HostSignal::SubAcqRel(hsa_signal_value_t value) {
+  atomic::Sub(&signal_.value, int64_t(value), std::memory_order_acq_rel);
+  Wake();
+}
+
+hsa_signal_value_t HostSignal::ExchRelaxed(hsa_signal_value_t value) {
+  hsa_signal_value_t ret = hsa_signal_value_t(atomic::Exchange(
+      &signal_.value, int64_t(value), std::memory_order_relaxed));
+  Wake();
+  return ret;
+}
+
+hsa_signal_value_t HostSignal::ExchAcquire(hsa_signal_value_t value) {
+  hsa_signal_value_t ret = hsa_signal_value_t(atomic::Exchange(
+      &signal_.value, int64_t(value), std::memory_order_acquire));
+  Wake();
+  return ret;
+}
+
+hsa_signal_value_t HostSignal::ExchRelease(hsa_signal_value_t value) {
+  hsa_signal_value_t ret = hsa_signal_value_t(atomic::Exchange(
+      &signal_.value, int64_t(value), std::memory_order_release));
+  Wake();
+  return ret;
+}
+
+hsa_signal_value_t HostSignal::ExchAcqRel(hsa_signal_value_t value) {
+  hsa_signal_value_t ret = hsa_signal_value_t(atomic::Exchange(
+      &signal_.value, int64_t(value), std::memory_order_acq_rel));
+  Wake();
+  return ret;
+}
+
+hsa_signal_value_t HostSignal::CasRelaxed(hsa_signal_value_t expected,
+                                          hsa_signal_value_t value) {
+  hsa_signal_value_t ret = hsa_signal_value_t(
+      atomic::Cas(&signal_.value, int64_t(value), int64_t(expected),
+                  std::memory_order_relaxed));
+  Wake();
+  return ret;
+}
+
+hsa_signal_value_t HostSignal::CasAcquire(hsa_signal_value_t expected,
+                                          hsa_signal_value_t value) {
+  hsa_signal_value_t ret = hsa_signal_value_t(
+      atomic::Cas(&signal_.value, int64_t(value), int64_t(expected),
+                  std::memory_order_acquire));
+  Wake();
+  return ret;
+}
+
+hsa_signal_value_t HostSignal::CasRelease(hsa_signal_value_t expected,
+                                          hsa_signal_value_t value) {
+  hsa_signal_value_t ret = hsa_signal_value_t(
+      atomic::Cas(&signal_.value, int64_t(value), int64_t(expected),
+                  std::memory_order_release));
+  Wake();
+  return ret;
+}
+
+hsa_signal_value_t HostSignal::CasAcqRel(hsa_signal_value_t expected,
+                                         hsa_signal_value_t value) {
+  hsa_signal_value_t ret = hsa_signal_value_t(
+      atomic::Cas(&signal_.value, int64_t(value), int64_t(expected),
+                  std::memory_order_acq_rel));
+  Wake();
+  return ret;
+}
+
+}  // namespace core
+}  // namespace rocr
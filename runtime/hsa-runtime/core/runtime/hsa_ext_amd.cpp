@@ -56,6 +56,7 @@
 #include "core/inc/amd_memory_region.h"
 #include "core/inc/default_signal.h"
 #include "core/inc/exceptions.h"
+#include "core/inc/host_signal.h"
 #include "core/inc/intercept_queue.h"
 #include "core/inc/interrupt_signal.h"
 #include "core/inc/ipc_signal.h"
@@ -292,6 +293,56 @@ hsa_status_t hsa_amd_memory_async_copy(void* dst, hsa_agent_t dst_agent_handle,
   CATCH;
 }
 
+hsa_status_t hsa_amd_memory_async_copy_batch(const hsa_amd_copy_desc_t* copies, size_t count,
+                                             hsa_agent_t dst_agent_handle,
+                                             hsa_agent_t src_agent_handle,
+                                             uint32_t num_dep_signals,
+                                             const hsa_signal_t* dep_signals,
+                                             hsa_signal_t completion_signal) {
+  TRY;
+  IS_OPEN();
+
+  if ((count != 0 && copies == nullptr) ||
+      (num_dep_signals == 0 && dep_signals != nullptr) ||
+      (num_dep_signals > 0 && dep_signals == nullptr)) {
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  core::Agent* dst_agent = core::Agent::Convert(dst_agent_handle);
+  IS_VALID(dst_agent);
+
+  core::Agent* src_agent = core::Agent::Convert(src_agent_handle);
+  IS_VALID(src_agent);
+
+  std::vector<core::Signal*> dep_signal_list(num_dep_signals);
+  for (size_t i = 0; i < num_dep_signals; ++i) {
+    core::Signal* dep_signal_obj = core::Signal::Convert(dep_signals[i]);
+    IS_VALID(dep_signal_obj);
+    dep_signal_list[i] = dep_signal_obj;
+  }
+
+  core::Signal* out_signal_obj = core::Signal::Convert(completion_signal);
+  IS_VALID(out_signal_obj);
+
+  std::vector<core::LinearCopyDesc> batch;
+  batch.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    IS_BAD_PTR(copies[i].dst);
+    IS_BAD_PTR(copies[i].src);
+    if (copies[i].size == 0) continue;
+    batch.push_back({copies[i].dst, copies[i].src, copies[i].size});
+  }
+
+  // Same as an empty hsa_amd_memory_async_copy, nothing is queued and the signal is untouched.
+  if (batch.empty()) return HSA_STATUS_SUCCESS;
+
+  bool rev_copy_dir = core::Runtime::runtime_singleton_->flag().rev_copy_dir();
+  return core::Runtime::runtime_singleton_->CopyMemoryBatch(
+      &batch[0], batch.size(), (rev_copy_dir ? src_agent : dst_agent),
+      (rev_copy_dir ? dst_agent : src_agent), dep_signal_list, *out_signal_obj);
+  CATCH;
+}
+
 hsa_status_t hsa_amd_memory_async_copy_on_engine(void* dst, hsa_agent_t dst_agent_handle,
                                        const void* src, hsa_agent_t src_agent_handle, size_t size,
                                        uint32_t num_dep_signals, const hsa_signal_t* dep_signals,
@@ -524,6 +575,14 @@ hsa_status_t hsa_amd_signal_create(hsa_signal_value_t initial_value, uint32_t nu
   core::Signal* ret;
 
   bool enable_ipc = attributes & HSA_AMD_SIGNAL_IPC;
+  if (attributes & HSA_AMD_SIGNAL_HOST_ONLY) {
+    if (enable_ipc || (attributes & HSA_AMD_SIGNAL_AMD_GPU_ONLY))
+      return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+    ret = new core::HostSignal(initial_value);
+    *hsa_signal = core::Signal::Convert(ret);
+    return HSA_STATUS_SUCCESS;
+  }
+
   bool use_default =
       enable_ipc || (attributes & HSA_AMD_SIGNAL_AMD_GPU_ONLY) || (!core::g_use_interrupt_wait);
 
@@ -601,6 +660,7 @@ hsa_status_t hsa_amd_signal_async_handler(hsa_signal_t hsa_signal, hsa_signal_co
   IS_VALID(signal);
   if (core::g_use_interrupt_wait && (!core::InterruptSignal::IsType(signal)))
     return HSA_STATUS_ERROR_INVALID_SIGNAL;
+  if (core::HostSignal::IsType(signal)) return HSA_STATUS_ERROR_INVALID_SIGNAL;
   return core::Runtime::runtime_singleton_->SetAsyncSignalHandler(
       hsa_signal, cond, value, handler, arg);
   CATCH;
@@ -672,6 +732,8 @@ hsa_status_t hsa_amd_memory_lock(void* host_ptr, size_t size,
   const AMD::MemoryRegion* system_region = static_cast<const AMD::MemoryRegion*>(
       core::Runtime::runtime_singleton_->system_regions_coarse()[0]);
 
+  // hsa_memory_copy's classifications of the range change once it is locked.
+  core::Runtime::runtime_singleton_->InvalidateCopyCaches(host_ptr, size);
   return system_region->Lock(num_agent, agents, host_ptr, size, agent_ptr);
   CATCH;
 }
@@ -700,6 +762,7 @@ hsa_status_t hsa_amd_memory_lock_to_pool(void* host_ptr, size_t size, hsa_agent_
   if (mem_region->owner()->device_type() != core::Agent::kAmdCpuDevice)
     return (hsa_status_t)HSA_STATUS_ERROR_INVALID_MEMORY_POOL;
 
+  core::Runtime::runtime_singleton_->InvalidateCopyCaches(host_ptr, size);
   return mem_region->Lock(num_agent, agents, host_ptr, size, agent_ptr);
   CATCH;
 }
@@ -712,7 +775,9 @@ hsa_status_t hsa_amd_memory_unlock(void* host_ptr) {
       reinterpret_cast<const AMD::MemoryRegion*>(
           core::Runtime::runtime_singleton_->system_regions_fine()[0]);
 
-  return system_region->Unlock(host_ptr);
+  hsa_status_t err = system_region->Unlock(host_ptr);
+  core::Runtime::runtime_singleton_->InvalidateCopyCaches(host_ptr, 0);
+  return err;
   CATCH;
 }
 
@@ -792,6 +857,18 @@ hsa_status_t hsa_amd_memory_pool_allocate(hsa_amd_memory_pool_t memory_pool, siz
   if (flags & HSA_AMD_MEMORY_POOL_CONTIGUOUS_FLAG)
     alloc_flag |= core::MemoryRegion::AllocateContiguous;
 
+  const uint32_t numa_flags = flags & (HSA_AMD_MEMORY_POOL_NUMA_INTERLEAVE_FLAG |
+                                       HSA_AMD_MEMORY_POOL_NUMA_BIND_FLAG |
+                                       HSA_AMD_MEMORY_POOL_NUMA_LOCAL_FLAG);
+  if ((numa_flags & (numa_flags - 1)) != 0) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+
+  if (flags & HSA_AMD_MEMORY_POOL_NUMA_INTERLEAVE_FLAG)
+    alloc_flag |= core::MemoryRegion::AllocateNumaInterleave;
+  else if (flags & HSA_AMD_MEMORY_POOL_NUMA_BIND_FLAG)
+    alloc_flag |= core::MemoryRegion::AllocateNumaBind;
+  else if (flags & HSA_AMD_MEMORY_POOL_NUMA_LOCAL_FLAG)
+    alloc_flag |= core::MemoryRegion::AllocateNumaLocal;
+
 #ifdef SANITIZER_AMDGPU
   alloc_flag |= core::MemoryRegion::AllocateAsan;
 #endif
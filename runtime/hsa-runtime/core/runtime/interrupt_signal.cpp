@@ -53,27 +53,62 @@
 namespace rocr {
 namespace core {
 
-HsaEvent* InterruptSignal::EventPool::alloc() {
+HsaEvent* InterruptSignal::EventPool::alloc(const void* key) {
   ScopedAcquire<HybridMutex> lock(&lock_);
-  if (events_.empty()) {
-    if (!allEventsAllocated) {
-      HsaEvent* evt = InterruptSignal::CreateEvent(HSA_EVENTTYPE_SIGNAL, false);
-      if (evt == nullptr) allEventsAllocated = true;
-      return evt;
-    }
-    return nullptr;
+  if (!events_.empty()) {
+    HsaEvent* ret = events_.back().release();
+    events_.pop_back();
+    return Activate(ret);
   }
-  HsaEvent* ret = events_.back().release();
-  events_.pop_back();
-  return ret;
+
+  const bool can_share = !active_.empty() &&
+      Runtime::runtime_singleton_->KfdVersion().supports_event_age;
+  const size_t ratio = Runtime::runtime_singleton_->flag().signal_event_share_ratio();
+  if (can_share && (users_ < active_.size() * ratio)) return Share(key);
+
+  if (!allEventsAllocated) {
+    HsaEvent* evt = InterruptSignal::CreateEvent(HSA_EVENTTYPE_SIGNAL, false);
+    if (evt != nullptr) return Activate(evt);
+    allEventsAllocated = true;
+  }
+  return can_share ? Share(key) : nullptr;
 }
 
 void InterruptSignal::EventPool::free(HsaEvent* evt) {
   if (evt == nullptr) return;
   ScopedAcquire<HybridMutex> lock(&lock_);
+  auto it = refs_.find(evt);
+  if (it != refs_.end()) {
+    users_--;
+    if (--it->second.count != 0) return;
+
+    // Last signal using the event, move it to the idle list.
+    const size_t index = it->second.index;
+    active_[index] = active_.back();
+    refs_[active_[index]].index = index;
+    active_.pop_back();
+    refs_.erase(evt);
+  }
   events_.push_back(unique_event_ptr(evt));
 }
 
+HsaEvent* InterruptSignal::EventPool::Activate(HsaEvent* evt) {
+  Ref ref = {1, active_.size()};
+  refs_[evt] = ref;
+  active_.push_back(evt);
+  users_++;
+  return evt;
+}
+
+HsaEvent* InterruptSignal::EventPool::Share(const void* key) {
+  // Fibonacci hash, signal addresses are aligned so low bits carry little information.
+  const uint64_t hash = (uint64_t(uintptr_t(key)) >> 4) * 0x9E3779B97F4A7C15ull;
+  HsaEvent* evt = active_[(hash >> 32) % active_.size()];
+  refs_[evt].count++;
+  users_++;
+  return evt;
+}
+
 int InterruptSignal::rtti_id_ = 0;
 
 HsaEvent* InterruptSignal::CreateEvent(HSA_EVENTTYPE type, bool manual_reset) {
@@ -105,7 +140,7 @@ InterruptSignal::InterruptSignal(hsa_signal_value_t initial_value, HsaEvent* use
     event_ = use_event;
     free_event_ = false;
   } else {
-    event_ = Runtime::runtime_singleton_->GetEventPool()->alloc();
+    event_ = Runtime::runtime_singleton_->GetEventPool()->alloc(this);
     free_event_ = true;
   }
 
@@ -67,6 +67,7 @@
 #include "core/inc/hsa_ext_interface.h"
 #include "core/inc/amd_cpu_agent.h"
 #include "core/inc/amd_gpu_agent.h"
+#include "core/inc/amd_ipc_fragment.h"
 #include "core/inc/amd_memory_region.h"
 #include "core/inc/amd_topology.h"
 #include "core/inc/signal.h"
@@ -106,8 +107,23 @@ Runtime* Runtime::runtime_singleton_ = NULL;
 
 KernelMutex Runtime::bootstrap_lock_;
 
+// Starts at 1 so zero initialized CopyPtrCache entries never match.
+std::atomic<uint64_t> Runtime::copy_cache_generation_(1);
+
 static bool loaded = true;
 
+// Recent hsa_memory_copy pointer classifications for the calling thread.
+struct CopyPtrClass {
+  uintptr_t base;
+  size_t size;
+  Agent* agent;
+  bool system;
+  uint64_t generation;
+};
+static const uint32_t kCopyPtrCacheEntries = 4;
+static thread_local CopyPtrClass CopyPtrCache[kCopyPtrCacheEntries];
+static thread_local uint32_t CopyPtrCacheNext = 0;
+
 class RuntimeCleanup {
  public:
   ~RuntimeCleanup() {
@@ -380,6 +396,7 @@ hsa_status_t Runtime::FreeMemory(void* ptr) {
 
     allocation_map_.erase(it);
   }
+  InvalidateCopyCaches(ptr, size);
 
   // Notifiers can't run while holding the lock or the callback won't be able to manage memory.
   // The memory triggering the notification has already been removed from the memory map so can't
@@ -498,33 +515,9 @@ hsa_status_t Runtime::CopyMemory(void* dst, const void* src, size_t size) {
   core::Agent* src_agent;
   core::Agent* dst_agent;
 
-  // Fetch ownership
-  const auto& is_system_mem = [&](void* ptr, core::Agent*& agent, bool& need_lock) {
-    hsa_amd_pointer_info_t info;
-    uint32_t count;
-    hsa_agent_t* accessible = nullptr;
-    MAKE_SCOPE_GUARD([&]() { free(accessible); });
-    info.size = sizeof(info);
-    hsa_status_t err = PtrInfo(ptr, &info, malloc, &count, &accessible);
-    if (err != HSA_STATUS_SUCCESS)
-      throw AMD::hsa_exception(err, "PtrInfo failed in hsa_memory_copy.");
-    ptrdiff_t endPtr = (ptrdiff_t)ptr + size;
-    if (info.agentBaseAddress <= ptr &&
-        endPtr <= (ptrdiff_t)info.agentBaseAddress + info.sizeInBytes) {
-      if (info.agentOwner.handle == 0) info.agentOwner = accessible[0];
-      agent = core::Agent::Convert(info.agentOwner);
-      need_lock = false;
-      return agent->device_type() != core::Agent::DeviceType::kAmdGpuDevice;
-    } else {
-      need_lock = true;
-      agent = cpu_agents_[0];
-      return true;
-    }
-  };
-
   bool src_lock, dst_lock;
-  is_src_system = is_system_mem(source, src_agent, src_lock);
-  is_dst_system = is_system_mem(dst, dst_agent, dst_lock);
+  is_src_system = ClassifyCopyPtr(source, size, src_agent, src_lock);
+  is_dst_system = ClassifyCopyPtr(dst, size, dst_agent, dst_lock);
 
   // CPU-CPU
   if (is_src_system && is_dst_system) {
@@ -540,9 +533,21 @@ hsa_status_t Runtime::CopyMemory(void* dst, const void* src, size_t size) {
   const AMD::MemoryRegion* system_region =
       static_cast<const AMD::MemoryRegion*>(system_regions_fine_[0]);
 
+  CopyPin* pin = nullptr;
   void* gpuPtr = nullptr;
+  bool staged = false;
   const auto& locked_copy = [&](void*& ptr, core::Agent* locking_agent) {
     void* tmp;
+    pin = AcquireCopyPin(ptr, size, &tmp);
+    if (pin != nullptr) {
+      ptr = tmp;
+      return;
+    }
+    // Bounce through pinned buffers when that is estimated to beat pinning the range.
+    if (staged_copy_->Preferred(size)) {
+      staged = true;
+      return;
+    }
     hsa_agent_t agent = locking_agent->public_handle();
     hsa_status_t err = system_region->Lock(1, &agent, ptr, size, &tmp);
     if (err != HSA_STATUS_SUCCESS) throw AMD::hsa_exception(err, "Lock failed in hsa_memory_copy.");
@@ -551,11 +556,16 @@ hsa_status_t Runtime::CopyMemory(void* dst, const void* src, size_t size) {
   };
 
   MAKE_SCOPE_GUARD([&]() {
+    if (pin != nullptr) ReleaseCopyPin(pin);
     if (gpuPtr != nullptr) system_region->Unlock(gpuPtr);
   });
 
   if (src_lock) locked_copy(source, dst_agent);
   if (dst_lock) locked_copy(dst, src_agent);
+  if (staged) {
+    if (src_lock) return staged_copy_->Copy(dst, source, size, dst_agent, true);
+    return staged_copy_->Copy(dst, source, size, src_agent, false);
+  }
   if (is_src_system) return dst_agent->DmaCopy(dst, source, size);
   if (is_dst_system) return src_agent->DmaCopy(dst, source, size);
 
@@ -574,35 +584,251 @@ hsa_status_t Runtime::CopyMemory(void* dst, const void* src, size_t size) {
   return err;
 }
 
+bool Runtime::ClassifyCopyPtr(const void* ptr, size_t size, core::Agent*& agent,
+                              bool& need_lock) {
+  const uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+  const uintptr_t end = start + size;
+
+  // Read the generation before PtrInfo so a concurrent invalidation can't be missed.
+  const uint64_t generation = copy_cache_generation_.load(std::memory_order_acquire);
+  for (const auto& entry : CopyPtrCache) {
+    if ((entry.generation == generation) && (entry.size != 0) && (entry.base <= start) &&
+        (end <= entry.base + entry.size)) {
+      agent = entry.agent;
+      need_lock = false;
+      return entry.system;
+    }
+  }
+
+  // The accessible agent list is only needed when the owning node has no agent in this process.
+  hsa_amd_pointer_info_t info;
+  info.size = sizeof(info);
+  hsa_status_t err = PtrInfo(ptr, &info, nullptr, nullptr, nullptr);
+  if (err != HSA_STATUS_SUCCESS)
+    throw AMD::hsa_exception(err, "PtrInfo failed in hsa_memory_copy.");
+
+  const uintptr_t base = reinterpret_cast<uintptr_t>(info.agentBaseAddress);
+  if ((info.type == HSA_EXT_POINTER_TYPE_UNKNOWN) || (start < base) ||
+      (base + info.sizeInBytes < end)) {
+    need_lock = true;
+    agent = cpu_agents_[0];
+    return true;
+  }
+
+  if (info.agentOwner.handle == 0) {
+    uint32_t count;
+    hsa_agent_t* accessible = nullptr;
+    MAKE_SCOPE_GUARD([&]() { free(accessible); });
+    err = PtrInfo(ptr, &info, malloc, &count, &accessible);
+    if (err != HSA_STATUS_SUCCESS)
+      throw AMD::hsa_exception(err, "PtrInfo failed in hsa_memory_copy.");
+    info.agentOwner = accessible[0];
+  }
+
+  agent = core::Agent::Convert(info.agentOwner);
+  need_lock = false;
+  const bool system = agent->device_type() != core::Agent::DeviceType::kAmdGpuDevice;
+
+  CopyPtrClass& entry = CopyPtrCache[CopyPtrCacheNext];
+  CopyPtrCacheNext = (CopyPtrCacheNext + 1) % kCopyPtrCacheEntries;
+  entry.base = base;
+  entry.size = info.sizeInBytes;
+  entry.agent = agent;
+  entry.system = system;
+  entry.generation = generation;
+  return system;
+}
+
+Runtime::CopyPin* Runtime::AcquireCopyPin(void* ptr, size_t size, void** agent_ptr) {
+  const size_t budget = flag_.copy_pin_cache_size();
+  const uintptr_t base = AlignDown(reinterpret_cast<uintptr_t>(ptr), 4096);
+  const uintptr_t end = AlignUp(reinterpret_cast<uintptr_t>(ptr) + size, 4096);
+  const size_t bytes = end - base;
+  if (bytes > budget) return nullptr;
+
+  std::list<CopyPin> evicted;
+  MAKE_SCOPE_GUARD([&]() { UnlockCopyPins(evicted); });
+
+  {
+    ScopedAcquire<KernelMutex> lock(&copy_pin_lock_);
+    for (auto it = copy_pins_.begin(); it != copy_pins_.end(); it++) {
+      if (!it->stale && (it->base <= base) && (end <= it->base + it->size)) {
+        it->users++;
+        copy_pins_.splice(copy_pins_.begin(), copy_pins_, it);
+        *agent_ptr = reinterpret_cast<uint8_t*>(it->agent_ptr) +
+            (reinterpret_cast<uintptr_t>(ptr) - it->base);
+        return &copy_pins_.front();
+      }
+    }
+
+    // Make room from the least recently used end. Pins in use can't be dropped.
+    auto it = copy_pins_.end();
+    while ((copy_pin_bytes_ + bytes > budget) && (it != copy_pins_.begin())) {
+      auto victim = std::prev(it);
+      if (victim->users != 0) {
+        it = victim;
+        continue;
+      }
+      copy_pin_bytes_ -= victim->size;
+      evicted.splice(evicted.end(), copy_pins_, victim);
+    }
+    if (copy_pin_bytes_ + bytes > budget) return nullptr;
+    // Reserve the space while locking without the mutex held.
+    copy_pin_bytes_ += bytes;
+  }
+
+  // Lock to all GPUs so the pin serves copies from any of them.
+  const AMD::MemoryRegion* system_region =
+      static_cast<const AMD::MemoryRegion*>(system_regions_fine_[0]);
+  void* tmp;
+  hsa_status_t err = system_region->Lock(0, nullptr, reinterpret_cast<void*>(base), bytes, &tmp);
+
+  ScopedAcquire<KernelMutex> lock(&copy_pin_lock_);
+  if (err != HSA_STATUS_SUCCESS) {
+    copy_pin_bytes_ -= bytes;
+    return nullptr;
+  }
+  CopyPin pin = {base, bytes, tmp, 1, false};
+  copy_pins_.push_front(pin);
+  *agent_ptr = reinterpret_cast<uint8_t*>(tmp) + (reinterpret_cast<uintptr_t>(ptr) - base);
+  return &copy_pins_.front();
+}
+
+void Runtime::ReleaseCopyPin(CopyPin* pin) {
+  std::list<CopyPin> released;
+  {
+    ScopedAcquire<KernelMutex> lock(&copy_pin_lock_);
+    assert(pin->users != 0 && "Copy pin released too many times.");
+    pin->users--;
+    if ((pin->users != 0) || !pin->stale) return;
+    for (auto it = copy_pins_.begin(); it != copy_pins_.end(); it++) {
+      if (&*it == pin) {
+        copy_pin_bytes_ -= pin->size;
+        released.splice(released.end(), copy_pins_, it);
+        break;
+      }
+    }
+  }
+  UnlockCopyPins(released);
+}
+
+void Runtime::UnlockCopyPins(std::list<CopyPin>& pins) {
+  if (pins.empty()) return;
+  const AMD::MemoryRegion* system_region =
+      static_cast<const AMD::MemoryRegion*>(system_regions_fine_[0]);
+  for (auto& pin : pins) system_region->Unlock(reinterpret_cast<void*>(pin.base));
+  pins.clear();
+  // Threads may have classified the ranges as locked memory. Bump only after unlocking so that
+  // no classification can be cached against the new generation while the pins still exist.
+  copy_cache_generation_++;
+}
+
+void Runtime::InvalidateCopyCaches(const void* ptr, size_t size) {
+  const uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+  const uintptr_t end = start + Max(size, size_t(1));
+  std::list<CopyPin> released;
+  {
+    ScopedAcquire<KernelMutex> lock(&copy_pin_lock_);
+    for (auto it = copy_pins_.begin(); it != copy_pins_.end();) {
+      auto cur = it++;
+      if ((end <= cur->base) || (cur->base + cur->size <= start)) continue;
+      if (cur->users != 0) {
+        cur->stale = true;
+        continue;
+      }
+      copy_pin_bytes_ -= cur->size;
+      released.splice(released.end(), copy_pins_, cur);
+    }
+  }
+  UnlockCopyPins(released);
+  copy_cache_generation_++;
+}
+
+void Runtime::FlushCopyPins() {
+  std::list<CopyPin> released;
+  {
+    ScopedAcquire<KernelMutex> lock(&copy_pin_lock_);
+    assert(std::all_of(copy_pins_.begin(), copy_pins_.end(),
+                       [](const CopyPin& pin) { return pin.users == 0; }) &&
+           "Copy pin in use at shutdown.");
+    released.swap(copy_pins_);
+    copy_pin_bytes_ = 0;
+  }
+  UnlockCopyPins(released);
+  copy_cache_generation_++;
+}
+
 hsa_status_t Runtime::CopyMemory(void* dst, core::Agent* dst_agent, const void* src,
                                  core::Agent* src_agent, size_t size,
                                  std::vector<core::Signal*>& dep_signals,
                                  core::Signal& completion_signal) {
-  auto lookupAgent = [this](core::Agent* agent, const void* ptr) {
-    hsa_amd_pointer_info_t info;
-    PtrInfoBlockData block;
-    info.size = sizeof(info);
-    PtrInfo(ptr, &info, nullptr, nullptr, nullptr, &block);
-    // Limit to IPC and GFX types for now.  These are the only types for which the application may
-    // not posess a proper agent handle.
-    if ((info.type != HSA_EXT_POINTER_TYPE_IPC) && (info.type != HSA_EXT_POINTER_TYPE_GRAPHICS)) {
-      return agent;
-    }
-    return block.agentOwner;
-  };
-
   const bool src_gpu = (src_agent->device_type() == core::Agent::DeviceType::kAmdGpuDevice);
   core::Agent* copy_agent = (src_gpu) ? src_agent : dst_agent;
 
   // Lookup owning agent if blit kernel is selected or if flag override is set.
   if ((dst_agent == src_agent) || flag().discover_copy_agents()) {
-    dst_agent = lookupAgent(dst_agent, dst);
-    src_agent = lookupAgent(src_agent, src);
+    dst_agent = CopyOwnerAgent(dst_agent, dst);
+    src_agent = CopyOwnerAgent(src_agent, src);
   }
   return copy_agent->DmaCopy(dst, *dst_agent, src, *src_agent, size, dep_signals,
                              completion_signal);
 }
 
+hsa_status_t Runtime::CopyMemoryBatch(const core::LinearCopyDesc* copies, size_t count,
+                                      core::Agent* dst_agent, core::Agent* src_agent,
+                                      std::vector<core::Signal*>& dep_signals,
+                                      core::Signal& completion_signal) {
+  assert(count != 0 && "Empty copy batch.");
+  const bool src_gpu = (src_agent->device_type() == core::Agent::DeviceType::kAmdGpuDevice);
+  core::Agent* copy_agent = (src_gpu) ? src_agent : dst_agent;
+
+  // Issue the copies one by one, each retiring one signal count.
+  auto copyEach = [&]() {
+    completion_signal.AddRelaxed(static_cast<hsa_signal_value_t>(count - 1));
+    for (size_t i = 0; i < count; ++i) {
+      hsa_status_t stat = CopyMemory(copies[i].dst, dst_agent, copies[i].src, src_agent,
+                                     copies[i].size, dep_signals, completion_signal);
+      if (stat != HSA_STATUS_SUCCESS) {
+        // Release the counts owned by copies that were never submitted.
+        completion_signal.SubRelaxed(static_cast<hsa_signal_value_t>(count - 1 - i));
+        return stat;
+      }
+    }
+    return HSA_STATUS_SUCCESS;
+  };
+
+  // Only GPU copy engines take a batch as one command stream.
+  if (copy_agent->device_type() != core::Agent::DeviceType::kAmdGpuDevice) return copyEach();
+
+  // Every copy in a batch must resolve to the same owners.
+  if ((dst_agent == src_agent) || flag().discover_copy_agents()) {
+    core::Agent* dst_owner = CopyOwnerAgent(dst_agent, copies[0].dst);
+    core::Agent* src_owner = CopyOwnerAgent(src_agent, copies[0].src);
+    for (size_t i = 1; i < count; ++i) {
+      if ((CopyOwnerAgent(dst_agent, copies[i].dst) != dst_owner) ||
+          (CopyOwnerAgent(src_agent, copies[i].src) != src_owner))
+        return copyEach();
+    }
+    dst_agent = dst_owner;
+    src_agent = src_owner;
+  }
+  return copy_agent->DmaCopyBatch(copies, count, *dst_agent, *src_agent, dep_signals,
+                                  completion_signal);
+}
+
+core::Agent* Runtime::CopyOwnerAgent(core::Agent* agent, const void* ptr) {
+  hsa_amd_pointer_info_t info;
+  PtrInfoBlockData block;
+  info.size = sizeof(info);
+  PtrInfo(ptr, &info, nullptr, nullptr, nullptr, &block);
+  // Limit to IPC and GFX types for now.  These are the only types for which the application may
+  // not posess a proper agent handle.
+  if ((info.type != HSA_EXT_POINTER_TYPE_IPC) && (info.type != HSA_EXT_POINTER_TYPE_GRAPHICS)) {
+    return agent;
+  }
+  return block.agentOwner;
+}
+
 hsa_status_t Runtime::CopyMemoryOnEngine(void* dst, core::Agent* dst_agent, const void* src,
                                  core::Agent* src_agent, size_t size,
                                  std::vector<core::Signal*>& dep_signals,
@@ -683,6 +909,7 @@ hsa_status_t Runtime::AllowAccess(uint32_t num_agents,
     std::map<const void*, AllocationRegion>::const_iterator it = allocation_map_.find(ptr);
 
     if (it == allocation_map_.end()) {
+      lock.Release();
       /* See if this address was mapped via VMM */
       return VMemoryMapAllowAccess(ptr, HSA_ACCESS_PERMISSION_RW, agents,
                                    num_agents);
@@ -816,6 +1043,18 @@ hsa_status_t Runtime::GetSystemInfo(hsa_system_info_t attribute, void* value) {
       *((uint16_t*)value) = HSA_AMD_INTERFACE_VERSION_MINOR;
       break;
     }
+    case HSA_AMD_SYSTEM_INFO_LOCK_CACHE_HITS: {
+      *((uint64_t*)value) = pin_registry_->hits();
+      break;
+    }
+    case HSA_AMD_SYSTEM_INFO_LOCK_CACHE_MISSES: {
+      *((uint64_t*)value) = pin_registry_->misses();
+      break;
+    }
+    case HSA_AMD_SYSTEM_INFO_LOCK_CACHE_SIZE: {
+      *((size_t*)value) = pin_registry_->cached_bytes();
+      break;
+    }
     default:
       return HSA_STATUS_ERROR_INVALID_ARGUMENT;
   }
@@ -927,6 +1166,7 @@ hsa_status_t Runtime::InteropUnmap(void* ptr) {
     return HSA_STATUS_ERROR_INVALID_ARGUMENT;
   if(hsaKmtDeregisterMemory(ptr)!=HSAKMT_STATUS_SUCCESS)
     return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  InvalidateCopyCaches(ptr, 0);
   return HSA_STATUS_SUCCESS;
 }
 
@@ -1229,13 +1469,16 @@ hsa_status_t Runtime::IPCCreate(void* ptr, size_t len, hsa_amd_ipc_memory_t* han
 
   bool useFrag = (block.base != ptr || block.length != len);
   // Assume all pointers and blocks are 4Kb aligned.
-  uint32_t fragOffset = (reinterpret_cast<uint8_t*>(ptr) -
-                         reinterpret_cast<uint8_t*>(block.base))/pageSize;
+  size_t fragOffset = reinterpret_cast<uint8_t*>(ptr) - reinterpret_cast<uint8_t*>(block.base);
   if (useFrag) {
     if (!IsMultipleOf(block.base, 2 * 1024 * 1024)) {
       assert(false && "Fragment's block not aligned to 2MB!");
       return HSA_STATUS_ERROR_INVALID_ARGUMENT;
     }
+    if (fragOffset >= AMD::IpcFragment::kMaxBlockSize) {
+      assert(false && "Fragment offset exceeds IPC handle encoding!");
+      return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+    }
   }
 
   if (!ipc_dmabuf_supported_) {
@@ -1245,7 +1488,8 @@ hsa_status_t Runtime::IPCCreate(void* ptr, size_t len, hsa_amd_ipc_memory_t* han
 
     hsa_status_t err = HSA_STATUS_SUCCESS;
     if (useFrag) {
-      handle->handle[6] |= 0x80000000 | fragOffset;
+      if (!AMD::IpcFragment::Encode(fragOffset, handle->handle[6]))
+        return HSA_STATUS_ERROR_INVALID_ARGUMENT;
       // Prevent realloction of fragment for better performance.
       ScopedAcquire<KernelSharedMutex::Shared> lock(memory_lock_.shared());
       err = allocation_map_[ptr].region->IPCFragmentExport(ptr);
@@ -1266,7 +1510,8 @@ hsa_status_t Runtime::IPCCreate(void* ptr, size_t len, hsa_amd_ipc_memory_t* han
   // System sub allocations are not supported for now.
   if (handle->handle[3] && useFrag) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
   handle->handle[4] = agent->node_id();
-  if (useFrag) handle->handle[6] |= 0x80000000 | fragOffset;
+  if (useFrag && !AMD::IpcFragment::Encode(fragOffset, handle->handle[6]))
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
 
   // Work around to defer export on import call to minimize FD creation.
   // Without this, a deferred export may fail due to the kernel mode driver not
@@ -1276,7 +1521,7 @@ hsa_status_t Runtime::IPCCreate(void* ptr, size_t len, hsa_amd_ipc_memory_t* han
   int dmabuf_fd;
   uint64_t dmabufOffset;
   HSAKMT_STATUS err = hsaKmtExportDMABufHandle(ptr, len, &dmabuf_fd, &dmabufOffset);
-  assert(dmabufOffset/pageSize == fragOffset && "DMA Buf inconsistent with pointer offset.");
+  assert(dmabufOffset == fragOffset && "DMA Buf inconsistent with pointer offset.");
   if (err != HSAKMT_STATUS_SUCCESS) return HSA_STATUS_ERROR;
   close(dmabuf_fd);
 
@@ -1396,7 +1641,7 @@ hsa_status_t Runtime::IPCAttach(const hsa_amd_ipc_memory_t* handle, size_t len,
 
   // Extract fragment info
   bool isFragment = false;
-  uint32_t fragOffset = 0;
+  size_t fragOffset = 0;
 
   auto fixFragment = [&](amdgpu_bo_handle ldrm_bo) {
     if (isFragment) {
@@ -1447,11 +1692,7 @@ hsa_status_t Runtime::IPCAttach(const hsa_amd_ipc_memory_t* handle, size_t len,
     return HSA_STATUS_SUCCESS;
   };
 
-  if ((importHandle.handle[6] & 0x80000000) != 0) {
-    isFragment = true;
-    fragOffset = (importHandle.handle[6] & 0x1FF) * 4096;
-    importHandle.handle[6] &= ~(0x80000000 | 0x1FF);
-  }
+  isFragment = AMD::IpcFragment::Decode(importHandle.handle[6], fragOffset);
 
   if (ipc_dmabuf_supported_) {
     uint64_t dmaBufFDHandleLo = importHandle.handle[0];
@@ -1553,6 +1794,7 @@ hsa_status_t Runtime::IPCDetach(void* ptr) {
     if (hsaKmtDeregisterMemory(ptr) != HSAKMT_STATUS_SUCCESS)
       return HSA_STATUS_ERROR_INVALID_ARGUMENT;
   }
+  InvalidateCopyCaches(ptr, 0);
   return HSA_STATUS_SUCCESS;
 }
 
@@ -1879,9 +2121,15 @@ bool Runtime::VMFaultHandler(hsa_signal_value_t val, void* arg) {
     if (faulty_agent && faulty_agent->isa()->GetMajorVersion() != 11 &&
         !runtime_singleton_->KfdVersion().supports_core_dump) {
 
+      amd::coredump::DumpOptions options;
+      options.threads = runtime_singleton_->flag().coredump_threads();
+      options.sparse = runtime_singleton_->flag().coredump_sparse();
+      options.compress = runtime_singleton_->flag().coredump_compress();
+      options.pipe_command = runtime_singleton_->flag().coredump_pipe();
+
       if (pcs::PcsRuntime::instance()->SessionsActive())
         fprintf(stderr, "GPU core dump skipped because PC Sampling active\n");
-      else if (amd::coredump::dump_gpu_core())
+      else if (amd::coredump::dump_gpu_core(options))
         fprintf(stderr, "GPU core dump failed\n");
     }
     assert(false && "GPU memory access fault.");
@@ -1942,7 +2190,8 @@ void Runtime::PrintMemoryMapNear(void* ptr) {
 }
 
 Runtime::Runtime()
-    : region_gpu_(nullptr),
+    : copy_pin_bytes_(0),
+      region_gpu_(nullptr),
       sys_clock_freq_(0),
       vm_fault_event_(nullptr),
       vm_fault_signal_(nullptr),
@@ -2010,6 +2259,31 @@ hsa_status_t Runtime::Load() {
   // Load svm profiler
   svm_profile_.reset(new AMD::SvmProfileControl);
 
+  pin_registry_.reset(new AMD::PinRegistry(
+      [](const void* owner, void* base, size_t size, const std::vector<uint32_t>& nodes,
+         void** agent_base) {
+        return static_cast<const AMD::MemoryRegion*>(owner)->Pin(base, size, nodes, agent_base);
+      },
+      [](const void* owner, void* base) {
+        static_cast<const AMD::MemoryRegion*>(owner)->Unpin(base);
+      },
+      flag().lock_cache_size()));
+
+  svm_prefetch_.reset(new AMD::SvmPrefetch(
+      [](void* base, size_t size, uint32_t node) {
+        HSA_SVM_ATTRIBUTE attrib;
+        attrib.type = HSA_SVM_ATTR_PREFETCH_LOC;
+        attrib.value = node;
+        HSAKMT_STATUS error = hsaKmtSVMSetAttr(base, size, 1, &attrib);
+        assert(error == HSAKMT_STATUS_SUCCESS && "KFD Prefetch failed.");
+      },
+      [](hsa_signal_t completion) {
+        if (completion.handle != 0) Signal::Convert(completion)->SubRelaxed(1);
+      },
+      flag().svm_prefetch_batch_size()));
+
+  staged_copy_.reset(new AMD::StagedCopy);
+
   return HSA_STATUS_SUCCESS;
 }
 
@@ -2021,6 +2295,11 @@ void Runtime::Unload() {
 
   svm_profile_.reset(nullptr);
 
+  FlushCopyPins();
+  staged_copy_.reset(nullptr);
+  // Copy pins hold registry locks, release what's left only after them.
+  pin_registry_.reset(nullptr);
+
   UnloadTools();
   UnloadExtensions();
 
@@ -2036,6 +2315,9 @@ void Runtime::Unload() {
   asyncSignals_.control.Shutdown();
   asyncExceptions_.control.Shutdown();
 
+  // No dependency handlers remain to mark prefetches ready.
+  svm_prefetch_.reset(nullptr);
+
   if (vm_fault_signal_ != nullptr) {
     vm_fault_signal_->DestroySignal();
     vm_fault_signal_ = nullptr;
@@ -2060,6 +2342,8 @@ void Runtime::Unload() {
 
   DestroyDrivers();
 
+  AsyncLogger::Stop();
+
   AMD::Unload();
 }
 
@@ -2808,18 +3092,20 @@ hsa_status_t Runtime::SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent,
   uintptr_t end = AlignUp(reinterpret_cast<uintptr_t>(ptr) + size, 4096);
   size_t len = end - base;
 
+  if (!svm_prefetch_->Start())
+    throw AMD::hsa_exception(HSA_STATUS_ERROR_OUT_OF_RESOURCES,
+                             "SVM prefetch thread creation failed.");
+
   PrefetchOp* op = new PrefetchOp();
   MAKE_NAMED_SCOPE_GUARD(OpGuard, [&]() { delete op; });
 
+  uint32_t node_id;
   Agent* dest = Agent::Convert(agent);
   if (dest->device_type() == Agent::kAmdCpuDevice)
-    op->node_id = 0;
+    node_id = 0;
   else
-    op->node_id = dest->node_id();
+    node_id = dest->node_id();
 
-  op->base = reinterpret_cast<void*>(base);
-  op->size = len;
-  op->completion = completion_signal;
   if (num_dep_signals > 1) {
     op->remaining_deps = num_dep_signals - 1;
     for (int i = 0; i < num_dep_signals - 1; i++) op->dep_signals.push_back(dep_signals[i]);
@@ -2827,78 +3113,8 @@ hsa_status_t Runtime::SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent,
     op->remaining_deps = 0;
   }
 
-  {
-    ScopedAcquire<KernelMutex> lock(&prefetch_lock_);
-    // Remove all fully overlapped and trim partially overlapped ranges.
-    // Get iteration bounds
-    auto start = prefetch_map_.upper_bound(base);
-    if (start != prefetch_map_.begin()) start--;
-    auto stop = prefetch_map_.lower_bound(end);
-
-    auto isEndNode = [&](decltype(start) node) { return node->second.next == prefetch_map_.end(); };
-    auto isFirstNode = [&](decltype(start) node) {
-      return node->second.prev == prefetch_map_.end();
-    };
-
-    // Trim and remove old ranges.
-    while (start != stop) {
-      uintptr_t startBase = start->first;
-      uintptr_t startEnd = startBase + start->second.bytes;
-
-      auto ibase = Max(startBase, base);
-      auto iend = Min(startEnd, end);
-      // Check for overlap
-      if (ibase < iend) {
-        // Second range check
-        if (iend < startEnd) {
-          auto ret = prefetch_map_.insert(
-              std::make_pair(iend, PrefetchRange(startEnd - iend, start->second.op)));
-          assert(ret.second && "Prefetch map insert failed during range split.");
-
-          auto it = ret.first;
-          it->second.prev = start;
-          it->second.next = start->second.next;
-          start->second.next = it;
-          if (!isEndNode(it)) it->second.next->second.prev = it;
-        }
-
-        // Is the first interval of the old range valid
-        if (startBase < ibase) {
-          start->second.bytes = ibase - startBase;
-        } else {
-          if (isFirstNode(start)) {
-            start->second.op->prefetch_map_entry = start->second.next;
-            if (!isEndNode(start)) start->second.next->second.prev = prefetch_map_.end();
-          } else {
-            start->second.prev->second.next = start->second.next;
-            if (!isEndNode(start)) start->second.next->second.prev = start->second.prev;
-          }
-          start = prefetch_map_.erase(start);
-          continue;
-        }
-      }
-      start++;
-    }
-
-    // Insert new range.
-    auto ret = prefetch_map_.insert(std::make_pair(base, PrefetchRange(len, op)));
-    assert(ret.second && "Prefetch map insert failed.");
-
-    auto it = ret.first;
-    op->prefetch_map_entry = it;
-    it->second.next = it->second.prev = prefetch_map_.end();
-  }
-
-  // Remove the prefetch's ranges from the map.
-  static auto removePrefetchRanges = [](PrefetchOp* op) {
-    ScopedAcquire<KernelMutex> lock(&Runtime::runtime_singleton_->prefetch_lock_);
-    auto it = op->prefetch_map_entry;
-    while (it != Runtime::runtime_singleton_->prefetch_map_.end()) {
-      auto next = it->second.next;
-      Runtime::runtime_singleton_->prefetch_map_.erase(it);
-      it = next;
-    }
-  };
+  // Supersedes any older pending prefetch of the same pages.
+  op->prefetch = svm_prefetch_->Add(base, len, node_id, completion_signal);
 
   // Prefetch Signal handler for synchronization.
   static hsa_amd_signal_handler signal_handler = [](hsa_signal_value_t value, void* arg) {
@@ -2911,15 +3127,8 @@ hsa_status_t Runtime::SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent,
       return false;
     }
 
-    HSA_SVM_ATTRIBUTE attrib;
-    attrib.type = HSA_SVM_ATTR_PREFETCH_LOC;
-    attrib.value = op->node_id;
-    HSAKMT_STATUS error = hsaKmtSVMSetAttr(op->base, op->size, 1, &attrib);
-    assert(error == HSAKMT_STATUS_SUCCESS && "KFD Prefetch failed.");
-
-    removePrefetchRanges(op);
-
-    if (op->completion.handle != 0) Signal::Convert(op->completion)->SubRelaxed(1);
+    // Migration is issued by the prefetch worker, coalesced with other ready prefetches.
+    Runtime::runtime_singleton_->svm_prefetch_->Ready(op->prefetch);
     delete op;
 
     return false;
@@ -2927,7 +3136,7 @@ hsa_status_t Runtime::SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent,
 
   auto no_dependencies = [](void* arg) { signal_handler(0, arg); };
 
-  MAKE_NAMED_SCOPE_GUARD(RangeGuard, [&]() { removePrefetchRanges(op); });
+  MAKE_NAMED_SCOPE_GUARD(PrefetchGuard, [&]() { svm_prefetch_->Cancel(op->prefetch); });
 
   hsa_status_t err;
   if (num_dep_signals == 0)
@@ -2937,7 +3146,7 @@ hsa_status_t Runtime::SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent,
                                 signal_handler, op);
   if (err != HSA_STATUS_SUCCESS) throw AMD::hsa_exception(err, "Signal handler unable to be set.");
 
-  RangeGuard.Dismiss();
+  PrefetchGuard.Dismiss();
   OpGuard.Dismiss();
   return HSA_STATUS_SUCCESS;
 }
@@ -2946,39 +3155,11 @@ Agent* Runtime::GetSVMPrefetchAgent(void* ptr, size_t size) {
   uintptr_t base = reinterpret_cast<uintptr_t>(AlignDown(ptr, 4096));
   uintptr_t end = AlignUp(reinterpret_cast<uintptr_t>(ptr) + size, 4096);
 
-  std::vector<std::pair<uintptr_t, uintptr_t>> holes;
-
-  ScopedAcquire<KernelMutex> lock(&Runtime::runtime_singleton_->prefetch_lock_);
-  auto start = prefetch_map_.upper_bound(base);
-  if (start != prefetch_map_.begin()) start--;
-  auto stop = prefetch_map_.lower_bound(end);
+  std::vector<std::pair<uintptr_t, size_t>> holes;
 
   // KFD returns -1 for no or mixed destinations.
-  uint32_t prefetch_node = -2;
-  if (start != stop) {
-    prefetch_node = start->second.op->node_id;
-  }
-
-  while (start != stop) {
-    uintptr_t startBase = start->first;
-    uintptr_t startEnd = startBase + start->second.bytes;
-
-    auto ibase = Max(base, startBase);
-    auto iend = Min(end, startEnd);
-    // Check for intersection with the query
-    if (ibase < iend) {
-      // If prefetch locations are different then we report null agent.
-      if (prefetch_node != start->second.op->node_id) return nullptr;
-
-      // Push leading gap to an array for checking KFD.
-      if (base < ibase) holes.push_back(std::make_pair(base, ibase - base));
-
-      // Trim query range.
-      base = iend;
-    }
-    start++;
-  }
-  if (base < end) holes.push_back(std::make_pair(base, end - base));
+  uint32_t prefetch_node;
+  if (!svm_prefetch_->Destination(base, end, &prefetch_node, &holes)) return nullptr;
 
   HSA_SVM_ATTRIBUTE attrib;
   attrib.type = HSA_SVM_ATTR_PREFETCH_LOC;
@@ -2988,11 +3169,11 @@ Agent* Runtime::GetSVMPrefetchAgent(void* ptr, size_t size) {
     assert(error == HSAKMT_STATUS_SUCCESS && "KFD prefetch query failed.");
 
     if (attrib.value == -1) return nullptr;
-    if (prefetch_node == -2) prefetch_node = attrib.value;
+    if (prefetch_node == AMD::SvmPrefetch::kNoNode) prefetch_node = attrib.value;
     if (prefetch_node != attrib.value) return nullptr;
   }
 
-  assert(prefetch_node != -2 && "prefetch_node was not updated.");
+  assert(prefetch_node != AMD::SvmPrefetch::kNoNode && "prefetch_node was not updated.");
   assert(prefetch_node != -1 && "Should have already returned.");
   return agents_by_node_[prefetch_node][0];
 }
@@ -3052,7 +3233,7 @@ hsa_status_t Runtime::VMemoryAddressReserve(void** va, size_t size, uint64_t add
   if (!alignment)
     alignment = sysconf(_SC_PAGE_SIZE);
 
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
 
   memFlags.ui32.OnlyAddress = 1;
   memFlags.ui32.FixedAddress = 1;
@@ -3065,14 +3246,14 @@ hsa_status_t Runtime::VMemoryAddressReserve(void** va, size_t size, uint64_t add
       return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
   }
 
-  reserved_address_map_[addr] = AddressHandle(size);
+  reserved_address_map_.emplace(addr, size);
   *va = addr;
   return HSA_STATUS_SUCCESS;
 }
 
 hsa_status_t Runtime::VMemoryAddressFree(void* va, size_t size) {
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
-  std::map<const void*, AddressHandle>::iterator it = reserved_address_map_.find(va);
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
+  auto it = reserved_address_map_.find(va);
 
   if (it == reserved_address_map_.end()) {
     debug_warning(false && "Can't find address in reserved address");
@@ -3098,7 +3279,7 @@ hsa_status_t Runtime::VMemoryHandleCreate(const MemoryRegion* region, size_t siz
   if (!IsMultipleOf(size, memRegion->GetPageSize()))
     return HSA_STATUS_ERROR_INVALID_ARGUMENT;
 
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
   void *user_mode_driver_handle;
   hsa_status_t status =
       region->Allocate(size, alloc_flags, &user_mode_driver_handle, 0);
@@ -3115,7 +3296,7 @@ hsa_status_t Runtime::VMemoryHandleCreate(const MemoryRegion* region, size_t siz
 }
 
 hsa_status_t Runtime::VMemoryHandleRelease(hsa_amd_vmem_alloc_handle_t memoryOnlyHandle) {
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
   auto memoryHandleIt = memory_handle_map_.find(reinterpret_cast<void*>(memoryOnlyHandle.handle));
 
   if (memoryHandleIt == memory_handle_map_.end()) {
@@ -3180,31 +3361,13 @@ hsa_status_t Runtime::VMemoryHandleMap(void* va, size_t size, size_t in_offset,
   uint64_t offset = 0, ret;
   uint64_t drm_cpu_addr = 0;
   amdgpu_bo_handle ldrm_bo = 0;
-  bool reservedAddressFound = false;
 
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
-  auto reservedAddressIt = reserved_address_map_.upper_bound(va);
-  if (reservedAddressIt != reserved_address_map_.begin()) {
-    reservedAddressIt--;
-    if ((reservedAddressIt->first <= va) &&
-        ((reinterpret_cast<uint8_t*>(va) + size) <=
-         (reinterpret_cast<const uint8_t*>(reservedAddressIt->first) + reservedAddressIt->second.size))) {
-      reservedAddressFound = true;
-    }
-  }
-  if (!reservedAddressFound) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
+  auto reservedAddressIt = reserved_address_map_.find_enclosing(va, size);
+  if (reservedAddressIt == reserved_address_map_.end()) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
 
   /* Confirm that this VA range has not been mapped yet */
-  auto upperMappedHandleIt = mapped_handle_map_.upper_bound(va);
-  if (upperMappedHandleIt != mapped_handle_map_.begin()) {
-    upperMappedHandleIt--;
-    if ((reinterpret_cast<const uint8_t*>(upperMappedHandleIt->first) + upperMappedHandleIt->second.size) > va)
-      return HSA_STATUS_ERROR_INVALID_ARGUMENT;
-  }
-  auto lowerMappedHandleIt = mapped_handle_map_.lower_bound(va);
-  if (lowerMappedHandleIt != mapped_handle_map_.end()) {
-    if (reinterpret_cast<uint8_t*>(va) + size > lowerMappedHandleIt->first) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
-  }
+  if (mapped_handle_map_.overlaps(va, size)) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
 
   auto memoryHandleIt = memory_handle_map_.find(reinterpret_cast<void*>(memoryOnlyHandle.handle));
   if (memoryHandleIt == memory_handle_map_.end()) {
@@ -3227,10 +3390,9 @@ hsa_status_t Runtime::VMemoryHandleMap(void* va, size_t size, size_t in_offset,
   ret = GetAmdgpuDeviceArgs(agent, ldrm_bo, &drm_fd, &drm_cpu_addr);
   if (ret) return HSA_STATUS_ERROR;
 
-  mapped_handle_map_.emplace(std::piecewise_construct,
-          std::forward_as_tuple(va),
-          std::forward_as_tuple(&memoryHandleIt->second, &reservedAddressIt->second, offset, size, drm_fd,
-                   reinterpret_cast<void*>(drm_cpu_addr), HSA_ACCESS_PERMISSION_NONE, ldrm_bo));
+  mapped_handle_map_.emplace(va, &memoryHandleIt->second, &reservedAddressIt->second, offset, size,
+                             drm_fd, reinterpret_cast<void*>(drm_cpu_addr),
+                             HSA_ACCESS_PERMISSION_NONE, ldrm_bo);
 
   reservedAddressIt->second.use_count++;
   memoryHandleIt->second.use_count++;
@@ -3240,7 +3402,7 @@ hsa_status_t Runtime::VMemoryHandleMap(void* va, size_t size, size_t in_offset,
 
 hsa_status_t Runtime::VMemoryHandleUnmap(void* va, size_t size) {
   int ret;
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
 
   auto mappedHandleIt = mapped_handle_map_.find(va);
   if (mappedHandleIt == mapped_handle_map_.end()) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
@@ -3281,6 +3443,8 @@ hsa_status_t Runtime::VMemoryHandleUnmap(void* va, size_t size) {
   }
 
   mapped_handle_map_.erase(mappedHandleIt);
+  lock.Release();
+  InvalidateCopyCaches(va, size);
   return HSA_STATUS_SUCCESS;
 }
 
@@ -3350,7 +3514,7 @@ hsa_status_t Runtime::MappedHandleAllowedAgent::RemoveAccess() {
   return (ret) ? HSA_STATUS_ERROR : HSA_STATUS_SUCCESS;
 }
 
-// Note: VMemorySetAccessPerHandle should be called with &memory_lock_ held
+// Note: VMemorySetAccessPerHandle should be called with &vmem_lock_ held
 hsa_status_t
 Runtime::VMemorySetAccessPerHandle(void *va, MappedHandle &mappedHandle,
                                    const hsa_amd_memory_access_desc_t *desc,
@@ -3394,9 +3558,6 @@ Runtime::VMemorySetAccessPerHandle(void *va, MappedHandle &mappedHandle,
 hsa_status_t Runtime::VMemorySetAccess(void* va, size_t size,
                                        const hsa_amd_memory_access_desc_t* desc,
                                        const size_t desc_cnt) {
-  std::list<std::pair<void*, MappedHandle*>> mappedHandles;
-  bool reservedAddressFound = false;
-
   // Validate all agents
   for (int i = 0; i < desc_cnt; i++) {
     Agent* targetAgent = Agent::Convert(desc[i].agent_handle);
@@ -3404,43 +3565,21 @@ hsa_status_t Runtime::VMemorySetAccess(void* va, size_t size,
     if (targetAgent == NULL || !targetAgent->IsValid()) return HSA_STATUS_ERROR_INVALID_AGENT;
   }
 
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
 
-  auto reservedAddressIt = reserved_address_map_.upper_bound(va);
-  if (reservedAddressIt != reserved_address_map_.begin()) {
-    reservedAddressIt--;
-    if ((reservedAddressIt->first <= va) &&
-        ((reinterpret_cast<uint8_t*>(va) + size) <=
-         (reinterpret_cast<const uint8_t*>(reservedAddressIt->first) +
-          reservedAddressIt->second.size))) {
-      reservedAddressFound = true;
-    }
-  }
-  if (!reservedAddressFound) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
-
-  // va + size may consist of multiple MappedHandle's. Build a list lf MappedHandles within this VA
-  // range
-  uint8_t* va_chunk = reinterpret_cast<uint8_t*>(va);
-  while (va_chunk < reinterpret_cast<uint8_t*>(va) + size) {
-    auto mappedHandleIt = mapped_handle_map_.find(va_chunk);
-    // Cannot find a contiguous list of MappedHandles for the full VA range
-    if (mappedHandleIt == mapped_handle_map_.end()) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
-
-    mappedHandles.push_back(std::make_pair(va_chunk, &mappedHandleIt->second));
-    va_chunk += mappedHandleIt->second.size;
-  }
+  if (reserved_address_map_.find_enclosing(va, size) == reserved_address_map_.end())
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
 
-  hsa_status_t status;
-  for (auto mappedHandleIt : mappedHandles) {
-    status = VMemorySetAccessPerHandle(mappedHandleIt.first,
-                                       *mappedHandleIt.second, desc, desc_cnt);
-    if (status != HSA_STATUS_SUCCESS)
-      return status;
-  }
-  return HSA_STATUS_SUCCESS;
+  // va + size may consist of multiple MappedHandle's. They must tile the VA range without gaps.
+  hsa_status_t status = HSA_STATUS_SUCCESS;
+  bool tiled = mapped_handle_map_.for_each_tiling(va, size, [&](IntervalMap<MappedHandle>::iterator it) {
+    if (status == HSA_STATUS_SUCCESS)
+      status = VMemorySetAccessPerHandle(const_cast<void*>(it->first), it->second, desc, desc_cnt);
+  });
+  if (!tiled) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
+  return status;
 }
 
-// Note: VMemoryMapAllowAccess should be called with &memory_lock_ held
 hsa_status_t Runtime::VMemoryMapAllowAccess(const void *va,
                                             const hsa_access_permission_t perm,
                                             const hsa_agent_t *agents,
@@ -3460,60 +3599,33 @@ hsa_status_t Runtime::VMemoryMapAllowAccess(const void *va,
     desc[i].agent_handle = agents[i];
   }
 
-  std::list<std::pair<void *, MappedHandle *>> mappedHandles;
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
 
-  auto mappedHandleIt = mapped_handle_map_.upper_bound(va);
-  if (mappedHandleIt != mapped_handle_map_.begin()) {
-    mappedHandleIt--;
-
-    if ((reinterpret_cast<const uint8_t *>(mappedHandleIt->first) +
-         mappedHandleIt->second.size) > va) {
-      // We found a mapped handle. See if there are more contiguous mapped
-      // handles and add them to the list
-
-      uint8_t *va_chunk = (uint8_t *)mappedHandleIt->first;
-      do {
-        mappedHandles.push_back(
-            std::make_pair(va_chunk, &mappedHandleIt->second));
-        va_chunk += mappedHandleIt->second.size;
-
-        mappedHandleIt++;
-        if (mappedHandleIt == mapped_handle_map_.end())
-          break;
-      } while (va_chunk == mappedHandleIt->first);
-    }
-  }
-
-  if (mappedHandles.empty())
+  // Apply to the mapped handle containing va and any contiguous mapped handles after it.
+  auto mappedHandleIt = mapped_handle_map_.find_containing(va);
+  if (mappedHandleIt == mapped_handle_map_.end())
     return HSA_STATUS_ERROR_INVALID_ALLOCATION;
 
-  hsa_status_t status;
-  for (auto mappedHandleIt : mappedHandles) {
-    status = VMemorySetAccessPerHandle(
-        mappedHandleIt.first, *mappedHandleIt.second, desc, num_agents);
+  do {
+    hsa_status_t status =
+        VMemorySetAccessPerHandle(const_cast<void *>(mappedHandleIt->first),
+                                  mappedHandleIt->second, desc, num_agents);
     if (status != HSA_STATUS_SUCCESS)
       return status;
-  }
+    mappedHandleIt = mapped_handle_map_.next_adjacent(mappedHandleIt);
+  } while (mappedHandleIt != mapped_handle_map_.end());
+
   return HSA_STATUS_SUCCESS;
 }
 
 hsa_status_t Runtime::VMemoryGetAccess(const void* va, hsa_access_permission_t* perms,
                                        hsa_agent_t agent_handle) {
   *perms = HSA_ACCESS_PERMISSION_NONE;
-  bool mappedHandleFound = false;
 
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
+  ScopedAcquire<KernelSharedMutex::Shared> lock(vmem_lock_.shared());
 
-  auto mappedHandleIt = mapped_handle_map_.upper_bound(va);
-  if (mappedHandleIt != mapped_handle_map_.begin()) {
-    mappedHandleIt--;
-    if ((mappedHandleIt->first <= va) &&
-        reinterpret_cast<const uint8_t*>(va) <=
-         (reinterpret_cast<const uint8_t*>(mappedHandleIt->first) + mappedHandleIt->second.size)) {
-      mappedHandleFound = true;
-    }
-  }
-  if (!mappedHandleFound) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
+  auto mappedHandleIt = mapped_handle_map_.find_containing(va);
+  if (mappedHandleIt == mapped_handle_map_.end()) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
 
   Agent* agent = Agent::Convert(agent_handle);
   if (agent == NULL || !agent->IsValid() || agent->device_type() != core::Agent::kAmdGpuDevice)
@@ -3534,6 +3646,7 @@ hsa_status_t Runtime::VMemoryExportShareableHandle(int* dmabuf_fd,
                                                    hsa_amd_vmem_alloc_handle_t handle,
                                                    uint64_t flags) {
   *dmabuf_fd = -1;
+  ScopedAcquire<KernelSharedMutex::Shared> lock(vmem_lock_.shared());
   auto memoryHandle = memory_handle_map_.find((void*)handle.handle);
   if (memoryHandle == memory_handle_map_.end()) {
     debug_warning(false && "Can't find memory handle");
@@ -3586,7 +3699,7 @@ hsa_status_t Runtime::VMemoryImportShareableHandle(int dmabuf_fd,
   size_t size = info.SizeInBytes;
   int gpuid = info.NodeId;
 
-
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
   auto memoryHandleIt = memory_handle_map_.find(thunk_handle);
   if (memoryHandleIt != memory_handle_map_.end()) {
     /* This handle was already imported, increment ref_count and return */
@@ -3617,6 +3730,7 @@ hsa_status_t Runtime::VMemoryImportShareableHandle(int dmabuf_fd,
 
 hsa_status_t Runtime::VMemoryRetainAllocHandle(hsa_amd_vmem_alloc_handle_t* mapped_handle,
                                                void* va) {
+  ScopedAcquire<KernelSharedMutex> lock(&vmem_lock_);
   auto mappedHandleIt = mapped_handle_map_.find(va);
   if (mappedHandleIt == mapped_handle_map_.end()) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
 
@@ -3630,6 +3744,7 @@ hsa_status_t Runtime::VMemoryRetainAllocHandle(hsa_amd_vmem_alloc_handle_t* mapp
 hsa_status_t Runtime::VMemoryGetAllocPropertiesFromHandle(hsa_amd_vmem_alloc_handle_t allocHandle,
                                                           const core::MemoryRegion** mem_region,
                                                           hsa_amd_memory_type_t* type) {
+  ScopedAcquire<KernelSharedMutex::Shared> lock(vmem_lock_.shared());
   auto memoryHandleIt = memory_handle_map_.find(reinterpret_cast<void*>(allocHandle.handle));
   if (memoryHandleIt == memory_handle_map_.end()) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
 
@@ -3642,6 +3757,9 @@ hsa_status_t Runtime::VMemoryGetAllocPropertiesFromHandle(hsa_amd_vmem_alloc_han
 }
 
 hsa_status_t Runtime::EnableLogging(uint8_t* flags, void* file) {
+  // Flush deferred records to the previous file before switching.
+  AsyncLogger::Stop();
+
   memcpy(log_flags, flags, sizeof(log_flags));
 
   if (file)
@@ -3649,6 +3767,10 @@ hsa_status_t Runtime::EnableLogging(uint8_t* flags, void* file) {
   else
     log_file = stderr;
 
+  bool enabled = false;
+  for (size_t i = 0; i < sizeof(log_flags); i++) enabled |= (log_flags[i] != 0);
+  if (enabled) AsyncLogger::Start(flag().log_mode(), log_file);
+
   return HSA_STATUS_SUCCESS;
 }
 
@@ -46,6 +46,7 @@
 #include "core/inc/signal.h"
 
 #include <algorithm>
+#include <vector>
 #include "core/util/timer.h"
 #include "core/inc/runtime.h"
 
@@ -55,6 +56,39 @@ namespace core {
 KernelMutex Signal::ipcLock_;
 std::map<decltype(hsa_signal_t::handle), Signal*> Signal::ipcMap_;
 
+namespace {
+// Per-thread scratch for multi-signal waits. Completion threads wait on the
+// same signal lists in tight loops, so the deduplicated event list and the
+// thunk's ioctl array are kept across calls instead of being rebuilt.
+class ThreadEventWait {
+ public:
+  ~ThreadEventWait() {
+    if (wait_set_ != nullptr) hsaKmtDestroyEventWaitSet(wait_set_);
+  }
+
+  HsaEvent** Events(uint32_t count) {
+    if (events_.size() < count) events_.resize(count);
+    return events_.data();
+  }
+
+  void Wait(HsaEvent** evts, uint32_t count, uint32_t wait_ms, uint64_t* event_age) {
+    if (wait_set_ == nullptr &&
+        hsaKmtCreateEventWaitSet(count, &wait_set_) != HSAKMT_STATUS_SUCCESS) {
+      wait_set_ = nullptr;
+      hsaKmtWaitOnMultipleEvents_Ext(evts, count, false, wait_ms, event_age);
+      return;
+    }
+    hsaKmtWaitOnEventWaitSet(wait_set_, evts, count, false, wait_ms, event_age);
+  }
+
+ private:
+  HsaEventWaitSet* wait_set_ = nullptr;
+  std::vector<HsaEvent*> events_;
+};
+
+static thread_local ThreadEventWait EventWait;
+}  // namespace
+
 void SharedSignalPool_t::clear() {
   ifdebug {
     size_t capacity = 0;
@@ -212,24 +246,16 @@ uint32_t Signal::WaitAny(uint32_t signal_count, const hsa_signal_t* hsa_signals,
     }
   }
 
-  const uint32_t small_size = 10;
-  HsaEvent* short_evts[small_size];
   HsaEvent** evts = NULL;
   uint32_t unique_evts = 0;
   if (wait_hint != HSA_WAIT_STATE_ACTIVE) {
-    if (signal_count > small_size)
-      evts = new HsaEvent* [signal_count];
-    else
-      evts = short_evts;
+    evts = EventWait.Events(signal_count);
     for (uint32_t i = 0; i < signal_count; i++)
       evts[i] = signals[i]->EopEvent();
     std::sort(evts, evts + signal_count);
     HsaEvent** end = std::unique(evts, evts + signal_count);
     unique_evts = uint32_t(end - evts);
   }
-  MAKE_SCOPE_GUARD([&]() {
-    if (signal_count > small_size) delete[] evts;
-  });
 
   uint64_t event_age[unique_evts];
   memset(event_age, 0, unique_evts * sizeof(uint64_t));
@@ -306,7 +332,7 @@ uint32_t Signal::WaitAny(uint32_t signal_count, const hsa_signal_t* hsa_signals,
     uint64_t ct=timer::duration_cast<std::chrono::milliseconds>(
       time_remaining).count();
     wait_ms = (ct>0xFFFFFFFEu) ? 0xFFFFFFFEu : ct;
-    hsaKmtWaitOnMultipleEvents_Ext(evts, unique_evts, false, wait_ms, event_age);
+    EventWait.Wait(evts, unique_evts, wait_ms, event_age);
   }
 }
 
@@ -340,8 +366,7 @@ uint32_t Signal::WaitAnyExceptions(uint32_t signal_count, const hsa_signal_t* hs
       // race condition can cause some threads to sleep without wakeup since missing interrupt.
       if (prior != 0) wait_ms = 0;
 
-  HsaEvent** evts = new HsaEvent* [signal_count];
-  MAKE_SCOPE_GUARD([&]() { delete[] evts; });
+  HsaEvent** evts = EventWait.Events(signal_count);
 
   uint32_t unique_evts = 0;
 
@@ -411,7 +436,7 @@ uint32_t Signal::WaitAnyExceptions(uint32_t signal_count, const hsa_signal_t* hs
       }
     }
 
-    hsaKmtWaitOnMultipleEvents_Ext(evts, unique_evts, false, wait_ms, event_age);
+    EventWait.Wait(evts, unique_evts, wait_ms, event_age);
   } //while
 }
 
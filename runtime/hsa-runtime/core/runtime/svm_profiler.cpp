@@ -58,75 +58,49 @@
 namespace rocr {
 namespace AMD {
 
-static const char* smi_event_string(uint32_t event) {
-  static const char* strings[] = {"NONE",
-                                  "VMFAULT",
-                                  "THERMAL_THROTTLE",
-                                  "GPU_PRE_RESET",
-                                  "GPU_POST_RESET",
-                                  "MIGRATE_START",
-                                  "MIGRATE_END",
-                                  "PAGE_FAULT_START",
-                                  "PAGE_FAULT_END",
-                                  "QUEUE_EVICTION",
-                                  "QUEUE_RESTORE",
-                                  "UNMAP_FROM_GPU",
-                                  "UNKNOWN"};
-
-  event = std::min<uint32_t>(event, sizeof(strings) / sizeof(char*) - 1);
-  return strings[event];
+// Ring capacity per GPU, in records.
+static const size_t kTraceRingSize = 16384;
+// Size of the per GPU SMI read buffer, lets one read return many records.
+static const size_t kSmiReadSize = 64 * 1024;
+// Records taken from a ring at a time by the trace writer.
+static const size_t kTraceBatchSize = 4096;
+// Trace writer back off when all rings are empty.
+static const int kTraceIdleMs = 10;
+
+SvmTraceRing::SvmTraceRing(size_t capacity)
+    : records_(capacity), mask_(capacity - 1), head_(0), tail_(0), dropped_(0) {
+  assert(IsPowerOfTwo(capacity) && "Trace ring size must be a power of two.");
 }
 
-static const char* smi_migrate_string(uint32_t trigger) {
-  static const char* strings[] = {"PREFETCH",
-                                  "PAGEFAULT_GPU",
-                                  "PAGEFAULT_CPU",
-                                  "TTM_EVICTION",
-                                  "UNKNOWN"};
-
-  trigger = std::min<uint32_t>(trigger, sizeof(strings) / sizeof(char*) - 1);
-  return strings[trigger];
-}
-
-static const char* smi_eviction_string(uint32_t trigger) {
-  static const char* strings[] = {"SVM",
-                                  "USERPTR",
-                                  "TTM",
-                                  "SUSPEND",
-                                  "CRIU_CHECKPOINT",
-                                  "CRIU_RESTORE",
-                                  "UNKNOWN"};
-
-  trigger = std::min<uint32_t>(trigger, sizeof(strings) / sizeof(char*) - 1);
-  return strings[trigger];
+bool SvmTraceRing::Push(const SvmTraceRecord& record) {
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) == records_.size()) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  records_[tail & mask_] = record;
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
 }
 
-static const char* smi_unmap_string(uint32_t trigger) {
-  static const char* strings[] = {"MMU_NOTIFY",
-                                  "MMU_NOTIFY_MIGRATE",
-                                  "UNMAP_FROM_CPU",
-                                  "UNKNOWN"};
-
-  trigger = std::min<uint32_t>(trigger, sizeof(strings) / sizeof(char*) - 1);
-  return strings[trigger];
+size_t SvmTraceRing::Pop(SvmTraceRecord* records, size_t max) {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  size_t count = std::min<uint64_t>(tail_.load(std::memory_order_acquire) - head, max);
+  for (size_t i = 0; i < count; i++) records[i] = records_[(head + i) & mask_];
+  head_.store(head + count, std::memory_order_release);
+  return count;
 }
 
 void SvmProfileControl::PollSmiRun(void* _profileControl) {
   SvmProfileControl* profileControl = (SvmProfileControl*)_profileControl;
 
   profileControl->PollSmi();
+  profileControl->poll_done_.store(true, std::memory_order_release);
 }
 
 void SvmProfileControl::PollSmi() {
-  if (core::Runtime::runtime_singleton_->flag().svm_profile().empty()) {
-    return;
-  }
-  FILE* logFile = fopen(core::Runtime::runtime_singleton_->flag().svm_profile().c_str(), "a");
-  if (logFile == NULL) {
-    return;
-  }
-  MAKE_NAMED_SCOPE_GUARD(logGuard, [&]() { fclose(logFile); });
-
+  // The poll thread only parses events into the rings, the trace writer thread formats or
+  // writes them out.
   std::vector<pollfd> files;
   files.resize(core::Runtime::runtime_singleton_->gpu_agents().size() + 1);
   files[0].fd = event;
@@ -158,19 +132,10 @@ void SvmProfileControl::PollSmi() {
     }
   });
 
-  std::vector<std::string> smi_records;
-  smi_records.resize(core::Runtime::runtime_singleton_->gpu_agents().size() + 1);
-  char buffer[HSA_SMI_EVENT_MSG_SIZE + 1];
-
-  auto format_agent = [this](uint32_t gpuid) {
-    std::string ret;
-    core::Agent* agent = core::Runtime::runtime_singleton_->agent_by_gpuid(gpuid);
-    if (agent->device_type() == core::Agent::kAmdCpuDevice)
-      return std::string("CPU");
-    else
-      return format("GPU%u(%p)", ((AMD::GpuAgent*)agent)->enumeration_index(),
-                    agent->public_handle());
-  };
+  // Per GPU read buffers, partial records stay at the front until their newline arrives.
+  std::vector<std::vector<char>> buffers(files.size());
+  std::vector<size_t> fill(files.size(), 0);
+  for (int i = 1; i < files.size(); i++) buffers[i].resize(kSmiReadSize + 1);
 
   while (!exit) {
     int ready = poll(&files[0], files.size(), -1);
@@ -181,165 +146,36 @@ void SvmProfileControl::PollSmi() {
 
     for (int i = 1; i < files.size(); i++) {
       if (files[i].revents & POLLIN) {
-        memset(buffer, 0, sizeof(buffer));
-        auto len = read(files[i].fd, buffer, sizeof(buffer) - 1);
+        char* buffer = &buffers[i][0];
+        // A line longer than the buffer can not be a valid record, drop it.
+        if (fill[i] == kSmiReadSize) fill[i] = 0;
+        auto len = read(files[i].fd, buffer + fill[i], kSmiReadSize - fill[i]);
         if (len > 0) {
-          buffer[len] = '\0';
-          // printf("%s\n", buffer);
-          // fprintf(logFile, "%s\n", buffer);
-
-          smi_records[i] += buffer;
+          size_t end = fill[i] + len;
+          buffer[end] = '\0';
 
+          char* line = buffer;
           while (true) {
-            size_t pos = smi_records[i].find('\n');
-            if (pos == std::string::npos) break;
-
-            std::string line = smi_records[i].substr(0, pos);
-            smi_records[i].erase(0, pos + 1);
-
-            const char* cursor;
-            cursor = line.c_str();
-
-            // Event records follow the format:
-            // event_id timestamp -pid event_specific_info trigger
-            // timestamp, pid, and trigger are in dec.  All other are hex.
-            // event_specific substring is listed for each event type.
-            // See kfd_ioctl.h for more info.
-            int event_id;
-            uint64_t time;
-            int pid;
-            int offset = 0;
-            int args = sscanf(cursor, "%x %lu -%u%n", &event_id, &time, &pid, &offset);
-            assert(args == 3 && "Parsing error!");
-
-            std::string detail;
-            cursor += offset + 1;
-            switch (event_id) {
-              //@addr(size) from->to prefetch_location:preferred_location
-              case HSA_SMI_EVENT_MIGRATE_START: {
-                uint64_t addr;
-                uint32_t size;
-                uint32_t from, to;
-                uint32_t trigger = 0;
-                uint32_t fetch, pref;
-                args = sscanf(cursor, "@%lx(%x) %x->%x %x:%x %u", &addr, &size, &from, &to, &fetch,
-                              &pref, &trigger);
-                assert(args == 7 && "Parsing error!");
-
-                addr *= 4096;
-                size *= 4096;
-
-                std::string from_agent = format_agent(from);
-                std::string to_agent = format_agent(to);
-                std::string range = format("[%p, %p]", addr, addr + size - 1);
-                std::string cause = smi_migrate_string(trigger);
-                detail = cause + " " + from_agent + "->" + to_agent + " " + range;
-                break;
-              }
-              //@addr(size) from->to
-              case HSA_SMI_EVENT_MIGRATE_END: {
-                uint64_t addr;
-                uint32_t size;
-                uint32_t from, to;
-                uint32_t trigger;
-                args = sscanf(cursor, "@%lx(%x) %x->%x %u", &addr, &size, &from, &to, &trigger);
-                assert(args == 5 && "Parsing error!");
-
-                addr *= 4096;
-                size *= 4096;
-
-                std::string from_agent = format_agent(from);
-                std::string to_agent = format_agent(to);
-                std::string range = format("[%p, %p]", addr, addr + size - 1);
-                std::string cause = smi_migrate_string(trigger);
-                detail = cause + " " + from_agent + "->" + to_agent + " " + range;
-                break;
-              }
-              //@addr(gpu_id) W/R
-              case HSA_SMI_EVENT_PAGE_FAULT_START: {
-                uint64_t addr;
-                uint32_t gpuid;
-                char mode;
-                args = sscanf(cursor, "@%lx(%x) %c", &addr, &gpuid, &mode);
-
-                addr *= 4096;
-
-                assert(args == 3 && "Parsing error!");
-                std::string agent = format_agent(gpuid);
-                std::string range = std::to_string(addr);
-                std::string cause = (mode == 'W') ? "Write" : "Read";
-                detail = cause + " " + agent + " " + range;
-                break;
-              }
-              //@addr(gpu_id) M/U  (migration / page table update)
-              case HSA_SMI_EVENT_PAGE_FAULT_END: {
-                uint64_t addr;
-                uint32_t gpuid;
-                char mode;
-                args = sscanf(cursor, "@%lx(%x) %c", &addr, &gpuid, &mode);
-                assert(args == 3 && "Parsing error!");
-
-                addr *= 4096;
-
-                std::string agent = format_agent(gpuid);
-                std::string range = std::to_string(addr);
-                std::string cause = (mode == 'M') ? "Migration" : "Map";
-                detail = cause + " " + agent + " " + range;
-                break;
-              }
-              // gpu_id
-              case HSA_SMI_EVENT_QUEUE_EVICTION: {
-                uint32_t gpuid;
-                uint32_t trigger;
-                args = sscanf(cursor, "%x %u", &gpuid, &trigger);
-                assert(args == 2 && "Parsing error!");
-                std::string agent = format_agent(gpuid);
-                std::string cause = smi_eviction_string(trigger);
-                detail = cause + " " + agent;
-                break;
-              }
-              // gpu_id
-              case HSA_SMI_EVENT_QUEUE_RESTORE: {
-                uint32_t gpuid;
-                uint32_t trigger;
-                args = sscanf(cursor, "%x %u", &gpuid, &trigger);
-                assert(args == 2 && "Parsing error!");
-                std::string agent = format_agent(gpuid);
-                std::string cause = smi_eviction_string(trigger);
-                detail = cause + " " + agent;
-                break;
-              }
-              //@addr(size) gpu_id
-              case HSA_SMI_EVENT_UNMAP_FROM_GPU: {
-                uint64_t addr;
-                uint32_t size;
-                uint32_t gpuid;
-                uint32_t trigger;
-                args = sscanf(cursor, "@%lx(%x) %x %u", &addr, &size, &gpuid, &trigger);
-                assert(args == 4 && "Parsing error!");
-
-                addr *= 4096;
-                size *= 4096;
-
-                std::string gpu = format_agent(gpuid);
-                std::string range = format("[%p, %p]", addr, addr + size - 1);
-                std::string cause = smi_unmap_string(trigger);
-                detail = cause + " " + gpu + " " + range;
-                break;
-              }
-              default:;
-            }
-
-            std::string record = std::string("ROCr HMM event: ") + std::to_string(time) + " " +
-                smi_event_string(event_id) + " " + detail;
-            // printf("%s\n", record.c_str());
-            fprintf(logFile, "%s\n", record.c_str());
+            char* newline = static_cast<char*>(memchr(line, '\n', buffer + end - line));
+            if (newline == nullptr) break;
+            *newline = '\0';
+
+            SvmTraceRecord record;
+            bool parsed = ParseSmiRecord(line, record);
+            assert(parsed && "Parsing error!");
+            if (parsed) rings_[i - 1]->Push(record);
+            line = newline + 1;
           }
+
+          fill[i] = buffer + end - line;
+          memmove(buffer, line, fill[i]);
         } else {
-          auto err = errno;
-          const char* msg = strerror(err);
-          // printf("ROCr HMM event error: Read returned %ld, %s (%d)\n", len, msg, err);
-          fprintf(logFile, "ROCr HMM event error: Read returned %ld, %s (%d)\n", len, msg, err);
+          SvmTraceRecord record = {};
+          record.event = SVM_TRACE_EVENT_ERROR;
+          record.from = agents_[i - 1].gpu_id;
+          record.address = uint64_t(int64_t(len));
+          record.size = uint64_t(errno);
+          rings_[i - 1]->Push(record);
         }
         files[i].revents = 0;
       }
@@ -348,7 +184,99 @@ void SvmProfileControl::PollSmi() {
   }
 }
 
-SvmProfileControl::SvmProfileControl() : event(-1), exit(false) {
+void SvmProfileControl::WriteTraceRun(void* _profileControl) {
+  SvmProfileControl* profileControl = (SvmProfileControl*)_profileControl;
+
+  profileControl->WriteTrace();
+}
+
+size_t SvmProfileControl::DrainTrace(FILE* file, std::vector<SvmTraceRecord>& records) {
+  size_t total = 0;
+  for (size_t i = 0; i < rings_.size(); i++) {
+    size_t count;
+    uint64_t last = 0;
+    while ((count = rings_[i]->Pop(&records[0], records.size())) != 0) {
+      if (binary_) {
+        fwrite(&records[0], sizeof(SvmTraceRecord), count, file);
+      } else {
+        for (size_t r = 0; r < count; r++) PrintSvmTraceRecord(file, records[r], agents_);
+      }
+      last = records[count - 1].timestamp;
+      total += count;
+    }
+
+    uint64_t dropped = rings_[i]->TakeDropped();
+    if (dropped != 0) {
+      // Stamped with the last record kept so the decoder sorts it near the loss.
+      SvmTraceRecord record = {};
+      record.timestamp = last;
+      record.event = SVM_TRACE_EVENT_DROPPED;
+      record.from = agents_[i].gpu_id;
+      record.size = dropped;
+      if (binary_)
+        fwrite(&record, sizeof(record), 1, file);
+      else
+        PrintSvmTraceRecord(file, record, agents_);
+    }
+  }
+  if (total != 0) fflush(file);
+  return total;
+}
+
+void SvmProfileControl::WriteTrace() {
+  const char* path = core::Runtime::runtime_singleton_->flag().svm_profile().c_str();
+  FILE* file = fopen(path, binary_ ? "wb" : "a");
+  if (file == NULL) return;
+  MAKE_NAMED_SCOPE_GUARD(fileGuard, [&]() { fclose(file); });
+
+  if (binary_) {
+    SvmTraceHeader header = {};
+    memcpy(header.magic, kSvmTraceMagic, sizeof(header.magic));
+    header.version = kSvmTraceVersion;
+    header.record_size = sizeof(SvmTraceRecord);
+    header.agent_count = agents_.size();
+    fwrite(&header, sizeof(header), 1, file);
+    if (!agents_.empty()) fwrite(&agents_[0], sizeof(SvmTraceAgent), agents_.size(), file);
+  }
+
+  std::vector<SvmTraceRecord> records(kTraceBatchSize);
+  while (!poll_done_.load(std::memory_order_acquire)) {
+    if (DrainTrace(file, records) == 0) os::Sleep(kTraceIdleMs);
+  }
+  DrainTrace(file, records);
+}
+
+SvmProfileControl::SvmProfileControl()
+    : event(-1),
+      exit(false),
+      binary_(false),
+      poll_smi_thread_(NULL),
+      write_trace_thread_(NULL),
+      poll_done_(false) {
+  const auto& flag = core::Runtime::runtime_singleton_->flag();
+  if (flag.svm_profile().empty()) return;
+  binary_ = flag.svm_profile_binary();
+
+  // GPUs first, in poll order, so agents_[i] matches rings_[i].
+  for (auto agent : core::Runtime::runtime_singleton_->gpu_agents()) {
+    GpuAgent* gpu = static_cast<GpuAgent*>(agent);
+    SvmTraceAgent entry = {};
+    entry.gpu_id = uint32_t(gpu->KfdGpuID());
+    entry.node_id = gpu->node_id();
+    entry.enumeration_index = gpu->enumeration_index();
+    entry.handle = gpu->public_handle().handle;
+    agents_.push_back(entry);
+    rings_.emplace_back(new SvmTraceRing(kTraceRingSize));
+  }
+  for (auto agent : core::Runtime::runtime_singleton_->cpu_agents()) {
+    SvmTraceAgent entry = {};
+    entry.gpu_id = 0;
+    entry.node_id = agent->node_id();
+    entry.enumeration_index = kSvmTraceCpuIndex;
+    agents_.push_back(entry);
+    break;
+  }
+
   event = eventfd(0, EFD_CLOEXEC);
   if (event == -1) return;
 
@@ -357,6 +285,9 @@ SvmProfileControl::SvmProfileControl() : event(-1), exit(false) {
     assert(false && "Poll SMI thread creation error.");
     return;
   }
+
+  write_trace_thread_ = os::CreateThread(WriteTraceRun, (void*)this);
+  assert(write_trace_thread_ != NULL && "SVM trace writer thread creation error.");
 }
 
 SvmProfileControl::~SvmProfileControl() {
@@ -367,18 +298,13 @@ SvmProfileControl::~SvmProfileControl() {
     os::CloseThread(poll_smi_thread_);
     poll_smi_thread_ = NULL;
   }
-  close(event);
-}
-
-template <typename... Args>
-std::string SvmProfileControl::format(const char* format, Args... args) {
-  int len = snprintf(&format_buffer[0], format_buffer.size(), format, args...);
-  if (len + 1 > format_buffer.size()) {
-    format_buffer.resize(len + 1);
-    snprintf(&format_buffer[0], format_buffer.size(), format, args...);
+  if (write_trace_thread_ != NULL) {
+    os::WaitForThread(write_trace_thread_);
+    os::CloseThread(write_trace_thread_);
+    write_trace_thread_ = NULL;
   }
-  return std::string(&format_buffer[0]);
+  if (event != -1) close(event);
 }
- 
+
 } // namespace AMD
 } // namespace rocr
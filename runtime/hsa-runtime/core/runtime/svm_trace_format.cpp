@@ -0,0 +1,345 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2022-2022, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// SVM trace parsing and printing shared by the profiler threads and the offline trace decoder.
+// Has no dependencies on the rest of the runtime so the decoder can be built on its own.
+
+#include "core/inc/svm_profiler.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <algorithm>
+
+#include "hsakmt/hsakmttypes.h"
+
+namespace rocr {
+namespace AMD {
+
+static const char* smi_event_string(uint32_t event) {
+  static const char* strings[] = {"NONE",
+                                  "VMFAULT",
+                                  "THERMAL_THROTTLE",
+                                  "GPU_PRE_RESET",
+                                  "GPU_POST_RESET",
+                                  "MIGRATE_START",
+                                  "MIGRATE_END",
+                                  "PAGE_FAULT_START",
+                                  "PAGE_FAULT_END",
+                                  "QUEUE_EVICTION",
+                                  "QUEUE_RESTORE",
+                                  "UNMAP_FROM_GPU",
+                                  "UNKNOWN"};
+
+  event = std::min<uint32_t>(event, sizeof(strings) / sizeof(char*) - 1);
+  return strings[event];
+}
+
+static const char* smi_migrate_string(uint32_t trigger) {
+  static const char* strings[] = {"PREFETCH",
+                                  "PAGEFAULT_GPU",
+                                  "PAGEFAULT_CPU",
+                                  "TTM_EVICTION",
+                                  "UNKNOWN"};
+
+  trigger = std::min<uint32_t>(trigger, sizeof(strings) / sizeof(char*) - 1);
+  return strings[trigger];
+}
+
+static const char* smi_eviction_string(uint32_t trigger) {
+  static const char* strings[] = {"SVM",
+                                  "USERPTR",
+                                  "TTM",
+                                  "SUSPEND",
+                                  "CRIU_CHECKPOINT",
+                                  "CRIU_RESTORE",
+                                  "UNKNOWN"};
+
+  trigger = std::min<uint32_t>(trigger, sizeof(strings) / sizeof(char*) - 1);
+  return strings[trigger];
+}
+
+static const char* smi_unmap_string(uint32_t trigger) {
+  static const char* strings[] = {"MMU_NOTIFY",
+                                  "MMU_NOTIFY_MIGRATE",
+                                  "UNMAP_FROM_CPU",
+                                  "UNKNOWN"};
+
+  trigger = std::min<uint32_t>(trigger, sizeof(strings) / sizeof(char*) - 1);
+  return strings[trigger];
+}
+
+// Scanners for SMI event text.  They follow the sscanf conventions the event format was
+// written for: numbers skip leading blanks and literals must match.
+static inline void SkipBlanks(const char*& cursor) {
+  while (*cursor == ' ' || *cursor == '\t') cursor++;
+}
+
+static bool ScanHex(const char*& cursor, uint64_t& value) {
+  SkipBlanks(cursor);
+  const char* start = cursor;
+  value = 0;
+  while (true) {
+    char c = *cursor;
+    uint32_t digit;
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else
+      break;
+    value = (value << 4) | digit;
+    cursor++;
+  }
+  return cursor != start;
+}
+
+static bool ScanDec(const char*& cursor, uint64_t& value) {
+  SkipBlanks(cursor);
+  const char* start = cursor;
+  value = 0;
+  while (*cursor >= '0' && *cursor <= '9') {
+    value = value * 10 + (*cursor - '0');
+    cursor++;
+  }
+  return cursor != start;
+}
+
+static bool ScanChar(const char*& cursor, char expected) {
+  SkipBlanks(cursor);
+  if (*cursor != expected) return false;
+  cursor++;
+  return true;
+}
+
+// @addr(size) - addr and size in pages.
+static bool ScanRange(const char*& cursor, SvmTraceRecord& record) {
+  uint64_t addr, size;
+  if (!ScanChar(cursor, '@') || !ScanHex(cursor, addr) || !ScanChar(cursor, '(') ||
+      !ScanHex(cursor, size) || !ScanChar(cursor, ')'))
+    return false;
+  record.address = addr * 4096;
+  record.size = size * 4096;
+  return true;
+}
+
+static bool ScanU32(const char*& cursor, uint32_t& value, bool hex) {
+  uint64_t v;
+  if (!(hex ? ScanHex(cursor, v) : ScanDec(cursor, v))) return false;
+  value = uint32_t(v);
+  return true;
+}
+
+static bool ScanTrigger(const char*& cursor, SvmTraceRecord& record) {
+  uint32_t trigger;
+  if (!ScanU32(cursor, trigger, false)) return false;
+  record.trigger = uint8_t(std::min<uint32_t>(trigger, UINT8_MAX));
+  return true;
+}
+
+// Nothing but blanks may follow a record.
+static bool ScanEnd(const char*& cursor) {
+  SkipBlanks(cursor);
+  return *cursor == '\0';
+}
+
+/* Event records follow the format:
+   event_id timestamp -pid event_specific_info trigger
+   timestamp, pid, and trigger are in dec.  All other are hex.
+   event_specific substring is listed for each event type.
+   See kfd_ioctl.h for more info.  */
+bool ParseSmiRecord(const char* cursor, SvmTraceRecord& record) {
+  memset(&record, 0, sizeof(record));
+
+  uint64_t event_id, pid;
+  if (!ScanHex(cursor, event_id) || !ScanDec(cursor, record.timestamp) ||
+      !ScanChar(cursor, '-') || !ScanDec(cursor, pid))
+    return false;
+  record.event = uint16_t(event_id);
+  record.pid = uint32_t(pid);
+
+  uint32_t ignore;
+  switch (event_id) {
+    //@addr(size) from->to prefetch_location:preferred_location trigger
+    case HSA_SMI_EVENT_MIGRATE_START:
+      return ScanRange(cursor, record) && ScanU32(cursor, record.from, true) &&
+          ScanChar(cursor, '-') && ScanChar(cursor, '>') && ScanU32(cursor, record.to, true) &&
+          ScanU32(cursor, ignore, true) && ScanChar(cursor, ':') &&
+          ScanU32(cursor, ignore, true) && ScanTrigger(cursor, record) && ScanEnd(cursor);
+    //@addr(size) from->to trigger
+    case HSA_SMI_EVENT_MIGRATE_END:
+      return ScanRange(cursor, record) && ScanU32(cursor, record.from, true) &&
+          ScanChar(cursor, '-') && ScanChar(cursor, '>') && ScanU32(cursor, record.to, true) &&
+          ScanTrigger(cursor, record) && ScanEnd(cursor);
+    //@addr(gpu_id) W/R or M/U (migration / page table update)
+    case HSA_SMI_EVENT_PAGE_FAULT_START:
+    case HSA_SMI_EVENT_PAGE_FAULT_END: {
+      uint64_t addr;
+      if (!ScanChar(cursor, '@') || !ScanHex(cursor, addr) || !ScanChar(cursor, '(') ||
+          !ScanU32(cursor, record.from, true) || !ScanChar(cursor, ')'))
+        return false;
+      record.address = addr * 4096;
+      SkipBlanks(cursor);
+      record.mode = *cursor;
+      if (record.mode == '\0') return false;
+      cursor++;
+      return ScanEnd(cursor);
+    }
+    // gpu_id trigger
+    case HSA_SMI_EVENT_QUEUE_EVICTION:
+      return ScanU32(cursor, record.from, true) && ScanTrigger(cursor, record) && ScanEnd(cursor);
+    // gpu_id, followed by R if the restore was rescheduled
+    case HSA_SMI_EVENT_QUEUE_RESTORE:
+      if (!ScanU32(cursor, record.from, true)) return false;
+      SkipBlanks(cursor);
+      if (*cursor == 'R') record.mode = *cursor++;
+      return ScanEnd(cursor);
+    //@addr(size) gpu_id trigger
+    case HSA_SMI_EVENT_UNMAP_FROM_GPU:
+      return ScanRange(cursor, record) && ScanU32(cursor, record.from, true) &&
+          ScanTrigger(cursor, record) && ScanEnd(cursor);
+    default:
+      return true;
+  }
+}
+
+static void PrintAgent(FILE* file, uint32_t gpu_id, const std::vector<SvmTraceAgent>& agents) {
+  for (auto& agent : agents) {
+    if (agent.gpu_id != gpu_id) continue;
+    if (agent.enumeration_index == kSvmTraceCpuIndex)
+      fputs("CPU", file);
+    else
+      fprintf(file, "GPU%u(%p)", agent.enumeration_index, reinterpret_cast<void*>(agent.handle));
+    return;
+  }
+  fprintf(file, "UNKNOWN(%x)", gpu_id);
+}
+
+void PrintSvmTraceRecord(FILE* file, const SvmTraceRecord& record,
+                         const std::vector<SvmTraceAgent>& agents) {
+  if (record.event == SVM_TRACE_EVENT_DROPPED) {
+    fprintf(file, "ROCr HMM event: %" PRIu64 " %" PRIu64 " events dropped on ", record.timestamp,
+            record.size);
+    PrintAgent(file, record.from, agents);
+    fputc('\n', file);
+    return;
+  }
+  if (record.event == SVM_TRACE_EVENT_ERROR) {
+    fprintf(file, "ROCr HMM event error: Read returned %" PRId64 ", %s (%d) on ",
+            int64_t(record.address), strerror(int(record.size)), int(record.size));
+    PrintAgent(file, record.from, agents);
+    fputc('\n', file);
+    return;
+  }
+
+  fprintf(file, "ROCr HMM event: %" PRIu64 " %s ", record.timestamp,
+          smi_event_string(record.event));
+  void* first = reinterpret_cast<void*>(record.address);
+  void* last = reinterpret_cast<void*>(record.address + record.size - 1);
+  switch (record.event) {
+    case HSA_SMI_EVENT_MIGRATE_START:
+    case HSA_SMI_EVENT_MIGRATE_END:
+      fprintf(file, "%s ", smi_migrate_string(record.trigger));
+      PrintAgent(file, record.from, agents);
+      fputs("->", file);
+      PrintAgent(file, record.to, agents);
+      fprintf(file, " [%p, %p]", first, last);
+      break;
+    case HSA_SMI_EVENT_PAGE_FAULT_START:
+    case HSA_SMI_EVENT_PAGE_FAULT_END:
+      if (record.event == HSA_SMI_EVENT_PAGE_FAULT_START)
+        fputs((record.mode == 'W') ? "Write " : "Read ", file);
+      else
+        fputs((record.mode == 'M') ? "Migration " : "Map ", file);
+      PrintAgent(file, record.from, agents);
+      fprintf(file, " %" PRIu64, record.address);
+      break;
+    case HSA_SMI_EVENT_QUEUE_EVICTION:
+      fprintf(file, "%s ", smi_eviction_string(record.trigger));
+      PrintAgent(file, record.from, agents);
+      break;
+    case HSA_SMI_EVENT_QUEUE_RESTORE:
+      if (record.mode == 'R') fputs("RESCHEDULED ", file);
+      PrintAgent(file, record.from, agents);
+      break;
+    case HSA_SMI_EVENT_UNMAP_FROM_GPU:
+      fprintf(file, "%s ", smi_unmap_string(record.trigger));
+      PrintAgent(file, record.from, agents);
+      fprintf(file, " [%p, %p]", first, last);
+      break;
+    default:;
+  }
+  fputc('\n', file);
+}
+
+bool DecodeSvmTrace(FILE* in, FILE* out) {
+  SvmTraceHeader header;
+  if ((fread(&header, sizeof(header), 1, in) != 1) ||
+      (memcmp(header.magic, kSvmTraceMagic, sizeof(header.magic)) != 0) ||
+      (header.version != kSvmTraceVersion) || (header.record_size != sizeof(SvmTraceRecord)) ||
+      (header.agent_count > kSvmTraceMaxAgents))
+    return false;
+
+  std::vector<SvmTraceAgent> agents(header.agent_count);
+  if (!agents.empty() && (fread(&agents[0], sizeof(SvmTraceAgent), agents.size(), in) !=
+                          agents.size()))
+    return false;
+
+  std::vector<SvmTraceRecord> records;
+  SvmTraceRecord record;
+  size_t got;
+  while ((got = fread(&record, 1, sizeof(record), in)) == sizeof(record))
+    records.push_back(record);
+  // Records of different GPUs are written in batches, restore the time order.
+  std::stable_sort(records.begin(), records.end(),
+                   [](const SvmTraceRecord& a, const SvmTraceRecord& b) {
+                     return a.timestamp < b.timestamp;
+                   });
+  for (const auto& rec : records) PrintSvmTraceRecord(out, rec, agents);
+
+  // A partial record means the trace was cut short.
+  return (got == 0) && (ferror(in) == 0);
+}
+
+}  // namespace AMD
+}  // namespace rocr
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Offline decoder for binary runtime logs (HSA_LOG_MODE=binary) and binary SVM traces
+// (HSA_SVM_PROFILE_FORMAT=binary).  Prints them in the text format of the non binary modes, the
+// kind of input is told from its magic.
+//
+// Usage: rocr-log-decode <binary log or trace> [output]
+
+#include <stdio.h>
+#include <string.h>
+
+#include "core/inc/svm_profiler.h"
+#include "core/util/logger.h"
+
+int main(int argc, char** argv) {
+  if ((argc < 2) || (argc > 3)) {
+    fprintf(stderr, "Usage: %s <binary log or trace> [output]\n", argv[0]);
+    return 2;
+  }
+
+  FILE* in = fopen(argv[1], "rb");
+  if (in == nullptr) {
+    perror(argv[1]);
+    return 1;
+  }
+  FILE* out = (argc == 3) ? fopen(argv[2], "w") : stdout;
+  if (out == nullptr) {
+    perror(argv[2]);
+    fclose(in);
+    return 1;
+  }
+
+  char magic[8] = {};
+  bool svm = (fread(magic, 1, sizeof(magic), in) == sizeof(magic)) &&
+      (memcmp(magic, rocr::AMD::kSvmTraceMagic, sizeof(magic)) == 0);
+  rewind(in);
+
+  bool ok = svm ? rocr::AMD::DecodeSvmTrace(in, out) : rocr::DecodeBinaryLog(in, out);
+  if (!ok) fprintf(stderr, "%s: malformed or truncated input\n", argv[1]);
+
+  fclose(in);
+  if (out != stdout) fclose(out);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,400 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Drives the AIE submission engine over a host ring buffer.  Command chains go to a recording
+// sink.  The OS layer comes from host_os.cpp and the signal entry points are stubbed below.
+
+#include "core/inc/amd_aie_cmd_submitter.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/inc/signal.h"
+#include "core/util/atomic_helpers.h"
+#include "gtest/gtest.h"
+
+namespace rocr {
+namespace core {
+Signal::~Signal() {}
+void Signal::registerIpc() {}
+Signal* Signal::lookupIpc(hsa_signal_t signal) { return nullptr; }
+uint32_t Signal::WaitAny(uint32_t signal_count, const hsa_signal_t* hsa_signals,
+                         const hsa_signal_condition_t* conds, const hsa_signal_value_t* values,
+                         uint64_t timeout_hint, hsa_wait_state_t wait_hint,
+                         hsa_signal_value_t* satisfying_value) {
+  for (uint32_t i = 0; i < signal_count; i++) {
+    const hsa_signal_value_t value = Convert(hsa_signals[i])->LoadAcquire();
+    if (value == values[i]) {
+      *satisfying_value = value;
+      return i;
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::nanoseconds(timeout_hint));
+  return signal_count;
+}
+}  // namespace core
+}  // namespace rocr
+
+using namespace rocr;
+using namespace rocr::AMD;
+using rocr::core::AqlPacket;
+
+namespace {
+
+// Holds the ABI block so it is constructed before the Signal base that links to it.
+struct SignalBlock {
+  core::SharedSignal shared;
+};
+
+// Host-only signal with the value semantics of a default signal.
+class TestSignal : private SignalBlock, public core::Signal {
+ public:
+  explicit TestSignal(hsa_signal_value_t value) : core::Signal(&shared) {
+    signal_.value = value;
+  }
+  ~TestSignal() {}
+
+  hsa_signal_t handle() { return Convert(this); }
+
+  hsa_signal_value_t LoadRelaxed() override { return atomic::Load(&signal_.value); }
+  hsa_signal_value_t LoadAcquire() override {
+    return atomic::Load(&signal_.value, std::memory_order_acquire);
+  }
+  void StoreRelaxed(hsa_signal_value_t value) override { atomic::Store(&signal_.value, value); }
+  void StoreRelease(hsa_signal_value_t value) override {
+    atomic::Store(&signal_.value, value, std::memory_order_release);
+  }
+
+  hsa_signal_value_t WaitRelaxed(hsa_signal_condition_t condition,
+                                 hsa_signal_value_t compare_value, uint64_t timeout,
+                                 hsa_wait_state_t wait_hint) override {
+    return WaitAcquire(condition, compare_value, timeout, wait_hint);
+  }
+  // Only equality waits are used by the submitter.
+  hsa_signal_value_t WaitAcquire(hsa_signal_condition_t condition,
+                                 hsa_signal_value_t compare_value, uint64_t timeout,
+                                 hsa_wait_state_t wait_hint) override {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeout);
+    hsa_signal_value_t value = LoadAcquire();
+    while (value != compare_value && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      value = LoadAcquire();
+    }
+    return value;
+  }
+
+#define TEST_SIGNAL_RMW(Op)                                                                       \
+  void Op##Relaxed(hsa_signal_value_t value) override { atomic::Op(&signal_.value, value); }      \
+  void Op##Acquire(hsa_signal_value_t value) override {                                           \
+    atomic::Op(&signal_.value, value, std::memory_order_acquire);                                 \
+  }                                                                                               \
+  void Op##Release(hsa_signal_value_t value) override {                                           \
+    atomic::Op(&signal_.value, value, std::memory_order_release);                                 \
+  }                                                                                               \
+  void Op##AcqRel(hsa_signal_value_t value) override {                                            \
+    atomic::Op(&signal_.value, value, std::memory_order_acq_rel);                                 \
+  }
+  TEST_SIGNAL_RMW(And)
+  TEST_SIGNAL_RMW(Or)
+  TEST_SIGNAL_RMW(Xor)
+  TEST_SIGNAL_RMW(Add)
+  TEST_SIGNAL_RMW(Sub)
+#undef TEST_SIGNAL_RMW
+
+  hsa_signal_value_t ExchRelaxed(hsa_signal_value_t value) override {
+    return atomic::Exchange(&signal_.value, value);
+  }
+  hsa_signal_value_t ExchAcquire(hsa_signal_value_t value) override {
+    return atomic::Exchange(&signal_.value, value, std::memory_order_acquire);
+  }
+  hsa_signal_value_t ExchRelease(hsa_signal_value_t value) override {
+    return atomic::Exchange(&signal_.value, value, std::memory_order_release);
+  }
+  hsa_signal_value_t ExchAcqRel(hsa_signal_value_t value) override {
+    return atomic::Exchange(&signal_.value, value, std::memory_order_acq_rel);
+  }
+
+  hsa_signal_value_t CasRelaxed(hsa_signal_value_t expected, hsa_signal_value_t value) override {
+    return atomic::Cas(&signal_.value, value, expected);
+  }
+  hsa_signal_value_t CasAcquire(hsa_signal_value_t expected, hsa_signal_value_t value) override {
+    return atomic::Cas(&signal_.value, value, expected, std::memory_order_acquire);
+  }
+  hsa_signal_value_t CasRelease(hsa_signal_value_t expected, hsa_signal_value_t value) override {
+    return atomic::Cas(&signal_.value, value, expected, std::memory_order_release);
+  }
+  hsa_signal_value_t CasAcqRel(hsa_signal_value_t expected, hsa_signal_value_t value) override {
+    return atomic::Cas(&signal_.value, value, expected, std::memory_order_acq_rel);
+  }
+
+  hsa_signal_value_t* ValueLocation() const override {
+    return const_cast<hsa_signal_value_t*>(&signal_.value);
+  }
+  HsaEvent* EopEvent() override { return nullptr; }
+
+ protected:
+  bool _IsA(rtti_t id) const override { return false; }
+};
+
+// Records the opcodes of each chain.  WaitChain blocks while the sink is held so tests can
+// observe packets that were submitted but not yet retired.
+class RecordingSink : public AieCommandSink {
+ public:
+  hsa_status_t SubmitChain(uint32_t hw_ctx, const hsa_amd_aie_ert_packet_t* const* cmds,
+                           uint32_t count, uint64_t* seq) override {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::vector<uint32_t> opcodes;
+    for (uint32_t i = 0; i < count; i++) opcodes.push_back(cmds[i]->opcode);
+    chains_.push_back(opcodes);
+    hw_ctxs_.push_back(hw_ctx);
+    *seq = next_seq_++;
+    return HSA_STATUS_SUCCESS;
+  }
+
+  hsa_status_t WaitChain(uint32_t hw_ctx, uint64_t seq) override {
+    std::unique_lock<std::mutex> lock(lock_);
+    released_.wait(lock, [this] { return !held_; });
+    waited_.push_back(seq);
+    return HSA_STATUS_SUCCESS;
+  }
+
+  void Hold(bool held) {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      held_ = held;
+    }
+    released_.notify_all();
+  }
+
+  std::vector<std::vector<uint32_t>> chains() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return chains_;
+  }
+  std::vector<uint32_t> hw_ctxs() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return hw_ctxs_;
+  }
+  std::vector<uint64_t> waited() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return waited_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable released_;
+  bool held_ = false;
+  uint64_t next_seq_ = 1;
+  std::vector<std::vector<uint32_t>> chains_;
+  std::vector<uint32_t> hw_ctxs_;
+  std::vector<uint64_t> waited_;
+};
+
+const uint32_t kHwCtx = 7;
+const uint32_t kQueueSize = 128;
+
+// Queue storage is over-aligned, so it lives outside the heap allocated fixture.
+amd_queue_t g_queue;
+AqlPacket g_ring[kQueueSize];
+
+class AieCommandSubmitterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&g_queue, 0, sizeof(g_queue));
+    memset(g_ring, 0, sizeof(g_ring));
+    for (AqlPacket& pkt : g_ring)
+      pkt.packet.header = HSA_PACKET_TYPE_INVALID << HSA_PACKET_HEADER_TYPE;
+    g_queue.hsa_queue.base_address = g_ring;
+    g_queue.hsa_queue.size = kQueueSize;
+    memset(payload_, 0, sizeof(payload_));
+    submitter_.reset(new AieCommandSubmitter(sink_, g_queue, kHwCtx));
+  }
+
+  void TearDown() override {
+    sink_.Hold(false);
+    submitter_.reset();
+  }
+
+  // Writes the packet body, then publishes the header the way an application does.
+  void Publish(const AqlPacket& pkt) {
+    const uint64_t index = g_queue.write_dispatch_id;
+    AqlPacket& slot = g_ring[index & (kQueueSize - 1)];
+    memcpy(&slot.packet.body, &pkt.packet.body, sizeof(slot.packet.body));
+    atomic::Store(&slot.packet.header, pkt.packet.header, std::memory_order_release);
+    atomic::Store(&g_queue.write_dispatch_id, index + 1, std::memory_order_release);
+  }
+
+  void PublishErt(uint32_t opcode) {
+    AqlPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    hsa_amd_aie_ert_packet_t& ert = reinterpret_cast<hsa_amd_aie_ert_packet_t&>(pkt);
+    ert.header.header = HSA_PACKET_TYPE_VENDOR_SPECIFIC << HSA_PACKET_HEADER_TYPE;
+    ert.header.AmdFormat = HSA_AMD_PACKET_TYPE_AIE_ERT;
+    ert.opcode = opcode;
+    ert.count = 2;
+    ert.payload_data = reinterpret_cast<uintptr_t>(payload_);
+    Publish(pkt);
+  }
+
+  void PublishBarrier(hsa_signal_t dep, hsa_signal_t completion) {
+    AqlPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.barrier_and.header = HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE;
+    pkt.barrier_and.dep_signal[0] = dep;
+    pkt.barrier_and.completion_signal = completion;
+    Publish(pkt);
+  }
+
+  // Waits for the retire thread to advance the read index to at least @p index.
+  bool WaitForReadIndex(uint64_t index) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (atomic::Load(&g_queue.read_dispatch_id, std::memory_order_acquire) < index) {
+      if (std::chrono::steady_clock::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+  }
+
+  uint64_t ReadIndex() { return atomic::Load(&g_queue.read_dispatch_id, std::memory_order_acquire); }
+
+  void SettleRetireThread() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); }
+
+  uint32_t payload_[2];
+  RecordingSink sink_;
+  std::unique_ptr<AieCommandSubmitter> submitter_;
+};
+
+}  // namespace
+
+TEST_F(AieCommandSubmitterTest, CoalescesKernelStarts) {
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  PublishErt(HSA_AMD_AIE_ERT_START_CU);
+  PublishErt(HSA_AMD_AIE_ERT_START_DPU);
+  submitter_->Submit();
+  ASSERT_TRUE(WaitForReadIndex(4));
+
+  const std::vector<std::vector<uint32_t>> chains = sink_.chains();
+  ASSERT_EQ(chains.size(), 1u);
+  EXPECT_EQ(chains[0], std::vector<uint32_t>({HSA_AMD_AIE_ERT_START_NPU, HSA_AMD_AIE_ERT_START_NPU,
+                                              HSA_AMD_AIE_ERT_START_CU,
+                                              HSA_AMD_AIE_ERT_START_DPU}));
+  EXPECT_EQ(sink_.hw_ctxs(), std::vector<uint32_t>({kHwCtx}));
+}
+
+TEST_F(AieCommandSubmitterTest, SplitsChainsAtMaxLength) {
+  const uint32_t kMaxChain = AieCommandSubmitter::kMaxChainLength;
+  const uint32_t kPackets = kMaxChain + 8;
+  for (uint32_t i = 0; i < kPackets; i++) PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  submitter_->Submit();
+  ASSERT_TRUE(WaitForReadIndex(kPackets));
+
+  const std::vector<std::vector<uint32_t>> chains = sink_.chains();
+  ASSERT_EQ(chains.size(), 2u);
+  EXPECT_EQ(chains[0].size(), kMaxChain);
+  EXPECT_EQ(chains[1].size(), 8u);
+}
+
+TEST_F(AieCommandSubmitterTest, SubmitsControlCommandsAlone) {
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  PublishErt(HSA_AMD_AIE_ERT_CONFIGURE);
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  submitter_->Submit();
+  ASSERT_TRUE(WaitForReadIndex(4));
+
+  const std::vector<std::vector<uint32_t>> chains = sink_.chains();
+  ASSERT_EQ(chains.size(), 3u);
+  EXPECT_EQ(chains[0].size(), 2u);
+  EXPECT_EQ(chains[1], std::vector<uint32_t>({HSA_AMD_AIE_ERT_CONFIGURE}));
+  EXPECT_EQ(chains[2].size(), 1u);
+}
+
+TEST_F(AieCommandSubmitterTest, BarrierBlocksLaterCommands) {
+  TestSignal dep(1);
+  TestSignal done(1);
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  PublishBarrier(dep.handle(), done.handle());
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  submitter_->Submit();
+  ASSERT_TRUE(WaitForReadIndex(1));
+
+  // Another doorbell ring must not let the last command overtake the barrier.
+  submitter_->Submit();
+  SettleRetireThread();
+  EXPECT_EQ(sink_.chains().size(), 1u);
+  EXPECT_EQ(ReadIndex(), 1u);
+  EXPECT_EQ(done.LoadAcquire(), 1);
+
+  dep.StoreRelease(0);
+  ASSERT_TRUE(WaitForReadIndex(3));
+  EXPECT_EQ(sink_.chains().size(), 2u);
+  EXPECT_EQ(done.LoadAcquire(), 0);
+}
+
+TEST_F(AieCommandSubmitterTest, RetiresAfterChainCompletes) {
+  TestSignal done(1);
+  sink_.Hold(true);
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  PublishErt(HSA_AMD_AIE_ERT_START_NPU);
+  PublishErt(HSA_AMD_AIE_ERT_CONFIGURE);
+  PublishBarrier(hsa_signal_t{0}, done.handle());
+  submitter_->Submit();
+
+  // Nothing retires while the device still owns the first chain.
+  SettleRetireThread();
+  EXPECT_EQ(sink_.chains().size(), 2u);
+  EXPECT_EQ(ReadIndex(), 0u);
+  EXPECT_EQ(done.LoadAcquire(), 1);
+  EXPECT_EQ(AqlPacket::type(g_ring[0].packet.header), HSA_PACKET_TYPE_VENDOR_SPECIFIC);
+
+  sink_.Hold(false);
+  ASSERT_TRUE(WaitForReadIndex(4));
+  EXPECT_EQ(sink_.waited(), std::vector<uint64_t>({1, 2}));
+  EXPECT_EQ(done.LoadAcquire(), 0);
+  for (uint32_t i = 0; i < 4; i++)
+    EXPECT_EQ(AqlPacket::type(g_ring[i].packet.header), HSA_PACKET_TYPE_INVALID);
+}
@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_blit_dispatch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr::AMD;
+
+namespace {
+
+BlitDispatchTemplate MakeTemplate(uint32_t workitems, uint64_t block) {
+  BlitDispatchTemplate dispatch;
+  dispatch.Init(0xABCD000, workitems, block);
+  return dispatch;
+}
+
+}  // namespace
+
+TEST(BlitDispatch, TemplatePacket) {
+  BlitDispatchTemplate dispatch = MakeTemplate(1000, 4096);
+  const hsa_kernel_dispatch_packet_t& packet = dispatch.packet;
+  EXPECT_EQ(packet.header, HSA_PACKET_TYPE_INVALID);
+  EXPECT_EQ(packet.setup, 1u << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS);
+  EXPECT_EQ(packet.kernel_object, 0xABCD000u);
+  EXPECT_EQ(packet.grid_size_x, 1024u);
+  EXPECT_EQ(packet.grid_size_y, 1u);
+  EXPECT_EQ(packet.grid_size_z, 1u);
+  EXPECT_EQ(packet.workgroup_size_x, 64u);
+  EXPECT_EQ(packet.workgroup_size_y, 1u);
+  EXPECT_EQ(packet.workgroup_size_z, 1u);
+  EXPECT_EQ(packet.private_segment_size, 0u);
+  EXPECT_EQ(packet.group_segment_size, 0u);
+  EXPECT_EQ(dispatch.num_workitems, 1000u);
+  EXPECT_EQ(dispatch.block_size, 4096u);
+}
+
+TEST(BlitDispatch, BuildOnlyFillsKernargAndSignal) {
+  BlitDispatchTemplate dispatch = MakeTemplate(256, 4096);
+  BlitKernelArgs args;
+  hsa_signal_t signal = {0x5150};
+  hsa_kernel_dispatch_packet_t packet = dispatch.Build(&args, signal);
+
+  EXPECT_EQ(packet.kernarg_address, &args);
+  EXPECT_EQ(packet.completion_signal.handle, signal.handle);
+  EXPECT_EQ(packet.header, HSA_PACKET_TYPE_INVALID);
+
+  packet.kernarg_address = nullptr;
+  packet.completion_signal.handle = 0;
+  EXPECT_EQ(memcmp(&packet, &dispatch.packet, sizeof(packet)), 0);
+}
+
+TEST(BlitDispatch, CopyAlignedPhases) {
+  BlitDispatchTemplate dispatch = MakeTemplate(512, 512 * 16);
+  const uintptr_t dst = 0x10010, src = 0x20010;
+  for (uint64_t size : {0ull, 1ull, 3ull, 240ull, 241ull, 8192ull + 240ull, 100000ull}) {
+    BlitKernelArgs args;
+    dispatch.SetCopyAlignedArgs(dst, src, size, &args);
+    const auto& a = args.copy_aligned;
+
+    EXPECT_EQ(a.phase1_src_start, src);
+    EXPECT_EQ(a.phase1_dst_start, dst);
+    EXPECT_EQ(a.phase4_src_end, src + size);
+    EXPECT_EQ(a.phase4_dst_end, dst + size);
+    EXPECT_EQ(a.num_workitems, 512u);
+
+    // Phases are contiguous, in order and identical for source and destination.
+    EXPECT_LE(a.phase1_dst_start, a.phase2_dst_start);
+    EXPECT_LE(a.phase2_dst_start, a.phase3_dst_start);
+    EXPECT_LE(a.phase3_dst_start, a.phase4_dst_start);
+    EXPECT_LE(a.phase4_dst_start, a.phase4_dst_end);
+    EXPECT_EQ(a.phase2_src_start - src, a.phase2_dst_start - dst);
+    EXPECT_EQ(a.phase3_src_start - src, a.phase3_dst_start - dst);
+    EXPECT_EQ(a.phase4_src_start - src, a.phase4_dst_start - dst);
+
+    // Byte head up to 256 byte alignment, whole blocks, whole dwords, byte tail.
+    if (a.phase2_dst_start != a.phase4_dst_end) {
+      EXPECT_EQ(a.phase2_dst_start & 0xFF, 0u);
+    }
+    EXPECT_EQ((a.phase3_dst_start - a.phase2_dst_start) % dispatch.block_size, 0u);
+    EXPECT_LT(a.phase4_dst_start - a.phase3_dst_start, dispatch.block_size);
+    EXPECT_EQ((a.phase4_dst_start - a.phase3_dst_start) % 4, 0u);
+    EXPECT_LT(a.phase4_dst_end - a.phase4_dst_start, 4u);
+  }
+}
+
+TEST(BlitDispatch, CopyMisalignedPhases) {
+  BlitDispatchTemplate dispatch = MakeTemplate(512, 2048);
+  const uintptr_t dst = 0x10001, src = 0x20002;
+  BlitKernelArgs args;
+  dispatch.SetCopyMisalignedArgs(dst, src, 2048 * 3 + 17, &args);
+  const auto& a = args.copy_misaligned;
+  EXPECT_EQ(a.phase1_src_start, src);
+  EXPECT_EQ(a.phase1_dst_start, dst);
+  EXPECT_EQ(a.phase2_src_start, src + 2048 * 3);
+  EXPECT_EQ(a.phase2_dst_start, dst + 2048 * 3);
+  EXPECT_EQ(a.phase2_src_end, src + 2048 * 3 + 17);
+  EXPECT_EQ(a.phase2_dst_end, dst + 2048 * 3 + 17);
+  EXPECT_EQ(a.num_workitems, 512u);
+}
+
+TEST(BlitDispatch, FillPhases) {
+  BlitDispatchTemplate dispatch = MakeTemplate(128, 128 * 16);
+  BlitKernelArgs args;
+  dispatch.SetFillArgs(0x40000, 0xDEADBEEF, 128 * 16 * 2 + 12, &args);
+  const auto& f = args.fill;
+  EXPECT_EQ(f.phase1_dst_start, 0x40000u);
+  EXPECT_EQ(f.phase2_dst_start, 0x40000u + 128 * 16 * 2);
+  EXPECT_EQ(f.phase2_dst_end, 0x40000u + 128 * 16 * 2 + 12);
+  EXPECT_EQ(f.fill_value, 0xDEADBEEFu);
+  EXPECT_EQ(f.num_workitems, 128u);
+}
+
+// A kernarg entry is shared only by packets a full queue apart, which can not be in flight
+// together.
+TEST(BlitKernargSlab, SlotPerQueueEntry) {
+  const uint32_t kSlots = 16;
+  void* mem = aligned_alloc(16, BlitKernargSlab::Bytes(kSlots));
+  ASSERT_NE(mem, nullptr);
+  BlitKernargSlab slab;
+  slab.Init(mem, kSlots);
+  EXPECT_EQ(slab.base(), mem);
+
+  for (uint64_t read = 0; read < 5 * kSlots; read += 3) {
+    std::set<BlitKernelArgs*> in_flight;
+    for (uint64_t index = read; index < read + kSlots; index++) {
+      BlitKernelArgs* args = slab.At(index);
+      EXPECT_EQ(uintptr_t(args) % 16, 0u);
+      EXPECT_GE(uintptr_t(args), uintptr_t(mem));
+      EXPECT_LT(uintptr_t(args), uintptr_t(mem) + BlitKernargSlab::Bytes(kSlots));
+      EXPECT_TRUE(in_flight.insert(args).second) << "index " << index;
+      EXPECT_EQ(args, slab.At(index + kSlots));
+    }
+  }
+  free(mem);
+}
+
+// Pending bytes are those of packets at or after the read index.  Barrier packets carry no
+// record.
+TEST(BlitHistory, PendingBytes) {
+  BlitHistory history;
+  history.Init(8);
+  history.Record(100, 0);
+  history.Record(200, 2);  // Behind a barrier at index 1.
+  history.Record(300, 3);
+
+  EXPECT_EQ(history.PendingBytes(0), 600u);
+  EXPECT_EQ(history.PendingBytes(1), 500u);
+  EXPECT_EQ(history.PendingBytes(2), 500u);
+  EXPECT_EQ(history.PendingBytes(3), 300u);
+  EXPECT_EQ(history.PendingBytes(4), 0u);
+}
+
+TEST(BlitHistory, RecordsWrapWithQueue) {
+  BlitHistory history;
+  history.Init(4);
+  uint64_t read = 0;
+  for (uint64_t index = 0; index < 64; index++) {
+    history.Record(10, index);
+    // Keep the queue full, the oldest packet retires as a new one is recorded.
+    if (index >= 3) {
+      read = index - 3;
+      EXPECT_EQ(history.PendingBytes(read), 40u) << "index " << index;
+    }
+  }
+  EXPECT_EQ(history.PendingBytes(read + 3), 10u);
+  EXPECT_EQ(history.PendingBytes(read + 4), 0u);
+}
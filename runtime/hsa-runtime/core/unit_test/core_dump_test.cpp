@@ -0,0 +1,252 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Drives the core dump pipeline with a synthetic segment builder.  The thunk and OS loader
+// entry points referenced by amd_core_dump.cpp are stubbed below.
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "core/inc/amd_core_dump.hpp"
+#include "core/util/os.h"
+#include "hsakmt/hsakmt.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+HSAKMT_STATUS HSAKMTAPI hsaKmtDbgEnable(void** runtime_info, HSAuint32* data_size) {
+  return HSAKMT_STATUS_ERROR;
+}
+HSAKMT_STATUS HSAKMTAPI hsaKmtDbgDisable(void) { return HSAKMT_STATUS_ERROR; }
+HSAKMT_STATUS HSAKMTAPI hsaKmtDbgGetDeviceData(void** data, HSAuint32* n_entries,
+                                               HSAuint32* entry_size) {
+  return HSAKMT_STATUS_ERROR;
+}
+HSAKMT_STATUS HSAKMTAPI hsaKmtDbgGetQueueData(void** data, HSAuint32* n_entries,
+                                              HSAuint32* entry_size, bool suspend_queues) {
+  return HSAKMT_STATUS_ERROR;
+}
+HSAKMT_STATUS HSAKMTAPI hsaKmtGetVersion(HsaVersionInfo* info) { return HSAKMT_STATUS_ERROR; }
+}
+
+namespace rocr {
+namespace os {
+LibHandle LoadLib(std::string filename) { return dlopen(filename.c_str(), RTLD_LAZY); }
+void* GetExportAddress(LibHandle lib, std::string export_name) {
+  return dlsym(lib, export_name.c_str());
+}
+void CloseLib(LibHandle lib) { dlclose(lib); }
+}  // namespace os
+}  // namespace rocr
+
+using namespace rocr::amd::coredump;
+
+namespace {
+
+const size_t kPage = 4096;
+
+// Memory with a recognizable pattern and all-zero pages, read as if it was VRAM.
+struct SyntheticBuilder : public impl::SegmentBuilder {
+  explicit SyntheticBuilder(uint64_t base) : base_(base) {}
+
+  void Add(impl::SegmentsInfo& segments, impl::SegmentType type, size_t size) {
+    impl::SegmentInfo s;
+    s.stype = type;
+    s.vaddr = base_ + data_.size();
+    s.size = size;
+    s.flags = 0;
+    s.builder = this;
+    for (size_t i = 0; i < size; i++) {
+      // Every third page stays zero so sparse output has holes to skip.
+      const bool zero = ((data_.size() / kPage) % 3) == 1;
+      data_.push_back(zero ? 0 : uint8_t(i * 7 + segments.size() + 1));
+    }
+    segments.push_back(s);
+  }
+
+  hsa_status_t Collect(impl::SegmentsInfo& segments) override { return HSA_STATUS_SUCCESS; }
+
+  hsa_status_t Read(void* buf, size_t buf_size, off_t offset) override {
+    if (offset < off_t(base_) || offset - base_ + buf_size > data_.size())
+      return HSA_STATUS_ERROR;
+    memcpy(buf, &data_[offset - base_], buf_size);
+    return HSA_STATUS_SUCCESS;
+  }
+
+  const uint8_t* At(uint64_t vaddr) const { return &data_[vaddr - base_]; }
+
+  uint64_t base_;
+  std::vector<uint8_t> data_;
+};
+
+class CoreDumpTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    struct rlimit limit;
+    ASSERT_EQ(getrlimit(RLIMIT_CORE, &limit), 0);
+    // Dumps honor the core file limit, nothing can be checked below it.
+    if (limit.rlim_max != RLIM_INFINITY) {
+      printf("Core file size is limited, skipped.\n");
+      return;
+    }
+    limit.rlim_cur = RLIM_INFINITY;
+    ASSERT_EQ(setrlimit(RLIMIT_CORE, &limit), 0);
+
+    char dir[] = "/tmp/core_dump_testXXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+
+    builder_.Add(segments_, impl::NOTE, 301);
+    builder_.Add(segments_, impl::LOAD, 9 * 1024 * 1024 + 123);
+    builder_.Add(segments_, impl::LOAD, 5 * kPage);
+  }
+
+  void TearDown() override {
+    if (!dir_.empty()) system(("rm -rf " + dir_).c_str());
+  }
+
+  std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::vector<uint8_t> ret;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) return ret;
+    uint8_t buf[65536];
+    ssize_t got;
+    while ((got = read(fd, buf, sizeof(buf))) > 0) ret.insert(ret.end(), buf, buf + got);
+    close(fd);
+    return ret;
+  }
+
+  // Checks headers and that every segment's data sits at its p_offset.
+  void CheckCore(const std::vector<uint8_t>& core) {
+    ASSERT_GE(core.size(), sizeof(Elf64_Ehdr));
+    const Elf64_Ehdr* ehdr = reinterpret_cast<const Elf64_Ehdr*>(core.data());
+    ASSERT_EQ(memcmp(ehdr->e_ident, ELFMAG, SELFMAG), 0);
+    EXPECT_EQ(ehdr->e_type, ET_CORE);
+    ASSERT_EQ(ehdr->e_phnum, segments_.size());
+
+    const Elf64_Phdr* phdrs = reinterpret_cast<const Elf64_Phdr*>(&core[ehdr->e_phoff]);
+    for (size_t i = 0; i < segments_.size(); i++) {
+      const Elf64_Phdr& phdr = phdrs[i];
+      EXPECT_EQ(phdr.p_type, uint32_t(segments_[i].stype == impl::LOAD ? PT_LOAD : PT_NOTE));
+      EXPECT_EQ(phdr.p_vaddr, segments_[i].vaddr);
+      ASSERT_EQ(phdr.p_filesz, segments_[i].size);
+      ASSERT_LE(phdr.p_offset + phdr.p_filesz, core.size());
+      EXPECT_EQ(memcmp(&core[phdr.p_offset], builder_.At(phdr.p_vaddr), phdr.p_filesz), 0)
+          << "segment " << i;
+    }
+  }
+
+  bool Skipped() const { return dir_.empty(); }
+
+  std::string dir_;
+  SyntheticBuilder builder_{0x7f0000000000ull};
+  impl::SegmentsInfo segments_;
+};
+
+}  // namespace
+
+TEST_F(CoreDumpTest, ParallelSparseFile) {
+  if (Skipped()) return;
+  DumpOptions options;
+  options.threads = 4;
+  options.sparse = true;
+  const std::string path = dir_ + "/core";
+  ASSERT_EQ(impl::build_core_dump(path, segments_, options), HSA_STATUS_SUCCESS);
+  CheckCore(ReadFile(path));
+}
+
+TEST_F(CoreDumpTest, DenseFileMatchesSparse) {
+  if (Skipped()) return;
+  DumpOptions options;
+  options.threads = 3;
+  options.sparse = false;
+  ASSERT_EQ(impl::build_core_dump(dir_ + "/dense", segments_, options), HSA_STATUS_SUCCESS);
+  options.sparse = true;
+  ASSERT_EQ(impl::build_core_dump(dir_ + "/sparse", segments_, options), HSA_STATUS_SUCCESS);
+
+  std::vector<uint8_t> dense = ReadFile(dir_ + "/dense");
+  CheckCore(dense);
+  EXPECT_TRUE(dense == ReadFile(dir_ + "/sparse"));
+}
+
+TEST_F(CoreDumpTest, PipeMatchesFile) {
+  if (Skipped()) return;
+  DumpOptions options;
+  options.threads = 4;
+  ASSERT_EQ(impl::build_core_dump(dir_ + "/file", segments_, options), HSA_STATUS_SUCCESS);
+  options.pipe_command = "cat > " + dir_ + "/piped";
+  ASSERT_EQ(impl::build_core_dump(dir_ + "/unused", segments_, options), HSA_STATUS_SUCCESS);
+
+  std::vector<uint8_t> piped = ReadFile(dir_ + "/piped");
+  CheckCore(piped);
+  EXPECT_TRUE(piped == ReadFile(dir_ + "/file"));
+  EXPECT_NE(access((dir_ + "/unused").c_str(), F_OK), 0);
+}
+
+TEST_F(CoreDumpTest, SuffixOnlyWhenCompressed) {
+  if (Skipped()) return;
+  DumpOptions options;
+  options.compress = true;
+  const std::string path = dir_ + "/core";
+  ASSERT_EQ(impl::build_core_dump(path, segments_, options), HSA_STATUS_SUCCESS);
+
+  void* zstd = dlopen("libzstd.so.1", RTLD_LAZY);
+  if (zstd == nullptr) {
+    // Written uncompressed, so no .zst name.
+    EXPECT_NE(access((path + ".zst").c_str(), F_OK), 0);
+    CheckCore(ReadFile(path));
+    return;
+  }
+  dlclose(zstd);
+  EXPECT_NE(access(path.c_str(), F_OK), 0);
+  std::vector<uint8_t> packed = ReadFile(path + ".zst");
+  ASSERT_GE(packed.size(), 4u);
+  const uint8_t magic[] = {0x28, 0xB5, 0x2F, 0xFD};
+  EXPECT_EQ(memcmp(packed.data(), magic, sizeof(magic)), 0);
+}
@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Minimal pthread backed implementation of the os:: entry points used by the AIE components, host
+// signals and the logger, for tests that cannot link os_linux.cpp and the runtime it depends on.
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "core/util/os.h"
+
+namespace rocr {
+namespace os {
+
+Mutex CreateMutex() {
+  pthread_mutex_t* lock = new pthread_mutex_t;
+  pthread_mutex_init(lock, nullptr);
+  return lock;
+}
+
+bool AcquireMutex(Mutex lock) {
+  return pthread_mutex_lock(reinterpret_cast<pthread_mutex_t*>(lock)) == 0;
+}
+
+void ReleaseMutex(Mutex lock) { pthread_mutex_unlock(reinterpret_cast<pthread_mutex_t*>(lock)); }
+
+void DestroyMutex(Mutex lock) {
+  pthread_mutex_destroy(reinterpret_cast<pthread_mutex_t*>(lock));
+  delete reinterpret_cast<pthread_mutex_t*>(lock);
+}
+
+Semaphore CreateSemaphore() {
+  sem_t* sem = new sem_t;
+  sem_init(sem, 0, 0);
+  return sem;
+}
+
+bool WaitSemaphore(Semaphore sem) {
+  while (sem_wait(reinterpret_cast<sem_t*>(sem)) != 0) {
+  }
+  return true;
+}
+
+void PostSemaphore(Semaphore sem) { sem_post(reinterpret_cast<sem_t*>(sem)); }
+
+void DestroySemaphore(Semaphore sem) {
+  sem_destroy(reinterpret_cast<sem_t*>(sem));
+  delete reinterpret_cast<sem_t*>(sem);
+}
+
+Thread CreateThread(ThreadEntry entry_function, void* entry_argument, uint stack_size) {
+  return new std::thread(entry_function, entry_argument);
+}
+
+bool WaitForThread(Thread thread) {
+  reinterpret_cast<std::thread*>(thread)->join();
+  return true;
+}
+
+void CloseThread(Thread thread) { delete reinterpret_cast<std::thread*>(thread); }
+
+void YieldThread() { sched_yield(); }
+
+void Sleep(int delayInMs) { usleep(delayInMs * 1000); }
+
+int GetProcessId() { return getpid(); }
+
+void FutexWait(volatile uint32_t* address, uint32_t expected, uint64_t timeout_ns) {
+  const uint64_t max_ns = uint64_t(INT32_MAX) * 1000000000ull;
+  if (timeout_ns > max_ns) timeout_ns = max_ns;
+  struct timespec ts;
+  ts.tv_sec = timeout_ns / 1000000000ull;
+  ts.tv_nsec = timeout_ns % 1000000000ull;
+  syscall(SYS_futex, const_cast<uint32_t*>(address), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr,
+          0);
+}
+
+void FutexWake(volatile uint32_t* address) {
+  syscall(SYS_futex, const_cast<uint32_t*>(address), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr,
+          nullptr, 0);
+}
+
+uint64_t ReadAccurateClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+uint64_t AccurateClockFrequency() { return 1000000000; }
+
+// Signal timeouts are in nanoseconds.
+uint64_t SystemClockFrequency() { return 1000000000; }
+
+}  // namespace os
+}  // namespace rocr
@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Exercises the futex backed host signal without a runtime. The shared ABI block comes from page
+// allocations on the host, and signal timeouts are in nanoseconds.
+
+#include "core/inc/host_signal.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "core/inc/hsa_internal.h"
+#include "gtest/gtest.h"
+
+namespace rocr {
+namespace core {
+LocalSignal::LocalSignal(hsa_signal_value_t initial_value, bool exportable)
+    : local_signal_(nullptr, 0) {
+  local_signal_.shared_object()->amd_signal.value = initial_value;
+}
+SharedSignal* SharedSignalPool_t::alloc() { return nullptr; }
+void SharedSignalPool_t::free(SharedSignal* ptr) {}
+Signal::~Signal() { signal_.kind = AMD_SIGNAL_KIND_INVALID; }
+void Signal::Release() {
+  if (--retained_ == 0) doDestroySignal();
+}
+void Signal::registerIpc() {}
+Signal* Signal::lookupIpc(hsa_signal_t signal) { return nullptr; }
+}  // namespace core
+
+namespace HSA {
+hsa_status_t hsa_system_get_info(hsa_system_info_t attribute, void* value) {
+  *reinterpret_cast<uint64_t*>(value) = 1000000000;
+  return HSA_STATUS_SUCCESS;
+}
+}  // namespace HSA
+}  // namespace rocr
+
+using namespace rocr;
+using core::HostSignal;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Long enough that a waiter returning early was woken, short enough that a lost wake fails.
+const uint64_t kLong = 10000000000ull;
+const uint64_t kMs = 1000000;
+
+class HostSignalTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    core::BaseShared::SetAllocateAndFree(
+        [](size_t size, size_t align, uint32_t flags, int node) { return aligned_alloc(align, size); },
+        [](void* ptr) { ::free(ptr); });
+  }
+};
+
+// Runs a blocked wait on another thread and returns once it has had time to fall asleep.
+class Waiter {
+ public:
+  Waiter(HostSignal& signal, hsa_signal_condition_t condition, hsa_signal_value_t compare,
+         uint64_t timeout = kLong, hsa_wait_state_t hint = HSA_WAIT_STATE_BLOCKED)
+      : done_(false) {
+    thread_ = std::thread([=, &signal]() {
+      const Clock::time_point start = Clock::now();
+      value_ = signal.WaitAcquire(condition, compare, timeout, hint);
+      elapsed_ = Clock::now() - start;
+      done_ = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  ~Waiter() {
+    if (thread_.joinable()) thread_.join();
+  }
+
+  bool done() const { return done_; }
+  hsa_signal_value_t Join() {
+    thread_.join();
+    return value_;
+  }
+  Clock::duration elapsed() const { return elapsed_; }
+
+ private:
+  std::thread thread_;
+  std::atomic<bool> done_;
+  hsa_signal_value_t value_;
+  Clock::duration elapsed_;
+};
+
+}  // namespace
+
+TEST_F(HostSignalTest, ConditionsMetImmediately) {
+  HostSignal signal(5);
+  EXPECT_EQ(signal.WaitRelaxed(HSA_SIGNAL_CONDITION_EQ, 5, 0, HSA_WAIT_STATE_BLOCKED), 5);
+  EXPECT_EQ(signal.WaitRelaxed(HSA_SIGNAL_CONDITION_NE, 4, 0, HSA_WAIT_STATE_BLOCKED), 5);
+  EXPECT_EQ(signal.WaitRelaxed(HSA_SIGNAL_CONDITION_GTE, 5, 0, HSA_WAIT_STATE_BLOCKED), 5);
+  EXPECT_EQ(signal.WaitRelaxed(HSA_SIGNAL_CONDITION_LT, 6, 0, HSA_WAIT_STATE_BLOCKED), 5);
+  EXPECT_EQ(signal.LoadAcquire(), 5);
+}
+
+// Unmet conditions return the current value once the timeout expires.
+TEST_F(HostSignalTest, TimeoutReturnsCurrentValue) {
+  HostSignal signal(5);
+  EXPECT_EQ(signal.WaitRelaxed(HSA_SIGNAL_CONDITION_EQ, 4, 0, HSA_WAIT_STATE_BLOCKED), 5);
+  EXPECT_EQ(signal.WaitRelaxed(HSA_SIGNAL_CONDITION_NE, 5, 0, HSA_WAIT_STATE_ACTIVE), 5);
+  EXPECT_EQ(signal.WaitRelaxed(HSA_SIGNAL_CONDITION_GTE, 6, 0, HSA_WAIT_STATE_BLOCKED), 5);
+  EXPECT_EQ(signal.WaitRelaxed(HSA_SIGNAL_CONDITION_LT, 5, 0, HSA_WAIT_STATE_BLOCKED), 5);
+
+  const Clock::time_point start = Clock::now();
+  EXPECT_EQ(signal.WaitAcquire(HSA_SIGNAL_CONDITION_EQ, 0, 50 * kMs, HSA_WAIT_STATE_BLOCKED), 5);
+  const Clock::duration elapsed = Clock::now() - start;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(50));
+  EXPECT_LT(elapsed, std::chrono::seconds(5));
+}
+
+TEST_F(HostSignalTest, UnknownConditionReturnsZero) {
+  HostSignal signal(5);
+  EXPECT_EQ(signal.WaitRelaxed(hsa_signal_condition_t(17), 5, kLong, HSA_WAIT_STATE_BLOCKED),
+            0);
+}
+
+// A sleeping waiter is woken by the update, long before its timeout.
+TEST_F(HostSignalTest, StoreWakesSleepingWaiter) {
+  HostSignal signal(1);
+  Waiter waiter(signal, HSA_SIGNAL_CONDITION_EQ, 0);
+  EXPECT_FALSE(waiter.done());
+  signal.StoreRelease(0);
+  EXPECT_EQ(waiter.Join(), 0);
+  EXPECT_LT(waiter.elapsed(), std::chrono::seconds(5));
+}
+
+// Updates that leave the condition unmet put the waiter back to sleep.
+TEST_F(HostSignalTest, WaiterSleepsAgainOnUnmetUpdate) {
+  HostSignal signal(3);
+  Waiter waiter(signal, HSA_SIGNAL_CONDITION_LT, 1);
+  signal.SubRelease(1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(waiter.done());
+  signal.SubRelease(1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(waiter.done());
+  signal.SubRelease(1);
+  EXPECT_EQ(waiter.Join(), 0);
+}
+
+// Every read-modify-write entry point advances the sequence and wakes sleepers.
+TEST_F(HostSignalTest, EveryUpdateWakes) {
+  struct Update {
+    const char* name;
+    hsa_signal_value_t initial;
+    hsa_signal_condition_t condition;
+    hsa_signal_value_t compare;
+    std::function<void(HostSignal&)> apply;
+  };
+  const std::vector<Update> updates = {
+      {"StoreRelaxed", 1, HSA_SIGNAL_CONDITION_EQ, 2, [](HostSignal& s) { s.StoreRelaxed(2); }},
+      {"AddAcqRel", 1, HSA_SIGNAL_CONDITION_GTE, 3, [](HostSignal& s) { s.AddAcqRel(2); }},
+      {"SubRelaxed", 1, HSA_SIGNAL_CONDITION_LT, 1, [](HostSignal& s) { s.SubRelaxed(1); }},
+      {"AndRelease", 3, HSA_SIGNAL_CONDITION_EQ, 1, [](HostSignal& s) { s.AndRelease(1); }},
+      {"OrAcquire", 1, HSA_SIGNAL_CONDITION_EQ, 5, [](HostSignal& s) { s.OrAcquire(4); }},
+      {"XorRelaxed", 1, HSA_SIGNAL_CONDITION_EQ, 0, [](HostSignal& s) { s.XorRelaxed(1); }},
+      {"ExchAcqRel", 1, HSA_SIGNAL_CONDITION_NE, 1,
+       [](HostSignal& s) { EXPECT_EQ(s.ExchAcqRel(9), 1); }},
+      {"CasRelease", 1, HSA_SIGNAL_CONDITION_EQ, 7,
+       [](HostSignal& s) { EXPECT_EQ(s.CasRelease(1, 7), 1); }},
+  };
+
+  for (const Update& update : updates) {
+    HostSignal signal(update.initial);
+    Waiter waiter(signal, update.condition, update.compare);
+    EXPECT_FALSE(waiter.done()) << update.name;
+    update.apply(signal);
+    waiter.Join();
+    EXPECT_LT(waiter.elapsed(), std::chrono::seconds(5)) << update.name;
+  }
+}
+
+TEST_F(HostSignalTest, WakesAllWaiters) {
+  HostSignal signal(1);
+  std::vector<std::unique_ptr<Waiter>> waiters;
+  for (int i = 0; i < 4; i++)
+    waiters.emplace_back(new Waiter(signal, HSA_SIGNAL_CONDITION_EQ, 0));
+  signal.StoreRelease(0);
+  for (auto& waiter : waiters) {
+    EXPECT_EQ(waiter->Join(), 0);
+    EXPECT_LT(waiter->elapsed(), std::chrono::seconds(5));
+  }
+}
+
+TEST_F(HostSignalTest, ActiveWaitSeesUpdates) {
+  HostSignal signal(1);
+  Waiter waiter(signal, HSA_SIGNAL_CONDITION_EQ, 0, kLong, HSA_WAIT_STATE_ACTIVE);
+  EXPECT_FALSE(waiter.done());
+  signal.StoreRelease(0);
+  EXPECT_EQ(waiter.Join(), 0);
+}
+
+// Writes through the raw value location don't advance the sequence, so a sleeping waiter only
+// sees them when its timeout expires.
+TEST_F(HostSignalTest, RawWritesSeenAtTimeout) {
+  HostSignal signal(1);
+  Waiter waiter(signal, HSA_SIGNAL_CONDITION_EQ, 0, 200 * kMs);
+  *signal.ValueLocation() = 0;
+  EXPECT_EQ(waiter.Join(), 0);
+  EXPECT_GE(waiter.elapsed(), std::chrono::milliseconds(200));
+}
@@ -0,0 +1,189 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/util/interval_map.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr;
+
+namespace {
+
+struct Range {
+  explicit Range(size_t size, int id = 0) : size(size), id(id) {}
+  size_t size;
+  int id;
+};
+
+typedef IntervalMap<Range> Map;
+
+const void* At(uintptr_t offset) { return reinterpret_cast<const void*>(0x100000 + offset); }
+
+std::vector<int> Tiling(Map& map, uintptr_t offset, size_t len) {
+  std::vector<int> ids;
+  if (!map.for_each_tiling(At(offset), len, [&](Map::iterator it) { ids.push_back(it->second.id); }))
+    ids.push_back(-1);
+  return ids;
+}
+
+}  // namespace
+
+// Entries cover [base, base + size): the last byte belongs to the entry, its end does not.
+TEST(IntervalMap, HalfOpenLookups) {
+  Map map;
+  map.emplace(At(0x1000), 0x1000, 1);
+
+  EXPECT_EQ(map.find_containing(At(0xfff)), map.end());
+  EXPECT_EQ(map.find_containing(At(0x1000))->second.id, 1);
+  EXPECT_EQ(map.find_containing(At(0x1fff))->second.id, 1);
+  EXPECT_EQ(map.find_containing(At(0x2000)), map.end());
+
+  EXPECT_EQ(map.find(At(0x1000))->second.id, 1);
+  EXPECT_EQ(map.find(At(0x1001)), map.end());
+
+  EXPECT_EQ(map.find_enclosing(At(0x1000), 0x1000)->second.id, 1);
+  EXPECT_EQ(map.find_enclosing(At(0x1800), 0x800)->second.id, 1);
+  EXPECT_EQ(map.find_enclosing(At(0x1800), 0x801), map.end());
+  EXPECT_EQ(map.find_enclosing(At(0xfff), 0x10), map.end());
+
+  EXPECT_FALSE(map.overlaps(At(0), 0x1000));
+  EXPECT_TRUE(map.overlaps(At(0), 0x1001));
+  EXPECT_TRUE(map.overlaps(At(0x1fff), 1));
+  EXPECT_FALSE(map.overlaps(At(0x2000), 0x1000));
+  EXPECT_TRUE(map.overlaps(At(0), 0x10000));
+}
+
+// Inserting at either edge of an entry leaves both entries intact and makes them adjacent.
+TEST(IntervalMap, InsertAtEdges) {
+  Map map;
+  map.emplace(At(0x2000), 0x1000, 2);
+  map.emplace(At(0x3000), 0x1000, 3);
+  map.emplace(At(0x1000), 0x1000, 1);
+  map.emplace(At(0x5000), 0x1000, 5);
+  ASSERT_EQ(map.size(), 4u);
+
+  std::vector<int> order;
+  for (auto& entry : map) order.push_back(entry.second.id);
+  EXPECT_EQ(order, std::vector<int>({1, 2, 3, 5}));
+
+  Map::iterator it = map.find(At(0x1000));
+  it = map.next_adjacent(it);
+  ASSERT_NE(it, map.end());
+  EXPECT_EQ(it->second.id, 2);
+  it = map.next_adjacent(it);
+  ASSERT_NE(it, map.end());
+  EXPECT_EQ(it->second.id, 3);
+  // 0x4000 is a hole.
+  EXPECT_EQ(map.next_adjacent(it), map.end());
+
+  EXPECT_EQ(map.find_containing(At(0x1fff))->second.id, 1);
+  EXPECT_EQ(map.find_containing(At(0x2000))->second.id, 2);
+  EXPECT_EQ(map.find_containing(At(0x4000)), map.end());
+  EXPECT_FALSE(map.overlaps(At(0x4000), 0x1000));
+}
+
+// A range is split across entries when it tiles several of them exactly, and is refused when it
+// starts or ends inside an entry or crosses a hole.
+TEST(IntervalMap, TilingAcrossEntries) {
+  Map map;
+  map.emplace(At(0x0000), 0x1000, 0);
+  map.emplace(At(0x1000), 0x2000, 1);
+  map.emplace(At(0x3000), 0x1000, 2);
+  map.emplace(At(0x5000), 0x1000, 3);
+
+  EXPECT_EQ(Tiling(map, 0x0000, 0x4000), std::vector<int>({0, 1, 2}));
+  EXPECT_EQ(Tiling(map, 0x1000, 0x3000), std::vector<int>({1, 2}));
+  EXPECT_EQ(Tiling(map, 0x1000, 0x2000), std::vector<int>({1}));
+
+  EXPECT_EQ(Tiling(map, 0x1000, 0x1000), std::vector<int>({-1}));
+  EXPECT_EQ(Tiling(map, 0x0800, 0x1800), std::vector<int>({-1}));
+  EXPECT_EQ(Tiling(map, 0x0000, 0x3800), std::vector<int>({-1}));
+  EXPECT_EQ(Tiling(map, 0x3000, 0x3000), std::vector<int>({-1}));
+  EXPECT_EQ(Tiling(map, 0x4000, 0x1000), std::vector<int>({-1}));
+}
+
+// Erasing a range spanning several entries, as an unmap of adjacent handles does, leaves the
+// neighbours on both sides in place.
+TEST(IntervalMap, EraseSpanningRange) {
+  Map map;
+  for (int i = 0; i < 6; i++) map.emplace(At(i * 0x1000), 0x1000, i);
+
+  std::vector<Map::iterator> doomed;
+  ASSERT_TRUE(map.for_each_tiling(At(0x1000), 0x3000,
+                                  [&](Map::iterator it) { doomed.push_back(it); }));
+  for (Map::iterator it : doomed) map.erase(it);
+
+  ASSERT_EQ(map.size(), 3u);
+  EXPECT_EQ(map.find_containing(At(0x0fff))->second.id, 0);
+  EXPECT_EQ(map.find_containing(At(0x1000)), map.end());
+  EXPECT_EQ(map.find_containing(At(0x3fff)), map.end());
+  EXPECT_EQ(map.find_containing(At(0x4000))->second.id, 4);
+  EXPECT_FALSE(map.overlaps(At(0x1000), 0x3000));
+  EXPECT_TRUE(map.overlaps(At(0x0fff), 2));
+  EXPECT_EQ(map.next_adjacent(map.find(At(0))), map.end());
+  EXPECT_EQ(map.next_adjacent(map.find(At(0x4000)))->second.id, 5);
+
+  // The hole can be refilled by a single entry that abuts both sides.
+  map.emplace(At(0x1000), 0x3000, 9);
+  EXPECT_EQ(Tiling(map, 0x0000, 0x6000), std::vector<int>({0, 9, 4, 5}));
+}
+
+// References to values stay valid while other entries come and go.
+TEST(IntervalMap, ValuesAreStable) {
+  Map map;
+  Range& kept = map.emplace(At(0x8000), 0x1000, 8)->second;
+  for (int i = 0; i < 8; i++) map.emplace(At(i * 0x1000), 0x1000, i);
+  for (int i = 0; i < 8; i += 2) map.erase(map.find(At(i * 0x1000)));
+  EXPECT_EQ(&map.find(At(0x8000))->second, &kept);
+  EXPECT_EQ(kept.id, 8);
+}
+
+#ifndef NDEBUG
+TEST(IntervalMap, OverlapAsserts) {
+  Map map;
+  map.emplace(At(0x1000), 0x1000, 1);
+  EXPECT_DEATH(map.emplace(At(0x1800), 0x1000, 2), "Overlapping interval");
+  EXPECT_DEATH(map.emplace(At(0x0800), 0x1000, 2), "Overlapping interval");
+}
+#endif
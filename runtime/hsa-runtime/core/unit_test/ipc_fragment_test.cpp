@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_ipc_fragment.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr::AMD;
+
+namespace {
+
+const size_t k2MB = 2 * 1024 * 1024;
+
+// handle[6] of a legacy (non-dmabuf) handle: the thunk's SizeInPages for a block.
+uint32_t SizeInPages(size_t block_size) { return uint32_t(block_size / 4096); }
+
+}  // namespace
+
+// Fragments below 2MB must keep the encoding older runtimes decode.
+TEST(IpcFragment, LegacyEncodingBelow2MB) {
+  for (size_t offset = 0; offset < k2MB; offset += 4096) {
+    uint32_t word = SizeInPages(k2MB);
+    ASSERT_TRUE(IpcFragment::Encode(offset, word));
+    EXPECT_EQ(word, SizeInPages(k2MB) | 0x80000000u | uint32_t(offset / 4096));
+  }
+}
+
+// Export then import of fragments at and beyond 2MB in large blocks.
+TEST(IpcFragment, RoundTripBeyond2MB) {
+  const std::vector<size_t> blocks = {4 * 1024 * 1024, 64 * 1024 * 1024,
+                                      IpcFragment::kMaxBlockSize};
+  for (size_t block : blocks) {
+    std::vector<size_t> offsets = {k2MB, k2MB + 4096, block / 2 + 12288, block - 4096};
+    for (size_t offset : offsets) {
+      uint32_t word = SizeInPages(block);
+      ASSERT_TRUE(IpcFragment::Encode(offset, word)) << "block " << block << " offset " << offset;
+
+      size_t decoded = 0;
+      ASSERT_TRUE(IpcFragment::Decode(word, decoded));
+      EXPECT_EQ(decoded, offset) << "block " << block;
+      // The thunk must see its size field unmodified.
+      EXPECT_EQ(word, SizeInPages(block)) << "block " << block << " offset " << offset;
+    }
+  }
+}
+
+TEST(IpcFragment, RoundTripDmabufHandle) {
+  for (size_t offset = 0; offset < IpcFragment::kMaxBlockSize; offset += 3 * 4096 + k2MB) {
+    uint32_t word = 0;
+    ASSERT_TRUE(IpcFragment::Encode(offset, word));
+    size_t decoded = 0;
+    ASSERT_TRUE(IpcFragment::Decode(word, decoded));
+    EXPECT_EQ(decoded, offset);
+    EXPECT_EQ(word, 0u);
+  }
+}
+
+TEST(IpcFragment, RejectsUnencodable) {
+  uint32_t word = 0;
+  EXPECT_FALSE(IpcFragment::Encode(IpcFragment::kMaxBlockSize, word));
+  EXPECT_FALSE(IpcFragment::Encode(4096 + 16, word));
+  EXPECT_EQ(word, 0u);
+
+  // A size that overlaps the offset fields can not carry a fragment.
+  word = SizeInPages(k2MB) | 1;
+  EXPECT_FALSE(IpcFragment::Encode(4096, word));
+  word = SizeInPages(64ull * 1024 * 1024 * 1024);
+  EXPECT_FALSE(IpcFragment::Encode(4096, word));
+}
+
+TEST(IpcFragment, DecodeWholeAllocation) {
+  uint32_t word = SizeInPages(k2MB);
+  size_t offset = 1;
+  EXPECT_FALSE(IpcFragment::Decode(word, offset));
+  EXPECT_EQ(word, SizeInPages(k2MB));
+  EXPECT_EQ(offset, 1u);
+}
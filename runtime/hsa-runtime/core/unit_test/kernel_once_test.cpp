@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Races KernelOnce::Run the way concurrent first queue creations race GpuAgent::BringUp.
+
+#include "core/util/locks.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr;
+
+namespace {
+
+const int kThreads = 16;
+
+}  // namespace
+
+TEST(KernelOnceTest, RunsOnce) {
+  KernelOnce once;
+  int calls = 0;
+  EXPECT_FALSE(once.Done());
+  once.Run([&]() { calls++; });
+  once.Run([&]() { calls++; });
+  EXPECT_EQ(calls, 1);
+  EXPECT_TRUE(once.Done());
+}
+
+// All threads are released together into a slow body. It must run once and every caller must
+// return only after it has finished.
+TEST(KernelOnceTest, ConcurrentCallersWaitForTheFirst) {
+  KernelOnce once;
+  std::atomic<int> calls(0);
+  std::atomic<int> finished(0);
+  std::atomic<int> ready(0);
+  std::atomic<bool> go(false);
+  std::atomic<int> early(0);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&]() {
+      ready++;
+      while (!go.load()) std::this_thread::yield();
+      once.Run([&]() {
+        calls++;
+        usleep(20000);
+        finished++;
+      });
+      if (finished.load() != 1) early++;
+    });
+  }
+  while (ready.load() != kThreads) std::this_thread::yield();
+  go.store(true);
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(calls.load(), 1);
+  EXPECT_EQ(early.load(), 0);
+  EXPECT_TRUE(once.Done());
+}
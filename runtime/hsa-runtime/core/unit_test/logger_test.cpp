@@ -0,0 +1,351 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/util/logger.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr;
+
+#define TEST_LOG(format, ...)                                                                      \
+  AsyncLogger::Log<LogStringArgs(format)>("logger_test.cpp", __LINE__, format, ##__VA_ARGS__)
+
+namespace {
+
+// Reads file from the start, one entry per line.
+std::vector<std::string> Lines(FILE* file) {
+  std::vector<std::string> lines;
+  fflush(file);
+  rewind(file);
+  char buffer[8192];
+  while (fgets(buffer, sizeof(buffer), file) != nullptr) {
+    std::string line(buffer);
+    if (!line.empty() && line.back() == '\n') line.pop_back();
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+// The message part of a text log line.
+std::string Message(const std::string& line) {
+  const std::string marker = "[***rocr***] ";
+  size_t pos = line.find(marker);
+  return (pos == std::string::npos) ? std::string() : line.substr(pos + marker.size());
+}
+
+// Sums the counts of "N log messages dropped" lines, other messages are returned in messages.
+uint64_t Dropped(const std::vector<std::string>& lines, std::vector<std::string>* messages) {
+  uint64_t dropped = 0;
+  for (const auto& line : lines) {
+    std::string msg = Message(line);
+    unsigned long long count;
+    char tail[32];
+    if (sscanf(msg.c_str(), "%llu log messages %31s", &count, tail) == 2 &&
+        std::string(tail) == "dropped")
+      dropped += count;
+    else if (messages != nullptr)
+      messages->push_back(msg);
+  }
+  return dropped;
+}
+
+}  // namespace
+
+TEST(Logger, StringArgsScan) {
+  static_assert(LogStringArgs("no args") == 0, "");
+  static_assert(LogStringArgs("%s") == 0x1, "");
+  static_assert(LogStringArgs("%d %s %p %s") == 0xa, "");
+  static_assert(LogStringArgs("%% %s") == 0x1, "");
+  static_assert(LogStringArgs("%*d %.*s") == 0x8, "");
+  static_assert(LogStringArgs("%-10s|%08.3f|%lld|%zu %hhs") == 0x11, "");
+  static_assert(LogStringArgs("long literal text before the one %s conversion") == 0x1, "");
+  static_assert(LogStringArgs("trailing %") == 0, "");
+  EXPECT_EQ(LogStringArgs("%p %s"), 0x2u);
+}
+
+TEST(Logger, LogWhileStopped) {
+  EXPECT_FALSE(AsyncLogger::Active());
+  EXPECT_FALSE(TEST_LOG("dropped %d", 1));
+}
+
+// Records queued right before Stop() are written by the final drain.
+TEST(Logger, FlushOnStop) {
+  FILE* file = tmpfile();
+  ASSERT_NE(file, nullptr);
+  AsyncLogger::Start(AsyncLogger::kAsync, file);
+  ASSERT_TRUE(AsyncLogger::Active());
+
+  const char* name = "queue";
+  char buffer[] = "buffer";
+  int value = 7;
+  EXPECT_TRUE(TEST_LOG("%s %d %u %x", name, -3, 5u, 0xabcu));
+  EXPECT_TRUE(TEST_LOG("%p is not copied, %s is", buffer, buffer));
+  EXPECT_TRUE(TEST_LOG("%.2f %5d|%-5d| %*d %c%%", 1.5, 42, 42, 4, 9, 'x'));
+  EXPECT_TRUE(TEST_LOG("%lld %hhd %llu", -1ll, 257, ~0ull));
+  EXPECT_TRUE(TEST_LOG("missing %d %d", 1));
+  EXPECT_TRUE(TEST_LOG("ptr %p", &value));
+  AsyncLogger::Stop();
+  EXPECT_FALSE(AsyncLogger::Active());
+  EXPECT_FALSE(TEST_LOG("after stop"));
+
+  char ptr[32], buf[32];
+  snprintf(ptr, sizeof(ptr), "%p", static_cast<void*>(&value));
+  snprintf(buf, sizeof(buf), "%p", static_cast<void*>(buffer));
+  auto lines = Lines(file);
+  ASSERT_EQ(lines.size(), 6u);
+  EXPECT_EQ(Message(lines[0]), "queue -3 5 abc");
+  EXPECT_EQ(Message(lines[1]), std::string(buf) + " is not copied, buffer is");
+  EXPECT_EQ(Message(lines[2]), "1.50    42|42   |    9 x%");
+  EXPECT_EQ(Message(lines[3]), "-1 1 18446744073709551615");
+  EXPECT_EQ(Message(lines[4]), "missing 1 (missing)");
+  EXPECT_EQ(Message(lines[5]), std::string("ptr ") + ptr);
+  EXPECT_NE(lines[0].find(":logger_test.cpp"), std::string::npos);
+  fclose(file);
+}
+
+// Pushes many times the ring size through one ring, in order, with nothing lost.
+TEST(Logger, RingWrap) {
+  FILE* file = tmpfile();
+  ASSERT_NE(file, nullptr);
+  AsyncLogger::Start(AsyncLogger::kAsync, file);
+
+  const int kCount = 4000;
+  int logged = 0;
+  for (int i = 0; i < kCount; i++) {
+    ASSERT_TRUE(TEST_LOG("seq %d", i));
+    logged++;
+    // Let the logger keep up so nothing drops.
+    if ((i % 256) == 255) usleep(5000);
+  }
+  AsyncLogger::Stop();
+
+  std::vector<std::string> messages;
+  uint64_t dropped = Dropped(Lines(file), &messages);
+  EXPECT_EQ(messages.size() + dropped, size_t(logged));
+  int last = -1;
+  for (const auto& msg : messages) {
+    int seq;
+    ASSERT_EQ(sscanf(msg.c_str(), "seq %d", &seq), 1);
+    EXPECT_GT(seq, last);
+    last = seq;
+  }
+  EXPECT_EQ(last, kCount - 1);
+  fclose(file);
+}
+
+// A logger blocked on its output drops records once the ring fills, and reports how many.
+TEST(Logger, DropWhenFull) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  FILE* out = fdopen(fds[1], "w");
+  ASSERT_NE(out, nullptr);
+  AsyncLogger::Start(AsyncLogger::kAsync, out);
+
+  // Far more than the pipe buffer and the ring can hold while nothing reads the pipe.
+  const int kCount = 20000;
+  for (int i = 0; i < kCount; i++)
+    ASSERT_TRUE(TEST_LOG("message %d padded to make the line longer", i));
+
+  std::string text;
+  std::thread reader([&]() {
+    char buffer[4096];
+    ssize_t len;
+    while ((len = read(fds[0], buffer, sizeof(buffer))) > 0) text.append(buffer, len);
+  });
+  AsyncLogger::Stop();
+  fclose(out);
+  reader.join();
+  close(fds[0]);
+
+  std::vector<std::string> lines;
+  size_t start = 0, end;
+  while ((end = text.find('\n', start)) != std::string::npos) {
+    lines.push_back(text.substr(start, end - start));
+    start = end + 1;
+  }
+  std::vector<std::string> messages;
+  uint64_t dropped = Dropped(lines, &messages);
+  EXPECT_GT(dropped, 0u);
+  EXPECT_EQ(messages.size() + dropped, size_t(kCount));
+}
+
+// Threads exiting while the logger runs, and after it stopped, keep their messages and don't
+// leave rings behind to crash a restart.
+TEST(Logger, ThreadsAndRestart) {
+  FILE* file = tmpfile();
+  ASSERT_NE(file, nullptr);
+  AsyncLogger::Start(AsyncLogger::kAsync, file);
+
+  const int kThreads = 8;
+  const int kPerThread = 100;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++)
+    threads.emplace_back([t]() {
+      for (int i = 0; i < kPerThread; i++) TEST_LOG("thread %d msg %d", t, i);
+    });
+  for (auto& thread : threads) thread.join();
+
+  // A thread that outlives a stop and logs again after a restart.
+  bool go = false, done = false;
+  std::mutex lock;
+  std::condition_variable cv;
+  std::thread survivor([&]() {
+    TEST_LOG("survivor before");
+    std::unique_lock<std::mutex> hold(lock);
+    cv.wait(hold, [&]() { return go; });
+    TEST_LOG("survivor after");
+    done = true;
+    cv.notify_all();
+  });
+
+  usleep(10000);
+  AsyncLogger::Stop();
+  std::vector<std::string> messages;
+  EXPECT_EQ(Dropped(Lines(file), &messages), 0u);
+  EXPECT_EQ(messages.size(), size_t(kThreads * kPerThread + 1));
+
+  FILE* file2 = tmpfile();
+  AsyncLogger::Start(AsyncLogger::kAsync, file2);
+  {
+    std::unique_lock<std::mutex> hold(lock);
+    go = true;
+    cv.notify_all();
+    cv.wait(hold, [&]() { return done; });
+  }
+  survivor.join();
+  AsyncLogger::Stop();
+
+  auto lines = Lines(file2);
+  ASSERT_EQ(lines.size(), 1u);
+  EXPECT_EQ(Message(lines[0]), "survivor after");
+  fclose(file);
+  fclose(file2);
+}
+
+// A binary log decodes to the same text as the async text mode.
+TEST(Logger, BinaryDecode) {
+  FILE* text = tmpfile();
+  FILE* binary = tmpfile();
+  ASSERT_NE(text, nullptr);
+  ASSERT_NE(binary, nullptr);
+
+  auto log = [](int round) {
+    const char* name = (round == 0) ? "first" : "second";
+    TEST_LOG("%s round %d", name, round);
+    TEST_LOG("%08.3f %lld %x %c", 2.25, -5ll, 255u, 'q');
+    TEST_LOG("plain");
+  };
+  AsyncLogger::Start(AsyncLogger::kAsync, text);
+  log(0);
+  log(1);
+  AsyncLogger::Stop();
+  AsyncLogger::Start(AsyncLogger::kBinary, binary);
+  log(0);
+  log(1);
+  AsyncLogger::Stop();
+
+  FILE* decoded = tmpfile();
+  rewind(binary);
+  EXPECT_TRUE(DecodeBinaryLog(binary, decoded));
+  auto expect = Lines(text);
+  auto lines = Lines(decoded);
+  ASSERT_EQ(lines.size(), 6u);
+  ASSERT_EQ(lines.size(), expect.size());
+  for (size_t i = 0; i < lines.size(); i++) {
+    EXPECT_EQ(Message(lines[i]), Message(expect[i]));
+    EXPECT_EQ(lines[i].substr(0, 32), expect[i].substr(0, 32));
+  }
+  EXPECT_EQ(Message(lines[0]), "first round 0");
+  EXPECT_EQ(Message(lines[1]), "0002.250 -5 ff q");
+
+  // Every truncation of the log is reported, after decoding what came before it.
+  fflush(binary);
+  long size = ftell(binary);
+  std::vector<char> bytes(size);
+  rewind(binary);
+  ASSERT_EQ(fread(bytes.data(), 1, size, binary), size_t(size));
+  for (long cut = 0; cut < size; cut++) {
+    FILE* part = tmpfile();
+    fwrite(bytes.data(), 1, cut, part);
+    rewind(part);
+    FILE* sink = tmpfile();
+    bool ok = DecodeBinaryLog(part, sink);
+    // Cuts on an entry boundary are a valid, shorter log.
+    if (ok) {
+      EXPECT_LE(Lines(sink).size(), 6u);
+    }
+    if (cut < 24) {
+      EXPECT_FALSE(ok);
+    }
+    fclose(part);
+    fclose(sink);
+  }
+
+  // Corrupt tag and bad version.
+  std::vector<char> bad = bytes;
+  bad[24] = 99;
+  FILE* part = tmpfile();
+  fwrite(bad.data(), 1, bad.size(), part);
+  rewind(part);
+  EXPECT_FALSE(DecodeBinaryLog(part, decoded));
+  fclose(part);
+  bad = bytes;
+  bad[8] = 1;
+  part = tmpfile();
+  fwrite(bad.data(), 1, bad.size(), part);
+  rewind(part);
+  EXPECT_FALSE(DecodeBinaryLog(part, decoded));
+  fclose(part);
+
+  fclose(text);
+  fclose(binary);
+  fclose(decoded);
+}
@@ -0,0 +1,312 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Drives the pin registry with fake pin callbacks. In SVM mode ranges are mapped at their host
+// address; in userptr mode each registration gets its own GPU address range.
+
+#include "core/inc/amd_pin_registry.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr::AMD;
+
+namespace {
+
+const uintptr_t kBase = 0x7f0000000000;
+const size_t kPage = 4096;
+const uintptr_t kUserptrOffset = 0x100000000000;
+
+void* Page(size_t page) { return reinterpret_cast<void*>(kBase + page * kPage); }
+
+struct Pin {
+  const void* owner;
+  uintptr_t base;
+  size_t size;
+  std::vector<uint32_t> nodes;
+};
+
+class PinRegistryTest : public ::testing::Test {
+ protected:
+  PinRegistryTest() : owner_(&owner_), svm_(true), fail_(false) {}
+
+  void Create(size_t budget_pages) {
+    registry_.reset(new PinRegistry(
+        [this](const void* owner, void* base, size_t size, const std::vector<uint32_t>& nodes,
+               void** agent_base) {
+          if (fail_) return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
+          uintptr_t addr = reinterpret_cast<uintptr_t>(base);
+          pins_.push_back({owner, addr, size, nodes});
+          *agent_base = reinterpret_cast<void*>(svm_ ? addr : addr + kUserptrOffset);
+          return HSA_STATUS_SUCCESS;
+        },
+        [this](const void* owner, void* base) {
+          unpins_.push_back(reinterpret_cast<uintptr_t>(base));
+        },
+        budget_pages * kPage));
+  }
+
+  hsa_status_t Lock(size_t first_page, size_t pages, std::vector<uint32_t> nodes = {1},
+                    void** agent_ptr = nullptr, const void* owner = nullptr) {
+    void* unused;
+    return registry_->Lock(owner ? owner : owner_, Page(first_page), pages * kPage, nodes,
+                           agent_ptr ? agent_ptr : &unused);
+  }
+
+  void Unlock(size_t first_page) { registry_->Unlock(Page(first_page)); }
+
+  void ExpectPin(size_t i, size_t first_page, size_t pages) {
+    ASSERT_LT(i, pins_.size());
+    EXPECT_EQ(pins_[i].base, uintptr_t(Page(first_page))) << "pin " << i;
+    EXPECT_EQ(pins_[i].size, pages * kPage) << "pin " << i;
+  }
+
+  bool Unpinned(size_t first_page) const {
+    return std::count(unpins_.begin(), unpins_.end(), uintptr_t(Page(first_page))) != 0;
+  }
+
+  const void* owner_;
+  bool svm_;
+  bool fail_;
+  std::vector<Pin> pins_;
+  std::vector<uintptr_t> unpins_;
+  std::unique_ptr<PinRegistry> registry_;
+};
+
+}  // namespace
+
+// A lock covered by an entry of the same owner mapped to a superset of its nodes shares it.
+TEST_F(PinRegistryTest, CoveredLockReusesEntry) {
+  Create(0);
+  void* agent_ptr;
+  ASSERT_EQ(Lock(0, 4, {2, 1}), HSA_STATUS_SUCCESS);
+  ASSERT_EQ(pins_.size(), 1u);
+  EXPECT_EQ(pins_[0].nodes, std::vector<uint32_t>({1, 2}));
+
+  void* inner = reinterpret_cast<char*>(Page(1)) + 100;
+  ASSERT_EQ(registry_->Lock(owner_, inner, 2 * kPage, {1}, &agent_ptr), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(agent_ptr, inner);
+  EXPECT_EQ(pins_.size(), 1u);
+  EXPECT_EQ(registry_->hits(), 1u);
+  EXPECT_EQ(registry_->misses(), 1u);
+
+  // Dropping one lock keeps the entry pinned for the other.
+  registry_->Unlock(inner);
+  EXPECT_EQ(registry_->cached_bytes(), 0u);
+  EXPECT_TRUE(unpins_.empty());
+
+  // Another owner, or a node outside the entry, needs a registration of its own.
+  int other;
+  ASSERT_EQ(Lock(1, 1, {1}, nullptr, &other), HSA_STATUS_SUCCESS);
+  ASSERT_EQ(Lock(2, 1, {1, 3}), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(pins_.size(), 3u);
+  EXPECT_EQ(registry_->misses(), 3u);
+  EXPECT_EQ(registry_->hits(), 1u);
+}
+
+// SVM locks partially covered by entries are split: existing entries serve their parts and
+// only the gaps are pinned.
+TEST_F(PinRegistryTest, SvmLockSplitsAcrossEntries) {
+  Create(64);
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+  ASSERT_EQ(Lock(4, 2), HSA_STATUS_SUCCESS);
+
+  void* agent_ptr;
+  ASSERT_EQ(Lock(0, 8, {1}, &agent_ptr), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(agent_ptr, Page(0));
+  ASSERT_EQ(pins_.size(), 4u);
+  ExpectPin(2, 2, 2);
+  ExpectPin(3, 6, 2);
+  EXPECT_EQ(registry_->misses(), 3u);
+
+  // Fully served by the pieces, so nothing new is pinned.
+  ASSERT_EQ(Lock(1, 6, {1}, &agent_ptr), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(agent_ptr, Page(1));
+  EXPECT_EQ(pins_.size(), 4u);
+  EXPECT_EQ(registry_->hits(), 1u);
+
+  // Each lock releases exactly the pieces it took; the lock of [0, 8) holds them all.
+  Unlock(4);
+  Unlock(1);
+  EXPECT_EQ(registry_->cached_bytes(), 0u);
+  Unlock(0);
+  Unlock(0);
+  EXPECT_EQ(registry_->cached_bytes(), 8 * kPage);
+  EXPECT_TRUE(unpins_.empty());
+}
+
+// Userptr locks absorb the idle entries they overlap into one new registration.
+TEST_F(PinRegistryTest, UserptrLockExtendsIdleEntries) {
+  svm_ = false;
+  Create(64);
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+  ASSERT_EQ(Lock(3, 2), HSA_STATUS_SUCCESS);
+  Unlock(0);
+  Unlock(3);
+  EXPECT_EQ(registry_->cached_bytes(), 4 * kPage);
+
+  void* agent_ptr;
+  ASSERT_EQ(Lock(1, 3, {2}, &agent_ptr), HSA_STATUS_SUCCESS);
+  EXPECT_TRUE(Unpinned(0));
+  EXPECT_TRUE(Unpinned(3));
+  ASSERT_EQ(pins_.size(), 3u);
+  ExpectPin(2, 0, 5);
+  EXPECT_EQ(pins_[2].nodes, std::vector<uint32_t>({1, 2}));
+  EXPECT_EQ(agent_ptr, reinterpret_cast<void*>(uintptr_t(Page(1)) + kUserptrOffset));
+  EXPECT_EQ(registry_->cached_bytes(), 0u);
+
+  // The union now covers later locks of any of its parts.
+  ASSERT_EQ(Lock(4, 1, {1}, &agent_ptr), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(agent_ptr, reinterpret_cast<void*>(uintptr_t(Page(4)) + kUserptrOffset));
+  EXPECT_EQ(pins_.size(), 3u);
+}
+
+// A userptr entry in use can't be extended, and KFD can't take a second registration at its
+// start address.
+TEST_F(PinRegistryTest, UserptrRefusesBusyStart) {
+  svm_ = false;
+  Create(64);
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+
+  EXPECT_EQ(Lock(0, 4), HSA_STATUS_ERROR);
+  EXPECT_EQ(pins_.size(), 1u);
+
+  // Starting elsewhere pins an overlapping registration of its own.
+  ASSERT_EQ(Lock(1, 3), HSA_STATUS_SUCCESS);
+  ASSERT_EQ(pins_.size(), 2u);
+  ExpectPin(1, 1, 3);
+  EXPECT_TRUE(unpins_.empty());
+
+  // Once idle, the old entry at the start address is replaced.
+  Unlock(0);
+  ASSERT_EQ(Lock(0, 4), HSA_STATUS_SUCCESS);
+  EXPECT_TRUE(Unpinned(0));
+}
+
+// Idle entries are kept most recently used first and retired from the other end once their
+// total exceeds the budget.
+TEST_F(PinRegistryTest, LruEvictionWithinBudget) {
+  Create(4);
+  for (size_t page : {0, 10, 20}) {
+    ASSERT_EQ(Lock(page, 2), HSA_STATUS_SUCCESS);
+    Unlock(page);
+  }
+  EXPECT_EQ(registry_->cached_bytes(), 4 * kPage);
+  EXPECT_EQ(unpins_, std::vector<uintptr_t>({uintptr_t(Page(0))}));
+
+  // Reusing 10 makes 20 the oldest.
+  ASSERT_EQ(Lock(10, 1), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(registry_->hits(), 1u);
+  EXPECT_EQ(registry_->cached_bytes(), 2 * kPage);
+  Unlock(10);
+  ASSERT_EQ(Lock(30, 2), HSA_STATUS_SUCCESS);
+  Unlock(30);
+  EXPECT_TRUE(Unpinned(20));
+  EXPECT_FALSE(Unpinned(10));
+  EXPECT_EQ(registry_->cached_bytes(), 4 * kPage);
+
+  // Entries larger than the budget are released on unlock.
+  ASSERT_EQ(Lock(40, 5), HSA_STATUS_SUCCESS);
+  Unlock(40);
+  EXPECT_TRUE(Unpinned(40));
+  EXPECT_EQ(registry_->misses(), 5u);
+}
+
+TEST_F(PinRegistryTest, NoCacheWithZeroBudget) {
+  Create(0);
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+  Unlock(0);
+  EXPECT_TRUE(Unpinned(0));
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(pins_.size(), 2u);
+  EXPECT_EQ(registry_->hits(), 0u);
+  EXPECT_EQ(registry_->misses(), 2u);
+}
+
+TEST_F(PinRegistryTest, FailedPinLeavesNoEntry) {
+  Create(64);
+  fail_ = true;
+  EXPECT_EQ(Lock(0, 2), HSA_STATUS_ERROR_OUT_OF_RESOURCES);
+  fail_ = false;
+  Unlock(0);
+  EXPECT_EQ(registry_->cached_bytes(), 0u);
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(pins_.size(), 1u);
+}
+
+// A failed gap pin releases the pieces already taken for the lock.
+TEST_F(PinRegistryTest, FailedSvmSplitReleasesPieces) {
+  Create(64);
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+  fail_ = true;
+  EXPECT_NE(Lock(0, 4), HSA_STATUS_SUCCESS);
+  fail_ = false;
+  Unlock(0);
+  EXPECT_EQ(registry_->cached_bytes(), 2 * kPage);
+}
+
+TEST_F(PinRegistryTest, UnlockOfUnknownPointerIsIgnored) {
+  Create(64);
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+  Unlock(1);
+  Unlock(7);
+  EXPECT_EQ(registry_->cached_bytes(), 0u);
+  EXPECT_TRUE(unpins_.empty());
+}
+
+TEST_F(PinRegistryTest, FlushUnpinsEverything) {
+  Create(64);
+  ASSERT_EQ(Lock(0, 2), HSA_STATUS_SUCCESS);
+  ASSERT_EQ(Lock(4, 2), HSA_STATUS_SUCCESS);
+  Unlock(4);
+  registry_->Flush();
+  EXPECT_TRUE(Unpinned(0));
+  EXPECT_TRUE(Unpinned(4));
+  EXPECT_EQ(registry_->cached_bytes(), 0u);
+
+  // Destruction flushes too.
+  ASSERT_EQ(Lock(8, 1), HSA_STATUS_SUCCESS);
+  registry_.reset();
+  EXPECT_TRUE(Unpinned(8));
+}
@@ -0,0 +1,241 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_rect_copy.h"
+
+#include <vector>
+
+#include "core/inc/exceptions.h"
+#include "gtest/gtest.h"
+
+using namespace rocr::AMD;
+using rocr::core::LinearCopyDesc;
+
+namespace {
+
+const uintptr_t kSrcBase = 0x100000000;
+const uintptr_t kDstBase = 0x800000000;
+
+// Small enough that MB pitches need the wide pitch forms.
+const RectCopyLimits kLimits = {1 << 13, 1 << 28};
+const RectCopyLimits kNoRect = {0, 0};
+
+hsa_pitched_ptr_t Surface(uintptr_t base, size_t pitch, size_t slice) {
+  hsa_pitched_ptr_t ptr = {reinterpret_cast<void*>(base), pitch, slice};
+  return ptr;
+}
+
+hsa_dim3_t Dim(uint32_t x, uint32_t y, uint32_t z) {
+  hsa_dim3_t dim = {x, y, z};
+  return dim;
+}
+
+uintptr_t Addr(const hsa_pitched_ptr_t& ptr, const hsa_dim3_t& offset, uint64_t y, uint64_t z) {
+  return reinterpret_cast<uintptr_t>(ptr.base) + offset.x + (offset.y + y) * ptr.pitch +
+      (offset.z + z) * ptr.slice;
+}
+
+struct Plan {
+  std::vector<LinearCopyDesc> spans;
+  std::vector<RectCopyDesc> rects;
+};
+
+Plan PlanCopy(const hsa_pitched_ptr_t& dst, const hsa_dim3_t& dst_offset,
+              const hsa_pitched_ptr_t& src, const hsa_dim3_t& src_offset,
+              const hsa_dim3_t& range, const RectCopyLimits& limits) {
+  Plan plan;
+  ValidateRectCopy(dst, dst_offset, src, src_offset, range, false);
+  PlanRectCopy(dst, dst_offset, src, src_offset, range, limits, plan.spans, plan.rects);
+  EXPECT_TRUE(plan.spans.empty() != plan.rects.empty()) << "Exactly one plan kind expected";
+  return plan;
+}
+
+void ExpectSpan(const LinearCopyDesc& span, uintptr_t dst, uintptr_t src, size_t size) {
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(span.dst), dst);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(span.src), src);
+  EXPECT_EQ(span.size, size);
+}
+
+}  // namespace
+
+TEST(RectCopyPlan, ContiguousVolumeIsOneSpan) {
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, 256, 256 * 16);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, 256, 256 * 16);
+  const hsa_dim3_t off = Dim(0, 0, 1);
+  Plan plan = PlanCopy(dst, off, src, off, Dim(256, 16, 4), kLimits);
+  ASSERT_EQ(plan.spans.size(), 1u);
+  ExpectSpan(plan.spans[0], kDstBase + 256 * 16, kSrcBase + 256 * 16, 256 * 16 * 4);
+}
+
+TEST(RectCopyPlan, ContiguousRowsLargeSlicesSpanPerSlice) {
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, 4096, 4096 * 20);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, 4096, 4096 * 24);
+  const hsa_dim3_t src_off = Dim(0, 2, 1), dst_off = Dim(0, 5, 0);
+  Plan plan = PlanCopy(dst, dst_off, src, src_off, Dim(4096, 16, 3), kLimits);
+  ASSERT_EQ(plan.spans.size(), 3u);
+  for (uint32_t z = 0; z < 3; z++)
+    ExpectSpan(plan.spans[z], Addr(dst, dst_off, 0, z), Addr(src, src_off, 0, z), 4096 * 16);
+}
+
+TEST(RectCopyPlan, ContiguousRowsSmallSlicesUseOneRect) {
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, 64, 64 * 8);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, 64, 64 * 10);
+  Plan plan = PlanCopy(dst, Dim(0, 0, 0), src, Dim(0, 0, 0), Dim(64, 4, 3), kLimits);
+  ASSERT_EQ(plan.rects.size(), 1u);
+  EXPECT_EQ(plan.rects[0].range.z, 3u);
+}
+
+TEST(RectCopyPlan, SubVolumeIsOneRect) {
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, 512, 512 * 32);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, 1024, 1024 * 40);
+  const hsa_dim3_t src_off = Dim(12, 3, 1), dst_off = Dim(20, 5, 2), range = Dim(100, 10, 3);
+  Plan plan = PlanCopy(dst, dst_off, src, src_off, range, kLimits);
+  ASSERT_EQ(plan.rects.size(), 1u);
+  const RectCopyDesc& rect = plan.rects[0];
+  EXPECT_EQ(rect.src.base, src.base);
+  EXPECT_EQ(rect.dst.pitch, dst.pitch);
+  EXPECT_EQ(rect.src_offset.y, 3u);
+  EXPECT_EQ(rect.dst_offset.z, 2u);
+  EXPECT_EQ(rect.range.x, 100u);
+  EXPECT_EQ(rect.range.y, 10u);
+  EXPECT_EQ(rect.range.z, 3u);
+}
+
+TEST(RectCopyPlan, NoRectSupportSpanPerRow) {
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, 512, 512 * 32);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, 1024, 1024 * 40);
+  const hsa_dim3_t src_off = Dim(12, 3, 1), dst_off = Dim(20, 5, 2);
+  Plan plan = PlanCopy(dst, dst_off, src, src_off, Dim(100, 10, 3), kNoRect);
+  ASSERT_EQ(plan.spans.size(), 30u);
+  for (uint32_t z = 0; z < 3; z++)
+    for (uint32_t y = 0; y < 10; y++)
+      ExpectSpan(plan.spans[z * 10 + y], Addr(dst, dst_off, y, z), Addr(src, src_off, y, z), 100);
+}
+
+TEST(RectCopyPlan, UnalignedPitchSpanPerRow) {
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, 65, 0);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, 64, 0);
+  const hsa_dim3_t src_off = Dim(1, 0, 0), dst_off = Dim(3, 1, 0);
+  Plan plan = PlanCopy(dst, dst_off, src, src_off, Dim(7, 5, 1), kLimits);
+  ASSERT_EQ(plan.spans.size(), 5u);
+  for (uint32_t y = 0; y < 5; y++)
+    ExpectSpan(plan.spans[y], Addr(dst, dst_off, y, 0), Addr(src, src_off, y, 0), 7);
+}
+
+// A pitch too wide for the pitch field moves rows into the slice field.
+TEST(RectCopyPlan, WidePitchSwapsRowsIntoSlices) {
+  const size_t pitch = 1 << 20;
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, pitch, 0);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, pitch, 0);
+  const hsa_dim3_t src_off = Dim(16, 1, 0), dst_off = Dim(32, 0, 0);
+  Plan plan = PlanCopy(dst, dst_off, src, src_off, Dim(64, 4, 1), kLimits);
+  ASSERT_EQ(plan.rects.size(), 1u);
+  const RectCopyDesc& rect = plan.rects[0];
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(rect.src.base), kSrcBase + pitch);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(rect.dst.base), kDstBase);
+  EXPECT_EQ(rect.src.pitch, 0u);
+  EXPECT_EQ(rect.src.slice, pitch);
+  EXPECT_EQ(rect.src_offset.x, 16u);
+  EXPECT_EQ(rect.src_offset.y, 0u);
+  EXPECT_EQ(rect.dst_offset.x, 32u);
+  EXPECT_EQ(rect.range.x, 64u);
+  EXPECT_EQ(rect.range.y, 1u);
+  EXPECT_EQ(rect.range.z, 4u);
+}
+
+TEST(RectCopyPlan, WidePitchVolumeSplitsPerSlice) {
+  const size_t pitch = 1 << 20;
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, pitch, pitch * 8);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, pitch, pitch * 8);
+  const hsa_dim3_t src_off = Dim(0, 1, 0), dst_off = Dim(4, 2, 1);
+  Plan plan = PlanCopy(dst, dst_off, src, src_off, Dim(64, 4, 2), kLimits);
+  ASSERT_EQ(plan.rects.size(), 2u);
+  for (uint32_t z = 0; z < 2; z++) {
+    const RectCopyDesc& rect = plan.rects[z];
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(rect.src.base), Addr(src, src_off, 0, z));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(rect.dst.base), Addr(dst, dst_off, 0, z) - 4);
+    EXPECT_EQ(rect.range.y, 1u);
+    EXPECT_EQ(rect.range.z, 4u);
+  }
+}
+
+TEST(RectCopyPlan, EmptyCopyPlansOneEmptySpan) {
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, 512, 512 * 32);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, 1024, 1024 * 40);
+  const hsa_dim3_t off = Dim(8, 1, 1);
+  for (const hsa_dim3_t& range : {Dim(0, 4, 2), Dim(16, 0, 2), Dim(16, 4, 0)}) {
+    for (const RectCopyLimits& limits : {kLimits, kNoRect}) {
+      Plan plan = PlanCopy(dst, off, src, off, range, limits);
+      ASSERT_EQ(plan.spans.size(), 1u);
+      ExpectSpan(plan.spans[0], Addr(dst, off, 0, 0), Addr(src, off, 0, 0), 0);
+    }
+  }
+}
+
+TEST(RectCopyValidate, RejectsOutOfRange) {
+  const hsa_pitched_ptr_t src = Surface(kSrcBase, 64, 64 * 4);
+  const hsa_pitched_ptr_t dst = Surface(kDstBase, 64, 0);
+  const hsa_dim3_t zero = Dim(0, 0, 0);
+  EXPECT_THROW(ValidateRectCopy(dst, Dim(8, 0, 0), src, zero, Dim(60, 1, 1), false),
+               hsa_exception);
+  EXPECT_THROW(ValidateRectCopy(dst, zero, src, Dim(0, 2, 0), Dim(8, 3, 1), false),
+               hsa_exception);
+  // A volume needs slices on both sides.
+  EXPECT_THROW(ValidateRectCopy(dst, zero, src, zero, Dim(8, 1, 2), false), hsa_exception);
+  EXPECT_NO_THROW(ValidateRectCopy(dst, zero, src, zero, Dim(64, 4, 1), false));
+}
+
+TEST(RectCopyValidate, DwordAlignmentOnlyWhenRequired) {
+  const hsa_dim3_t zero = Dim(0, 0, 0);
+  const hsa_dim3_t range = Dim(8, 2, 1);
+  const hsa_pitched_ptr_t aligned = Surface(kSrcBase, 64, 0);
+  const hsa_pitched_ptr_t base = Surface(kSrcBase + 1, 64, 0);
+  const hsa_pitched_ptr_t pitch = Surface(kSrcBase, 66, 0);
+  const hsa_pitched_ptr_t slice = Surface(kSrcBase, 64, 64 * 4 + 2);
+
+  for (const hsa_pitched_ptr_t& bad : {base, pitch, slice}) {
+    EXPECT_THROW(ValidateRectCopy(aligned, zero, bad, zero, range, true), hsa_exception);
+    EXPECT_THROW(ValidateRectCopy(bad, zero, aligned, zero, range, true), hsa_exception);
+    EXPECT_NO_THROW(ValidateRectCopy(bad, zero, aligned, zero, range, false));
+  }
+  EXPECT_NO_THROW(ValidateRectCopy(aligned, zero, aligned, zero, range, true));
+}
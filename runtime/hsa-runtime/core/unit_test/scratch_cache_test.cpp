@@ -0,0 +1,383 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Drives the scratch cache with fake block addresses. Each ScratchInfo stands for one queue; its
+// main_queue_base field is the queue's affinity key.
+
+#include "core/inc/scratch_cache.h"
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr::AMD;
+
+namespace {
+
+const size_t kMB = 1024 * 1024;
+
+class ScratchCacheTest : public ::testing::Test {
+ protected:
+  ScratchCacheTest()
+      : next_base_(0x10000000),
+        cache_(new ScratchCache([this](void* base, size_t size, bool large) {
+          freed_.insert(base);
+          freed_bytes_ += size;
+        })),
+        freed_bytes_(0) {}
+
+  ~ScratchCacheTest() {
+    cache_->trim(false);
+    cache_.reset();
+  }
+
+  // A queue's scratch request.
+  ScratchCache::ScratchInfo Queue(size_t size, bool large) {
+    ScratchCache::ScratchInfo info = {};
+    info.main_size = size;
+    info.large = large;
+    return info;
+  }
+
+  // Allocates a new block for info, as the agent does on a cache miss.
+  void* Insert(ScratchCache::ScratchInfo& info) {
+    info.main_queue_base = reinterpret_cast<void*>(next_base_);
+    next_base_ += 0x10000000;
+    cache_->insertMain(info);
+    return info.main_queue_base;
+  }
+
+  // Returns the block the cache hands to info, or nullptr on a miss.
+  void* Alloc(ScratchCache::ScratchInfo& info) {
+    if (!cache_->allocMain(info)) return nullptr;
+    return info.main_queue_base;
+  }
+
+  uintptr_t next_base_;
+  std::unique_ptr<ScratchCache> cache_;
+  std::set<void*> freed_;
+  size_t freed_bytes_;
+};
+
+}  // namespace
+
+// Small requests only take small blocks of exactly their size.
+TEST_F(ScratchCacheTest, SmallRequestsUseTheirSizeClass) {
+  ScratchCache::ScratchInfo a = Queue(2 * kMB, false);
+  ScratchCache::ScratchInfo b = Queue(4 * kMB, false);
+  ScratchCache::ScratchInfo c = Queue(4 * kMB, true);
+  void* a_block = Insert(a);
+  Insert(b);
+  Insert(c);
+  cache_->freeMain(a);
+  cache_->freeMain(b);
+  cache_->freeMain(c);
+  EXPECT_EQ(cache_->free_bytes(), 10 * kMB);
+
+  ScratchCache::ScratchInfo q = Queue(3 * kMB, false);
+  EXPECT_EQ(Alloc(q), nullptr);
+
+  // The large 4MB block is not handed to a small request.
+  ScratchCache::ScratchInfo r = Queue(4 * kMB, false);
+  void* block = Alloc(r);
+  ASSERT_NE(block, nullptr);
+  ScratchCache::ScratchInfo s = Queue(4 * kMB, false);
+  EXPECT_EQ(Alloc(s), nullptr);
+
+  ScratchCache::ScratchInfo t = Queue(2 * kMB, false);
+  EXPECT_EQ(Alloc(t), a_block);
+  EXPECT_EQ(cache_->free_bytes(), 4 * kMB);
+  EXPECT_EQ(cache_->stats().hits, 2u);
+  EXPECT_EQ(cache_->stats().misses, 2u);
+
+  cache_->freeMain(r);
+  cache_->freeMain(t);
+}
+
+// Large requests take the smallest size class which fits, preferring large blocks within it.
+TEST_F(ScratchCacheTest, LargeRequestsTakeSmallestFit) {
+  std::vector<ScratchCache::ScratchInfo> owners = {Queue(8 * kMB, true), Queue(2 * kMB, true),
+                                                   Queue(4 * kMB, false), Queue(4 * kMB, true),
+                                                   Queue(16 * kMB, true)};
+  std::vector<void*> blocks;
+  for (auto& owner : owners) blocks.push_back(Insert(owner));
+  for (auto& owner : owners) cache_->freeMain(owner);
+
+  ScratchCache::ScratchInfo q = Queue(3 * kMB, true);
+  EXPECT_EQ(Alloc(q), blocks[3]);
+  ScratchCache::ScratchInfo r = Queue(3 * kMB, true);
+  EXPECT_EQ(Alloc(r), blocks[2]);
+  ScratchCache::ScratchInfo s = Queue(3 * kMB, true);
+  EXPECT_EQ(Alloc(s), blocks[0]);
+  ScratchCache::ScratchInfo t = Queue(17 * kMB, true);
+  EXPECT_EQ(Alloc(t), nullptr);
+
+  cache_->freeMain(q);
+  cache_->freeMain(r);
+  cache_->freeMain(s);
+}
+
+// A queue gets back the block it released last when other blocks of that class are free.
+TEST_F(ScratchCacheTest, AffinityWithinSizeClass) {
+  ScratchCache::ScratchInfo a = Queue(2 * kMB, false);
+  ScratchCache::ScratchInfo b = Queue(2 * kMB, false);
+  void* a_block = Insert(a);
+  void* b_block = Insert(b);
+  cache_->freeMain(a);
+  cache_->freeMain(b);
+
+  // b's block is on top of the free list, a still gets its own.
+  EXPECT_EQ(Alloc(a), a_block);
+  EXPECT_EQ(cache_->stats().affinity_hits, 1u);
+  EXPECT_EQ(Alloc(b), b_block);
+  EXPECT_EQ(cache_->stats().affinity_hits, 2u);
+
+  // Reusing a block drops the affinity of the queue that released it.
+  cache_->freeMain(a);
+  ScratchCache::ScratchInfo c = Queue(2 * kMB, false);
+  EXPECT_EQ(Alloc(c), a_block);
+  EXPECT_EQ(cache_->stats().affinity_hits, 2u);
+  cache_->freeMain(b);
+  EXPECT_EQ(Alloc(a), b_block);
+  EXPECT_EQ(cache_->stats().affinity_hits, 2u);
+
+  cache_->freeMain(a);
+  cache_->freeMain(c);
+}
+
+// A large request doesn't pin a queue's previous block when a smaller one fits.
+TEST_F(ScratchCacheTest, AffinityKeepsSmallestFit) {
+  ScratchCache::ScratchInfo q = Queue(64 * kMB, true);
+  void* huge = Insert(q);
+  cache_->freeMain(q);
+  ScratchCache::ScratchInfo other = Queue(4 * kMB, true);
+  void* small = Insert(other);
+  cache_->freeMain(other);
+
+  q.main_size = 4 * kMB;
+  EXPECT_EQ(Alloc(q), small);
+  EXPECT_EQ(cache_->stats().affinity_hits, 0u);
+
+  // Affinity applies again when the queue's block is in the smallest fitting class, even if
+  // another block of that class was released more recently.
+  ScratchCache::ScratchInfo third = Queue(4 * kMB, true);
+  Insert(third);
+  cache_->freeMain(q);
+  cache_->freeMain(third);
+  EXPECT_EQ(Alloc(q), small);
+  EXPECT_EQ(cache_->stats().affinity_hits, 1u);
+  cache_->freeMain(q);
+
+  q.main_size = 32 * kMB;
+  EXPECT_EQ(Alloc(q), huge);
+  cache_->freeMain(q);
+}
+
+// Trim releases free blocks at once and in-use blocks when they are freed.
+TEST_F(ScratchCacheTest, TrimReleasesBlocks) {
+  ScratchCache::ScratchInfo a = Queue(2 * kMB, false);
+  ScratchCache::ScratchInfo b = Queue(8 * kMB, true);
+  void* a_block = Insert(a);
+  void* b_block = Insert(b);
+  cache_->freeMain(a);
+  EXPECT_EQ(cache_->retained_bytes(), 10 * kMB);
+
+  EXPECT_TRUE(cache_->trim(true));
+  EXPECT_EQ(freed_, std::set<void*>({a_block}));
+  EXPECT_EQ(cache_->free_bytes(), 0u);
+  EXPECT_EQ(cache_->retained_bytes(), 8 * kMB);
+  EXPECT_EQ(cache_->stats().trims, 1u);
+  EXPECT_EQ(cache_->stats().trimmed_bytes, 2 * kMB);
+
+  ScratchCache::ScratchInfo c = Queue(2 * kMB, false);
+  EXPECT_EQ(Alloc(c), nullptr);
+
+  cache_->freeMain(b);
+  EXPECT_EQ(freed_, std::set<void*>({a_block, b_block}));
+  EXPECT_EQ(cache_->retained_bytes(), 0u);
+  EXPECT_EQ(freed_bytes_, 10 * kMB);
+  EXPECT_FALSE(cache_->trim(false));
+}
+
+TEST_F(ScratchCacheTest, ReservedBlock) {
+  int reserved;
+  cache_->reserve(4 * kMB, &reserved);
+  EXPECT_EQ(cache_->free_bytes(), 4 * kMB);
+
+  ScratchCache::ScratchInfo big = Queue(8 * kMB, true);
+  EXPECT_FALSE(cache_->use_reserved(big));
+  ScratchCache::ScratchInfo q = Queue(2 * kMB, false);
+  ASSERT_TRUE(cache_->use_reserved(q));
+  EXPECT_EQ(q.main_queue_base, &reserved);
+  EXPECT_EQ(cache_->free_bytes(), 0u);
+  ScratchCache::ScratchInfo r = Queue(2 * kMB, false);
+  EXPECT_FALSE(cache_->use_reserved(r));
+
+  // Reserved memory is freed back to the reservation, never to the cache.
+  cache_->freeMain(q);
+  EXPECT_EQ(cache_->free_bytes(), 4 * kMB);
+  EXPECT_EQ(cache_->retained_bytes(), 0u);
+  cache_->free_reserve();
+  EXPECT_EQ(freed_, std::set<void*>({&reserved}));
+}
+
+// Steal candidates follow the allocMain size rules. Reserved, free and stolen blocks are not
+// candidates.
+TEST_F(ScratchCacheTest, StealCandidates) {
+  ScratchCache::ScratchInfo small = Queue(4 * kMB, false);
+  ScratchCache::ScratchInfo large = Queue(16 * kMB, true);
+  Insert(small);
+  Insert(large);
+
+  size_t size = 0;
+  ScratchCache::ScratchInfo exact = Queue(4 * kMB, false);
+  EXPECT_TRUE(cache_->canStealMain(small, exact, size));
+  EXPECT_EQ(size, 4 * kMB);
+  ScratchCache::ScratchInfo smaller = Queue(2 * kMB, false);
+  EXPECT_FALSE(cache_->canStealMain(small, smaller, size));
+  EXPECT_FALSE(cache_->canStealMain(large, exact, size));
+
+  ScratchCache::ScratchInfo want = Queue(8 * kMB, true);
+  EXPECT_TRUE(cache_->canStealMain(large, want, size));
+  EXPECT_EQ(size, 16 * kMB);
+  EXPECT_FALSE(cache_->canStealMain(small, want, size));
+
+  cache_->stealMain(large);
+  EXPECT_FALSE(cache_->canStealMain(large, want, size));
+  cache_->cancelStealMain(large);
+  EXPECT_TRUE(cache_->canStealMain(large, want, size));
+
+  cache_->freeMain(small);
+  EXPECT_FALSE(cache_->canStealMain(small, exact, size));
+
+  int reserved;
+  cache_->reserve(4 * kMB, &reserved);
+  ScratchCache::ScratchInfo r = Queue(4 * kMB, false);
+  ASSERT_TRUE(cache_->use_reserved(r));
+  EXPECT_FALSE(cache_->canStealMain(r, exact, size));
+  cache_->freeMain(r);
+  cache_->free_reserve();
+
+  cache_->freeMain(large);
+}
+
+// A block being stolen stays bound to its owner until the steal resolves. A cancelled steal
+// leaves the owner's binding intact.
+TEST_F(ScratchCacheTest, StealCancel) {
+  ScratchCache::ScratchInfo victim = Queue(8 * kMB, true);
+  void* block = Insert(victim);
+  ScratchCache::ScratchInfo owner = victim;
+
+  cache_->stealMain(owner);
+  EXPECT_EQ(cache_->free_bytes(), 0u);
+  ScratchCache::ScratchInfo q = Queue(8 * kMB, true);
+  EXPECT_EQ(Alloc(q), nullptr);
+  cache_->trim(false);
+  EXPECT_TRUE(freed_.empty());
+
+  cache_->cancelStealMain(owner);
+  EXPECT_EQ(owner.main_queue_base, block);
+  EXPECT_EQ(cache_->retained_bytes(), 8 * kMB);
+
+  cache_->freeMain(victim);
+  EXPECT_EQ(Alloc(q), block);
+  cache_->freeMain(q);
+}
+
+// A completed steal moves the block to the thief. It is released under the thief's affinity.
+TEST_F(ScratchCacheTest, StealTransfer) {
+  ScratchCache::ScratchInfo victim = Queue(8 * kMB, true);
+  void* block = Insert(victim);
+  ScratchCache::ScratchInfo owner = victim;
+  ScratchCache::ScratchInfo thief = Queue(4 * kMB, true);
+  thief.main_queue_base = reinterpret_cast<void*>(0x1);
+
+  cache_->stealMain(owner);
+  cache_->transferMain(owner, thief);
+  EXPECT_EQ(thief.main_queue_base, block);
+  EXPECT_EQ(owner.main_queue_base, nullptr);
+  EXPECT_EQ(cache_->retained_bytes(), 8 * kMB);
+  EXPECT_EQ(cache_->free_bytes(), 0u);
+
+  cache_->freeMain(thief);
+  EXPECT_EQ(cache_->free_bytes(), 8 * kMB);
+  EXPECT_TRUE(freed_.empty());
+
+  // The thief's key now owns the block's affinity.
+  ScratchCache::ScratchInfo other = Queue(8 * kMB, true);
+  Insert(other);
+  cache_->freeMain(other);
+  thief.main_size = 8 * kMB;
+  EXPECT_EQ(Alloc(thief), block);
+  EXPECT_EQ(cache_->stats().affinity_hits, 1u);
+  cache_->freeMain(thief);
+}
+
+// A trim of in-use blocks during a steal takes effect once the block is released, whichever way
+// the steal resolves.
+TEST_F(ScratchCacheTest, TrimDuringSteal) {
+  ScratchCache::ScratchInfo a = Queue(8 * kMB, true);
+  ScratchCache::ScratchInfo b = Queue(4 * kMB, false);
+  void* a_block = Insert(a);
+  void* b_block = Insert(b);
+  ScratchCache::ScratchInfo a_owner = a;
+  ScratchCache::ScratchInfo b_owner = b;
+  cache_->stealMain(a_owner);
+  cache_->stealMain(b_owner);
+
+  cache_->trim(true);
+  EXPECT_TRUE(freed_.empty());
+
+  ScratchCache::ScratchInfo thief = Queue(8 * kMB, true);
+  cache_->transferMain(a_owner, thief);
+  cache_->cancelStealMain(b_owner);
+  EXPECT_TRUE(freed_.empty());
+
+  cache_->freeMain(thief);
+  EXPECT_EQ(freed_, std::set<void*>({a_block}));
+  cache_->freeMain(b);
+  EXPECT_EQ(freed_, std::set<void*>({a_block, b_block}));
+  EXPECT_EQ(cache_->retained_bytes(), 0u);
+  EXPECT_EQ(cache_->free_bytes(), 0u);
+}
@@ -0,0 +1,260 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_sdma_copy_batch.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr::AMD;
+using rocr::core::LinearCopyDesc;
+
+namespace {
+
+// Encoding of the GFX9 and later engines, count holds bytes - 1.
+const SdmaLinearCopyFormat kFormat = {SDMA_PKT_COPY_LINEAR::kMaxSize_, -1};
+
+LinearCopyDesc Copy(uint64_t dst, uint64_t src, size_t size) {
+  LinearCopyDesc copy = {reinterpret_cast<void*>(dst), reinterpret_cast<const void*>(src), size};
+  return copy;
+}
+
+void ExpectPacket(const SDMA_PKT_COPY_LINEAR& packet, uint32_t count, uint64_t dst,
+                  uint64_t src) {
+  static_assert(sizeof(SDMA_PKT_COPY_LINEAR) == 7 * sizeof(uint32_t), "Copy packet is 7 dwords");
+  uint32_t dw[7];
+  memcpy(dw, &packet, sizeof(dw));
+  EXPECT_EQ(dw[0], 0x00000001u);  // Op COPY, sub op LINEAR.
+  EXPECT_EQ(dw[1], count);
+  EXPECT_EQ(dw[2], 0u);
+  EXPECT_EQ(dw[3], uint32_t(src));
+  EXPECT_EQ(dw[4], uint32_t(src >> 32));
+  EXPECT_EQ(dw[5], uint32_t(dst));
+  EXPECT_EQ(dw[6], uint32_t(dst >> 32));
+}
+
+}  // namespace
+
+TEST(SdmaCopyBatch, SingleCopyGolden) {
+  std::vector<SDMA_PKT_COPY_LINEAR> packets;
+  std::vector<SdmaCopySegment> segments;
+  const LinearCopyDesc copy = Copy(0x7F1200003000, 0x8A0000001000, 4096);
+  PlanSdmaCopyBatch(&copy, 1, kFormat, 16, packets, segments);
+
+  ASSERT_EQ(packets.size(), 1u);
+  ExpectPacket(packets[0], 4095, 0x7F1200003000, 0x8A0000001000);
+  ASSERT_EQ(segments.size(), 1u);
+  EXPECT_EQ(segments[0].first_packet, 0u);
+  EXPECT_EQ(segments[0].num_packets, 1u);
+  EXPECT_EQ(segments[0].bytes, 4096u);
+}
+
+TEST(SdmaCopyBatch, LargeCopySplitsAtPacketLimit) {
+  const size_t max = kFormat.max_copy_size;
+  std::vector<SDMA_PKT_COPY_LINEAR> packets;
+  std::vector<SdmaCopySegment> segments;
+  const LinearCopyDesc copy = Copy(0x100000000, 0x200000000, 2 * max + 64);
+  PlanSdmaCopyBatch(&copy, 1, kFormat, 16, packets, segments);
+
+  ASSERT_EQ(packets.size(), 3u);
+  ExpectPacket(packets[0], max - 1, 0x100000000, 0x200000000);
+  ExpectPacket(packets[1], max - 1, 0x100000000 + max, 0x200000000 + max);
+  ExpectPacket(packets[2], 63, 0x100000000 + 2 * max, 0x200000000 + 2 * max);
+  ASSERT_EQ(segments.size(), 1u);
+  EXPECT_EQ(segments[0].bytes, 2 * max + 64);
+}
+
+TEST(SdmaCopyBatch, ExtendedCountEncoding) {
+  // Engines with a 30 bit count and no size offset.
+  const SdmaLinearCopyFormat format = {(1 << 30) - 1, 0};
+  SDMA_PKT_COPY_LINEAR packet;
+  BuildSdmaLinearCopy(&packet, 1, reinterpret_cast<void*>(0x1000),
+                      reinterpret_cast<const void*>(0x2000), 0x3000000, format);
+  ExpectPacket(packet, 0x3000000, 0x1000, 0x2000);
+  EXPECT_EQ(SdmaLinearCopyPacketCount(0x3000000, format), 1u);
+}
+
+// Copies are encoded in order and a full segment closes before the next copy, so a copy may
+// straddle two segments.
+TEST(SdmaCopyBatch, SegmentsSplitAtLimit) {
+  const size_t max = kFormat.max_copy_size;
+  const LinearCopyDesc copies[] = {Copy(0x10000, 0x90000, 256), Copy(0x20000, 0xA0000, 512),
+                                   Copy(0x40000000, 0x80000000, 2 * max),
+                                   Copy(0x30000, 0xB0000, 8)};
+  std::vector<SDMA_PKT_COPY_LINEAR> packets;
+  std::vector<SdmaCopySegment> segments;
+  PlanSdmaCopyBatch(copies, 4, kFormat, 3, packets, segments);
+
+  ASSERT_EQ(packets.size(), 5u);
+  ExpectPacket(packets[0], 255, 0x10000, 0x90000);
+  ExpectPacket(packets[1], 511, 0x20000, 0xA0000);
+  ExpectPacket(packets[2], max - 1, 0x40000000, 0x80000000);
+  ExpectPacket(packets[3], max - 1, 0x40000000 + max, 0x80000000 + max);
+  ExpectPacket(packets[4], 7, 0x30000, 0xB0000);
+
+  ASSERT_EQ(segments.size(), 2u);
+  EXPECT_EQ(segments[0].first_packet, 0u);
+  EXPECT_EQ(segments[0].num_packets, 3u);
+  EXPECT_EQ(segments[0].bytes, 256 + 512 + max);
+  EXPECT_EQ(segments[1].first_packet, 3u);
+  EXPECT_EQ(segments[1].num_packets, 2u);
+  EXPECT_EQ(segments[1].bytes, max + 8);
+}
+
+TEST(SdmaCopyBatch, ExactlyFullSegmentHasNoEmptyTail) {
+  const LinearCopyDesc copies[] = {Copy(0x1000, 0x9000, 16), Copy(0x2000, 0xA000, 16)};
+  std::vector<SDMA_PKT_COPY_LINEAR> packets;
+  std::vector<SdmaCopySegment> segments;
+  PlanSdmaCopyBatch(copies, 2, kFormat, 2, packets, segments);
+  ASSERT_EQ(segments.size(), 1u);
+  EXPECT_EQ(segments[0].num_packets, 2u);
+}
+
+// A batch of empty copies still produces a segment to carry its completion signal.
+TEST(SdmaCopyBatch, EmptyCopiesKeepOneSegment) {
+  const LinearCopyDesc copies[] = {Copy(0x1000, 0x2000, 0), Copy(0x3000, 0x4000, 0)};
+  std::vector<SDMA_PKT_COPY_LINEAR> packets;
+  std::vector<SdmaCopySegment> segments;
+  PlanSdmaCopyBatch(copies, 2, kFormat, 4, packets, segments);
+  EXPECT_TRUE(packets.empty());
+  ASSERT_EQ(segments.size(), 1u);
+  EXPECT_EQ(segments[0].num_packets, 0u);
+  EXPECT_EQ(segments[0].bytes, 0u);
+}
+
+namespace {
+
+// Command stream of one batch segment: its copy packets followed by the completion.
+std::vector<uint32_t> BatchStream(const LinearCopyDesc* copies, size_t count,
+                                  const SdmaCompletion& completion, bool platform_atomics,
+                                  bool set_mtype) {
+  std::vector<SDMA_PKT_COPY_LINEAR> packets;
+  std::vector<SdmaCopySegment> segments;
+  PlanSdmaCopyBatch(copies, count, kFormat, 16, packets, segments);
+  EXPECT_EQ(segments.size(), 1u);
+
+  const size_t copy_bytes = packets.size() * sizeof(SDMA_PKT_COPY_LINEAR);
+  const uint32_t completion_bytes = SdmaCompletionSize(completion, platform_atomics);
+  std::vector<uint32_t> stream((copy_bytes + completion_bytes) / sizeof(uint32_t));
+  char* cmd = reinterpret_cast<char*>(stream.data());
+  if (copy_bytes) memcpy(cmd, packets.data(), copy_bytes);
+  EXPECT_EQ(BuildSdmaCompletion(cmd + copy_bytes, completion, platform_atomics, set_mtype),
+            completion_bytes);
+  return stream;
+}
+
+SdmaCompletion Completion(uint64_t value_location, uint64_t value, uint64_t mailbox,
+                          uint32_t event_id) {
+  SdmaCompletion completion = {reinterpret_cast<void*>(value_location), value,
+                               reinterpret_cast<uint32_t*>(mailbox), event_id};
+  return completion;
+}
+
+}  // namespace
+
+// A batch decrements its signal once with a 64 bit atomic add of -1.
+TEST(SdmaCopyBatch, AtomicCompletionGolden) {
+  const LinearCopyDesc copies[] = {Copy(0x7F0000001000, 0x7E0000002000, 64),
+                                   Copy(0x7F0000003000, 0x7E0000004000, 128)};
+  const std::vector<uint32_t> stream =
+      BatchStream(copies, 2, Completion(0x7FAB00000040, 0, 0, 0), true, true);
+
+  const uint32_t expected[] = {
+      0x00000001, 63,  0, 0x00002000, 0x7E00, 0x00001000, 0x7F00,     // Copy.
+      0x00000001, 127, 0, 0x00004000, 0x7E00, 0x00003000, 0x7F00,     // Copy.
+      0x5E00000A, 0x00000040, 0x7FAB, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0, 0,  // Atomic ADD64.
+  };
+  ASSERT_EQ(stream.size(), sizeof(expected) / sizeof(expected[0]));
+  for (size_t i = 0; i < stream.size(); ++i) EXPECT_EQ(stream[i], expected[i]) << "dword " << i;
+}
+
+// Without platform atomics the expected value is stored by a fence, high dword first when it is
+// needed. GFX10 and later fences use the uncached memory type.
+TEST(SdmaCopyBatch, FenceCompletionGolden) {
+  const LinearCopyDesc copy = Copy(0x10000, 0x20000, 4);
+  std::vector<uint32_t> stream =
+      BatchStream(&copy, 1, Completion(0x7FAB00000040, 6, 0, 0), false, false);
+  const uint32_t low_only[] = {
+      0x00000001, 3, 0, 0x00020000, 0, 0x00010000, 0,  // Copy.
+      0x00000005, 0x00000040, 0x7FAB, 6,               // Fence of the low dword.
+  };
+  ASSERT_EQ(stream.size(), sizeof(low_only) / sizeof(low_only[0]));
+  for (size_t i = 0; i < stream.size(); ++i) EXPECT_EQ(stream[i], low_only[i]) << "dword " << i;
+
+  stream = BatchStream(&copy, 1, Completion(0x7FAB00000040, 0x200000003ull, 0, 0), false, true);
+  const uint32_t both[] = {
+      0x00000001, 3, 0, 0x00020000, 0, 0x00010000, 0,  // Copy.
+      0x00030005, 0x00000044, 0x7FAB, 2,               // Fence of the high dword.
+      0x00030005, 0x00000040, 0x7FAB, 3,               // Fence of the low dword.
+  };
+  ASSERT_EQ(stream.size(), sizeof(both) / sizeof(both[0]));
+  for (size_t i = 0; i < stream.size(); ++i) EXPECT_EQ(stream[i], both[i]) << "dword " << i;
+}
+
+// Interrupt signals get a mailbox fence carrying the event id and a trap after the decrement.
+TEST(SdmaCopyBatch, InterruptCompletionGolden) {
+  const LinearCopyDesc copy = Copy(0x10000, 0x20000, 4);
+  std::vector<uint32_t> stream = BatchStream(
+      &copy, 1, Completion(0x7FAB00000040, 0, 0x7FCD00000100, 0x123), true, true);
+  const uint32_t atomic[] = {
+      0x00000001, 3, 0, 0x00020000, 0, 0x00010000, 0,                   // Copy.
+      0x5E00000A, 0x00000040, 0x7FAB, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0, 0,  // Atomic ADD64.
+      0x00030005, 0x00000100, 0x7FCD, 0x123,                            // Mailbox fence.
+      0x00000006, 0x123,                                                // Trap.
+  };
+  ASSERT_EQ(stream.size(), sizeof(atomic) / sizeof(atomic[0]));
+  for (size_t i = 0; i < stream.size(); ++i) EXPECT_EQ(stream[i], atomic[i]) << "dword " << i;
+
+  stream = BatchStream(&copy, 1, Completion(0x7FAB00000040, 1, 0x7FCD00000100, 0x123), false,
+                       false);
+  const uint32_t fence[] = {
+      0x00000001, 3, 0, 0x00020000, 0, 0x00010000, 0,  // Copy.
+      0x00000005, 0x00000040, 0x7FAB, 1,               // Signal fence.
+      0x00000005, 0x00000100, 0x7FCD, 0x123,           // Mailbox fence.
+      0x00000006, 0x123,                               // Trap.
+  };
+  ASSERT_EQ(stream.size(), sizeof(fence) / sizeof(fence[0]));
+  for (size_t i = 0; i < stream.size(); ++i) EXPECT_EQ(stream[i], fence[i]) << "dword " << i;
+}
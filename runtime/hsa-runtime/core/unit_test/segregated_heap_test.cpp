@@ -0,0 +1,316 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/util/segregated_heap.h"
+
+#include <map>
+#include <memory>
+
+#include "gtest/gtest.h"
+
+using namespace rocr;
+
+namespace {
+
+const size_t KiB = 1024;
+const size_t MiB = 1024 * 1024;
+
+// Hands out fake, never dereferenced, 2MB aligned addresses and records what the heap holds.
+// Rounds requests the same way as MemoryRegion::BlockAllocator.
+struct FakeMemory {
+  uintptr_t next = 0x100000000000ull;
+  size_t block_size = 2 * MiB;
+  std::map<uintptr_t, size_t> live;
+  size_t allocs = 0;
+};
+
+class FakeBlockAllocator {
+ public:
+  explicit FakeBlockAllocator(std::shared_ptr<FakeMemory> mem) : mem_(mem) {}
+
+  void* alloc(size_t request_size, size_t& allocated_size) const {
+    allocated_size = (request_size <= mem_->block_size) ? mem_->block_size
+                                                        : AlignUp(request_size, 2 * MiB);
+    const uintptr_t base = mem_->next;
+    mem_->next = AlignUp(base + allocated_size, 2 * MiB);
+    mem_->live[base] = allocated_size;
+    mem_->allocs++;
+    return reinterpret_cast<void*>(base);
+  }
+
+  void free(void* ptr, size_t length) const {
+    auto it = mem_->live.find(reinterpret_cast<uintptr_t>(ptr));
+    ASSERT_NE(it, mem_->live.end());
+    EXPECT_EQ(it->second, length);
+    mem_->live.erase(it);
+  }
+
+  size_t block_size() const { return mem_->block_size; }
+  void set_block_size(size_t block_size) { mem_->block_size = block_size; }
+
+ private:
+  std::shared_ptr<FakeMemory> mem_;
+};
+
+typedef SegregatedHeap<FakeBlockAllocator> Heap;
+
+uintptr_t Addr(void* ptr) { return reinterpret_cast<uintptr_t>(ptr); }
+
+class SegregatedHeapTest : public ::testing::Test {
+ protected:
+  SegregatedHeapTest() : mem(std::make_shared<FakeMemory>()), heap(FakeBlockAllocator(mem)) {}
+
+  size_t held() const {
+    size_t total = 0;
+    for (const auto& it : mem->live) total += it.second;
+    return total;
+  }
+
+  std::shared_ptr<FakeMemory> mem;
+  Heap heap;
+};
+
+}  // namespace
+
+// Slab requests are rounded to the next class: powers of two and their midpoints.
+TEST_F(SegregatedHeapTest, SlabSizeClasses) {
+  const struct {
+    size_t request;
+    size_t object;
+  } cases[] = {{1, 4 * KiB},       {4 * KiB, 4 * KiB},   {5000, 8 * KiB},
+               {9 * KiB, 12 * KiB}, {13 * KiB, 16 * KiB}, {17 * KiB, 24 * KiB},
+               {40 * KiB, 48 * KiB}, {64 * KiB, 64 * KiB}};
+
+  for (const auto& c : cases) {
+    void* a = heap.alloc(c.request);
+    void* b = heap.alloc(c.request);
+    EXPECT_EQ(Addr(b) - Addr(a), c.object) << "request " << c.request;
+  }
+  // One slab block per class, the first two requests share the 4KB class.
+  EXPECT_EQ(mem->allocs, 7u);
+}
+
+// Requests past the slab limit use buddy chunks and share one block.
+TEST_F(SegregatedHeapTest, TierSelection) {
+  void* slab = heap.alloc(heap.slab_limit());
+  void* buddy = heap.alloc(heap.slab_limit() + 1);
+  void* direct = heap.alloc(heap.default_block_size() + 1);
+  EXPECT_EQ(mem->allocs, 3u);
+
+  // Smallest buddy chunk is the power of two above the slab limit.
+  void* buddy2 = heap.alloc(heap.slab_limit() + 1);
+  EXPECT_EQ(Addr(buddy2) - Addr(buddy), 128 * KiB);
+  EXPECT_EQ(mem->allocs, 3u);
+
+  EXPECT_TRUE(heap.free(slab));
+  EXPECT_TRUE(heap.free(buddy));
+  EXPECT_TRUE(heap.free(buddy2));
+  EXPECT_TRUE(heap.free(direct));
+}
+
+// A buddy request only holds its size rounded to the smallest chunk, the tail of the enclosing
+// power of two chunk is handed out to later requests.
+TEST_F(SegregatedHeapTest, BuddyTailReturned) {
+  void* a = heap.alloc(640 * KiB);
+  const uintptr_t base = Addr(a);
+  EXPECT_EQ(heap.fragmented_size(), 2 * MiB - 640 * KiB);
+
+  void* b = heap.alloc(128 * KiB);
+  void* c = heap.alloc(256 * KiB);
+  EXPECT_EQ(Addr(b), base + 640 * KiB);
+  EXPECT_EQ(Addr(c), base + 768 * KiB);
+
+  // The upper half of the block is still one free chunk.
+  void* d = heap.alloc(1 * MiB);
+  EXPECT_EQ(Addr(d), base + 1 * MiB);
+  EXPECT_EQ(mem->allocs, 1u);
+  EXPECT_EQ(heap.fragmented_size(), 0u);
+
+  // Rounding within the smallest chunk is still reported as fragmentation.
+  EXPECT_TRUE(heap.free(d));
+  void* e = heap.alloc(700 * KiB);
+  EXPECT_EQ(Addr(e), base + 1 * MiB);
+  EXPECT_EQ(heap.fragmented_size(), 1 * MiB - 700 * KiB);
+
+  EXPECT_TRUE(heap.free(a));
+  EXPECT_TRUE(heap.free(b));
+  EXPECT_TRUE(heap.free(c));
+  EXPECT_TRUE(heap.free(e));
+  EXPECT_EQ(heap.fragmented_size(), 0u);
+  EXPECT_EQ(heap.cache_size(), 2 * MiB);
+}
+
+// Freed chunks merge with their free buddies, including the pieces of a multi chunk allocation.
+TEST_F(SegregatedHeapTest, FreeCoalesces) {
+  void* a = heap.alloc(640 * KiB);
+  void* pin = heap.alloc(1 * MiB);
+  const uintptr_t base = Addr(a);
+  ASSERT_EQ(Addr(pin), base + 1 * MiB);
+
+  // All of the lower half merges back into one chunk.
+  EXPECT_TRUE(heap.free(a));
+  void* b = heap.alloc(1 * MiB);
+  EXPECT_EQ(Addr(b), base);
+
+  // Free quarters out of order.
+  EXPECT_TRUE(heap.free(b));
+  void* q[4];
+  for (int i = 0; i < 4; i++) {
+    q[i] = heap.alloc(256 * KiB);
+    EXPECT_EQ(Addr(q[i]), base + i * 256 * KiB);
+  }
+  EXPECT_TRUE(heap.free(q[2]));
+  EXPECT_TRUE(heap.free(q[0]));
+  EXPECT_TRUE(heap.free(q[3]));
+  // q[1] still pins both halves of the lower 512KB.
+  void* c = heap.alloc(512 * KiB);
+  EXPECT_EQ(Addr(c), base + 512 * KiB);
+  EXPECT_TRUE(heap.free(c));
+  EXPECT_TRUE(heap.free(q[1]));
+  void* d = heap.alloc(1 * MiB);
+  EXPECT_EQ(Addr(d), base);
+  EXPECT_EQ(mem->allocs, 1u);
+
+  EXPECT_TRUE(heap.free(d));
+  EXPECT_TRUE(heap.free(pin));
+  EXPECT_EQ(heap.cache_size(), 2 * MiB);
+}
+
+// Slab objects return to their block, and empty blocks go to the cache for reuse by any tier.
+TEST_F(SegregatedHeapTest, SlabFreeAndReuse) {
+  void* objs[8];
+  for (auto& obj : objs) obj = heap.alloc(16 * KiB);
+  EXPECT_EQ(heap.fragmented_size(), 2 * MiB - 8 * 16 * KiB);
+
+  EXPECT_TRUE(heap.free(objs[3]));
+  EXPECT_EQ(heap.alloc(16 * KiB), objs[3]);
+  for (auto& obj : objs) EXPECT_TRUE(heap.free(obj));
+  EXPECT_EQ(heap.cache_size(), 2 * MiB);
+  EXPECT_EQ(heap.fragmented_size(), 0u);
+
+  void* buddy = heap.alloc(1 * MiB);
+  EXPECT_EQ(Addr(buddy), Addr(objs[0]));
+  EXPECT_EQ(mem->allocs, 1u);
+  EXPECT_EQ(heap.cache_size(), 0u);
+  EXPECT_TRUE(heap.free(buddy));
+}
+
+// Direct allocations are rounded to fragment granularity, not the block size, and released on free.
+TEST_F(SegregatedHeapTest, DirectGranularity) {
+  ASSERT_TRUE(heap.configure(64 * MiB, 64 * KiB));
+
+  void* ptr = heap.alloc(64 * MiB + 4 * KiB);
+  EXPECT_EQ(mem->live[Addr(ptr)], 66 * MiB);
+  EXPECT_EQ(heap.high_water_mark(), 66 * MiB);
+  EXPECT_EQ(heap.fragmented_size(), 0u);
+
+  EXPECT_TRUE(heap.free(ptr));
+  EXPECT_TRUE(mem->live.empty());
+  EXPECT_EQ(heap.cache_size(), 0u);
+
+  // Heap blocks are still whole blocks.
+  void* small = heap.alloc(4 * KiB);
+  EXPECT_EQ(held(), 64 * MiB);
+  EXPECT_TRUE(heap.free(small));
+}
+
+TEST_F(SegregatedHeapTest, Configure) {
+  EXPECT_FALSE(heap.configure(3 * MiB, 64 * KiB));
+  EXPECT_FALSE(heap.configure(2 * MiB, 2 * MiB));
+  EXPECT_FALSE(heap.configure(2 * MiB, 5 * KiB));
+  ASSERT_TRUE(heap.configure(4 * MiB, 128 * KiB));
+
+  void* a = heap.alloc(128 * KiB);
+  void* b = heap.alloc(129 * KiB);
+  EXPECT_EQ(held(), 8 * MiB);
+  // Can't reconfigure a heap that holds memory.
+  EXPECT_FALSE(heap.configure(2 * MiB, 64 * KiB));
+  EXPECT_TRUE(heap.free(a));
+  EXPECT_TRUE(heap.free(b));
+}
+
+TEST_F(SegregatedHeapTest, InvalidFree) {
+  EXPECT_TRUE(heap.free(nullptr));
+  EXPECT_FALSE(heap.free(reinterpret_cast<void*>(0x1000)));
+
+  void* a = heap.alloc(8 * KiB);
+  void* b = heap.alloc(200 * KiB);
+  EXPECT_FALSE(heap.free(reinterpret_cast<uint8_t*>(a) + 4 * KiB));
+  EXPECT_FALSE(heap.free(reinterpret_cast<uint8_t*>(b) + 64 * KiB));
+  EXPECT_TRUE(heap.free(a));
+  EXPECT_FALSE(heap.free(a));
+  EXPECT_TRUE(heap.free(b));
+  EXPECT_FALSE(heap.free(b));
+}
+
+// Discarded blocks hand out no further memory and are released rather than cached.
+TEST_F(SegregatedHeapTest, DiscardBlock) {
+  void* a = heap.alloc(256 * KiB);
+  EXPECT_TRUE(heap.discardBlock(a));
+  void* b = heap.alloc(256 * KiB);
+  EXPECT_NE(Addr(b) - Addr(a), 256 * KiB);
+  EXPECT_EQ(mem->allocs, 2u);
+
+  EXPECT_TRUE(heap.free(a));
+  EXPECT_EQ(heap.cache_size(), 0u);
+  EXPECT_EQ(mem->live.size(), 1u);
+  EXPECT_TRUE(heap.free(b));
+  EXPECT_EQ(heap.cache_size(), 2 * MiB);
+}
+
+// Alternating tiers and sizes never leaks blocks.
+TEST_F(SegregatedHeapTest, Churn) {
+  const size_t sizes[] = {4 * KiB, 20 * KiB, 64 * KiB, 96 * KiB, 300 * KiB, 1 * MiB, 3 * MiB};
+  std::vector<void*> live;
+  for (int round = 0; round < 50; round++) {
+    for (size_t size : sizes) live.push_back(heap.alloc(size + round * KiB));
+    for (size_t i = round % 3; i < live.size(); i += 3) {
+      EXPECT_TRUE(heap.free(live[i]));
+      live[i] = nullptr;
+    }
+    live.erase(std::remove(live.begin(), live.end(), nullptr), live.end());
+  }
+  for (void* ptr : live) EXPECT_TRUE(heap.free(ptr));
+  EXPECT_EQ(heap.fragmented_size(), 0u);
+  heap.trim();
+  EXPECT_TRUE(mem->live.empty());
+}
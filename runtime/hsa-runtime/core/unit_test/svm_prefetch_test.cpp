@@ -0,0 +1,289 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Drives the SVM prefetch scheduler with Step() and records the migrations and completions it
+// issues through the injected callbacks.
+
+#include "core/inc/amd_svm_prefetch.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace rocr::AMD;
+
+namespace {
+
+const uintptr_t kBase = 0x7f0000000000;
+const size_t kPage = 4096;
+const size_t kBatch = 16 * kPage;
+const uint32_t kNoNode = SvmPrefetch::kNoNode;
+
+typedef std::tuple<uintptr_t, size_t, uint32_t> Migration;
+typedef std::vector<std::pair<uintptr_t, size_t>> Holes;
+
+hsa_signal_t Signal(uint64_t handle) {
+  hsa_signal_t signal = {handle};
+  return signal;
+}
+
+class SvmPrefetchTest : public ::testing::Test {
+ protected:
+  SvmPrefetchTest()
+      : prefetch_([this](void* base, size_t size, uint32_t node) { Migrate(base, size, node); },
+                  [this](hsa_signal_t completion) { Complete(completion); }, kBatch) {}
+
+  SvmPrefetch::Prefetch* Add(size_t first_page, size_t pages, uint32_t node, uint64_t signal) {
+    return prefetch_.Add(kBase + first_page * kPage, pages * kPage, node, Signal(signal));
+  }
+
+  SvmPrefetch::Prefetch* AddReady(size_t first_page, size_t pages, uint32_t node,
+                                  uint64_t signal) {
+    SvmPrefetch::Prefetch* prefetch = Add(first_page, pages, node, signal);
+    prefetch_.Ready(prefetch);
+    return prefetch;
+  }
+
+  // Runs Step() until nothing is ready.
+  void Drain() {
+    while (prefetch_.Step()) {
+    }
+  }
+
+  static Migration Pages(size_t first_page, size_t pages, uint32_t node) {
+    return Migration(kBase + first_page * kPage, pages * kPage, node);
+  }
+
+  std::vector<Migration> migrations() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return migrations_;
+  }
+
+  std::vector<uint64_t> completions() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return completions_;
+  }
+
+  // Called with the migration in flight, so tests can query the scheduler from inside it.
+  std::function<void()> on_migrate_;
+
+  SvmPrefetch prefetch_;
+
+ private:
+  void Migrate(void* base, size_t size, uint32_t node) {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      migrations_.push_back(Migration(reinterpret_cast<uintptr_t>(base), size, node));
+    }
+    if (on_migrate_) on_migrate_();
+  }
+
+  void Complete(hsa_signal_t completion) {
+    std::lock_guard<std::mutex> lock(lock_);
+    completions_.push_back(completion.handle);
+  }
+
+  std::mutex lock_;
+  std::vector<Migration> migrations_;
+  std::vector<uint64_t> completions_;
+};
+
+}  // namespace
+
+TEST_F(SvmPrefetchTest, MergesAbuttingRangesPerDestination) {
+  AddReady(0, 4, 1, 1);
+  AddReady(4, 4, 1, 2);
+  AddReady(8, 4, 2, 3);
+  Drain();
+
+  EXPECT_EQ(migrations(), std::vector<Migration>({Pages(0, 8, 1), Pages(8, 4, 2)}));
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1, 2, 3}));
+}
+
+TEST_F(SvmPrefetchTest, MergesBelowOldestReadyRange) {
+  SvmPrefetch::Prefetch* low = Add(0, 4, 1, 1);
+  AddReady(4, 4, 1, 2);
+  prefetch_.Ready(low);
+  Drain();
+
+  EXPECT_EQ(migrations(), std::vector<Migration>({Pages(0, 8, 1)}));
+  EXPECT_EQ(completions().size(), 2u);
+}
+
+TEST_F(SvmPrefetchTest, WaitsForUnreadyNeighbours) {
+  AddReady(0, 4, 1, 1);
+  SvmPrefetch::Prefetch* blocked = Add(4, 4, 1, 2);
+  Drain();
+  EXPECT_EQ(migrations(), std::vector<Migration>({Pages(0, 4, 1)}));
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1}));
+
+  prefetch_.Ready(blocked);
+  Drain();
+  EXPECT_EQ(migrations(), std::vector<Migration>({Pages(0, 4, 1), Pages(4, 4, 1)}));
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1, 2}));
+}
+
+TEST_F(SvmPrefetchTest, SplitsAtBatchSize) {
+  AddReady(0, 40, 1, 1);
+  Drain();
+
+  EXPECT_EQ(migrations(),
+            std::vector<Migration>({Pages(0, 16, 1), Pages(16, 16, 1), Pages(32, 8, 1)}));
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1}));
+}
+
+TEST_F(SvmPrefetchTest, MergedRangesSplitAtBatchSize) {
+  AddReady(0, 12, 1, 1);
+  AddReady(12, 12, 1, 2);
+  Drain();
+
+  EXPECT_EQ(migrations(), std::vector<Migration>({Pages(0, 16, 1), Pages(16, 8, 1)}));
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1, 2}));
+}
+
+TEST_F(SvmPrefetchTest, SupersededPrefetchCompletesWithoutMigration) {
+  SvmPrefetch::Prefetch* waiting = Add(0, 8, 1, 1);
+  AddReady(0, 8, 2, 2);
+  EXPECT_TRUE(completions().empty()) << "Only ready prefetches complete";
+
+  prefetch_.Ready(waiting);
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1}));
+
+  Drain();
+  EXPECT_EQ(migrations(), std::vector<Migration>({Pages(0, 8, 2)}));
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1, 2}));
+}
+
+TEST_F(SvmPrefetchTest, ReadyPrefetchCompletesWhenSuperseded) {
+  AddReady(2, 4, 1, 1);
+  AddReady(0, 8, 2, 2);
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1}));
+
+  Drain();
+  EXPECT_EQ(migrations(), std::vector<Migration>({Pages(0, 8, 2)}));
+}
+
+TEST_F(SvmPrefetchTest, PartlySupersededPrefetchMigratesTheRest) {
+  AddReady(0, 8, 1, 1);
+  AddReady(4, 8, 2, 2);
+  Drain();
+
+  EXPECT_EQ(migrations(), std::vector<Migration>({Pages(0, 4, 1), Pages(4, 8, 2)}));
+  EXPECT_EQ(completions(), std::vector<uint64_t>({1, 2}));
+}
+
+TEST_F(SvmPrefetchTest, CancelDropsWithoutCompletion) {
+  SvmPrefetch::Prefetch* cancelled = Add(0, 4, 1, 1);
+  prefetch_.Cancel(cancelled);
+  EXPECT_FALSE(prefetch_.Step());
+  EXPECT_TRUE(completions().empty());
+}
+
+TEST_F(SvmPrefetchTest, DestinationReportsPendingRangesAndHoles) {
+  Add(2, 2, 1, 1);
+  Add(6, 2, 1, 2);
+
+  uint32_t node = 0;
+  Holes holes;
+  EXPECT_TRUE(prefetch_.Destination(kBase, kBase + 10 * kPage, &node, &holes));
+  EXPECT_EQ(node, 1u);
+  EXPECT_EQ(holes, Holes({{kBase, 2 * kPage}, {kBase + 4 * kPage, 2 * kPage},
+                          {kBase + 8 * kPage, 2 * kPage}}));
+
+  Add(8, 1, 2, 3);
+  holes.clear();
+  EXPECT_FALSE(prefetch_.Destination(kBase, kBase + 10 * kPage, &node, &holes));
+
+  holes.clear();
+  EXPECT_TRUE(prefetch_.Destination(kBase + 20 * kPage, kBase + 21 * kPage, &node, &holes));
+  EXPECT_EQ(node, kNoNode);
+  EXPECT_EQ(holes, Holes({{kBase + 20 * kPage, kPage}}));
+}
+
+TEST_F(SvmPrefetchTest, DestinationIncludesInFlightRange) {
+  AddReady(2, 4, 1, 1);
+  Add(10, 2, 2, 2);
+
+  bool queried = false;
+  on_migrate_ = [&]() {
+    if (queried) return;
+    queried = true;
+
+    // The migrating pages are still pending to their destination, the rest are holes.
+    uint32_t node = 0;
+    Holes holes;
+    EXPECT_TRUE(prefetch_.Destination(kBase, kBase + 8 * kPage, &node, &holes));
+    EXPECT_EQ(node, 1u);
+    EXPECT_EQ(holes, Holes({{kBase, 2 * kPage}, {kBase + 6 * kPage, 2 * kPage}}));
+
+    // A pending range elsewhere in the query with another destination conflicts.
+    holes.clear();
+    EXPECT_FALSE(prefetch_.Destination(kBase, kBase + 12 * kPage, &node, &holes));
+  };
+  EXPECT_TRUE(prefetch_.Step());
+  EXPECT_TRUE(queried);
+
+  // Once the migration returns the range is no longer pending.
+  uint32_t node = 0;
+  Holes holes;
+  EXPECT_TRUE(prefetch_.Destination(kBase + 2 * kPage, kBase + 6 * kPage, &node, &holes));
+  EXPECT_EQ(node, kNoNode);
+}
+
+TEST_F(SvmPrefetchTest, WorkerThreadMigratesReadyPrefetches) {
+  ASSERT_TRUE(prefetch_.Start());
+  AddReady(0, 4, 1, 1);
+  AddReady(4, 4, 1, 2);
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (completions().size() < 2 && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  EXPECT_EQ(completions().size(), 2u);
+  size_t migrated = 0;
+  for (const Migration& migration : migrations()) migrated += std::get<1>(migration);
+  EXPECT_EQ(migrated, 8 * kPage);
+}
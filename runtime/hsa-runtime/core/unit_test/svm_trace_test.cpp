@@ -0,0 +1,285 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/svm_profiler.h"
+
+#include <errno.h>
+
+#include <string>
+#include <vector>
+
+#include "hsakmt/hsakmttypes.h"
+#include "gtest/gtest.h"
+
+using namespace rocr::AMD;
+
+namespace {
+
+const uint32_t kGpu0 = 0x1a2b;
+const uint32_t kGpu1 = 0x3c4d;
+
+std::vector<SvmTraceAgent> Agents() {
+  std::vector<SvmTraceAgent> agents(3);
+  agents[0] = {kGpu0, 1, 0, 0, 0x1000};
+  agents[1] = {kGpu1, 2, 1, 0, 0x2000};
+  agents[2] = {0, 0, kSvmTraceCpuIndex, 0, 0};
+  return agents;
+}
+
+std::string Print(const SvmTraceRecord& record) {
+  char* text = nullptr;
+  size_t size = 0;
+  FILE* file = open_memstream(&text, &size);
+  PrintSvmTraceRecord(file, record, Agents());
+  fclose(file);
+  std::string ret(text, size);
+  free(text);
+  return ret;
+}
+
+std::string ReadAll(FILE* file) {
+  std::string text;
+  rewind(file);
+  char buffer[4096];
+  size_t len;
+  while ((len = fread(buffer, 1, sizeof(buffer), file)) != 0) text.append(buffer, len);
+  return text;
+}
+
+}  // namespace
+
+// Lines as written by KFD for each event type.
+TEST(SvmTrace, ParseEvents) {
+  SvmTraceRecord rec;
+
+  ASSERT_TRUE(ParseSmiRecord("5 123456789 -4242 @7f0000(10) 1a2b->0 1a2b:0 1", rec));
+  EXPECT_EQ(rec.event, HSA_SMI_EVENT_MIGRATE_START);
+  EXPECT_EQ(rec.timestamp, 123456789u);
+  EXPECT_EQ(rec.pid, 4242u);
+  EXPECT_EQ(rec.address, 0x7f0000ull * 4096);
+  EXPECT_EQ(rec.size, 0x10ull * 4096);
+  EXPECT_EQ(rec.from, kGpu0);
+  EXPECT_EQ(rec.to, 0u);
+  EXPECT_EQ(rec.trigger, 1);
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 123456789 MIGRATE_START PAGEFAULT_GPU GPU0(0x1000)->CPU "
+                        "[0x7f0000000, 0x7f000ffff]\n");
+
+  ASSERT_TRUE(ParseSmiRecord("6 123456790 -4242 @7f0000(10) 0->3c4d 0", rec));
+  EXPECT_EQ(rec.event, HSA_SMI_EVENT_MIGRATE_END);
+  EXPECT_EQ(rec.from, 0u);
+  EXPECT_EQ(rec.to, kGpu1);
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 123456790 MIGRATE_END PREFETCH CPU->GPU1(0x2000) "
+                        "[0x7f0000000, 0x7f000ffff]\n");
+
+  ASSERT_TRUE(ParseSmiRecord("7 100 -1 @abc(1a2b) W", rec));
+  EXPECT_EQ(rec.event, HSA_SMI_EVENT_PAGE_FAULT_START);
+  EXPECT_EQ(rec.address, 0xabcull * 4096);
+  EXPECT_EQ(rec.from, kGpu0);
+  EXPECT_EQ(rec.mode, 'W');
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 100 PAGE_FAULT_START Write GPU0(0x1000) 11255808\n");
+  ASSERT_TRUE(ParseSmiRecord("7 100 -1 @abc(1a2b) R", rec));
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 100 PAGE_FAULT_START Read GPU0(0x1000) 11255808\n");
+
+  ASSERT_TRUE(ParseSmiRecord("8 101 -1 @abc(3c4d) M", rec));
+  EXPECT_EQ(rec.event, HSA_SMI_EVENT_PAGE_FAULT_END);
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 101 PAGE_FAULT_END Migration GPU1(0x2000) 11255808\n");
+  ASSERT_TRUE(ParseSmiRecord("8 101 -1 @abc(3c4d) U", rec));
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 101 PAGE_FAULT_END Map GPU1(0x2000) 11255808\n");
+
+  ASSERT_TRUE(ParseSmiRecord("9 200 -7 1a2b 2", rec));
+  EXPECT_EQ(rec.event, HSA_SMI_EVENT_QUEUE_EVICTION);
+  EXPECT_EQ(rec.from, kGpu0);
+  EXPECT_EQ(rec.trigger, 2);
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 200 QUEUE_EVICTION TTM GPU0(0x1000)\n");
+
+  // Restore carries no trigger, only an R when it was rescheduled.
+  ASSERT_TRUE(ParseSmiRecord("a 201 -7 1a2b", rec));
+  EXPECT_EQ(rec.event, HSA_SMI_EVENT_QUEUE_RESTORE);
+  EXPECT_EQ(rec.from, kGpu0);
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 201 QUEUE_RESTORE GPU0(0x1000)\n");
+  ASSERT_TRUE(ParseSmiRecord("a 202 -7 1a2b R", rec));
+  EXPECT_EQ(rec.mode, 'R');
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 202 QUEUE_RESTORE RESCHEDULED GPU0(0x1000)\n");
+
+  ASSERT_TRUE(ParseSmiRecord("b 300 -9 @1000(2) 3c4d 1", rec));
+  EXPECT_EQ(rec.event, HSA_SMI_EVENT_UNMAP_FROM_GPU);
+  EXPECT_EQ(rec.address, 0x1000ull * 4096);
+  EXPECT_EQ(rec.size, 2ull * 4096);
+  EXPECT_EQ(rec.from, kGpu1);
+  EXPECT_EQ(rec.trigger, 1);
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 300 UNMAP_FROM_GPU MMU_NOTIFY_MIGRATE GPU1(0x2000) "
+                        "[0x1000000, 0x1001fff]\n");
+
+  // Events that are not traced keep their header only.
+  ASSERT_TRUE(ParseSmiRecord("1 400 -9 whatever follows", rec));
+  EXPECT_EQ(rec.event, HSA_SMI_EVENT_VMFAULT);
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 400 VMFAULT \n");
+
+  // Unknown agents and out of range triggers.
+  ASSERT_TRUE(ParseSmiRecord("9 500 -7 ffff 99", rec));
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 500 QUEUE_EVICTION UNKNOWN UNKNOWN(ffff)\n");
+}
+
+TEST(SvmTrace, ParseMalformed) {
+  SvmTraceRecord rec;
+  const char* bad[] = {
+      "",
+      "5",
+      "5 123",
+      "5 123 4242 @7f0000(10) 1a2b->0 1a2b:0 1",   // pid without '-'
+      "5 123 -4242 7f0000(10) 1a2b->0 1a2b:0 1",   // no '@'
+      "5 123 -4242 @7f0000(10 1a2b->0 1a2b:0 1",   // no ')'
+      "5 123 -4242 @7f0000(10) 1a2b-0 1a2b:0 1",   // no "->"
+      "5 123 -4242 @7f0000(10) 1a2b->0 1a2b 0 1",  // no ':'
+      "5 123 -4242 @7f0000(10) 1a2b->0 1a2b:0",    // no trigger
+      "6 123 -4242 @7f0000(10) 0->3c4d",
+      "6 123 -4242 @7f0000(10) 0->3c4d 1 junk",
+      "7 100 -1 @abc(1a2b)",
+      "7 100 -1 @abc(1a2b) WW",
+      "7 100 -1 @(1a2b) W",
+      "8 101 -1 abc(3c4d) M",
+      "9 200 -7 1a2b",
+      "9 200 -7 xyz 2",
+      "a 201 -7",
+      "a 201 -7 1a2b X",
+      "b 300 -9 @1000(2) 3c4d",
+      "b 300 -9 @1000 3c4d 1",
+      "zz 300 -9",
+  };
+  for (const char* line : bad) EXPECT_FALSE(ParseSmiRecord(line, rec)) << "'" << line << "'";
+}
+
+TEST(SvmTrace, PrintSpecialRecords) {
+  SvmTraceRecord rec = {};
+  rec.event = SVM_TRACE_EVENT_DROPPED;
+  rec.timestamp = 77;
+  rec.from = kGpu1;
+  rec.size = 12;
+  EXPECT_EQ(Print(rec), "ROCr HMM event: 77 12 events dropped on GPU1(0x2000)\n");
+
+  rec = {};
+  rec.event = SVM_TRACE_EVENT_ERROR;
+  rec.from = kGpu0;
+  rec.address = uint64_t(int64_t(-1));
+  rec.size = EINTR;
+  EXPECT_EQ(Print(rec), std::string("ROCr HMM event error: Read returned -1, ") +
+                strerror(EINTR) + " (" + std::to_string(EINTR) + ") on GPU0(0x1000)\n");
+}
+
+// Binary traces decode to the text format in time order, malformed traces are rejected.
+TEST(SvmTrace, DecodeBinary) {
+  std::vector<SvmTraceAgent> agents = Agents();
+  SvmTraceHeader header = {};
+  memcpy(header.magic, kSvmTraceMagic, sizeof(header.magic));
+  header.version = kSvmTraceVersion;
+  header.record_size = sizeof(SvmTraceRecord);
+  header.agent_count = agents.size();
+
+  // GPU batches are written one after the other, not interleaved in time.
+  const char* lines[] = {"7 10 -1 @abc(1a2b) W", "8 30 -1 @abc(1a2b) M",
+                         "9 20 -1 3c4d 0", "a 40 -1 3c4d"};
+  std::vector<SvmTraceRecord> records;
+  for (const char* line : lines) {
+    SvmTraceRecord rec;
+    ASSERT_TRUE(ParseSmiRecord(line, rec));
+    records.push_back(rec);
+  }
+  SvmTraceRecord dropped = {};
+  dropped.event = SVM_TRACE_EVENT_DROPPED;
+  dropped.timestamp = 40;
+  dropped.from = kGpu1;
+  dropped.size = 3;
+  records.push_back(dropped);
+
+  std::string trace(reinterpret_cast<char*>(&header), sizeof(header));
+  trace.append(reinterpret_cast<char*>(&agents[0]), agents.size() * sizeof(SvmTraceAgent));
+  trace.append(reinterpret_cast<char*>(&records[0]), records.size() * sizeof(SvmTraceRecord));
+
+  auto decode = [](const std::string& bytes, std::string* text) {
+    FILE* in = tmpfile();
+    fwrite(bytes.data(), 1, bytes.size(), in);
+    rewind(in);
+    FILE* out = tmpfile();
+    bool ok = DecodeSvmTrace(in, out);
+    if (text != nullptr) *text = ReadAll(out);
+    fclose(in);
+    fclose(out);
+    return ok;
+  };
+
+  std::string text;
+  ASSERT_TRUE(decode(trace, &text));
+  EXPECT_EQ(text,
+            "ROCr HMM event: 10 PAGE_FAULT_START Write GPU0(0x1000) 11255808\n"
+            "ROCr HMM event: 20 QUEUE_EVICTION SVM GPU1(0x2000)\n"
+            "ROCr HMM event: 30 PAGE_FAULT_END Migration GPU0(0x1000) 11255808\n"
+            "ROCr HMM event: 40 QUEUE_RESTORE GPU1(0x2000)\n"
+            "ROCr HMM event: 40 3 events dropped on GPU1(0x2000)\n");
+
+  // An empty trace is valid.
+  EXPECT_TRUE(decode(trace.substr(0, sizeof(header) + agents.size() * sizeof(SvmTraceAgent)),
+                     nullptr));
+  // Truncated anywhere else is not.
+  for (size_t cut = 0; cut < trace.size(); cut++) {
+    size_t body = cut - std::min(cut, sizeof(header) + agents.size() * sizeof(SvmTraceAgent));
+    bool boundary = (cut >= sizeof(header) + agents.size() * sizeof(SvmTraceAgent)) &&
+        (body % sizeof(SvmTraceRecord) == 0);
+    EXPECT_EQ(decode(trace.substr(0, cut), nullptr), boundary) << "cut at " << cut;
+  }
+
+  std::string bad = trace;
+  bad[0] = 'X';
+  EXPECT_FALSE(decode(bad, nullptr));
+  SvmTraceHeader changed = header;
+  changed.version = kSvmTraceVersion + 1;
+  bad = trace;
+  bad.replace(0, sizeof(changed), reinterpret_cast<char*>(&changed), sizeof(changed));
+  EXPECT_FALSE(decode(bad, nullptr));
+  changed = header;
+  changed.record_size = sizeof(SvmTraceRecord) + 8;
+  bad.replace(0, sizeof(changed), reinterpret_cast<char*>(&changed), sizeof(changed));
+  EXPECT_FALSE(decode(bad, nullptr));
+  changed = header;
+  changed.agent_count = kSvmTraceMaxAgents + 1;
+  bad.replace(0, sizeof(changed), reinterpret_cast<char*>(&changed), sizeof(changed));
+  EXPECT_FALSE(decode(bad, nullptr));
+}
@@ -0,0 +1,452 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Exercises the XDNA driver's buffer object bookkeeping against a stub DRM device.  The test
+// defines ioctl() so every request on the stub's file lands in StubXdnaDevice, while command BO
+// mappings are served by a memfd.  The OS layer comes from host_os.cpp, and runtime pieces the
+// driver references but these tests never reach are stubbed below.
+
+#include "core/inc/amd_xdna_driver.h"
+
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/driver/xdna/uapi/amdxdna_accel.h"
+#include "core/inc/amd_aie_aql_queue.h"
+#include "core/inc/runtime.h"
+#include "gtest/gtest.h"
+
+namespace rocr {
+namespace core {
+Runtime* Runtime::runtime_singleton_ = nullptr;
+void Runtime::RegisterDriver(std::unique_ptr<Driver>& driver) {}
+
+// No queues are created, so no barrier is ever waited on.
+uint32_t Signal::WaitAny(uint32_t signal_count, const hsa_signal_t* hsa_signals,
+                         const hsa_signal_condition_t* conds, const hsa_signal_value_t* values,
+                         uint64_t timeout_hint, hsa_wait_state_t wait_hint,
+                         hsa_signal_value_t* satisfying_value) {
+  abort();
+}
+Signal* Signal::lookupIpc(hsa_signal_t signal) { abort(); }
+}  // namespace core
+
+namespace AMD {
+int AieAqlQueue::rtti_id_ = 0;
+}  // namespace AMD
+}  // namespace rocr
+
+using namespace rocr;
+using namespace rocr::AMD;
+
+namespace {
+
+// Device BOs are not CPU mapped, so the stub hands out addresses from a range nothing else uses.
+const uint64_t kDevVaBase = 0x100000000000ull;
+const size_t kMapFileSize = size_t(1) << 32;
+
+// Implements the amdxdna ioctls the driver uses for BOs and command execution.
+class StubXdnaDevice {
+ public:
+  StubXdnaDevice() {
+    memfd_ = memfd_create("xdna_bo_test", 0);
+    EXPECT_GE(memfd_, 0);
+    EXPECT_EQ(ftruncate(memfd_, kMapFileSize), 0);
+    struct stat st;
+    fstat(memfd_, &st);
+    dev_ = st.st_dev;
+    ino_ = st.st_ino;
+  }
+  ~StubXdnaDevice() { close(memfd_); }
+
+  // Path the driver opens as its device node.
+  std::string path() const { return "/proc/self/fd/" + std::to_string(memfd_); }
+
+  bool Owns(int fd) const {
+    struct stat st;
+    return fstat(fd, &st) == 0 && st.st_dev == dev_ && st.st_ino == ino_;
+  }
+
+  int Ioctl(unsigned long request, void* arg) {
+    std::lock_guard<std::mutex> lock(lock_);
+    ioctls_++;
+    switch (request) {
+      case DRM_IOCTL_AMDXDNA_CREATE_BO: {
+        auto* args = reinterpret_cast<amdxdna_drm_create_bo*>(arg);
+        Bo bo = {args->type, args->size, 0, 0};
+        if (args->type == AMDXDNA_BO_DEV) {
+          bo.vaddr = next_va_;
+          next_va_ += args->size;
+        } else {
+          bo.map_offset = next_map_offset_;
+          next_map_offset_ += (args->size + 4095) & ~uint64_t(4095);
+          if (next_map_offset_ > kMapFileSize) return -1;
+        }
+        args->handle = next_handle_++;
+        bos_[args->handle] = bo;
+        created_[args->type]++;
+        return 0;
+      }
+      case DRM_IOCTL_AMDXDNA_GET_BO_INFO: {
+        auto* args = reinterpret_cast<amdxdna_drm_get_bo_info*>(arg);
+        auto it = bos_.find(args->handle);
+        if (it == bos_.end()) return -1;
+        args->map_offset = it->second.map_offset;
+        args->vaddr = it->second.vaddr;
+        args->xdna_addr = it->second.vaddr;
+        return 0;
+      }
+      case DRM_IOCTL_GEM_CLOSE: {
+        auto* args = reinterpret_cast<drm_gem_close*>(arg);
+        if (bos_.erase(args->handle) == 0) {
+          bad_closes_++;
+          return -1;
+        }
+        return 0;
+      }
+      case DRM_IOCTL_AMDXDNA_EXEC_CMD: {
+        auto* args = reinterpret_cast<amdxdna_drm_exec_cmd*>(arg);
+        const uint32_t* handles = reinterpret_cast<const uint32_t*>(args->args);
+        exec_args_.push_back(std::vector<uint32_t>(handles, handles + args->arg_count));
+        args->seq = ++next_seq_;
+        cmd_by_seq_[args->seq] = static_cast<uint32_t>(args->cmd_handles);
+        return 0;
+      }
+      case DRM_IOCTL_AMDXDNA_WAIT_CMD: {
+        auto* args = reinterpret_cast<amdxdna_drm_wait_cmd*>(arg);
+        if (fail_waits_) return -1;
+        // The device reports completion in the state field of the command header.
+        const uint64_t offset = bos_.at(cmd_by_seq_.at(args->seq)).map_offset;
+        uint32_t header = 0;
+        EXPECT_EQ(pread(memfd_, &header, sizeof(header), offset), ssize_t(sizeof(header)));
+        header = (header & ~0xFu) | HSA_AMD_AIE_ERT_STATE_COMPLETED;
+        EXPECT_EQ(pwrite(memfd_, &header, sizeof(header), offset), ssize_t(sizeof(header)));
+        return 0;
+      }
+      default:
+        return -1;
+    }
+  }
+
+  size_t live_bos() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return bos_.size();
+  }
+  size_t live_bos(uint32_t type) {
+    std::lock_guard<std::mutex> lock(lock_);
+    size_t count = 0;
+    for (const auto& bo : bos_) count += (bo.second.type == type);
+    return count;
+  }
+  size_t created(uint32_t type) {
+    std::lock_guard<std::mutex> lock(lock_);
+    return created_[type];
+  }
+  size_t ioctls() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return ioctls_;
+  }
+  size_t bad_closes() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return bad_closes_;
+  }
+  std::vector<std::vector<uint32_t>> exec_args() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return exec_args_;
+  }
+  void set_fail_waits(bool fail) {
+    std::lock_guard<std::mutex> lock(lock_);
+    fail_waits_ = fail;
+  }
+
+ private:
+  struct Bo {
+    uint32_t type;
+    uint64_t size;
+    uint64_t map_offset;
+    uint64_t vaddr;
+  };
+
+  std::mutex lock_;
+  int memfd_;
+  dev_t dev_;
+  ino_t ino_;
+  std::map<uint32_t, Bo> bos_;
+  std::map<uint32_t, size_t> created_;
+  std::map<uint64_t, uint32_t> cmd_by_seq_;
+  std::vector<std::vector<uint32_t>> exec_args_;
+  uint32_t next_handle_ = 1;
+  uint64_t next_va_ = kDevVaBase;
+  uint64_t next_map_offset_ = 0;
+  uint64_t next_seq_ = 0;
+  size_t ioctls_ = 0;
+  size_t bad_closes_ = 0;
+  bool fail_waits_ = false;
+};
+
+StubXdnaDevice* g_device = nullptr;
+
+}  // namespace
+
+extern "C" int ioctl(int fd, unsigned long request, ...) __THROW {
+  va_list ap;
+  va_start(ap, request);
+  void* arg = va_arg(ap, void*);
+  va_end(ap);
+  if (g_device != nullptr && g_device->Owns(fd)) return g_device->Ioctl(request, arg);
+  return syscall(SYS_ioctl, fd, request, arg);
+}
+
+namespace {
+
+const core::MemoryRegion::AllocateFlags kNoFlags = core::MemoryRegion::AllocateNoFlags;
+
+class XdnaBoTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    device_.reset(new StubXdnaDevice());
+    g_device = device_.get();
+    driver_.reset(new XdnaDriver(device_->path()));
+    ASSERT_EQ(driver_->Open(), HSA_STATUS_SUCCESS);
+  }
+
+  void TearDown() override {
+    DestroyDriver();
+    g_device = nullptr;
+    device_.reset();
+  }
+
+  // Destroys the driver, which must close every BO it still owns.
+  void DestroyDriver() {
+    if (!driver_) return;
+    driver_.reset();
+    EXPECT_EQ(device_->live_bos(), 0u);
+    EXPECT_EQ(device_->bad_closes(), 0u);
+  }
+
+  void* Allocate(size_t size, uint32_t type = AMDXDNA_BO_DEV,
+                 core::MemoryRegion::AllocateFlags flags = kNoFlags) {
+    void* mem = nullptr;
+    EXPECT_EQ(driver_->AllocateBoMemory(type, flags, &mem, size), HSA_STATUS_SUCCESS);
+    return mem;
+  }
+
+  uint32_t BoHandle(const void* ptr, size_t* offset = nullptr) {
+    uint32_t handle = 0;
+    size_t bo_offset = 0;
+    EXPECT_EQ(driver_->GetBoHandle(ptr, &handle, &bo_offset), HSA_STATUS_SUCCESS);
+    if (offset != nullptr) *offset = bo_offset;
+    return handle;
+  }
+
+  // Builds a start kernel command whose payload is @p data after the CU mask.
+  hsa_amd_aie_ert_packet_t StartKernel(std::vector<uint32_t>& payload,
+                                       const std::vector<uint32_t>& data) {
+    payload.assign(1, 1);
+    payload.insert(payload.end(), data.begin(), data.end());
+    hsa_amd_aie_ert_packet_t ert;
+    memset(&ert, 0, sizeof(ert));
+    ert.header.header = HSA_PACKET_TYPE_VENDOR_SPECIFIC << HSA_PACKET_HEADER_TYPE;
+    ert.header.AmdFormat = HSA_AMD_PACKET_TYPE_AIE_ERT;
+    ert.opcode = HSA_AMD_AIE_ERT_START_NPU;
+    ert.count = payload.size();
+    ert.payload_data = reinterpret_cast<uintptr_t>(payload.data());
+    return ert;
+  }
+
+  // Submits @p count copies of @p ert as one submission and waits for it.
+  hsa_status_t SubmitAndWait(const hsa_amd_aie_ert_packet_t& ert, uint32_t count) {
+    std::vector<const hsa_amd_aie_ert_packet_t*> cmds(count, &ert);
+    uint64_t seq = 0;
+    hsa_status_t status = driver_->GetCommandSink().SubmitChain(1, cmds.data(), count, &seq);
+    if (status != HSA_STATUS_SUCCESS) return status;
+    return driver_->GetCommandSink().WaitChain(1, seq);
+  }
+
+  std::unique_ptr<StubXdnaDevice> device_;
+  std::unique_ptr<XdnaDriver> driver_;
+};
+
+void AppendAddress(std::vector<uint32_t>& data, const void* ptr) {
+  const uint64_t addr = reinterpret_cast<uintptr_t>(ptr);
+  data.push_back(uint32_t(addr));
+  data.push_back(uint32_t(addr >> 32));
+}
+
+}  // namespace
+
+TEST_F(XdnaBoTest, SmallBuffersSharePooledBo) {
+  std::vector<void*> buffers;
+  for (int i = 0; i < 64; i++) buffers.push_back(Allocate(4096));
+  EXPECT_EQ(device_->created(AMDXDNA_BO_DEV), 1u);
+
+  const uint32_t block = BoHandle(buffers[0]);
+  for (void* buffer : buffers) {
+    size_t offset = 0;
+    EXPECT_EQ(BoHandle(static_cast<char*>(buffer) + 100, &offset), block);
+    EXPECT_EQ(offset, reinterpret_cast<uintptr_t>(buffer) + 100 - kDevVaBase);
+  }
+
+  for (void* buffer : buffers) EXPECT_EQ(driver_->FreeMemory(buffer, 4096), HSA_STATUS_SUCCESS);
+}
+
+TEST_F(XdnaBoTest, LargeAndHandleOnlyBuffersOwnTheirBo) {
+  void* small = Allocate(4096);
+  void* large = Allocate(256 * 1024);
+  void* handle_only = Allocate(4096, AMDXDNA_BO_DEV, core::MemoryRegion::AllocateMemoryOnly);
+  EXPECT_EQ(device_->created(AMDXDNA_BO_DEV), 3u);
+
+  size_t offset = 0;
+  const uint32_t large_handle = BoHandle(static_cast<char*>(large) + 4000, &offset);
+  EXPECT_NE(large_handle, BoHandle(small));
+  EXPECT_EQ(offset, 4000u);
+  EXPECT_LT(reinterpret_cast<uintptr_t>(handle_only), uintptr_t(UINT32_MAX));
+
+  uint32_t handle = 0;
+  EXPECT_EQ(driver_->GetBoHandle(&handle, &handle, &offset), HSA_STATUS_ERROR_INVALID_ALLOCATION);
+
+  EXPECT_EQ(driver_->FreeMemory(large, 256 * 1024), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(driver_->FreeMemory(handle_only, 4096), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(driver_->FreeMemory(small, 4096), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(driver_->FreeMemory(large, 256 * 1024), HSA_STATUS_ERROR_INVALID_ALLOCATION);
+  EXPECT_EQ(device_->live_bos(AMDXDNA_BO_DEV), 1u) << "Only the cached pool block remains";
+}
+
+TEST_F(XdnaBoTest, DriverClosesLeakedBos) {
+  Allocate(4096);
+  Allocate(512, AMDXDNA_BO_CMD);
+  Allocate(1024 * 1024);
+  Allocate(8192, AMDXDNA_BO_CMD, core::MemoryRegion::AllocateMemoryOnly);
+  void* freed = Allocate(128 * 1024);
+  EXPECT_EQ(driver_->FreeMemory(freed, 128 * 1024), HSA_STATUS_SUCCESS);
+
+  std::vector<uint32_t> payload;
+  const hsa_amd_aie_ert_packet_t ert = StartKernel(payload, {0, 0});
+  EXPECT_EQ(SubmitAndWait(ert, 4), HSA_STATUS_SUCCESS);
+  EXPECT_GT(device_->live_bos(AMDXDNA_BO_CMD), 0u);
+
+  DestroyDriver();
+}
+
+TEST_F(XdnaBoTest, FailedWaitReleasesCommandBos) {
+  std::vector<uint32_t> payload;
+  const hsa_amd_aie_ert_packet_t ert = StartKernel(payload, {0, 0});
+  device_->set_fail_waits(true);
+  EXPECT_EQ(SubmitAndWait(ert, 3), HSA_STATUS_ERROR);
+  // The device may still own the BOs, so they go back to the kernel instead of the free list.
+  EXPECT_EQ(device_->live_bos(AMDXDNA_BO_CMD), 0u);
+}
+
+TEST_F(XdnaBoTest, ExecPassesPayloadBos) {
+  char* a = static_cast<char*>(Allocate(4096));
+  char* b = static_cast<char*>(Allocate(4096));
+  char* large = static_cast<char*>(Allocate(256 * 1024));
+
+  // Arguments are packed, so the second address starts at an odd DWORD.
+  std::vector<uint32_t> data;
+  AppendAddress(data, a);
+  data.push_back(64);
+  AppendAddress(data, b + 16);
+  AppendAddress(data, large + 4096);
+  AppendAddress(data, reinterpret_cast<void*>(0x1000));
+  std::vector<uint32_t> payload;
+  const hsa_amd_aie_ert_packet_t ert = StartKernel(payload, data);
+  EXPECT_EQ(SubmitAndWait(ert, 1), HSA_STATUS_SUCCESS);
+
+  std::vector<uint32_t> expected = {BoHandle(a), BoHandle(large)};
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(device_->exec_args().size(), 1u);
+  EXPECT_EQ(device_->exec_args()[0], expected);
+
+  // A chain attaches the union of its commands' BOs once each.
+  std::vector<uint32_t> other_payload;
+  std::vector<uint32_t> other_data;
+  AppendAddress(other_data, b);
+  const hsa_amd_aie_ert_packet_t other = StartKernel(other_payload, other_data);
+  const hsa_amd_aie_ert_packet_t* cmds[] = {&ert, &other};
+  uint64_t seq = 0;
+  ASSERT_EQ(driver_->GetCommandSink().SubmitChain(1, cmds, 2, &seq), HSA_STATUS_SUCCESS);
+  EXPECT_EQ(driver_->GetCommandSink().WaitChain(1, seq), HSA_STATUS_SUCCESS);
+  ASSERT_EQ(device_->exec_args().size(), 2u);
+  EXPECT_EQ(device_->exec_args()[1], expected);
+}
+
+TEST_F(XdnaBoTest, SmallAllocationsAvoidIoctls) {
+  const size_t kCount = 10000;
+  std::vector<void*> buffers;
+  const size_t before = device_->ioctls();
+  for (size_t i = 0; i < kCount; i++) buffers.push_back(Allocate(256));
+  for (void* buffer : buffers) driver_->FreeMemory(buffer, 256);
+  for (size_t i = 0; i < kCount; i++) driver_->FreeMemory(Allocate(256), 256);
+
+  // 2.5MB of buffers fit in three pool blocks. Each costs at most a create, an info query and a
+  // close, and blocks cached by the heap serve the second round.
+  EXPECT_EQ(device_->created(AMDXDNA_BO_DEV), 3u);
+  EXPECT_LE(device_->ioctls() - before, 9u);
+}
+
+TEST_F(XdnaBoTest, CommandBosAreRecycled) {
+  const uint32_t kMaxChain = AieCommandSubmitter::kMaxChainLength;
+  std::vector<uint32_t> payload;
+  const hsa_amd_aie_ert_packet_t ert = StartKernel(payload, {0, 0});
+
+  const size_t before = device_->ioctls();
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(SubmitAndWait(ert, 1), HSA_STATUS_SUCCESS);
+    ASSERT_EQ(SubmitAndWait(ert, kMaxChain), HSA_STATUS_SUCCESS);
+  }
+
+  // The longest chain needs one BO per command and one for the chain. After that each
+  // submission is one exec and one wait.
+  EXPECT_EQ(device_->created(AMDXDNA_BO_CMD), kMaxChain + 1);
+  EXPECT_EQ(device_->ioctls() - before, 2 * (kMaxChain + 1) + 2 * 2000);
+}
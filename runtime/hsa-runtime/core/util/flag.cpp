@@ -223,4 +223,44 @@ void Flag::parse_masks(std::string& var, uint32_t maxGpu, uint32_t maxCU) {
   }
 }
 
+/*
+Parse env var per the following syntax, all whitespace is ignored:
+
+SIZE = [0-9][0-9]*                       ex. size in bytes, base 10
+GPU_list = ID_list                       ex. 0,2-4,7
+Size_Set = SIZE | GPU_list : SIZE        ex. 4194304 OR 0,2-4:8388608
+VAR = Size_Set [; Size_Set]*             ex. 4194304; 1:8388608
+
+A set without a GPU list changes the default for all GPUs.  GPU indexes are taken post
+ROCR_VISIBLE_DEVICES reordering.  Parsing stops at the first set that has a syntax error, that
+set and all following sets are ignored.
+*/
+void Flag::parse_sizes(std::string& var, size_t& size, std::map<uint32_t, size_t>& gpu_size) {
+  if (var.empty()) return;
+
+  // Remove whitespace
+  auto end = std::remove_if(var.begin(), var.end(),
+                            [](char c) { return std::isspace<char>(c, std::locale::classic()); });
+  var.erase(end, var.end());
+
+  auto sets = split(var, ';');
+  for (auto& set : sets) {
+    auto parts = split(set, ':');
+    if (parts.empty() || parts.size() > 2) return;
+
+    char* last;
+    size_t value = strtoull(parts.back().c_str(), &last, 10);
+    if ((*last != '\0') || (value == 0)) return;
+
+    if (parts.size() == 1) {
+      size = value;
+      continue;
+    }
+
+    auto gpu_index = get_elements(parts[0], UINT16_MAX);
+    if (gpu_index.empty()) return;
+    for (auto id : gpu_index) gpu_size[id] = value;
+  }
+}
+
 }  // namespace rocr
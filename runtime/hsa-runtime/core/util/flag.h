@@ -68,6 +68,8 @@ class Flag {
   // reclaim is supported
   const size_t DEFAULT_SCRATCH_SINGLE_LIMIT = 146800640;  // small_limit >> 2;
   const size_t DEFAULT_PCS_MAX_DEVICE_BUFFER_SIZE = 256 * 1024 * 1024;
+  const size_t DEFAULT_FRAGMENT_BLOCK_SIZE = 2 * 1024 * 1024;
+  const size_t DEFAULT_FRAGMENT_SLAB_LIMIT = 64 * 1024;
 
   explicit Flag() { Refresh(); }
 
@@ -117,6 +119,11 @@ class Flag {
     var = os::GetEnvVar("HSA_MAX_QUEUES");
     max_queues_ = static_cast<uint32_t>(atoi(var.c_str()));
 
+    // Number of interrupt signals that may share one KFD event. 0 or 1 gives every signal its own
+    // event until the driver runs out, after which events are shared regardless.
+    var = os::GetEnvVar("HSA_SIGNAL_EVENT_SHARE_RATIO");
+    signal_event_share_ratio_ = static_cast<uint32_t>(atoi(var.c_str()));
+
     // Maximum amount of scratch mem that can be used per process per gpu
     var = os::GetEnvVar("HSA_SCRATCH_MEM");
     scratch_mem_size_ = atoi(var.c_str());
@@ -152,6 +159,65 @@ class Flag {
     var = os::GetEnvVar("HSA_ENABLE_SCRATCH_ALT");
     enable_scratch_alt_ = (var == "0") || !enable_scratch_async_reclaim_ ? false : true;
 
+    // Time budget in microseconds for taking scratch bound to an idle queue before reducing
+    // occupancy. Only used with asynchronous scratch reclaim. 0 disables stealing.
+    var = os::GetEnvVar("HSA_SCRATCH_STEAL_WAIT_US");
+    scratch_steal_wait_us_ = var.empty() ? 1000 : strtoull(var.c_str(), nullptr, 10);
+
+    // Bytes of pageable host memory hsa_memory_copy may keep pinned between calls. Cached pins
+    // outlive the copy, so they are only safe if the application keeps the buffers mapped until
+    // they are evicted. 0 (default) pins and unpins around every copy.
+    var = os::GetEnvVar("HSA_COPY_PIN_CACHE_SIZE");
+    copy_pin_cache_size_ = var.empty() ? 0 : strtoull(var.c_str(), nullptr, 10);
+
+    // Bytes of host memory hsa_amd_memory_lock may keep pinned after the last unlock of a range,
+    // so later locks of it reuse the registration. Like the copy pin cache this is only safe if
+    // the application keeps unlocked buffers mapped. 0 (default) unpins on the last unlock.
+    var = os::GetEnvVar("HSA_LOCK_CACHE_SIZE");
+    lock_cache_size_ = var.empty() ? 0 : strtoull(var.c_str(), nullptr, 10);
+
+    // Bytes of AQL ring buffers each GPU keeps from destroyed queues for reuse. 0 disables.
+    var = os::GetEnvVar("HSA_QUEUE_RING_POOL_SIZE");
+    queue_ring_pool_size_ = var.empty() ? 32 * 1024 * 1024 : strtoull(var.c_str(), nullptr, 10);
+
+    // Bounce buffer ring used by hsa_memory_copy for pageable host memory. 0 buffers disables
+    // staging so pageable ranges are always pinned.
+    var = os::GetEnvVar("HSA_COPY_STAGING_BUFFERS");
+    copy_staging_buffers_ = var.empty() ? 4 : atoi(var.c_str());
+
+    var = os::GetEnvVar("HSA_COPY_STAGING_BUFFER_SIZE");
+    copy_staging_buffer_size_ =
+        var.empty() ? 4 * 1024 * 1024 : AlignUp(strtoull(var.c_str(), nullptr, 10), 4096);
+    if (copy_staging_buffer_size_ == 0) copy_staging_buffers_ = 0;
+
+    // Helper threads splitting host memcpy into and out of bounce buffers.
+    var = os::GetEnvVar("HSA_COPY_STAGING_THREADS");
+    copy_staging_threads_ = var.empty() ? 3 : atoi(var.c_str());
+
+    // Staging versus pinning cost model: pin and map cost per 4KB page in ns, host memcpy MB/s
+    // per thread and DMA MB/s.
+    var = os::GetEnvVar("HSA_COPY_PIN_NS_PER_PAGE");
+    copy_pin_ns_per_page_ = var.empty() ? 300 : atoi(var.c_str());
+
+    var = os::GetEnvVar("HSA_COPY_MEMCPY_MBPS");
+    copy_memcpy_mbps_ = var.empty() ? 8000 : atoi(var.c_str());
+    if (copy_memcpy_mbps_ == 0) copy_memcpy_mbps_ = 1;
+
+    var = os::GetEnvVar("HSA_COPY_DMA_MBPS");
+    copy_dma_mbps_ = var.empty() ? 24000 : atoi(var.c_str());
+    if (copy_dma_mbps_ == 0) copy_dma_mbps_ = 1;
+
+    // Upper bound on bytes handed to KFD in one coalesced SVM prefetch migration.
+    var = os::GetEnvVar("HSA_SVM_PREFETCH_BATCH_SIZE");
+    svm_prefetch_batch_size_ =
+        var.empty() ? 64 * 1024 * 1024 : AlignUp(strtoull(var.c_str(), nullptr, 10), 4096);
+    if (svm_prefetch_batch_size_ == 0) svm_prefetch_batch_size_ = 4096;
+
+    // Reserve scratch and bind the trap handler of each GPU at its first queue creation instead of
+    // in hsa_init. 0 restores eager bring-up of every visible GPU.
+    var = os::GetEnvVar("HSA_ENABLE_LAZY_AGENT_INIT");
+    lazy_agent_init_ = (var == "0") ? false : true;
+
     tools_lib_names_ = os::GetEnvVar("HSA_TOOLS_LIB");
 
     var = os::GetEnvVar("HSA_TOOLS_REPORT_LOAD_FAILURE");
@@ -171,6 +237,18 @@ class Flag {
     var = os::GetEnvVar("HSA_DISABLE_FRAGMENT_ALLOCATOR");
     disable_fragment_alloc_ = (var == "1") ? true : false;
 
+    // Block size and slab tier limit of the VRAM fragment allocator, optionally per GPU.  Block
+    // sizes must be power of two multiples of 2MB, at most 256MB, so fragments stay IPC exportable.
+    var = os::GetEnvVar("HSA_FRAGMENT_BLOCK_SIZE");
+    fragment_block_size_ = DEFAULT_FRAGMENT_BLOCK_SIZE;
+    fragment_block_size_gpu_.clear();
+    parse_sizes(var, fragment_block_size_, fragment_block_size_gpu_);
+
+    var = os::GetEnvVar("HSA_FRAGMENT_SLAB_LIMIT");
+    fragment_slab_limit_ = DEFAULT_FRAGMENT_SLAB_LIMIT;
+    fragment_slab_limit_gpu_.clear();
+    parse_sizes(var, fragment_slab_limit_, fragment_slab_limit_gpu_);
+
     var = os::GetEnvVar("HSA_ENABLE_SDMA_HDP_FLUSH");
     enable_sdma_hdp_flush_ = (var == "0") ? false : true;
 
@@ -209,6 +287,11 @@ class Flag {
     var = os::GetEnvVar("HSA_ENABLE_DEBUG");
     debug_ = (var == "1") ? true : false;
 
+    // LogPrint backend: "async" formats records on a logger thread, "binary" writes them raw.
+    var = os::GetEnvVar("HSA_LOG_MODE");
+    log_mode_ = (var == "async") ? AsyncLogger::kAsync
+                                 : ((var == "binary") ? AsyncLogger::kBinary : AsyncLogger::kSync);
+
     var = os::GetEnvVar("HSA_CU_MASK_SKIP_INIT");
     cu_mask_skip_init_ = (var == "1") ? true : false;
 
@@ -223,6 +306,23 @@ class Flag {
     var = os::GetEnvVar("HSA_SVM_PROFILE");
     svm_profile_ = var;
 
+    // "binary" writes fixed-size SMI event records for offline decoding instead of text.
+    var = os::GetEnvVar("HSA_SVM_PROFILE_FORMAT");
+    svm_profile_binary_ = (var == "binary") ? true : false;
+
+    // GPU core dump writer: worker threads, sparse output, zstd compression and an optional
+    // command the dump is piped into (e.g. "gzip > dump.gz").
+    var = os::GetEnvVar("HSA_COREDUMP_THREADS");
+    coredump_threads_ = var.empty() ? 4 : static_cast<uint32_t>(atoi(var.c_str()));
+
+    var = os::GetEnvVar("HSA_COREDUMP_SPARSE");
+    coredump_sparse_ = (var == "0") ? false : true;
+
+    var = os::GetEnvVar("HSA_COREDUMP_COMPRESS");
+    coredump_compress_ = (var == "1") ? true : false;
+
+    coredump_pipe_ = os::GetEnvVar("HSA_COREDUMP_PIPE");
+
     var = os::GetEnvVar("HSA_ENABLE_SRAMECC");
     sramecc_enable_ =
         (var == "0") ? SRAMECC_DISABLED : ((var == "1") ? SRAMECC_ENABLED : SRAMECC_DEFAULT);
@@ -279,6 +379,16 @@ class Flag {
 
   bool disable_fragment_alloc() const { return disable_fragment_alloc_; }
 
+  size_t fragment_block_size(uint32_t gpu_index) const {
+    auto it = fragment_block_size_gpu_.find(gpu_index);
+    return (it == fragment_block_size_gpu_.end()) ? fragment_block_size_ : it->second;
+  }
+
+  size_t fragment_slab_limit(uint32_t gpu_index) const {
+    auto it = fragment_slab_limit_gpu_.find(gpu_index);
+    return (it == fragment_slab_limit_gpu_.end()) ? fragment_slab_limit_ : it->second;
+  }
+
   bool rev_copy_dir() const { return rev_copy_dir_; }
 
   bool fine_grain_pcie() const { return fine_grain_pcie_; }
@@ -303,6 +413,8 @@ class Flag {
 
   uint32_t max_queues() const { return max_queues_; }
 
+  uint32_t signal_event_share_ratio() const { return signal_event_share_ratio_; }
+
   size_t scratch_mem_size() const { return scratch_mem_size_; }
 
   size_t scratch_single_limit() const { return scratch_single_limit_; }
@@ -311,6 +423,30 @@ class Flag {
 
   bool enable_scratch_alt() const { return enable_scratch_alt_; }
 
+  uint64_t scratch_steal_wait_us() const { return scratch_steal_wait_us_; }
+
+  size_t copy_pin_cache_size() const { return copy_pin_cache_size_; }
+
+  size_t lock_cache_size() const { return lock_cache_size_; }
+
+  size_t queue_ring_pool_size() const { return queue_ring_pool_size_; }
+
+  uint32_t copy_staging_buffers() const { return copy_staging_buffers_; }
+
+  size_t copy_staging_buffer_size() const { return copy_staging_buffer_size_; }
+
+  uint32_t copy_staging_threads() const { return copy_staging_threads_; }
+
+  uint32_t copy_pin_ns_per_page() const { return copy_pin_ns_per_page_; }
+
+  uint32_t copy_memcpy_mbps() const { return copy_memcpy_mbps_; }
+
+  uint32_t copy_dma_mbps() const { return copy_dma_mbps_; }
+
+  size_t svm_prefetch_batch_size() const { return svm_prefetch_batch_size_; }
+
+  bool lazy_agent_init() const { return lazy_agent_init_; }
+
   size_t scratch_single_limit_async() const { return scratch_single_limit_async_; }
 
   std::string tools_lib_names() const { return tools_lib_names_; }
@@ -339,6 +475,16 @@ class Flag {
 
   bool debug() const { return debug_; }
 
+  AsyncLogger::Mode log_mode() const { return log_mode_; }
+
+  uint32_t coredump_threads() const { return coredump_threads_; }
+
+  bool coredump_sparse() const { return coredump_sparse_; }
+
+  bool coredump_compress() const { return coredump_compress_; }
+
+  const std::string& coredump_pipe() const { return coredump_pipe_; }
+
   const std::vector<uint32_t>& cu_mask(uint32_t gpu_index) const {
     static const std::vector<uint32_t> empty;
     auto it = cu_mask_.find(gpu_index);
@@ -354,6 +500,8 @@ class Flag {
 
   const std::string& svm_profile() const { return svm_profile_; }
 
+  bool svm_profile_binary() const { return svm_profile_binary_; }
+
   SRAMECC_ENABLE sramecc_enable() const { return sramecc_enable_; }
 
   bool enable_ipc_mode_legacy() const { return enable_ipc_mode_legacy_; }
@@ -382,6 +530,9 @@ class Flag {
   bool loader_enable_mmap_uri_;
   bool check_sramecc_validity_;
   bool debug_;
+  bool coredump_sparse_;
+  bool coredump_compress_;
+  bool svm_profile_binary_;
   bool cu_mask_skip_init_;
   bool coop_cu_count_;
   bool discover_copy_agents_;
@@ -401,18 +552,41 @@ class Flag {
   std::string visible_gpus_;
 
   uint32_t max_queues_;
+  uint32_t signal_event_share_ratio_;
+  uint32_t coredump_threads_;
+
+  AsyncLogger::Mode log_mode_;
 
   size_t scratch_mem_size_;
   size_t scratch_single_limit_;
   size_t scratch_single_limit_async_;
   bool enable_scratch_async_reclaim_;
   bool enable_scratch_alt_;
+  uint64_t scratch_steal_wait_us_;
+  size_t copy_pin_cache_size_;
+  size_t lock_cache_size_;
+  size_t queue_ring_pool_size_;
+  uint32_t copy_staging_buffers_;
+  size_t copy_staging_buffer_size_;
+  uint32_t copy_staging_threads_;
+  uint32_t copy_pin_ns_per_page_;
+  uint32_t copy_memcpy_mbps_;
+  uint32_t copy_dma_mbps_;
+  size_t svm_prefetch_batch_size_;
+  bool lazy_agent_init_;
 
   std::string tools_lib_names_;
   std::string svm_profile_;
+  std::string coredump_pipe_;
 
   size_t force_sdma_size_;
 
+  // Fragment allocator tuning, defaults and GPU index post RVD to override.
+  size_t fragment_block_size_;
+  size_t fragment_slab_limit_;
+  std::map<uint32_t, size_t> fragment_block_size_gpu_;
+  std::map<uint32_t, size_t> fragment_slab_limit_gpu_;
+
   // Indicates user preference for Xnack state.
   XNACK_REQUEST xnack_;
 
@@ -425,6 +599,8 @@ class Flag {
 
   void parse_masks(std::string& args, uint32_t maxGpu, uint32_t maxCU);
 
+  void parse_sizes(std::string& var, size_t& size, std::map<uint32_t, size_t>& gpu_size);
+
   DISALLOW_COPY_AND_ASSIGN(Flag);
 };
 
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// An index of disjoint address ranges.  Each entry is keyed by its base address and its value
+// provides the range length in a size member.  Point, enclosing-range and overlap queries each
+// take a single O(log n) lookup.  Runs of adjacent entries are walked in O(log n + k) instead of
+// one lookup per entry.  Entries are node based so references to values stay valid until erased.
+// Not thread safe; callers provide locking.
+
+#ifndef HSA_RUNTME_CORE_UTIL_INTERVAL_MAP_H_
+#define HSA_RUNTME_CORE_UTIL_INTERVAL_MAP_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <tuple>
+#include <utility>
+
+#include "core/util/utils.h"
+
+namespace rocr {
+
+template <typename T> class IntervalMap {
+ public:
+  typedef typename std::map<const void*, T>::iterator iterator;
+  typedef typename std::map<const void*, T>::const_iterator const_iterator;
+
+  iterator begin() { return map_.begin(); }
+  iterator end() { return map_.end(); }
+  const_iterator begin() const { return map_.begin(); }
+  const_iterator end() const { return map_.end(); }
+  bool empty() const { return map_.empty(); }
+  size_t size() const { return map_.size(); }
+
+  // Returns the entry starting exactly at base.
+  iterator find(const void* base) { return map_.find(base); }
+
+  // Returns the entry containing ptr.
+  iterator find_containing(const void* ptr) {
+    iterator it = map_.upper_bound(ptr);
+    if (it == map_.begin()) return map_.end();
+    --it;
+    return (addr(ptr) < end_of(it)) ? it : map_.end();
+  }
+
+  // Returns the entry containing all of [ptr, ptr + len).
+  iterator find_enclosing(const void* ptr, size_t len) {
+    iterator it = find_containing(ptr);
+    if (it == map_.end()) return it;
+    return (addr(ptr) + len <= end_of(it)) ? it : map_.end();
+  }
+
+  // Returns true if any entry intersects [ptr, ptr + len).
+  bool overlaps(const void* ptr, size_t len) const {
+    const_iterator it = map_.lower_bound(ptr);
+    if ((it != map_.end()) && (addr(it->first) < addr(ptr) + len)) return true;
+    if (it == map_.begin()) return false;
+    --it;
+    return addr(ptr) < end_of(it);
+  }
+
+  // Returns the entry following it if it starts where it ends, otherwise end().
+  iterator next_adjacent(iterator it) {
+    const uintptr_t end = end_of(it);
+    ++it;
+    return ((it != map_.end()) && (addr(it->first) == end)) ? it : map_.end();
+  }
+
+  // Calls f(iterator) for the entries that exactly tile [ptr, ptr + len), in address order.
+  // Returns false without calling f if the range does not start at an entry or has a gap.
+  template <typename F> bool for_each_tiling(const void* ptr, size_t len, F f) {
+    const uintptr_t end = addr(ptr) + len;
+    iterator first = map_.find(ptr);
+    if (first == map_.end()) return false;
+
+    iterator it = first;
+    while (end_of(it) < end) {
+      it = next_adjacent(it);
+      if (it == map_.end()) return false;
+    }
+    if (end_of(it) != end) return false;
+
+    const iterator last = ++it;
+    for (it = first; it != last; ++it) f(it);
+    return true;
+  }
+
+  // Adds an entry.  The range must not overlap an existing entry.
+  template <typename... Args> iterator emplace(const void* base, Args&&... args) {
+    iterator hint = map_.lower_bound(base);
+    iterator it = map_.emplace_hint(hint, std::piecewise_construct, std::forward_as_tuple(base),
+                                    std::forward_as_tuple(std::forward<Args>(args)...));
+    assert(!overlaps_neighbours(it) && "Overlapping interval.");
+    return it;
+  }
+
+  void erase(iterator it) { map_.erase(it); }
+
+ private:
+  static __forceinline uintptr_t addr(const void* ptr) { return reinterpret_cast<uintptr_t>(ptr); }
+  static __forceinline uintptr_t end_of(const_iterator it) {
+    return addr(it->first) + it->second.size;
+  }
+
+  bool overlaps_neighbours(const_iterator it) const {
+    const_iterator next = it;
+    ++next;
+    if ((next != map_.end()) && (addr(next->first) < end_of(it))) return true;
+    if (it == map_.begin()) return false;
+    const_iterator prev = it;
+    --prev;
+    return addr(it->first) < end_of(prev);
+  }
+
+  std::map<const void*, T> map_;
+};
+
+}  // namespace rocr
+
+#endif  // HSA_RUNTME_CORE_UTIL_INTERVAL_MAP_H_
@@ -49,6 +49,8 @@
 #include <pthread.h>
 #include <limits.h>
 #include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
 #include <sys/time.h>
 #include <sys/utsname.h>
@@ -407,6 +409,22 @@ void uSleep(int delayInUs) { usleep(delayInUs); }
 
 void YieldThread() { sched_yield(); }
 
+void FutexWait(volatile uint32_t* address, uint32_t expected, uint64_t timeout_ns) {
+  // Clamp to avoid overflowing tv_sec, callers loop on spurious returns anyway.
+  const uint64_t max_ns = uint64_t(INT32_MAX) * 1000000000ull;
+  if (timeout_ns > max_ns) timeout_ns = max_ns;
+  struct timespec ts;
+  ts.tv_sec = timeout_ns / 1000000000ull;
+  ts.tv_nsec = timeout_ns % 1000000000ull;
+  syscall(SYS_futex, const_cast<uint32_t*>(address), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr,
+          0);
+}
+
+void FutexWake(volatile uint32_t* address) {
+  syscall(SYS_futex, const_cast<uint32_t*>(address), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr,
+          nullptr, 0);
+}
+
 Thread CreateThread(ThreadEntry function, void* threadArgument, uint stackSize) {
   os_thread* result = new os_thread(function, threadArgument, stackSize);
   if (!result->Valid()) {
@@ -167,6 +167,34 @@ class KernelEvent {
   DISALLOW_COPY_AND_ASSIGN(KernelEvent);
 };
 
+/// @brief: runs a callable at most once.
+/// Callers that race the first Run() block until it has completed, so every
+/// return from Run() observes the callable's side effects.
+class KernelOnce {
+ public:
+  KernelOnce() : done_(false) {}
+
+  template <typename F> void Run(F&& func) {
+    if (done_.load(std::memory_order_acquire)) return;
+
+    lock_.Acquire();
+    if (!done_.load(std::memory_order_relaxed)) {
+      func();
+      done_.store(true, std::memory_order_release);
+    }
+    lock_.Release();
+  }
+
+  bool Done() const { return done_.load(std::memory_order_acquire); }
+
+ private:
+  KernelMutex lock_;
+  std::atomic<bool> done_;
+
+  /// @brief: Disable copiable and assignable ability.
+  DISALLOW_COPY_AND_ASSIGN(KernelOnce);
+};
+
 /// @brief: represents a yielding shared mutex.
 /// aka read/write mutex
 class KernelSharedMutex {
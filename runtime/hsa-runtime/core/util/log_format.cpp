@@ -0,0 +1,276 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Log formatting shared by the logger thread and the offline binary log decoder.  Has no
+// dependencies on the rest of the runtime so the decoder can be built on its own.
+
+#include "core/util/logger.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace rocr {
+
+// Same limit as the synchronous log_printf.
+static const size_t kLogMessageSize = 4096;
+// Largest string or thread name accepted by the decoder.
+static const uint32_t kLogMaxDefinition = 64 * 1024;
+
+/* Each conversion is passed to snprintf on its own with the captured value widened to the length
+   the spec is rewritten to.  */
+void FormatLogRecord(const LogRecord& record, char* out, size_t size) {
+  size_t pos = 0;
+  uint32_t arg = 0;
+  auto emit = [&](int written) {
+    if (written > 0) pos = std::min(pos + written, size - 1);
+  };
+
+  const char* cursor = record.format;
+  while (*cursor != '\0' && pos + 1 < size) {
+    if (*cursor != '%') {
+      out[pos++] = *cursor++;
+      continue;
+    }
+    if (cursor[1] == '%') {
+      out[pos++] = '%';
+      cursor += 2;
+      continue;
+    }
+
+    char spec[48];
+    size_t len = 0;
+    spec[len++] = *cursor++;
+    while (*cursor != '\0' && strchr("-+ #0", *cursor) != nullptr && len < 8)
+      spec[len++] = *cursor++;
+    // Width and precision, '*' takes its value from the arguments.
+    for (int part = 0; part < 2; part++) {
+      if (part == 1) {
+        if (*cursor != '.') break;
+        spec[len++] = *cursor++;
+      }
+      if (*cursor == '*') {
+        cursor++;
+        int value = (arg < record.argc) ? int(record.args[arg++]) : 0;
+        value = std::max(std::min(value, int(size)), -int(size));
+        len += snprintf(&spec[len], 8, "%d", value);
+      } else {
+        while (*cursor >= '0' && *cursor <= '9' && len < 20) spec[len++] = *cursor++;
+      }
+    }
+    int length = 0;  // Bytes of the integer argument, 0 for int.
+    while (*cursor != '\0' && strchr("hljztL", *cursor) != nullptr) {
+      if (*cursor == 'h')
+        length = (length == 2) ? 1 : 2;
+      else
+        length = 8;
+      cursor++;
+    }
+    char conversion = *cursor;
+    if (conversion == '\0') break;
+    cursor++;
+
+    if (arg >= record.argc) {
+      emit(snprintf(&out[pos], size - pos, "(missing)"));
+      continue;
+    }
+    uint64_t raw = record.args[arg];
+    LogArgKind kind = LogArgKind(record.kinds[arg]);
+    arg++;
+
+    switch (conversion) {
+      case 'd':
+      case 'i': {
+        int64_t value = int64_t(raw);
+        if (length == 1) value = int8_t(raw);
+        if (length == 2) value = int16_t(raw);
+        if (length == 0) value = int32_t(raw);
+        memcpy(&spec[len], "lld", 4);
+        emit(snprintf(&out[pos], size - pos, spec, (long long)value));
+        break;
+      }
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X': {
+        uint64_t value = raw;
+        if (length == 1) value = uint8_t(raw);
+        if (length == 2) value = uint16_t(raw);
+        if (length == 0) value = uint32_t(raw);
+        spec[len++] = 'l';
+        spec[len++] = 'l';
+        spec[len++] = conversion;
+        spec[len] = '\0';
+        emit(snprintf(&out[pos], size - pos, spec, (unsigned long long)value));
+        break;
+      }
+      case 'c':
+        memcpy(&spec[len], "c", 2);
+        emit(snprintf(&out[pos], size - pos, spec, int(raw)));
+        break;
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A': {
+        double value;
+        if (kind == kLogArgDouble)
+          memcpy(&value, &raw, sizeof(value));
+        else
+          value = double(int64_t(raw));
+        spec[len++] = conversion;
+        spec[len] = '\0';
+        emit(snprintf(&out[pos], size - pos, spec, value));
+        break;
+      }
+      case 's':
+        memcpy(&spec[len], "s", 2);
+        emit(snprintf(&out[pos], size - pos, spec,
+                      (kind == kLogArgString) ? &record.strings[raw] : "(?)"));
+        break;
+      case 'p':
+        memcpy(&spec[len], "p", 2);
+        emit(snprintf(&out[pos], size - pos, spec, reinterpret_cast<void*>(raw)));
+        break;
+      default:;
+    }
+  }
+  out[pos] = '\0';
+}
+
+void WriteLogLine(FILE* file, const char* source, uint32_t line, uint64_t timestamp_us, int pid,
+                  const char* thread, const char* message) {
+  fprintf(file, ":%-25s:%-4d: %010lld us: [pid:%-5d tid:0x%s] [***rocr***] %s\n", source,
+          int(line), (long long)timestamp_us, pid, thread, message);
+}
+
+template <typename T> static bool Get(FILE* file, T& value) {
+  return fread(&value, sizeof(T), 1, file) == 1;
+}
+
+static bool GetString(FILE* file, std::string& str) {
+  uint32_t len;
+  if (!Get(file, len) || (len > kLogMaxDefinition)) return false;
+  str.resize(len);
+  return (len == 0) || (fread(&str[0], 1, len, file) == len);
+}
+
+bool DecodeBinaryLog(FILE* in, FILE* out) {
+  char magic[8];
+  uint32_t version, pid;
+  uint64_t frequency;
+  if ((fread(magic, 1, sizeof(magic), in) != sizeof(magic)) ||
+      (memcmp(magic, "ROCRLOG", sizeof(magic)) != 0) || !Get(in, version) ||
+      (version != kLogBinaryVersion) || !Get(in, pid) || !Get(in, frequency) || (frequency == 0))
+    return false;
+  auto micros = [frequency](uint64_t ticks) {
+    return uint64_t(double(ticks) * 1000000.0 / double(frequency));
+  };
+
+  std::unordered_map<uint64_t, std::string> strings;
+  std::unordered_map<uint64_t, std::string> threads;
+  uint8_t tag;
+  while (fread(&tag, 1, 1, in) == 1) {
+    switch (tag) {
+      case kLogTagString:
+      case kLogTagThread: {
+        uint64_t key;
+        std::string str;
+        if (!Get(in, key) || !GetString(in, str)) return false;
+        ((tag == kLogTagString) ? strings : threads)[key] = str;
+        break;
+      }
+      case kLogTagRecord: {
+        uint64_t format, file, thread;
+        LogRecord record;
+        memset(record.strings, 0, sizeof(record.strings));
+        if (!Get(in, format) || !Get(in, file) || !Get(in, thread) ||
+            !Get(in, record.timestamp) || !Get(in, record.line) || !Get(in, record.argc) ||
+            !Get(in, record.string_used))
+          return false;
+        if ((record.argc > LogRecord::kMaxArgs) || (record.string_used >= LogRecord::kStringSize))
+          return false;
+        if ((fread(record.kinds, 1, record.argc, in) != record.argc) ||
+            (fread(record.args, sizeof(uint64_t), record.argc, in) != record.argc) ||
+            (fread(record.strings, 1, record.string_used, in) != record.string_used))
+          return false;
+        for (uint32_t i = 0; i < record.argc; i++) {
+          if (record.kinds[i] > kLogArgString) return false;
+          if ((record.kinds[i] == kLogArgString) && (record.args[i] >= record.string_used))
+            return false;
+        }
+
+        auto fmt = strings.find(format);
+        auto src = strings.find(file);
+        auto name = threads.find(thread);
+        if ((fmt == strings.end()) || (src == strings.end()) || (name == threads.end()))
+          return false;
+        record.format = fmt->second.c_str();
+        record.file = src->second.c_str();
+
+        char message[kLogMessageSize];
+        FormatLogRecord(record, message, sizeof(message));
+        WriteLogLine(out, record.file, record.line, micros(record.timestamp), pid,
+                     name->second.c_str(), message);
+        break;
+      }
+      case kLogTagDropped: {
+        uint64_t thread, timestamp, count;
+        if (!Get(in, thread) || !Get(in, timestamp) || !Get(in, count)) return false;
+        auto name = threads.find(thread);
+        if (name == threads.end()) return false;
+        char message[64];
+        snprintf(message, sizeof(message), "%llu log messages dropped", (unsigned long long)count);
+        WriteLogLine(out, "logger.cpp", 0, micros(timestamp), pid, name->second.c_str(), message);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return ferror(in) == 0;
+}
+
+}  // namespace rocr
@@ -0,0 +1,317 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/util/logger.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include "core/util/locks.h"
+#include "core/util/os.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+
+// Records per thread ring.
+static const size_t kLogRingSize = 512;
+// Logger thread back off when all rings are empty.
+static const int kLogIdleMs = 1;
+// Same limit as the synchronous log_printf.
+static const size_t kLogMessageSize = 4096;
+
+std::atomic<bool> AsyncLogger::active_(false);
+
+namespace {
+struct LoggerState {
+  // Protects threads.  Held by Stop() while it waits for writers, so never taken by Log().
+  KernelMutex threads_lock;
+  std::vector<LogThread*> threads;
+  // Protects rings and next_tid.
+  KernelMutex rings_lock;
+  std::vector<LogRing*> rings;
+  uint64_t next_tid;
+
+  AsyncLogger::Mode mode;
+  FILE* file;
+  uint64_t frequency;
+  int pid;
+  os::Thread thread;
+  std::atomic<bool> running;
+  // Strings and threads already written to a binary log.
+  std::unordered_set<const void*> defined;
+  std::unordered_set<uint64_t> defined_threads;
+
+  LoggerState()
+      : next_tid(0),
+        mode(AsyncLogger::kSync),
+        file(nullptr),
+        frequency(1),
+        pid(0),
+        thread(NULL),
+        running(false) {}
+};
+
+// Never destroyed, threads may exit after static destructors ran.
+LoggerState& State() {
+  static LoggerState* state = new LoggerState();
+  return *state;
+}
+
+std::string ThreadName() {
+  std::stringstream name;
+  name << std::hex << std::this_thread::get_id();
+  return name.str();
+}
+
+uint64_t Micros(const LoggerState& state, uint64_t ticks) {
+  return uint64_t(double(ticks) * 1000000.0 / double(state.frequency));
+}
+}  // namespace
+
+LogRing::LogRing(uint64_t tid, const std::string& name)
+    : retired(false),
+      records_(kLogRingSize),
+      head_(0),
+      tail_(0),
+      dropped_(0),
+      tid_(tid),
+      name_(name) {}
+
+LogThread::LogThread() : ring(nullptr), busy(false) {
+  LoggerState& state = State();
+  ScopedAcquire<KernelMutex> lock(&state.threads_lock);
+  state.threads.push_back(this);
+}
+
+LogThread::~LogThread() {
+  LoggerState& state = State();
+  ScopedAcquire<KernelMutex> lock(&state.threads_lock);
+  state.threads.erase(std::find(state.threads.begin(), state.threads.end(), this));
+  // ring is only set while the logger runs, Stop() clears it under threads_lock.  Hand it to the
+  // logger thread which frees it once drained.
+  if (ring != nullptr) ring->retired.store(true, std::memory_order_release);
+}
+
+LogThread& AsyncLogger::Self() {
+  static thread_local LogThread self;
+  return self;
+}
+
+LogRing* AsyncLogger::NewRing(LogThread& thread) {
+  LoggerState& state = State();
+  ScopedAcquire<KernelMutex> lock(&state.rings_lock);
+  thread.ring = new LogRing(state.next_tid++, ThreadName());
+  state.rings.push_back(thread.ring);
+  return thread.ring;
+}
+
+uint64_t AsyncLogger::Timestamp() { return os::ReadAccurateClock(); }
+
+void AsyncLogger::StoreString(LogRecord& record, uint32_t index, const char* arg) {
+  if (arg == nullptr) arg = "(null)";
+  size_t len = std::min<size_t>(strlen(arg), LogRecord::kStringSize - 1 - record.string_used);
+  record.kinds[index] = kLogArgString;
+  record.args[index] = record.string_used;
+  memcpy(&record.strings[record.string_used], arg, len);
+  record.strings[record.string_used + len] = '\0';
+  record.string_used += len + 1;
+  if (record.string_used == LogRecord::kStringSize) record.string_used--;
+}
+
+template <typename T> static void Put(FILE* file, T value) { fwrite(&value, sizeof(T), 1, file); }
+
+static void PutString(FILE* file, LogBinaryTag tag, uint64_t key, const char* str) {
+  uint32_t len = strlen(str);
+  Put(file, tag);
+  Put(file, key);
+  Put(file, len);
+  fwrite(str, 1, len, file);
+}
+
+static uint64_t Key(const void* ptr) { return reinterpret_cast<uintptr_t>(ptr); }
+
+static void DefineThread(LoggerState& state, const LogRing& ring) {
+  if (state.defined_threads.insert(ring.tid()).second)
+    PutString(state.file, kLogTagThread, ring.tid(), ring.name().c_str());
+}
+
+static void WriteRecord(LoggerState& state, const LogRing& ring, const LogRecord& record) {
+  if (state.mode == AsyncLogger::kBinary) {
+    DefineThread(state, ring);
+    if (state.defined.insert(record.format).second)
+      PutString(state.file, kLogTagString, Key(record.format), record.format);
+    if (state.defined.insert(record.file).second)
+      PutString(state.file, kLogTagString, Key(record.file), record.file);
+
+    Put(state.file, kLogTagRecord);
+    Put(state.file, Key(record.format));
+    Put(state.file, Key(record.file));
+    Put(state.file, ring.tid());
+    Put(state.file, record.timestamp);
+    Put(state.file, record.line);
+    Put(state.file, record.argc);
+    Put(state.file, record.string_used);
+    fwrite(record.kinds, 1, record.argc, state.file);
+    fwrite(record.args, sizeof(uint64_t), record.argc, state.file);
+    fwrite(record.strings, 1, record.string_used, state.file);
+    return;
+  }
+
+  char message[kLogMessageSize];
+  FormatLogRecord(record, message, sizeof(message));
+  WriteLogLine(state.file, record.file, record.line, Micros(state, record.timestamp), state.pid,
+               ring.name().c_str(), message);
+}
+
+static void WriteDropped(LoggerState& state, const LogRing& ring, uint64_t count) {
+  const uint64_t now = os::ReadAccurateClock();
+  if (state.mode == AsyncLogger::kBinary) {
+    DefineThread(state, ring);
+    Put(state.file, kLogTagDropped);
+    Put(state.file, ring.tid());
+    Put(state.file, now);
+    Put(state.file, count);
+    return;
+  }
+  char message[64];
+  snprintf(message, sizeof(message), "%llu log messages dropped", (unsigned long long)count);
+  WriteLogLine(state.file, __FILENAME__, 0, Micros(state, now), state.pid, ring.name().c_str(),
+               message);
+}
+
+// Writes out every queued record and frees drained rings of exited threads.  Returns the number
+// of records written.
+static size_t Drain(LoggerState& state) {
+  ScopedAcquire<KernelMutex> lock(&state.rings_lock);
+  size_t count = 0;
+  for (size_t i = 0; i < state.rings.size();) {
+    LogRing* ring = state.rings[i];
+    bool retired = ring->retired.load(std::memory_order_acquire);
+
+    const LogRecord* record;
+    while ((record = ring->Front()) != nullptr) {
+      WriteRecord(state, *ring, *record);
+      ring->Release();
+      count++;
+    }
+    uint64_t dropped = ring->TakeDropped();
+    if (dropped != 0) WriteDropped(state, *ring, dropped);
+
+    if (retired) {
+      delete ring;
+      state.rings.erase(state.rings.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  if (count != 0) fflush(state.file);
+  return count;
+}
+
+static void LoggerThread(void* arg) {
+  LoggerState& state = *reinterpret_cast<LoggerState*>(arg);
+  while (state.running.load(std::memory_order_acquire)) {
+    if (Drain(state) == 0) os::Sleep(kLogIdleMs);
+  }
+  Drain(state);
+  fflush(state.file);
+}
+
+void AsyncLogger::Start(Mode mode, FILE* file) {
+  Stop();
+  if (mode == kSync) return;
+
+  LoggerState& state = State();
+  state.mode = mode;
+  state.file = file;
+  state.frequency = os::AccurateClockFrequency();
+  state.pid = os::GetProcessId();
+  state.defined.clear();
+  state.defined_threads.clear();
+  if (mode == kBinary) {
+    fwrite("ROCRLOG", 1, 8, file);
+    Put(file, kLogBinaryVersion);
+    Put(file, uint32_t(state.pid));
+    Put(file, state.frequency);
+  }
+
+  state.running.store(true, std::memory_order_release);
+  state.thread = os::CreateThread(LoggerThread, &state);
+  if (state.thread == NULL) {
+    state.running.store(false, std::memory_order_relaxed);
+    return;
+  }
+  active_.store(true, std::memory_order_release);
+}
+
+void AsyncLogger::Stop() {
+  LoggerState& state = State();
+  if (state.thread == NULL) return;
+
+  // Keeps threads from exiting, and so from touching their rings, until the rings are freed.
+  ScopedAcquire<KernelMutex> lock(&state.threads_lock);
+
+  // New messages go to log_printf, wait for the ones already being queued so the logger
+  // thread's final drain sees them.  Pairs with the fence in Log().
+  active_.store(false, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (LogThread* thread : state.threads)
+    while (thread->busy.load(std::memory_order_acquire)) os::YieldThread();
+
+  state.running.store(false, std::memory_order_release);
+  os::WaitForThread(state.thread);
+  os::CloseThread(state.thread);
+  state.thread = NULL;
+
+  // Every ring is drained and no writer is left.  Threads allocate new rings on restart.
+  {
+    ScopedAcquire<KernelMutex> rings(&state.rings_lock);
+    for (LogRing* ring : state.rings) delete ring;
+    state.rings.clear();
+  }
+  for (LogThread* thread : state.threads) thread->ring = nullptr;
+}
+
+}  // namespace rocr
@@ -0,0 +1,318 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Deferred backend for LogPrint.  Producers capture the format string pointer and the raw
+// arguments into a per thread ring, a logger thread formats and writes them out.
+
+#ifndef HSA_RUNTME_CORE_UTIL_LOGGER_H_
+#define HSA_RUNTME_CORE_UTIL_LOGGER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace rocr {
+
+enum LogArgKind : uint8_t {
+  kLogArgSigned,
+  kLogArgUnsigned,
+  kLogArgDouble,
+  kLogArgPointer,
+  kLogArgString,  // Value is the offset of the copied string in LogRecord::strings.
+};
+
+// One deferred LogPrint call.  Arguments past kMaxArgs are dropped, strings are copied and
+// truncated to fit in the record.
+struct LogRecord {
+  static const uint32_t kMaxArgs = 24;
+  static const uint32_t kStringSize = 96;
+
+  const char* file;
+  const char* format;
+  uint64_t timestamp;
+  uint32_t line;
+  uint16_t argc;
+  uint16_t string_used;
+  uint8_t kinds[kMaxArgs];
+  uint64_t args[kMaxArgs];
+  char strings[kStringSize];
+};
+
+/* Compile time scan of a printf format, returns a mask with bit i set when argument i is
+   consumed by %s.  Lets Log() tell strings to copy from other char pointers (%p) without parsing
+   the format at run time.  Recursive to stay a C++11 constant expression, literal text is
+   skipped four characters at a time to keep the depth down.  */
+constexpr bool LogIsLiteral(char c) { return (c != '%') && (c != '\0'); }
+constexpr bool LogIsFlag(char c) {
+  return (c == '-') || (c == '+') || (c == ' ') || (c == '#') || (c == '0');
+}
+constexpr bool LogIsLength(char c) {
+  return (c == 'h') || (c == 'l') || (c == 'j') || (c == 'z') || (c == 't') || (c == 'L');
+}
+constexpr const char* LogSkipDigits(const char* p) {
+  return ((*p >= '0') && (*p <= '9')) ? LogSkipDigits(p + 1) : p;
+}
+constexpr uint32_t LogScanText(const char* p, uint32_t arg);
+constexpr uint32_t LogScanConversion(const char* p, uint32_t arg) {
+  return (*p == '\0') ? 0
+                      : ((((*p == 's') && (arg < 32)) ? (1u << arg) : 0u) |
+                         LogScanText(p + 1, arg + 1));
+}
+constexpr uint32_t LogScanLength(const char* p, uint32_t arg) {
+  return LogIsLength(*p) ? LogScanLength(p + 1, arg) : LogScanConversion(p, arg);
+}
+constexpr uint32_t LogScanPrecision(const char* p, uint32_t arg) {
+  return (*p == '*') ? LogScanLength(p + 1, arg + 1) : LogScanLength(LogSkipDigits(p), arg);
+}
+constexpr uint32_t LogScanDot(const char* p, uint32_t arg) {
+  return (*p == '.') ? LogScanPrecision(p + 1, arg) : LogScanLength(p, arg);
+}
+constexpr uint32_t LogScanWidth(const char* p, uint32_t arg) {
+  return (*p == '*') ? LogScanDot(p + 1, arg + 1) : LogScanDot(LogSkipDigits(p), arg);
+}
+constexpr uint32_t LogScanFlags(const char* p, uint32_t arg) {
+  return LogIsFlag(*p) ? LogScanFlags(p + 1, arg) : LogScanWidth(p, arg);
+}
+constexpr uint32_t LogScanText(const char* p, uint32_t arg) {
+  return (LogIsLiteral(p[0]) && LogIsLiteral(p[1]) && LogIsLiteral(p[2]) && LogIsLiteral(p[3]))
+      ? LogScanText(p + 4, arg)
+      : ((*p == '\0') ? 0
+                      : ((*p != '%') ? LogScanText(p + 1, arg)
+                                     : ((p[1] == '%') ? LogScanText(p + 2, arg)
+                                                      : LogScanFlags(p + 1, arg))));
+}
+constexpr uint32_t LogStringArgs(const char* format) { return LogScanText(format, 0); }
+
+// Binary log layout.  A binary log starts with "ROCRLOG\0", the version, the process id and the
+// clock frequency, strings and thread names are defined once before the first record using them.
+static const uint32_t kLogBinaryVersion = 2;
+
+enum LogBinaryTag : uint8_t {
+  kLogTagString = 1,  // u64 key, u32 length, bytes
+  kLogTagThread = 2,  // u64 key, u32 length, bytes
+  kLogTagRecord = 3,  // u64 format, u64 file, u64 thread, u64 timestamp, u32 line,
+                      // u16 argc, u16 string_used, kinds[argc], u64 args[argc], strings
+  kLogTagDropped = 4  // u64 thread, u64 timestamp, u64 count
+};
+
+/* Formats record like vsnprintf would have with the original arguments.  Runs on the logger
+   thread and in the offline decoder.  */
+void FormatLogRecord(const LogRecord& record, char* out, size_t size);
+
+// Writes one line in the text log format, timestamp in microseconds.
+void WriteLogLine(FILE* file, const char* source, uint32_t line, uint64_t timestamp_us, int pid,
+                  const char* thread, const char* message);
+
+/* Converts a binary log (HSA_LOG_MODE=binary) to the text log format.  Returns false if the
+   log is malformed or truncated, everything before the bad entry has been written.  */
+bool DecodeBinaryLog(FILE* in, FILE* out);
+
+/* Per thread single producer, single consumer ring of log records.  */
+class LogRing {
+ public:
+  LogRing(uint64_t tid, const std::string& name);
+
+  // Reserves the next slot, returns nullptr and counts a drop if the ring is full.
+  LogRecord* Reserve() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == records_.size()) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &records_[tail & (records_.size() - 1)];
+  }
+  void Commit() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Consumer side, returns the oldest record or nullptr.  Release() frees it.
+  const LogRecord* Front() {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return nullptr;
+    return &records_[head & (records_.size() - 1)];
+  }
+  void Release() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  uint64_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+  // Unique key of the ring's thread in the log.
+  uint64_t tid() const { return tid_; }
+  const std::string& name() const { return name_; }
+
+  // Set when the owning thread exits, the logger frees the ring once it is drained.
+  std::atomic<bool> retired;
+
+ private:
+  std::vector<LogRecord> records_;
+  std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> tail_;
+  std::atomic<uint64_t> dropped_;
+  const uint64_t tid_;
+  const std::string name_;
+};
+
+/* Thread local logging state, registered with the logger for the life of the thread.  The ring
+   belongs to the logger, Stop() frees it and the thread allocates a new one if logging
+   restarts.  */
+struct LogThread {
+  LogThread();
+  ~LogThread();
+
+  LogRing* ring;
+  // Set while Log() may touch ring.  Only written by the owning thread.
+  std::atomic<bool> busy;
+};
+
+class AsyncLogger {
+ public:
+  enum Mode { kSync, kAsync, kBinary };
+
+  // Starts the logger thread writing to file.  kSync stops it.
+  static void Start(Mode mode, FILE* file);
+  // Drains all rings, stops the logger thread and frees the rings.
+  static void Stop();
+
+  static bool Active() { return active_.load(std::memory_order_relaxed); }
+
+  // Queues one message, StringArgs is LogStringArgs(format).  Returns false, without queuing, if
+  // the logger has stopped so the caller can print it synchronously.  Stop() waits for calls
+  // that passed the check.
+  template <uint32_t StringArgs, typename... Args>
+  static bool Log(const char* file, int line, const char* format, Args... args) {
+    LogThread& thread = Self();
+    // Publish busy before checking active_, Stop() does the reverse.
+    thread.busy.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!active_.load(std::memory_order_relaxed)) {
+      thread.busy.store(false, std::memory_order_release);
+      return false;
+    }
+    LogRing* ring = (thread.ring != nullptr) ? thread.ring : NewRing(thread);
+    LogRecord* record = (ring == nullptr) ? nullptr : ring->Reserve();
+    if (record != nullptr) {
+      record->file = file;
+      record->format = format;
+      record->timestamp = Timestamp();
+      record->line = line;
+      record->argc = 0;
+      record->string_used = 0;
+      Capture<StringArgs>(*record, args...);
+      ring->Commit();
+    }
+    thread.busy.store(false, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  template <uint32_t StringArgs> static void Capture(LogRecord&) {}
+
+  template <uint32_t StringArgs, typename T, typename... Rest>
+  static void Capture(LogRecord& record, T arg, Rest... rest) {
+    if (record.argc < LogRecord::kMaxArgs) {
+      StoreArg(record, record.argc, arg, ((StringArgs >> record.argc) & 1) != 0);
+      record.argc++;
+    }
+    Capture<StringArgs>(record, rest...);
+  }
+
+  template <typename T> static void StoreArg(LogRecord& record, uint32_t index, T arg, bool) {
+    Store(record, index, arg);
+  }
+
+  // Strings are copied for %s only, other conversions such as %p keep the pointer.
+  static void StoreArg(LogRecord& record, uint32_t index, const char* arg, bool is_string) {
+    if (is_string)
+      StoreString(record, index, arg);
+    else
+      Store(record, index, arg);
+  }
+  static void StoreArg(LogRecord& record, uint32_t index, char* arg, bool is_string) {
+    StoreArg(record, index, static_cast<const char*>(arg), is_string);
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+  Store(LogRecord& record, uint32_t index, T arg) {
+    record.kinds[index] = std::is_signed<T>::value ? kLogArgSigned : kLogArgUnsigned;
+    record.args[index] = std::is_signed<T>::value ? uint64_t(int64_t(arg)) : uint64_t(arg);
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value>::type
+  Store(LogRecord& record, uint32_t index, T arg) {
+    double value = arg;
+    record.kinds[index] = kLogArgDouble;
+    memcpy(&record.args[index], &value, sizeof(value));
+  }
+
+  template <typename T>
+  static void Store(LogRecord& record, uint32_t index, T* arg) {
+    record.kinds[index] = kLogArgPointer;
+    record.args[index] = reinterpret_cast<uintptr_t>(arg);
+  }
+
+  // Handles such as hsa_signal_t are passed to printf by value and print as their raw bits.
+  template <typename T>
+  static typename std::enable_if<std::is_class<T>::value>::type
+  Store(LogRecord& record, uint32_t index, const T& arg) {
+    static_assert(sizeof(T) <= sizeof(uint64_t), "Log argument too large.");
+    record.kinds[index] = kLogArgUnsigned;
+    record.args[index] = 0;
+    memcpy(&record.args[index], &arg, sizeof(T));
+  }
+
+  static void StoreString(LogRecord& record, uint32_t index, const char* arg);
+
+  static LogThread& Self();
+  // Allocates and registers thread's ring.  Only called between the active_ check and busy
+  // being cleared.
+  static LogRing* NewRing(LogThread& thread);
+  static uint64_t Timestamp();
+
+  static std::atomic<bool> active_;
+};
+
+}  // namespace rocr
+
+#endif  // HSA_RUNTME_CORE_UTIL_LOGGER_H_
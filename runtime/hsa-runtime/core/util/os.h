@@ -201,6 +201,19 @@ void uSleep(int delayInUs);
 /// @return: void.
 void YieldThread();
 
+/// @brief: Blocks the calling thread while *address == expected, until woken by
+/// FutexWake or timeout_ns elapses. May return spuriously.
+/// @param: address(Input), word to wait on, shared only within this process.
+/// @param: expected(Input), value *address must hold for the thread to block.
+/// @param: timeout_ns(Input), maximum time to block in nanoseconds.
+/// @return: void.
+void FutexWait(volatile uint32_t* address, uint32_t expected, uint64_t timeout_ns);
+
+/// @brief: Wakes all threads blocked in FutexWait on address.
+/// @param: address(Input), word threads are waiting on.
+/// @return: void.
+void FutexWake(volatile uint32_t* address);
+
 typedef void (*ThreadEntry)(void*);
 
 /// @brief: Creates a thread will return NULL if failed.
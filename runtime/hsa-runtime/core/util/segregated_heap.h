@@ -0,0 +1,473 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// A size segregated block sub-allocator.  Manages block sub-allocation in three tiers:
+//  - Slab classes for small requests.  Each slab block is carved into equally sized objects so
+//    small object churn never fragments the block.
+//  - Buddy chunks for medium requests up to the block size.  Requests are rounded to the smallest
+//    buddy chunk and carved from power of two chunks, the unused tail is returned to the free lists
+//    right away.  Chunks are eagerly coalesced on free.
+//  - Direct allocation for requests larger than the block size.  These are never cached.
+// Fully free slab and buddy blocks are retained in a block cache which is trimmed the same way as
+// SimpleHeap's.  O(log n) time.
+
+#ifndef HSA_RUNTME_CORE_UTIL_SEGREGATED_HEAP_H_
+#define HSA_RUNTME_CORE_UTIL_SEGREGATED_HEAP_H_
+
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "core/util/utils.h"
+
+namespace rocr {
+
+template <typename Allocator> class SegregatedHeap {
+ public:
+  // Smallest object handed out by the heap.  Requests are expected to be page aligned.
+  static constexpr size_t kMinObjectSize = 4096;
+  static constexpr size_t kDefaultSlabLimit = 64 * 1024;
+
+ private:
+  enum BlockType { kSlab, kBuddy, kDirect };
+
+  struct Block {
+    uintptr_t base_ptr_;
+    size_t length_;
+    BlockType type_;
+    bool discard_;
+    // Slab class index, only valid for slab blocks.
+    uint32_t size_class_;
+    // Free object offsets of a slab block.
+    std::vector<uint32_t> free_objects_;
+    // Live sub-allocations of this block, address to requested size.
+    std::map<uintptr_t, size_t> live_;
+
+    Block(uintptr_t base, size_t length, BlockType type)
+        : base_ptr_(base), length_(length), type_(type), discard_(false), size_class_(0) {}
+    bool contains(uintptr_t ptr) const { return (ptr >= base_ptr_) && (ptr < base_ptr_ + length_); }
+  };
+
+  struct CachedBlock {
+    uintptr_t base_ptr_;
+    size_t length_;
+
+    CachedBlock(uintptr_t base, size_t length) : base_ptr_(base), length_(length) {}
+  };
+
+  Allocator block_allocator_;
+
+  // Upper size limit of the slab tier.  Larger requests are served from buddy chunks.
+  size_t slab_limit_;
+  // Object size of each slab class, ascending.
+  std::vector<size_t> slab_sizes_;
+  // Slab blocks with at least one free object per class, keyed by block base.
+  std::vector<std::set<uintptr_t>> partial_slabs_;
+
+  // log2 of the smallest and largest buddy chunk.
+  uint32_t min_order_;
+  uint32_t max_order_;
+  // Free buddy chunks per order, indexed by (order - min_order_).
+  std::vector<std::set<uintptr_t>> buddy_free_;
+
+  std::map<uintptr_t, Block> block_list_;
+  std::deque<CachedBlock> block_cache_;
+
+  // Size of slab and buddy blocks that are at least partially in use.
+  size_t in_use_size_;
+  // Requested bytes of live slab and buddy sub-allocations.
+  size_t requested_size_;
+  // Size of live direct allocations.
+  size_t direct_size_;
+  // Total size of block cache
+  size_t cache_size_;
+  // Peak of all memory held by the heap.
+  size_t high_water_mark_;
+
+  static __forceinline uint32_t Log2(size_t value) {
+    return static_cast<uint32_t>(63 - __builtin_clzll(static_cast<uint64_t>(value)));
+  }
+
+  void buildSizeClasses() {
+    slab_sizes_.clear();
+    for (size_t size = kMinObjectSize; size <= slab_limit_; size *= 2) {
+      slab_sizes_.push_back(size);
+      // Add the midpoint class where it is still a multiple of the minimum object size.
+      const size_t mid = size + size / 2;
+      if ((size / 2 >= kMinObjectSize) && IsMultipleOf(mid, kMinObjectSize) && (mid <= slab_limit_))
+        slab_sizes_.push_back(mid);
+    }
+    std::sort(slab_sizes_.begin(), slab_sizes_.end());
+    partial_slabs_.assign(slab_sizes_.size(), std::set<uintptr_t>());
+
+    const size_t block_size = default_block_size();
+    min_order_ = Log2(NextPow2(static_cast<uint64_t>(std::max(slab_limit_ + 1, kMinObjectSize))));
+    max_order_ = Log2(block_size);
+    if (min_order_ > max_order_) min_order_ = max_order_;
+    buddy_free_.assign(max_order_ - min_order_ + 1, std::set<uintptr_t>());
+  }
+
+  __forceinline void updateHighWater() {
+    high_water_mark_ = std::max(high_water_mark_, in_use_size_ + cache_size_ + direct_size_);
+  }
+
+  __forceinline Block* findBlock(uintptr_t ptr) {
+    auto it = block_list_.upper_bound(ptr);
+    if (it == block_list_.begin()) return nullptr;
+    it--;
+    if (!it->second.contains(ptr)) return nullptr;
+    return &it->second;
+  }
+
+  // Returns a block of the default size, from the cache if possible.
+  Block& getBlock(BlockType type) {
+    uintptr_t base;
+    size_t size;
+    if (!block_cache_.empty()) {
+      const auto& block = block_cache_.back();
+      base = block.base_ptr_;
+      size = block.length_;
+      block_cache_.pop_back();
+      cache_size_ -= size;
+    } else {
+      void* ptr = block_allocator_.alloc(default_block_size(), size);
+      assert(ptr != nullptr && "Block allocation failed, Allocator is expected to throw.");
+      base = reinterpret_cast<uintptr_t>(ptr);
+    }
+    assert(size == default_block_size() && "Unexpected block size.");
+    in_use_size_ += size;
+    updateHighWater();
+    return block_list_.emplace(base, Block(base, size, type)).first->second;
+  }
+
+  // Block is fully free, move it to the cache or release it.
+  void releaseBlock(Block& block) {
+    CachedBlock cached(block.base_ptr_, block.length_);
+    bool discard = block.discard_;
+    in_use_size_ -= block.length_;
+    block_list_.erase(block.base_ptr_);
+
+    if (discard) {
+      block_allocator_.free(reinterpret_cast<void*>(cached.base_ptr_), cached.length_);
+    } else {
+      block_cache_.push_back(cached);
+      cache_size_ += cached.length_;
+    }
+    balance();
+  }
+
+  void* allocSlab(size_t bytes) {
+    const uint32_t cls = static_cast<uint32_t>(
+        std::lower_bound(slab_sizes_.begin(), slab_sizes_.end(), bytes) - slab_sizes_.begin());
+    const size_t obj_size = slab_sizes_[cls];
+    auto& partial = partial_slabs_[cls];
+
+    Block* block;
+    if (!partial.empty()) {
+      block = &block_list_.find(*partial.begin())->second;
+    } else {
+      block = &getBlock(kSlab);
+      block->size_class_ = cls;
+      const uint32_t count = static_cast<uint32_t>(block->length_ / obj_size);
+      // Push in reverse so objects are handed out in ascending address order.
+      block->free_objects_.reserve(count);
+      for (uint32_t i = count; i > 0; i--)
+        block->free_objects_.push_back(static_cast<uint32_t>((i - 1) * obj_size));
+      partial.insert(block->base_ptr_);
+    }
+
+    const uintptr_t ptr = block->base_ptr_ + block->free_objects_.back();
+    block->free_objects_.pop_back();
+    if (block->free_objects_.empty()) partial.erase(block->base_ptr_);
+    block->live_[ptr] = bytes;
+    requested_size_ += bytes;
+    return reinterpret_cast<void*>(ptr);
+  }
+
+  void freeSlab(Block& block, uintptr_t ptr) {
+    if (!block.discard_) {
+      if (block.free_objects_.empty()) partial_slabs_[block.size_class_].insert(block.base_ptr_);
+      block.free_objects_.push_back(static_cast<uint32_t>(ptr - block.base_ptr_));
+    }
+
+    if (block.live_.empty()) {
+      partial_slabs_[block.size_class_].erase(block.base_ptr_);
+      releaseBlock(block);
+    }
+  }
+
+  // Size of a buddy allocation, requests are rounded to the smallest chunk only.
+  __forceinline size_t buddySize(size_t bytes) const {
+    return AlignUp(bytes, size_t(1) << min_order_);
+  }
+
+  // Publish a free chunk, coalescing it with its free buddies.
+  void freeChunk(Block& block, uintptr_t ptr, uint32_t order) {
+    while (order < max_order_) {
+      const uintptr_t buddy = block.base_ptr_ + ((ptr - block.base_ptr_) ^ (size_t(1) << order));
+      auto& list = buddy_free_[order - min_order_];
+      auto it = list.find(buddy);
+      if (it == list.end()) break;
+      list.erase(it);
+      ptr = std::min(ptr, buddy);
+      order++;
+    }
+    buddy_free_[order - min_order_].insert(ptr);
+  }
+
+  void* allocBuddy(size_t bytes) {
+    const size_t size = buddySize(bytes);
+    const uint32_t order = Log2(NextPow2(static_cast<uint64_t>(size)));
+    assert(order <= max_order_ && "Buddy request exceeds block size.");
+
+    // Find the smallest free chunk that fits.
+    uint32_t found = order;
+    while ((found <= max_order_) && buddy_free_[found - min_order_].empty()) found++;
+
+    uintptr_t ptr;
+    if (found > max_order_) {
+      Block& block = getBlock(kBuddy);
+      ptr = block.base_ptr_;
+      found = max_order_;
+    } else {
+      auto& list = buddy_free_[found - min_order_];
+      ptr = *list.begin();
+      list.erase(list.begin());
+    }
+
+    // Split down to the requested order, publishing the upper halves.
+    while (found > order) {
+      found--;
+      buddy_free_[found - min_order_].insert(ptr + (size_t(1) << found));
+    }
+
+    // Return the tail of the chunk past the rounded request.  Each tail piece is naturally aligned
+    // and its buddy is at least partially in use, so no coalescing is possible here.
+    const size_t chunk = size_t(1) << order;
+    for (size_t offset = size; offset < chunk; offset += offset & (~offset + 1))
+      buddy_free_[Log2(offset & (~offset + 1)) - min_order_].insert(ptr + offset);
+
+    Block* block = findBlock(ptr);
+    assert(block != nullptr && block->type_ == kBuddy && "Inconsistency in SegregatedHeap.");
+    block->live_[ptr] = bytes;
+    requested_size_ += bytes;
+    return reinterpret_cast<void*>(ptr);
+  }
+
+  void freeBuddy(Block& block, uintptr_t ptr, size_t bytes) {
+    if (block.live_.empty()) {
+      // Remaining free chunks of the block are still published, drop them with the block.
+      if (!block.discard_) removeFreeChunks(block);
+      releaseBlock(block);
+      return;
+    }
+
+    // Don't publish free space from a discarded block.
+    if (block.discard_) return;
+
+    // The allocation is a run of naturally aligned chunks, largest first.  Free each of them.
+    size_t size = buddySize(bytes);
+    while (size != 0) {
+      const uint32_t order = Log2(size);
+      freeChunk(block, ptr, order);
+      ptr += size_t(1) << order;
+      size -= size_t(1) << order;
+    }
+  }
+
+  // Remove all free list records that point into block.
+  void removeFreeChunks(Block& block) {
+    for (auto& list : buddy_free_) {
+      auto it = list.lower_bound(block.base_ptr_);
+      while ((it != list.end()) && block.contains(*it)) it = list.erase(it);
+    }
+  }
+
+ public:
+  explicit SegregatedHeap(const Allocator& BlockAllocator = Allocator(),
+                          size_t SlabLimit = kDefaultSlabLimit)
+      : block_allocator_(BlockAllocator),
+        slab_limit_(SlabLimit),
+        in_use_size_(0),
+        requested_size_(0),
+        direct_size_(0),
+        cache_size_(0),
+        high_water_mark_(0) {
+    buildSizeClasses();
+  }
+  ~SegregatedHeap() {
+    trim();
+    // Leak here may be due to the user.  Check is for debugging only.
+    // assert(in_use_size_ == 0 && "Leak in SegregatedHeap.");
+  }
+
+  SegregatedHeap(const SegregatedHeap& rhs) = delete;
+  SegregatedHeap(SegregatedHeap&& rhs) = delete;
+  SegregatedHeap& operator=(const SegregatedHeap& rhs) = delete;
+  SegregatedHeap& operator=(SegregatedHeap&& rhs) = delete;
+
+  // Changes the block size and slab limit.  Only legal while the heap holds no memory.
+  bool configure(size_t block_size, size_t slab_limit) {
+    if (!block_list_.empty() || !block_cache_.empty()) return false;
+    if (!IsPowerOfTwo(block_size) || !IsMultipleOf(slab_limit, kMinObjectSize) ||
+        (slab_limit >= block_size))
+      return false;
+    block_allocator_.set_block_size(block_size);
+    slab_limit_ = slab_limit;
+    buildSizeClasses();
+    return true;
+  }
+
+  void* alloc(size_t bytes) {
+    bytes = std::max(bytes, kMinObjectSize);
+
+    if (bytes <= slab_limit_) return allocSlab(bytes);
+    if (bytes <= default_block_size()) return allocBuddy(bytes);
+
+    // Direct allocation - a private block that is released as soon as it is freed.
+    size_t size;
+    void* ptr = block_allocator_.alloc(bytes, size);
+    assert(ptr != nullptr && "Block allocation failed, Allocator is expected to throw.");
+    assert(size >= bytes && "Alloc exceeds block size.");
+    uintptr_t base = reinterpret_cast<uintptr_t>(ptr);
+    Block& block = block_list_.emplace(base, Block(base, size, kDirect)).first->second;
+    block.discard_ = true;
+    block.live_[base] = bytes;
+    direct_size_ += size;
+    updateHighWater();
+    return ptr;
+  }
+
+  bool free(void* ptr) {
+    if (ptr == nullptr) return true;
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(ptr);
+
+    // Find allocation and validate.
+    Block* block = findBlock(base);
+    if (block == nullptr) return false;
+    auto live = block->live_.find(base);
+    if (live == block->live_.end()) return false;
+    const size_t bytes = live->second;
+    block->live_.erase(live);
+
+    switch (block->type_) {
+      case kDirect: {
+        const size_t length = block->length_;
+        block_list_.erase(base);
+        direct_size_ -= length;
+        block_allocator_.free(ptr, length);
+        break;
+      }
+      case kSlab:
+        requested_size_ -= bytes;
+        freeSlab(*block, base);
+        break;
+      case kBuddy:
+        requested_size_ -= bytes;
+        freeBuddy(*block, base, bytes);
+        break;
+    }
+    return true;
+  }
+
+  void balance() {
+    // Release old blocks when over cache limit.
+    while ((block_cache_.size() > 1) && (cache_size_ > in_use_size_ * 2)) {
+      const auto& block = block_cache_.front();
+      block_allocator_.free(reinterpret_cast<void*>(block.base_ptr_), block.length_);
+      cache_size_ -= block.length_;
+      block_cache_.pop_front();
+    }
+  }
+
+  void trim() {
+    for (const auto& block : block_cache_)
+      block_allocator_.free(reinterpret_cast<void*>(block.base_ptr_), block.length_);
+    block_cache_.clear();
+    cache_size_ = 0;
+  }
+
+  size_t cache_size() const { return cache_size_; }
+
+  // Bytes held in partially used blocks which are not handed out, including rounding to the slab
+  // class or the smallest buddy chunk.
+  size_t fragmented_size() const { return in_use_size_ - requested_size_; }
+
+  size_t high_water_mark() const { return high_water_mark_; }
+
+  size_t default_block_size() const { return block_allocator_.block_size(); }
+
+  size_t slab_limit() const { return slab_limit_; }
+
+  // Prevent reuse of the block containing ptr.  No further objects will be allocated from the
+  // block and the block will not be added to the block cache when it is free.
+  bool discardBlock(void* ptr) {
+    if (ptr == nullptr) return true;
+
+    Block* block = findBlock(reinterpret_cast<uintptr_t>(ptr));
+    if (block == nullptr) return false;
+
+    // Is block already discarded?
+    if (block->discard_) return true;
+    block->discard_ = true;
+
+    // Unpublish the block's free space.
+    if (block->type_ == kSlab) {
+      partial_slabs_[block->size_class_].erase(block->base_ptr_);
+      block->free_objects_.clear();
+    } else {
+      removeFreeChunks(*block);
+    }
+    return true;
+  }
+};
+
+template <typename Allocator> constexpr size_t SegregatedHeap<Allocator>::kMinObjectSize;
+template <typename Allocator> constexpr size_t SegregatedHeap<Allocator>::kDefaultSlabLimit;
+
+}  // namespace rocr
+
+#endif  // HSA_RUNTME_CORE_UTIL_SEGREGATED_HEAP_H_
@@ -57,6 +57,8 @@
 #include <sstream>
 #include <thread>
 
+#include "core/util/logger.h"
+
 namespace rocr {
 extern FILE* log_file;
 extern uint8_t log_flags[8];
@@ -147,8 +149,12 @@ static __forceinline unsigned long long int strtoull(const char* str,
 
 #define LogPrint(flag, format, ...)                                                                \
   do {                                                                                             \
-    if (hsa_flag_isset64(log_flags, flag))                                                         \
-      rocr::log_printf(__FILENAME__, __LINE__, format, ##__VA_ARGS__);                             \
+    if (hsa_flag_isset64(log_flags, flag)) {                                                       \
+      if (!rocr::AsyncLogger::Active() ||                                                          \
+          !rocr::AsyncLogger::Log<rocr::LogStringArgs(format)>(__FILENAME__, __LINE__, format,     \
+                                                               ##__VA_ARGS__))                     \
+        rocr::log_printf(__FILENAME__, __LINE__, format, ##__VA_ARGS__);                           \
+    }                                                                                              \
   } while (false);
 
 
@@ -135,6 +135,13 @@ void uSleep(int delayInUs) { ::Sleep(delayInUs / 1000); }
 
 void YieldThread() { ::Sleep(0); }
 
+// No futex equivalent is used on Windows, waiters poll.
+void FutexWait(volatile uint32_t* address, uint32_t expected, uint64_t timeout_ns) {
+  if (*address == expected) YieldThread();
+}
+
+void FutexWake(volatile uint32_t* address) {}
+
 struct ThreadArgs {
   void* entry_args;
   ThreadEntry entry_function;
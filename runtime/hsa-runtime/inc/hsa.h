@@ -533,6 +533,23 @@ typedef enum {
    * implementation. The type of this attribute is uint16_t.
    */
   HSA_AMD_SYSTEM_INFO_EXT_VERSION_MINOR = 0x208,
+  /**
+   * Number of ::hsa_amd_memory_lock calls (and internal locks of pageable
+   * memory) served entirely by ranges which were already locked. The type of
+   * this attribute is uint64_t.
+   */
+  HSA_AMD_SYSTEM_INFO_LOCK_CACHE_HITS = 0x209,
+  /**
+   * Number of locks of host memory which had to register new ranges with the
+   * kernel driver. The type of this attribute is uint64_t.
+   */
+  HSA_AMD_SYSTEM_INFO_LOCK_CACHE_MISSES = 0x20A,
+  /**
+   * Number of bytes kept locked after their last ::hsa_amd_memory_unlock for
+   * reuse by later locks. Bounded by the HSA_LOCK_CACHE_SIZE environment
+   * variable. The type of this attribute is size_t.
+   */
+  HSA_AMD_SYSTEM_INFO_LOCK_CACHE_SIZE = 0x20B,
 } hsa_system_info_t;
 
 /**
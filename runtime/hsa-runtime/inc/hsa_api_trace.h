@@ -266,6 +266,7 @@ struct AmdExtTable {
   decltype(hsa_amd_queue_get_info)* hsa_amd_queue_get_info_fn;
   decltype(hsa_amd_vmem_address_reserve_align)* hsa_amd_vmem_address_reserve_align_fn;
   decltype(hsa_amd_enable_logging)* hsa_amd_enable_logging_fn;
+  decltype(hsa_amd_memory_async_copy_batch)* hsa_amd_memory_async_copy_batch_fn;
 };
 
 // Table to export HSA Core Runtime Apis
@@ -57,9 +57,12 @@
  * - 1.4 - Virtual Memory API
  * - 1.5 - hsa_amd_agent_info: HSA_AMD_AGENT_INFO_MEMORY_PROPERTIES
  * - 1.6 - Virtual Memory API: hsa_amd_vmem_address_reserve_align
+ * - 1.7 - hsa_amd_memory_pool_flag_t: NUMA placement flags
+ * - 1.8 - hsa_system_info_t: lock cache counters
+ * - 1.9 - hsa_amd_memory_async_copy_batch
  */
 #define HSA_AMD_INTERFACE_VERSION_MAJOR 1
-#define HSA_AMD_INTERFACE_VERSION_MINOR 6
+#define HSA_AMD_INTERFACE_VERSION_MINOR 9
 
 #ifdef __cplusplus
 extern "C" {
@@ -1038,6 +1041,16 @@ typedef enum {
    * another process is undefined.
    */
   HSA_AMD_SIGNAL_IPC = 2,
+  /**
+   * Signal will only be written from host code through HSA signal APIs.
+   * Blocking waits sleep on an OS primitive rather than a driver event and
+   * are woken directly by host writes.  Updating the signal from an agent,
+   * for instance by using it as a packet completion signal, is undefined.
+   * Host only signals may not be combined with HSA_AMD_SIGNAL_IPC or
+   * HSA_AMD_SIGNAL_AMD_GPU_ONLY, and can not be used with
+   * hsa_amd_signal_async_handler.
+   */
+  HSA_AMD_SIGNAL_HOST_ONLY = 4,
 } hsa_amd_signal_attribute_t;
 
 /**
@@ -1553,6 +1566,24 @@ typedef enum {
    * The size of this attribute is size_t.
    */
   HSA_AMD_MEMORY_POOL_INFO_RUNTIME_ALLOC_REC_GRANULE = 18,
+  /**
+   * Number of bytes held by the pool's internal sub-allocator in partially used
+   * blocks which are not currently allocated, including padding of allocations
+   * to the sub-allocator's size classes. Zero for pools which do not
+   * sub-allocate. The type of this attribute is size_t.
+   */
+  HSA_AMD_MEMORY_POOL_INFO_FRAGMENTATION = 19,
+  /**
+   * Number of bytes held by the pool's internal block cache. Cached blocks are
+   * reused by later allocations and released by ::hsa_amd_memory_pool_free
+   * rebalancing or device trimming. The type of this attribute is size_t.
+   */
+  HSA_AMD_MEMORY_POOL_INFO_CACHED_SIZE = 20,
+  /**
+   * Peak number of bytes held by the pool's internal sub-allocator, including
+   * cached blocks. The type of this attribute is size_t.
+   */
+  HSA_AMD_MEMORY_POOL_INFO_HIGH_WATER_MARK = 21,
 } hsa_amd_memory_pool_info_t;
 
 /**
@@ -1574,6 +1605,22 @@ typedef enum hsa_amd_memory_pool_flag_s {
    *  Allocates physically contiguous memory
    */
   HSA_AMD_MEMORY_POOL_CONTIGUOUS_FLAG = (1 << 1),
+  /**
+   * Interleaves the pages of a system memory allocation across all NUMA nodes
+   * the process may allocate from. At most one NUMA flag may be given. NUMA
+   * flags are ignored for device memory pools.
+   */
+  HSA_AMD_MEMORY_POOL_NUMA_INTERLEAVE_FLAG = (1 << 2),
+  /**
+   * Places a system memory allocation only on the NUMA node of the pool,
+   * failing rather than falling back to other nodes.
+   */
+  HSA_AMD_MEMORY_POOL_NUMA_BIND_FLAG = (1 << 3),
+  /**
+   * Leaves placement of a system memory allocation to the NUMA node of the
+   * CPU that first touches each page.
+   */
+  HSA_AMD_MEMORY_POOL_NUMA_LOCAL_FLAG = (1 << 4),
 
 } hsa_amd_memory_pool_flag_t;
 
@@ -1809,6 +1856,55 @@ hsa_status_t HSA_API
     hsa_amd_memory_copy_engine_status(hsa_agent_t dst_agent, hsa_agent_t src_agent,
                                       uint32_t *engine_ids_mask);
 
+/**
+ * @brief One copy of a batched asynchronous copy.
+ */
+typedef struct hsa_amd_copy_desc_s {
+  /**
+   * Destination buffer.
+   */
+  void* dst;
+  /**
+   * Source buffer.
+   */
+  const void* src;
+  /**
+   * Number of bytes to copy.
+   */
+  size_t size;
+} hsa_amd_copy_desc_t;
+
+/**
+ * @brief Asynchronously copy a batch of memory blocks between the same pair of
+ * agents.
+ *
+ * @details Every copy follows the rules of hsa_amd_memory_async_copy. All copies
+ * wait on the same dependent signals and @p completion_signal is decremented
+ * once, after every copy in the batch has finished. Where the copy engine
+ * supports it the batch is submitted behind a single set of dependency waits and
+ * a single completion, which makes this cheaper than issuing each copy on its
+ * own for large numbers of small copies.
+ *
+ * All param definitions are identical to hsa_amd_memory_async_copy with the
+ * exception of copies and count.
+ *
+ * @param[in] copies Array of copy descriptors. Copies of 0 bytes are skipped.
+ *
+ * @param[in] count Number of elements in @p copies.
+ *
+ * All return definitions are identical to hsa_amd_memory_async_copy with the
+ * following ammendments:
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p copies is NULL while @p count is
+ * not 0, or a copy has a NULL source or destination pointer.
+ */
+hsa_status_t HSA_API
+    hsa_amd_memory_async_copy_batch(const hsa_amd_copy_desc_t* copies, size_t count,
+                                    hsa_agent_t dst_agent, hsa_agent_t src_agent,
+                                    uint32_t num_dep_signals,
+                                    const hsa_signal_t* dep_signals,
+                                    hsa_signal_t completion_signal);
+
 /*
 [Provisional API]
 Pitched memory descriptor.
@@ -1837,7 +1933,8 @@ SDMA 3D memory copy API.  The same requirements must be met by src and dst as in
 hsa_amd_memory_async_copy.
 Both src and dst must be directly accessible to the copy_agent during the copy, src and dst rects
 must not overlap.
-CPU agents are not supported.  API requires SDMA and will return an error if SDMA is not available.
+CPU agents are not supported.  When SDMA is not available the copy is performed as a series of
+linear blit copies.
 Offsets and range carry x in bytes, y and z in rows and layers.
 */
 hsa_status_t HSA_API hsa_amd_memory_async_copy_rect(
@@ -49,7 +49,12 @@
 #include <sstream>
 #include <fstream>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include "core/util/utils.h"
+#include "core/util/os.h"
 #include "./amd_hsa_code_util.hpp"
 #include "core/inc/amd_core_dump.hpp"
 #include "hsakmt/hsakmt.h"
@@ -59,6 +64,8 @@ constexpr uint32_t LOAD_ALIGNMENT_SHIFT = 4;
 constexpr uint32_t NOTE_ALIGNMENT_SHIFT = 2;
 const std::string PREFIX_FILE_NAME = "gpucore";
 constexpr size_t MAX_BUFFER_SIZE = 4 * 1024 * 1024;
+constexpr size_t SPARSE_PAGE_SIZE = 4096;
+constexpr int ZSTD_COMPRESSION_LEVEL = 1;
 
 namespace rocr {
 namespace amd {
@@ -91,26 +98,7 @@ class PackageBuilder {
   std::stringstream st_;
 };
 
-enum SegmentType { LOAD, NOTE };
-struct SegmentBuilder;
-
-struct SegmentInfo {
-  SegmentType stype;
-  uint64_t vaddr = 0;
-  uint64_t size = 0;
-  uint32_t flags = 0;
-  SegmentBuilder* builder;
-};
-
-using SegmentsInfo = std::vector<SegmentInfo>;
 using rocr::amd::hsa::alignUp;
-struct SegmentBuilder {
-  virtual ~SegmentBuilder() = default;
-  /* Find which segments needs to be created.  */
-  virtual hsa_status_t Collect(SegmentsInfo& segments) = 0;
-  /* Called to read a given SegmentInfo's data.  */
-  virtual hsa_status_t Read(void* buf, size_t buf_size, off_t offset) = 0;
-};
 
 struct NoteSegmentBuilder : public SegmentBuilder {
   hsa_status_t Collect(SegmentsInfo& segments) override {
@@ -291,8 +279,284 @@ struct LoadSegmentBuilder : public SegmentBuilder {
   int fd_ = -1;
 };
 
-hsa_status_t build_core_dump(const std::string& filename, const SegmentsInfo& segments) {
-  std::unique_ptr<unsigned char[]> copy_buffer(new unsigned char[MAX_BUFFER_SIZE]);
+/* A piece of the output file.  Data comes from memory, a segment builder, or
+   is zero padding.  */
+struct Chunk {
+  const void* data;
+  SegmentBuilder* builder;
+  off_t src;
+  off_t dst;
+  size_t size;
+};
+
+/* libzstd is only loaded when compression is requested so the runtime does
+   not depend on it.  Every chunk becomes an independent frame, concatenated
+   frames form a valid zstd stream.  */
+class ZstdCompressor {
+ public:
+  ZstdCompressor() : lib_(os::LoadLib("libzstd.so.1")) {
+    if (lib_ == nullptr) return;
+    bound_ = reinterpret_cast<BoundFn>(os::GetExportAddress(lib_, "ZSTD_compressBound"));
+    compress_ = reinterpret_cast<CompressFn>(os::GetExportAddress(lib_, "ZSTD_compress"));
+    is_error_ = reinterpret_cast<IsErrorFn>(os::GetExportAddress(lib_, "ZSTD_isError"));
+  }
+  ~ZstdCompressor() {
+    if (lib_ != nullptr) os::CloseLib(lib_);
+  }
+
+  bool IsValid() const { return bound_ && compress_ && is_error_; }
+  size_t Bound(size_t size) const { return bound_(size); }
+  /* Returns the frame size, or 0 on failure.  */
+  size_t Compress(void* dst, size_t dst_size, const void* src, size_t src_size) const {
+    size_t ret = compress_(dst, dst_size, src, src_size, ZSTD_COMPRESSION_LEVEL);
+    return is_error_(ret) ? 0 : ret;
+  }
+
+ private:
+  typedef size_t (*BoundFn)(size_t);
+  typedef size_t (*CompressFn)(void*, size_t, const void*, size_t, int);
+  typedef unsigned (*IsErrorFn)(size_t);
+
+  os::LibHandle lib_;
+  BoundFn bound_ = nullptr;
+  CompressFn compress_ = nullptr;
+  IsErrorFn is_error_ = nullptr;
+};
+
+/* Core file destination, either a regular file or a pipe to a collector.  */
+class DumpOutput {
+ public:
+  ~DumpOutput() { Close(); }
+
+  hsa_status_t Open(const std::string& filename, const std::string& pipe_command) {
+    if (!pipe_command.empty()) {
+      pipe_ = popen(pipe_command.c_str(), "w");
+      if (pipe_ == nullptr) {
+        perror("Failed to start GPU coredump pipe");
+        return HSA_STATUS_ERROR;
+      }
+      fd_ = fileno(pipe_);
+      return HSA_STATUS_SUCCESS;
+    }
+    fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd_ == -1) {
+      perror("Failed to create GPU coredump");
+      return HSA_STATUS_ERROR;
+    }
+    return HSA_STATUS_SUCCESS;
+  }
+
+  bool Seekable() const { return pipe_ == nullptr; }
+
+  hsa_status_t Reserve(off_t size) {
+    int error = posix_fallocate(fd_, 0, size);
+    if (error != 0) {
+      fprintf(stderr, "Failed to allocate file: %s\n", strerror(error));
+      return HSA_STATUS_ERROR;
+    }
+    return HSA_STATUS_SUCCESS;
+  }
+
+  /* Positional write, seekable outputs only.  */
+  hsa_status_t WriteAt(const void* buf, size_t size, off_t offset) {
+    size_t done = 0;
+    while (done < size) {
+      ssize_t ret = pwrite(fd_, static_cast<const char*>(buf) + done, size - done, offset + done);
+      if (ret == -1) {
+        if (errno == EINTR) continue;
+        perror("Failed to write core dump");
+        return HSA_STATUS_ERROR;
+      }
+      done += ret;
+    }
+    return HSA_STATUS_SUCCESS;
+  }
+
+  /* Write leaving all-zero pages as holes.  Pages are taken at file offsets so
+     skipped pages line up with file system blocks.  */
+  hsa_status_t WriteSparse(const void* buf, size_t size, off_t offset) {
+    const uint8_t* data = static_cast<const uint8_t*>(buf);
+    auto page = [&](size_t pos) {
+      return std::min(SPARSE_PAGE_SIZE - (offset + pos) % SPARSE_PAGE_SIZE, size - pos);
+    };
+    size_t pos = 0;
+    while (pos < size) {
+      size_t start = pos;
+      while (pos < size && !IsZeroPage(data + pos, page(pos))) pos += page(pos);
+      if (pos != start) {
+        hsa_status_t st = WriteAt(data + start, pos - start, offset + start);
+        if (st != HSA_STATUS_SUCCESS) return st;
+      }
+      while (pos < size && IsZeroPage(data + pos, page(pos))) pos += page(pos);
+    }
+    return HSA_STATUS_SUCCESS;
+  }
+
+  /* Sequential write.  */
+  hsa_status_t Append(const void* buf, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+      ssize_t ret = write(fd_, static_cast<const char*>(buf) + done, size - done);
+      if (ret == -1) {
+        if (errno == EINTR) continue;
+        perror("Failed to write core dump");
+        return HSA_STATUS_ERROR;
+      }
+      done += ret;
+    }
+    return HSA_STATUS_SUCCESS;
+  }
+
+  /* Sets the final size so trailing holes are part of the file.  */
+  hsa_status_t Finish(off_t size) {
+    if (Seekable() && ftruncate(fd_, size) == -1) {
+      perror("Failed to size core dump");
+      return HSA_STATUS_ERROR;
+    }
+    return HSA_STATUS_SUCCESS;
+  }
+
+  void Close() {
+    if (pipe_ != nullptr) {
+      pclose(pipe_);
+    } else if (fd_ != -1) {
+      close(fd_);
+    }
+    pipe_ = nullptr;
+    fd_ = -1;
+  }
+
+ private:
+  static bool IsZeroPage(const uint8_t* data, size_t size) {
+    return data[0] == 0 && memcmp(data, data + 1, size - 1) == 0;
+  }
+
+  int fd_ = -1;
+  FILE* pipe_ = nullptr;
+};
+
+/* Reads chunks in parallel.  Seekable uncompressed output is written by each
+   worker at its chunk's offset.  Pipes and compressed output need the file in
+   order, so workers take turns writing once all earlier chunks are out.  */
+class DumpPipeline {
+ public:
+  DumpPipeline(const std::vector<Chunk>& chunks, DumpOutput& out, const DumpOptions& options,
+               const ZstdCompressor* compressor)
+      : chunks_(chunks),
+        out_(out),
+        sparse_(options.sparse && out.Seekable() && compressor == nullptr),
+        ordered_(!out.Seekable() || compressor != nullptr),
+        compressor_(compressor),
+        threads_(std::max(options.threads, 1u)) {}
+
+  hsa_status_t Run() {
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < threads_; i++) {
+      try {
+        workers.emplace_back(&DumpPipeline::Worker, this);
+      } catch (...) {
+        break;
+      }
+    }
+    Worker();
+    for (auto& t : workers) t.join();
+    return failed_ ? HSA_STATUS_ERROR : HSA_STATUS_SUCCESS;
+  }
+
+ private:
+  void Worker() {
+    std::unique_ptr<uint8_t[]> buffer;
+    std::unique_ptr<uint8_t[]> packed;
+    size_t packed_size = 0;
+    try {
+      buffer.reset(new uint8_t[MAX_BUFFER_SIZE]);
+      if (compressor_) {
+        packed_size = compressor_->Bound(MAX_BUFFER_SIZE);
+        packed.reset(new uint8_t[packed_size]);
+      }
+    } catch (...) {
+      Fail();
+      return;
+    }
+
+    while (!failed_) {
+      size_t idx = next_chunk_++;
+      if (idx >= chunks_.size()) return;
+      const Chunk& chunk = chunks_[idx];
+
+      const void* data = chunk.data;
+      if (data == nullptr) {
+        if (chunk.builder != nullptr) {
+          hsa_status_t st;
+          try {
+            st = chunk.builder->Read(buffer.get(), chunk.size, chunk.src);
+          } catch (...) {
+            st = HSA_STATUS_ERROR;
+          }
+          if (st != HSA_STATUS_SUCCESS) {
+            Fail();
+            return;
+          }
+        } else {
+          memset(buffer.get(), 0, chunk.size);
+        }
+        data = buffer.get();
+      }
+
+      size_t size = chunk.size;
+      if (compressor_) {
+        size = compressor_->Compress(packed.get(), packed_size, data, chunk.size);
+        if (size == 0) {
+          fprintf(stderr, "Failed to compress core dump.\n");
+          Fail();
+          return;
+        }
+        data = packed.get();
+      }
+
+      hsa_status_t st;
+      if (ordered_) {
+        std::unique_lock<std::mutex> lock(lock_);
+        turn_.wait(lock, [&]() { return failed_ || written_ == idx; });
+        if (failed_) return;
+        lock.unlock();
+        st = out_.Append(data, size);
+        lock.lock();
+        written_++;
+        turn_.notify_all();
+      } else {
+        st = sparse_ ? out_.WriteSparse(data, size, chunk.dst)
+                     : out_.WriteAt(data, size, chunk.dst);
+      }
+      if (st != HSA_STATUS_SUCCESS) {
+        Fail();
+        return;
+      }
+    }
+  }
+
+  void Fail() {
+    std::lock_guard<std::mutex> lock(lock_);
+    failed_ = true;
+    turn_.notify_all();
+  }
+
+  const std::vector<Chunk>& chunks_;
+  DumpOutput& out_;
+  const bool sparse_;
+  const bool ordered_;
+  const ZstdCompressor* compressor_;
+  const uint32_t threads_;
+
+  std::atomic<size_t> next_chunk_{0};
+  std::atomic<bool> failed_{false};
+  std::mutex lock_;
+  std::condition_variable turn_;
+  size_t written_ = 0;
+};
+
+hsa_status_t build_core_dump(const std::string& filename, const SegmentsInfo& segments,
+                             const DumpOptions& options) {
   struct rlimit rlimit;
 
   if (getrlimit(RLIMIT_CORE, &rlimit)) {
@@ -307,50 +571,11 @@ hsa_status_t build_core_dump(const std::string& filename, const SegmentsInfo& se
     debug_print("Core file size over limit\n");
     return HSA_STATUS_SUCCESS;
   }
-  int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
-  if (fd == -1) {
-    perror("Failed to create GPU coredump");
-    return HSA_STATUS_ERROR;
-  }
-  Elf64_Ehdr ehdr{};
-  ehdr.e_ident[EI_MAG0] = ELFMAG0;
-  ehdr.e_ident[EI_MAG1] = ELFMAG1;
-  ehdr.e_ident[EI_MAG2] = ELFMAG2;
-  ehdr.e_ident[EI_MAG3] = ELFMAG3;
-  ehdr.e_ident[EI_CLASS] = ELFCLASS64;
-  ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
-  ehdr.e_ident[EI_VERSION] = EV_CURRENT;
-  ehdr.e_ident[EI_OSABI] = ELF::ELFOSABI_AMDGPU_HSA;
-  ehdr.e_ident[EI_ABIVERSION] = 0;
-  ehdr.e_type = ET_CORE;
-  ehdr.e_machine = ELF::EM_AMDGPU;
-  ehdr.e_version = EV_CURRENT;
-  ehdr.e_entry = 0;
-  ehdr.e_phoff = sizeof(Elf64_Ehdr);
-  ehdr.e_shoff = 0;
-  ehdr.e_flags = 0;
-  ehdr.e_ehsize = sizeof(Elf64_Ehdr);
-  ehdr.e_phentsize = sizeof(Elf64_Phdr);
-  ehdr.e_phnum = segments.size();
-  ehdr.e_shentsize = 0;
-  ehdr.e_shnum = 0;
-  ehdr.e_shstrndx = 0;
 
-  if (write(fd, &ehdr, sizeof(ehdr)) == -1) {
-    perror("Failed to write ELF header");
-    close(fd);
-    return HSA_STATUS_ERROR;
-  }
-
-  /* Make sure that the underlying file has enough space for the file headers. */
-  int error = posix_fallocate(fd, sizeof(Elf64_Ehdr), segments.size() * sizeof(Elf64_Phdr));
-  if (error != 0) {
-    fprintf(stderr, "Failed to allocate file: %s\n", strerror(error));
-    close(fd);
-    return HSA_STATUS_ERROR;
-  }
-  size_t idx = 0;
-  for (SegmentInfo seg : segments) {
+  /* Lay out the file.  Segments that would exceed the core limit are dropped.  */
+  std::vector<Elf64_Phdr> phdrs;
+  bool truncated = false;
+  for (const SegmentInfo& seg : segments) {
     Elf64_Phdr phdr{};
     phdr.p_type = [](SegmentType s) {
       switch (s) {
@@ -380,56 +605,99 @@ hsa_status_t build_core_dump(const std::string& filename, const SegmentsInfo& se
       }
     }(seg.stype);
     if (rlimit.rlim_cur != -1 && (offset + seg.size > rlimit.rlim_cur)) {
-      printf("Core limit file reached. GPU core dump created: %s\n", filename.c_str());
-      close(fd);
-      return HSA_STATUS_SUCCESS;
+      truncated = true;
+      break;
     }
     phdr.p_offset = alignUp(offset, (uint64_t)1 << phdr.p_align);
-    if (pwrite(fd, &phdr, sizeof(phdr), sizeof(Elf64_Ehdr) + idx * sizeof(Elf64_Phdr)) == -1) {
-      perror("Failed to write ELF header");
-      close(fd);
-      return HSA_STATUS_ERROR;
-    }
-    /* Allocate stace for the segment on the file, and write the segment
-       content.  */
-    error = posix_fallocate(fd, phdr.p_offset, phdr.p_filesz);
-    if (error != 0) {
-      fprintf(stderr, "Failed to allocate file: %s\n", strerror(error));
-      close(fd);
-      return HSA_STATUS_ERROR;
+    phdrs.push_back(phdr);
+    offset = phdr.p_offset + phdr.p_filesz;
+  }
+  const off_t file_size = offset;
+
+  std::vector<uint8_t> headers(sizeof(Elf64_Ehdr) + segments.size() * sizeof(Elf64_Phdr), 0);
+  Elf64_Ehdr ehdr{};
+  ehdr.e_ident[EI_MAG0] = ELFMAG0;
+  ehdr.e_ident[EI_MAG1] = ELFMAG1;
+  ehdr.e_ident[EI_MAG2] = ELFMAG2;
+  ehdr.e_ident[EI_MAG3] = ELFMAG3;
+  ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+  ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+  ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+  ehdr.e_ident[EI_OSABI] = ELF::ELFOSABI_AMDGPU_HSA;
+  ehdr.e_ident[EI_ABIVERSION] = 0;
+  ehdr.e_type = ET_CORE;
+  ehdr.e_machine = ELF::EM_AMDGPU;
+  ehdr.e_version = EV_CURRENT;
+  ehdr.e_entry = 0;
+  ehdr.e_phoff = sizeof(Elf64_Ehdr);
+  ehdr.e_shoff = 0;
+  ehdr.e_flags = 0;
+  ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+  ehdr.e_phentsize = sizeof(Elf64_Phdr);
+  ehdr.e_phnum = phdrs.size();
+  ehdr.e_shentsize = 0;
+  ehdr.e_shnum = 0;
+  ehdr.e_shstrndx = 0;
+  memcpy(headers.data(), &ehdr, sizeof(ehdr));
+  if (!phdrs.empty())
+    memcpy(&headers[sizeof(Elf64_Ehdr)], phdrs.data(), phdrs.size() * sizeof(Elf64_Phdr));
+
+  std::unique_ptr<ZstdCompressor> compressor;
+  if (options.compress) {
+    compressor.reset(new ZstdCompressor());
+    if (!compressor->IsValid()) {
+      fprintf(stderr, "zstd is not available, GPU core dump not compressed.\n");
+      compressor.reset();
     }
-    size_t remaining = phdr.p_filesz;
-    while (remaining > 0) {
-      size_t curr_chunk = std::min(remaining, MAX_BUFFER_SIZE);
-      try {
-        hsa_status_t st = seg.builder->Read(copy_buffer.get(), curr_chunk,
-                                                    phdr.p_vaddr + phdr.p_filesz - remaining);
-        if (st != HSA_STATUS_SUCCESS) {
-          close(fd);
-          return st;
-        }
-        if (pwrite(fd, copy_buffer.get(), curr_chunk, phdr.p_offset + phdr.p_filesz - remaining) ==
-            -1) {
-          perror("Failed to white core dump");
-          close(fd);
-          return HSA_STATUS_ERROR;
-        }
-      } catch (...) {
-        close(fd);
-        return HSA_STATUS_ERROR;
-      }
-      remaining -= curr_chunk;
+  }
+
+  /* Only name the file as zstd when it really is compressed.  */
+  const std::string path = compressor ? filename + ".zst" : filename;
+
+  DumpOutput out;
+  hsa_status_t status = out.Open(path, options.pipe_command);
+  if (status != HSA_STATUS_SUCCESS) return status;
+  const bool ordered = !out.Seekable() || compressor;
+
+  /* Split the file in chunks of at most MAX_BUFFER_SIZE.  Ordered output needs
+     the alignment padding between segments spelled out.  */
+  std::vector<Chunk> chunks;
+  chunks.push_back({headers.data(), nullptr, 0, 0, headers.size()});
+  off_t end = headers.size();
+  for (size_t i = 0; i < phdrs.size(); i++) {
+    const Elf64_Phdr& phdr = phdrs[i];
+    if (ordered && (off_t)phdr.p_offset > end)
+      chunks.push_back({nullptr, nullptr, 0, end, size_t(phdr.p_offset - end)});
+    for (uint64_t done = 0; done < phdr.p_filesz; done += MAX_BUFFER_SIZE) {
+      size_t size = std::min(phdr.p_filesz - done, (uint64_t)MAX_BUFFER_SIZE);
+      chunks.push_back({nullptr, segments[i].builder, off_t(phdr.p_vaddr + done),
+                        off_t(phdr.p_offset + done), size});
     }
-    offset += phdr.p_filesz;
-    idx++;
+    end = phdr.p_offset + phdr.p_filesz;
   }
-  printf("GPU core dump created: %s\n", filename.c_str());
-  close(fd);
+
+  /* Without holes, make sure the file system has space for the whole dump.  */
+  if (out.Seekable() && !compressor && !options.sparse) {
+    status = out.Reserve(file_size);
+    if (status != HSA_STATUS_SUCCESS) return status;
+  }
+
+  DumpPipeline pipeline(chunks, out, options, compressor.get());
+  status = pipeline.Run();
+  if (status == HSA_STATUS_SUCCESS && !compressor) status = out.Finish(file_size);
+  out.Close();
+  if (status != HSA_STATUS_SUCCESS) return status;
+
+  const std::string& name = options.pipe_command.empty() ? path : options.pipe_command;
+  if (truncated)
+    printf("Core limit file reached. GPU core dump created: %s\n", name.c_str());
+  else
+    printf("GPU core dump created: %s\n", name.c_str());
   return HSA_STATUS_SUCCESS;
 }
 }   //  namespace impl
 
-hsa_status_t dump_gpu_core() {
+hsa_status_t dump_gpu_core(const DumpOptions& options) {
   impl::NoteSegmentBuilder nbuilder;
   impl::LoadSegmentBuilder lbuilder;
   impl::SegmentsInfo segments;
@@ -442,7 +710,7 @@ hsa_status_t dump_gpu_core() {
 
   std::stringstream st;
   st << PREFIX_FILE_NAME << "." << getpid();
-  return build_core_dump(st.str(), segments);
+  return build_core_dump(st.str(), segments, options);
 }
 }   //  namespace coredump
 }   //  namespace amd
@@ -87,6 +87,10 @@
 #define _lseek lseek
 #define _ftruncate ftruncate
 #include <sys/sendfile.h>
+#include <sys/syscall.h>
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
 #else
 #define _ftruncate _chsize
 #endif // !_WIN32
@@ -128,6 +132,7 @@ namespace elf {
       bool error(const char* msg);
       bool perror(const char *msg);
       std::string werror();
+      bool readAll(void* buffer, size_t size);
     };
 
     FileImage::FileImage()
@@ -175,6 +180,12 @@ namespace elf {
 
     bool FileImage::create()
     {
+#if defined(HAVE_MEMFD_CREATE) && !defined(USE_MEMFILE)
+      // Keep images in anonymous memory, libelf only needs a descriptor.  Temporary files
+      // are the fallback for kernels without memfd.
+      d = syscall(__NR_memfd_create, "amdelf", MFD_CLOEXEC);
+      if (d != -1) { return true; }
+#endif
       d = OpenTemp("amdelf");
       if (d == -1) { return error("Failed to open temporary file for elf image"); }
       return true;
@@ -238,10 +249,11 @@ namespace elf {
       assert(d != -1);
       if (_lseek(d, 0L, SEEK_SET) < 0) { return perror("lseek failed"); }
       if (_ftruncate(d, 0) < 0) { return perror("ftruncate failed"); }
-      int written, offset = 0;
+      size_t offset = 0;
       while (size > 0) {
-        written = _write(d, (const char*) data + offset, size);
+        auto written = _write(d, (const char*) data + offset, size);
         if (written < 0) {
+          if (errno == EINTR) { continue; }
           return perror("write failed");
         }
         size -= written;
@@ -261,11 +273,27 @@ namespace elf {
       return seek;
     }
 
+    bool FileImage::readAll(void* buffer, size_t size)
+    {
+      size_t offset = 0;
+      while (offset < size) {
+        auto count = _read(d, (char*) buffer + offset, size - offset);
+        if (count < 0) {
+          if (errno == EINTR) { continue; }
+          return perror("read failed");
+        }
+        if (count == 0) { return error("Unexpected end of image"); }
+        offset += count;
+      }
+      return true;
+    }
+
     bool FileImage::copyTo(void** buffer, size_t* size)
     {
       size_t size1 = getSize();
       void* buffer1 = malloc(size1);
-      if (_read(d, buffer1, size1) < 0) { free(buffer1); return perror("read failed"); }
+      if (!buffer1) { return error("Failed to allocate image buffer"); }
+      if (!readAll(buffer1, size1)) { free(buffer1); return false; }
       *buffer = buffer1;
       if (size) { *size = size1; }
       return true;
@@ -275,12 +303,28 @@ namespace elf {
     {
       size_t size1 = getSize();
       if (size < size1) { return error("Buffer size is not enough"); }
-      if (_read(d, buffer, size1) < 0) { return perror("read failed"); }
-      return true;
+      return readAll(buffer, size1);
     }
 
     bool FileImage::writeTo(const std::string& filename)
     {
+#if !defined(_WIN32) && !defined(USE_MEMFILE)
+      // Copy in kernel, the image is never staged in a user buffer.
+      size_t size = getSize();
+      int outfd = _open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (outfd < 0) { return perror("open failed"); }
+      while (size > 0) {
+        ssize_t written = sendfile(outfd, d, NULL, size);
+        if (written < 0 && errno == EINTR) { continue; }
+        if (written <= 0) {
+          _close(outfd);
+          return perror("sendfile failed");
+        }
+        size -= written;
+      }
+      if (_lseek(d, 0L, SEEK_SET) < 0) { _close(outfd); return perror("lseek failed"); }
+      return _close(outfd) == 0 || perror("close failed");
+#else
       bool res = false;
       size_t size = 0;
       void *buffer = nullptr;
@@ -291,6 +335,7 @@ namespace elf {
       }
       free(buffer);
       return res;
+#endif
     }
 
     class Buffer {